@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Benchmark.hpp"
+
+// Nearest-rank percentile of an already sorted list
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+	size_t Rank = (size_t)(p * sorted.size() + 0.999999);
+	if (Rank < 1) {
+		Rank = 1;
+	}
+	if (Rank > sorted.size()) {
+		Rank = sorted.size();
+	}
+	return sorted[Rank - 1];
+}
+
+FrameTimeStats ComputeFrameTimeStats(std::vector<double> frameTimesMs)
+{
+	FrameTimeStats Stats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (frameTimesMs.empty()) {
+		return Stats;
+	}
+
+	std::sort(frameTimesMs.begin(), frameTimesMs.end());
+
+	double Sum = 0.0;
+	for (size_t i = 0; i < frameTimesMs.size(); i++) {
+		Sum += frameTimesMs[i];
+	}
+
+	Stats.Frames = (int)frameTimesMs.size();
+	Stats.MinMs = frameTimesMs.front();
+	Stats.MedianMs = Percentile(frameTimesMs, 0.5);
+	Stats.P99Ms = Percentile(frameTimesMs, 0.99);
+	Stats.MaxMs = frameTimesMs.back();
+	Stats.MeanMs = Sum / frameTimesMs.size();
+
+	std::vector<double> Deviations(frameTimesMs.size());
+	for (size_t i = 0; i < frameTimesMs.size(); i++) {
+		Deviations[i] = frameTimesMs[i] > Stats.MedianMs ? frameTimesMs[i] - Stats.MedianMs : Stats.MedianMs - frameTimesMs[i];
+	}
+	std::sort(Deviations.begin(), Deviations.end());
+	Stats.MadMs = Percentile(Deviations, 0.5);
+	return Stats;
+}
+
+static FILE* OpenBenchmarkOutput(const char* path)
+{
+	if (path == NULL) {
+		return stdout;
+	}
+	FILE* Out = fopen(path, "w");
+	if (Out == NULL) {
+		fprintf(stderr, "Impossible to open %s to write the benchmark results\n", path);
+	}
+	return Out;
+}
+
+// The frame_time_ms object (or any other name), indented by indent spaces
+static void WriteTimeStats(FILE* out, const char* name, const FrameTimeStats& stats, int indent, bool last)
+{
+	fprintf(out, "%*s\"%s\": {\n", indent, "", name);
+	fprintf(out, "%*s  \"min\": %.4f,\n", indent, "", stats.MinMs);
+	fprintf(out, "%*s  \"median\": %.4f,\n", indent, "", stats.MedianMs);
+	fprintf(out, "%*s  \"p99\": %.4f,\n", indent, "", stats.P99Ms);
+	fprintf(out, "%*s  \"max\": %.4f,\n", indent, "", stats.MaxMs);
+	fprintf(out, "%*s  \"mean\": %.4f,\n", indent, "", stats.MeanMs);
+	fprintf(out, "%*s  \"mad\": %.4f\n", indent, "", stats.MadMs);
+	fprintf(out, "%*s}%s\n", indent, "", last ? "" : ",");
+}
+
+bool WriteBenchmarkJson(const char* path, const BenchmarkReport& report)
+{
+	FILE* Out = OpenBenchmarkOutput(path);
+	if (Out == NULL) {
+		return false;
+	}
+
+	fprintf(Out, "{\n");
+	fprintf(Out, "  \"scene\": \"%s\",\n", report.Scene.c_str());
+	fprintf(Out, "  \"width\": %d,\n", report.Width);
+	fprintf(Out, "  \"height\": %d,\n", report.Height);
+	fprintf(Out, "  \"frames\": %d,\n", report.FrameTimes.Frames);
+	WriteTimeStats(Out, "frame_time_ms", report.FrameTimes, 2, false);
+	fprintf(Out, "  \"fps\": %.2f%s\n", report.FrameTimes.MeanMs > 0.0 ? 1000.0 / report.FrameTimes.MeanMs : 0.0, report.Counters.empty() ? "" : ",");
+	if (!report.Counters.empty()) {
+		fprintf(Out, "  \"counters\": {\n");
+		for (size_t i = 0; i < report.Counters.size(); i++) {
+			fprintf(Out, "    \"%s\": %.6g%s\n", report.Counters[i].first.c_str(), report.Counters[i].second, i + 1 < report.Counters.size() ? "," : "");
+		}
+		fprintf(Out, "  }\n");
+	}
+	fprintf(Out, "}\n");
+
+	if (Out != stdout) {
+		fclose(Out);
+	}
+	return true;
+}
+
+bool WriteBenchmarkCasesJson(const char* path, const char* renderer, const std::vector<BenchmarkCase>& cases)
+{
+	FILE* Out = OpenBenchmarkOutput(path);
+	if (Out == NULL) {
+		return false;
+	}
+
+	fprintf(Out, "{\n");
+	fprintf(Out, "  \"renderer\": \"%s\",\n", renderer);
+	fprintf(Out, "  \"cases\": [\n");
+	for (size_t i = 0; i < cases.size(); i++) {
+		fprintf(Out, "    {\n");
+		fprintf(Out, "      \"name\": \"%s\",\n", cases[i].Name.c_str());
+		fprintf(Out, "      \"samples\": %d,\n", cases[i].Times.Frames);
+		WriteTimeStats(Out, "time_ms", cases[i].Times, 6, true);
+		fprintf(Out, "    }%s\n", i + 1 < cases.size() ? "," : "");
+	}
+	fprintf(Out, "  ]\n");
+	fprintf(Out, "}\n");
+
+	if (Out != stdout) {
+		fclose(Out);
+	}
+	return true;
+}
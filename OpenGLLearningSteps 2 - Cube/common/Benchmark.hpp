@@ -0,0 +1,44 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <string>
+#include <vector>
+
+// Summary of the frame times (in milliseconds) recorded during a benchmark run
+struct FrameTimeStats
+{
+	int Frames;
+	double MinMs;
+	double MedianMs;
+	double P99Ms;
+	double MaxMs;
+	double MeanMs;
+	double MadMs;		// Median absolute deviation: how far a typical frame is from the median, a spread outliers don't blow up
+};
+
+// Everything a benchmark run reports. Counters are extra named numbers (instance count, draw calls...)
+// that end up next to the frame times in the JSON, so new measurements don't need a new format.
+struct BenchmarkReport
+{
+	std::string Scene;
+	int Width;
+	int Height;
+	FrameTimeStats FrameTimes;
+	std::vector<std::pair<std::string, double> > Counters;
+};
+
+// One timed operation of a microbenchmark suite (--bench-hot-paths): the time of each sample
+struct BenchmarkCase
+{
+	std::string Name;
+	FrameTimeStats Times;
+};
+
+FrameTimeStats ComputeFrameTimeStats(std::vector<double> frameTimesMs);
+
+// Writes the report as a JSON object to the given file, or to stdout when path is NULL
+bool WriteBenchmarkJson(const char* path, const BenchmarkReport& report);
+// Same for a suite: what it ran on, then every case (tools/BenchmarkSuite.py compares them with a baseline)
+bool WriteBenchmarkCasesJson(const char* path, const char* renderer, const std::vector<BenchmarkCase>& cases);
+
+#endif
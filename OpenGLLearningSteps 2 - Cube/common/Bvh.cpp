@@ -0,0 +1,637 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BVH_X86 1
+#include <emmintrin.h>
+#endif
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bvh.hpp"
+#include "GpuCulling.hpp"
+
+static_assert(sizeof(BvhNode) == 32, "two BVH nodes per cache line");
+
+// SAH costs, relative to testing one object
+static const float TraversalCost = 1.0f;
+static const float ObjectCost = 1.0f;
+
+static void ResetBox(float boundsMin[3], float boundsMax[3])
+{
+	for (int Axis = 0; Axis < 3; Axis++) {
+		boundsMin[Axis] = HUGE_VALF;
+		boundsMax[Axis] = -HUGE_VALF;
+	}
+}
+
+static void GrowBox(float boundsMin[3], float boundsMax[3], const float* otherMin, const float* otherMax)
+{
+	for (int Axis = 0; Axis < 3; Axis++) {
+		boundsMin[Axis] = std::min(boundsMin[Axis], otherMin[Axis]);
+		boundsMax[Axis] = std::max(boundsMax[Axis], otherMax[Axis]);
+	}
+}
+
+// Half the surface area, the factor doesn't matter for SAH
+static float HalfArea(const float boundsMin[3], const float boundsMax[3])
+{
+	float x = std::max(0.0f, boundsMax[0] - boundsMin[0]);
+	float y = std::max(0.0f, boundsMax[1] - boundsMin[1]);
+	float z = std::max(0.0f, boundsMax[2] - boundsMin[2]);
+	return x * y + y * z + z * x;
+}
+
+static void ComputeLeafBounds(Bvh& bvh, BvhNode& node)
+{
+	ResetBox(node.BoundsMin, node.BoundsMax);
+	const float* Bounds = &bvh.ObjectBounds[node.LeftOrFirst * 6];
+	for (uint32_t i = 0; i < node.Count; i++) {
+		GrowBox(node.BoundsMin, node.BoundsMax, Bounds + i * 6, Bounds + i * 6 + 3);
+	}
+}
+
+// Returns false when the box didn't change, nothing above it needs to be refit then
+static bool FitToChildren(Bvh& bvh, BvhNode& node)
+{
+	const BvhNode& Left = bvh.Nodes[node.LeftOrFirst];
+	const BvhNode& Right = bvh.Nodes[node.LeftOrFirst + 1];
+	bool Changed = false;
+	for (int Axis = 0; Axis < 3; Axis++) {
+		float Min = std::min(Left.BoundsMin[Axis], Right.BoundsMin[Axis]);
+		float Max = std::max(Left.BoundsMax[Axis], Right.BoundsMax[Axis]);
+		Changed = Changed || Min != node.BoundsMin[Axis] || Max != node.BoundsMax[Axis];
+		node.BoundsMin[Axis] = Min;
+		node.BoundsMax[Axis] = Max;
+	}
+	return Changed;
+}
+
+// What the build moves around: a copy of each object's box with its centroid, so partitioning a node
+// reads and writes one contiguous range instead of jumping around the object arrays
+struct BuildObject
+{
+	float BoundsMin[3];
+	float BoundsMax[3];
+	float Centroid[3];
+	uint32_t Object;
+};
+
+struct BvhBin
+{
+	float BoundsMin[3];
+	float BoundsMax[3];
+	uint32_t Count;
+};
+
+static int BinOf(float centroid, float centroidMin, float binScale)
+{
+	int Bin = (int)((centroid - centroidMin) * binScale);
+	return Bin < 0 ? 0 : Bin >= BVH_BINS ? BVH_BINS - 1 : Bin;
+}
+
+// Bins the objects of a node on the 3 axes in one pass, then finds the cheapest of the BVH_BINS - 1 planes
+// between bins. Returns false if no split beats keeping the node as a leaf.
+static bool FindSplit(const BuildObject* objects, const BvhNode& node, const float centroidMin[3], const float binScale[3],
+	BvhBin bins[3][BVH_BINS], int& bestAxis, int& bestSplit)
+{
+	for (int Axis = 0; Axis < 3; Axis++) {
+		for (int b = 0; b < BVH_BINS; b++) {
+			ResetBox(bins[Axis][b].BoundsMin, bins[Axis][b].BoundsMax);
+			bins[Axis][b].Count = 0;
+		}
+	}
+	for (uint32_t i = 0; i < node.Count; i++) {
+		const BuildObject& Object = objects[i];
+		for (int Axis = 0; Axis < 3; Axis++) {
+			BvhBin& Bin = bins[Axis][BinOf(Object.Centroid[Axis], centroidMin[Axis], binScale[Axis])];
+			GrowBox(Bin.BoundsMin, Bin.BoundsMax, Object.BoundsMin, Object.BoundsMax);
+			Bin.Count++;
+		}
+	}
+
+	float BestCost = HUGE_VALF;
+	for (int Axis = 0; Axis < 3; Axis++) {
+		// Sweep from both ends: area and count of everything left (right) of each plane
+		float LeftArea[BVH_BINS - 1], RightArea[BVH_BINS - 1];
+		uint32_t LeftCount[BVH_BINS - 1], RightCount[BVH_BINS - 1];
+		float LeftMin[3], LeftMax[3], RightMin[3], RightMax[3];
+		ResetBox(LeftMin, LeftMax);
+		ResetBox(RightMin, RightMax);
+		uint32_t LeftSum = 0, RightSum = 0;
+		for (int b = 0; b < BVH_BINS - 1; b++) {
+			const BvhBin& Left = bins[Axis][b];
+			LeftSum += Left.Count;
+			GrowBox(LeftMin, LeftMax, Left.BoundsMin, Left.BoundsMax);
+			LeftCount[b] = LeftSum;
+			LeftArea[b] = HalfArea(LeftMin, LeftMax);
+
+			const BvhBin& Right = bins[Axis][BVH_BINS - 1 - b];
+			RightSum += Right.Count;
+			GrowBox(RightMin, RightMax, Right.BoundsMin, Right.BoundsMax);
+			RightCount[BVH_BINS - 2 - b] = RightSum;
+			RightArea[BVH_BINS - 2 - b] = HalfArea(RightMin, RightMax);
+		}
+
+		// A flat axis puts everything in bin 0, which leaves no plane with objects on both sides
+		for (int Split = 0; Split < BVH_BINS - 1; Split++) {
+			if (LeftCount[Split] == 0 || RightCount[Split] == 0) {
+				continue;
+			}
+			float Cost = LeftCount[Split] * LeftArea[Split] + RightCount[Split] * RightArea[Split];
+			if (Cost < BestCost) {
+				BestCost = Cost;
+				bestAxis = Axis;
+				bestSplit = Split;
+			}
+		}
+	}
+
+	if (BestCost == HUGE_VALF) {
+		return false;
+	}
+	float ParentArea = HalfArea(node.BoundsMin, node.BoundsMax);
+	float SplitCost = TraversalCost + ObjectCost * BestCost / (ParentArea > 0.0f ? ParentArea : 1.0f);
+	float LeafCost = ObjectCost * node.Count;
+	return SplitCost < LeafCost || node.Count > BVH_MAX_LEAF_OBJECTS;
+}
+
+void BuildBvh(Bvh& bvh, const float* bounds, size_t count)
+{
+	bvh.Nodes.clear();
+	bvh.Parents.clear();
+	bvh.DirtyLeaves.clear();
+	bvh.ObjectIndices.resize(count);
+	bvh.ObjectBounds.resize(count * 6);
+	bvh.ObjectSlots.resize(count);
+	bvh.ObjectLeaves.resize(count);
+	if (count == 0) {
+		bvh.NodeDirty.clear();
+		return;
+	}
+
+	std::vector<BuildObject> Objects(count);
+	BvhNode Root;
+	ResetBox(Root.BoundsMin, Root.BoundsMax);
+	Root.LeftOrFirst = 0;
+	Root.Count = (uint32_t)count;
+	for (size_t i = 0; i < count; i++) {
+		BuildObject& Object = Objects[i];
+		for (int Axis = 0; Axis < 3; Axis++) {
+			Object.BoundsMin[Axis] = bounds[i * 6 + Axis];
+			Object.BoundsMax[Axis] = bounds[i * 6 + 3 + Axis];
+			Object.Centroid[Axis] = 0.5f * (Object.BoundsMin[Axis] + Object.BoundsMax[Axis]);
+		}
+		Object.Object = (uint32_t)i;
+		GrowBox(Root.BoundsMin, Root.BoundsMax, Object.BoundsMin, Object.BoundsMax);
+	}
+
+	// A binary tree with count leaves at most has 2 * count - 1 nodes, so the array never moves while building
+	bvh.Nodes.reserve(2 * count);
+	bvh.Parents.reserve(2 * count);
+	bvh.Nodes.push_back(Root);
+	bvh.Parents.push_back(0);
+
+	std::vector<uint32_t> Stack(1, 0);
+	while (!Stack.empty()) {
+		uint32_t NodeIndex = Stack.back();
+		Stack.pop_back();
+		BvhNode& Node = bvh.Nodes[NodeIndex];
+		if (Node.Count <= 1) {
+			continue;
+		}
+		BuildObject* First = &Objects[Node.LeftOrFirst];
+		BuildObject* Last = First + Node.Count;
+
+		float CentroidMin[3], CentroidMax[3], BinScale[3];
+		ResetBox(CentroidMin, CentroidMax);
+		for (BuildObject* Object = First; Object != Last; Object++) {
+			GrowBox(CentroidMin, CentroidMax, Object->Centroid, Object->Centroid);
+		}
+		for (int Axis = 0; Axis < 3; Axis++) {
+			float Extent = CentroidMax[Axis] - CentroidMin[Axis];
+			BinScale[Axis] = Extent > 0.0f ? BVH_BINS / Extent : 0.0f;
+		}
+
+		BvhBin Bins[3][BVH_BINS];
+		int Axis = 0, Split = 0;
+		if (!FindSplit(First, Node, CentroidMin, BinScale, Bins, Axis, Split)) {
+			continue; // Stays a leaf
+		}
+
+		// Same binning as FindSplit, so the children get exactly the objects of their bins
+		BuildObject* Middle = std::partition(First, Last, [&](const BuildObject& object) {
+			return BinOf(object.Centroid[Axis], CentroidMin[Axis], BinScale[Axis]) <= Split;
+		});
+
+		BvhNode Left, Right;
+		ResetBox(Left.BoundsMin, Left.BoundsMax);
+		ResetBox(Right.BoundsMin, Right.BoundsMax);
+		for (int b = 0; b < BVH_BINS; b++) {
+			BvhNode& Child = b <= Split ? Left : Right;
+			GrowBox(Child.BoundsMin, Child.BoundsMax, Bins[Axis][b].BoundsMin, Bins[Axis][b].BoundsMax);
+		}
+		Left.LeftOrFirst = Node.LeftOrFirst;
+		Left.Count = (uint32_t)(Middle - First);
+		Right.LeftOrFirst = Left.LeftOrFirst + Left.Count;
+		Right.Count = Node.Count - Left.Count;
+
+		uint32_t LeftIndex = (uint32_t)bvh.Nodes.size();
+		Node.LeftOrFirst = LeftIndex;
+		Node.Count = 0;
+		bvh.Nodes.push_back(Left);
+		bvh.Nodes.push_back(Right);
+		bvh.Parents.push_back(NodeIndex);
+		bvh.Parents.push_back(NodeIndex);
+		Stack.push_back(LeftIndex + 1);
+		Stack.push_back(LeftIndex);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		const BuildObject& Object = Objects[i];
+		bvh.ObjectIndices[i] = Object.Object;
+		bvh.ObjectSlots[Object.Object] = (uint32_t)i;
+		memcpy(&bvh.ObjectBounds[i * 6], Object.BoundsMin, 3 * sizeof(float));
+		memcpy(&bvh.ObjectBounds[i * 6 + 3], Object.BoundsMax, 3 * sizeof(float));
+	}
+	for (uint32_t i = 0; i < bvh.Nodes.size(); i++) {
+		const BvhNode& Node = bvh.Nodes[i];
+		for (uint32_t k = 0; k < Node.Count; k++) {
+			bvh.ObjectLeaves[bvh.ObjectIndices[Node.LeftOrFirst + k]] = i;
+		}
+	}
+	bvh.NodeDirty.assign(bvh.Nodes.size(), 0);
+}
+
+void UpdateBvhObject(Bvh& bvh, uint32_t object, const float bounds[6])
+{
+	memcpy(&bvh.ObjectBounds[bvh.ObjectSlots[object] * 6], bounds, 6 * sizeof(float));
+	uint32_t Leaf = bvh.ObjectLeaves[object];
+	if (!bvh.NodeDirty[Leaf]) {
+		bvh.NodeDirty[Leaf] = 1;
+		bvh.DirtyLeaves.push_back(Leaf);
+	}
+}
+
+void RefitBvh(Bvh& bvh)
+{
+	if (bvh.DirtyLeaves.empty()) {
+		return;
+	}
+
+	if (bvh.DirtyLeaves.size() * 64 < bvh.Nodes.size()) {
+		// A few objects moved: walk up from each of their leaves, up to the root or to the first box that didn't change
+		for (size_t i = 0; i < bvh.DirtyLeaves.size(); i++) {
+			uint32_t NodeIndex = bvh.DirtyLeaves[i];
+			ComputeLeafBounds(bvh, bvh.Nodes[NodeIndex]);
+			bvh.NodeDirty[NodeIndex] = 0;
+			while (NodeIndex != 0) {
+				NodeIndex = bvh.Parents[NodeIndex];
+				if (!FitToChildren(bvh, bvh.Nodes[NodeIndex])) {
+					break;
+				}
+			}
+		}
+	}
+	else {
+		// Many moved: one pass backwards over the array, a node is refit when it's a dirty leaf or one of its
+		// children was. Children always come after their parent, so they're done first, and every node only once.
+		for (size_t i = bvh.Nodes.size(); i-- > 0;) {
+			BvhNode& Node = bvh.Nodes[i];
+			if (Node.Count > 0) {
+				if (bvh.NodeDirty[i]) {
+					ComputeLeafBounds(bvh, Node);
+				}
+			}
+			else if (bvh.NodeDirty[Node.LeftOrFirst] || bvh.NodeDirty[Node.LeftOrFirst + 1]) {
+				FitToChildren(bvh, Node);
+				bvh.NodeDirty[Node.LeftOrFirst] = 0;
+				bvh.NodeDirty[Node.LeftOrFirst + 1] = 0;
+				bvh.NodeDirty[i] = 1;
+			}
+		}
+		bvh.NodeDirty[0] = 0;
+	}
+	bvh.DirtyLeaves.clear();
+}
+
+enum BoxVisibility
+{
+	BoxOutside,
+	BoxIntersecting,
+	BoxInside
+};
+
+// The 6 planes, ready for the box test. Two more planes that can't reject anything pad them to 8.
+struct FrustumTest
+{
+	float Planes[8][4];
+	bool Positive[8][3];	// Sign of each normal component, picks the corner to test
+#ifdef BVH_X86
+	__m128 Nx[2], Ny[2], Nz[2], D[2];
+	__m128 PositiveX[2], PositiveY[2], PositiveZ[2];	// Lane masks of Positive
+#endif
+};
+
+static void PrepareFrustumTest(const float planes[6][4], FrustumTest& test)
+{
+	for (int Plane = 0; Plane < 8; Plane++) {
+		for (int k = 0; k < 4; k++) {
+			test.Planes[Plane][k] = Plane < 6 ? planes[Plane][k] : (k == 3 ? 1.0f : 0.0f);
+		}
+		for (int Axis = 0; Axis < 3; Axis++) {
+			test.Positive[Plane][Axis] = test.Planes[Plane][Axis] >= 0.0f;
+		}
+	}
+#ifdef BVH_X86
+	for (int Group = 0; Group < 2; Group++) {
+		const float (*p)[4] = &test.Planes[Group * 4];
+		test.Nx[Group] = _mm_setr_ps(p[0][0], p[1][0], p[2][0], p[3][0]);
+		test.Ny[Group] = _mm_setr_ps(p[0][1], p[1][1], p[2][1], p[3][1]);
+		test.Nz[Group] = _mm_setr_ps(p[0][2], p[1][2], p[2][2], p[3][2]);
+		test.D[Group] = _mm_setr_ps(p[0][3], p[1][3], p[2][3], p[3][3]);
+		test.PositiveX[Group] = _mm_cmpge_ps(test.Nx[Group], _mm_setzero_ps());
+		test.PositiveY[Group] = _mm_cmpge_ps(test.Ny[Group], _mm_setzero_ps());
+		test.PositiveZ[Group] = _mm_cmpge_ps(test.Nz[Group], _mm_setzero_ps());
+	}
+#endif
+}
+
+#ifdef BVH_X86
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+// For each plane, the box corner furthest along the normal tells if the box is completely behind it (outside),
+// and the nearest corner if it's completely in front of it. In front of all of them means inside.
+static BoxVisibility TestBox(const FrustumTest& test, const float boundsMin[3], const float boundsMax[3])
+{
+#ifdef BVH_X86
+	__m128 MinX = _mm_set1_ps(boundsMin[0]), MinY = _mm_set1_ps(boundsMin[1]), MinZ = _mm_set1_ps(boundsMin[2]);
+	__m128 MaxX = _mm_set1_ps(boundsMax[0]), MaxY = _mm_set1_ps(boundsMax[1]), MaxZ = _mm_set1_ps(boundsMax[2]);
+	__m128 Outside = _mm_setzero_ps();
+	__m128 Inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int Group = 0; Group < 2; Group++) {
+		__m128 Far = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(test.Nx[Group], Select(test.PositiveX[Group], MaxX, MinX)),
+			_mm_mul_ps(test.Ny[Group], Select(test.PositiveY[Group], MaxY, MinY))),
+			_mm_add_ps(_mm_mul_ps(test.Nz[Group], Select(test.PositiveZ[Group], MaxZ, MinZ)), test.D[Group]));
+		__m128 Near = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(test.Nx[Group], Select(test.PositiveX[Group], MinX, MaxX)),
+			_mm_mul_ps(test.Ny[Group], Select(test.PositiveY[Group], MinY, MaxY))),
+			_mm_add_ps(_mm_mul_ps(test.Nz[Group], Select(test.PositiveZ[Group], MinZ, MaxZ)), test.D[Group]));
+		Outside = _mm_or_ps(Outside, _mm_cmplt_ps(Far, _mm_setzero_ps()));
+		Inside = _mm_and_ps(Inside, _mm_cmpge_ps(Near, _mm_setzero_ps()));
+	}
+	if (_mm_movemask_ps(Outside) != 0) {
+		return BoxOutside;
+	}
+	return _mm_movemask_ps(Inside) == 0xF ? BoxInside : BoxIntersecting;
+#else
+	bool AllInside = true;
+	for (int Plane = 0; Plane < 6; Plane++) {
+		const float* p = test.Planes[Plane];
+		float Far = p[3], Near = p[3];
+		for (int Axis = 0; Axis < 3; Axis++) {
+			bool Positive = test.Positive[Plane][Axis];
+			Far += p[Axis] * (Positive ? boundsMax[Axis] : boundsMin[Axis]);
+			Near += p[Axis] * (Positive ? boundsMin[Axis] : boundsMax[Axis]);
+		}
+		if (Far < 0.0f) {
+			return BoxOutside;
+		}
+		AllInside = AllInside && Near >= 0.0f;
+	}
+	return AllInside ? BoxInside : BoxIntersecting;
+#endif
+}
+
+void CullBvh(const Bvh& bvh, const float planes[6][4], std::vector<uint32_t>& visible, BvhCullStats& stats, uint32_t root)
+{
+	memset(&stats, 0, sizeof(stats));
+	if (bvh.Nodes.empty()) {
+		return;
+	}
+	FrustumTest Test;
+	PrepareFrustumTest(planes, Test);
+	size_t VisibleBefore = visible.size();
+
+	std::vector<uint32_t> Stack;
+	Stack.reserve(64);
+	Stack.push_back(root);
+	while (!Stack.empty()) {
+		const BvhNode& Node = bvh.Nodes[Stack.back()];
+		Stack.pop_back();
+		stats.NodesVisited++;
+
+		BoxVisibility Visibility = TestBox(Test, Node.BoundsMin, Node.BoundsMax);
+		if (Visibility == BoxOutside) {
+			continue;
+		}
+		if (Visibility == BoxInside) {
+			// Everything below is visible, and its objects are one range: from the leftmost leaf to the rightmost one
+			const BvhNode* Leftmost = &Node;
+			while (Leftmost->Count == 0) {
+				Leftmost = &bvh.Nodes[Leftmost->LeftOrFirst];
+			}
+			const BvhNode* Rightmost = &Node;
+			while (Rightmost->Count == 0) {
+				Rightmost = &bvh.Nodes[Rightmost->LeftOrFirst + 1];
+			}
+			visible.insert(visible.end(), bvh.ObjectIndices.begin() + Leftmost->LeftOrFirst,
+				bvh.ObjectIndices.begin() + Rightmost->LeftOrFirst + Rightmost->Count);
+			stats.NodesInside++;
+			continue;
+		}
+		if (Node.Count > 0) {
+			for (uint32_t i = 0; i < Node.Count; i++) {
+				const float* Bounds = &bvh.ObjectBounds[(Node.LeftOrFirst + i) * 6];
+				if (TestBox(Test, Bounds, Bounds + 3) != BoxOutside) {
+					visible.push_back(bvh.ObjectIndices[Node.LeftOrFirst + i]);
+				}
+			}
+			stats.ObjectsTested += Node.Count;
+		}
+		else {
+			Stack.push_back(Node.LeftOrFirst + 1);
+			Stack.push_back(Node.LeftOrFirst);
+		}
+	}
+	stats.Visible = (int)(visible.size() - VisibleBefore);
+}
+
+void SplitBvh(const Bvh& bvh, int count, std::vector<uint32_t>& roots)
+{
+	roots.clear();
+	if (bvh.Nodes.empty()) {
+		return;
+	}
+	// Replaces the biggest interior node by its two children, in place so the order stays left to right
+	roots.push_back(0);
+	while ((int)roots.size() < count) {
+		size_t Biggest = roots.size();
+		uint32_t BiggestObjects = 0;
+		for (size_t i = 0; i < roots.size(); i++) {
+			const BvhNode& Node = bvh.Nodes[roots[i]];
+			uint32_t Objects = 0;
+			if (Node.Count == 0) {
+				// Same trick as a subtree inside the frustum: its objects go from its leftmost leaf to its rightmost one
+				const BvhNode* Leftmost = &Node;
+				while (Leftmost->Count == 0) {
+					Leftmost = &bvh.Nodes[Leftmost->LeftOrFirst];
+				}
+				const BvhNode* Rightmost = &Node;
+				while (Rightmost->Count == 0) {
+					Rightmost = &bvh.Nodes[Rightmost->LeftOrFirst + 1];
+				}
+				Objects = Rightmost->LeftOrFirst + Rightmost->Count - Leftmost->LeftOrFirst;
+			}
+			if (Objects > BiggestObjects) {
+				Biggest = i;
+				BiggestObjects = Objects;
+			}
+		}
+		if (Biggest == roots.size()) {
+			break; // Only leaves left
+		}
+		uint32_t Left = bvh.Nodes[roots[Biggest]].LeftOrFirst;
+		roots[Biggest] = Left;
+		roots.insert(roots.begin() + Biggest + 1, Left + 1);
+	}
+}
+
+void CullObjectsBruteForce(const float* bounds, size_t count, const float planes[6][4], std::vector<uint32_t>& visible)
+{
+	FrustumTest Test;
+	PrepareFrustumTest(planes, Test);
+	for (size_t i = 0; i < count; i++) {
+		if (TestBox(Test, &bounds[i * 6], &bounds[i * 6 + 3]) != BoxOutside) {
+			visible.push_back((uint32_t)i);
+		}
+	}
+}
+
+void ComputeBatchBounds(const TransformBatch& batch, float meshRadius, std::vector<float>& bounds)
+{
+	bounds.resize(batch.Count * 6);
+	for (size_t i = 0; i < batch.Count; i++) {
+		float Radius = meshRadius * batch.Scale[i];
+		float Center[3] = { batch.PositionX[i], batch.PositionY[i], batch.PositionZ[i] };
+		for (int Axis = 0; Axis < 3; Axis++) {
+			bounds[i * 6 + Axis] = Center[Axis] - Radius;
+			bounds[i * 6 + 3 + Axis] = Center[Axis] + Radius;
+		}
+	}
+}
+
+template <typename Function>
+static double TimeMs(Function function, int iterations)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		function();
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count() / iterations;
+}
+
+void RunBvhBenchmark(size_t count, int iterations)
+{
+	// Objects scattered in a cube as dense as the instanced grid (one every 3 units), with the camera in the
+	// middle of it: the view only reaches 100 units, so most of the scene is out of it
+	float WorldSize = 3.0f * cbrtf((float)count);
+	std::vector<float> Bounds(count * 6);
+	srand(1234);
+	for (size_t i = 0; i < count; i++) {
+		float Radius = sqrtf(3.0f) * (0.5f + rand() / (float)RAND_MAX);
+		for (int Axis = 0; Axis < 3; Axis++) {
+			float Center = (rand() / (float)RAND_MAX - 0.5f) * WorldSize;
+			Bounds[i * 6 + Axis] = Center - Radius;
+			Bounds[i * 6 + 3 + Axis] = Center + Radius;
+		}
+	}
+
+	glm::mat4 Projection = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	glm::mat4 View = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(4, 3, 3), glm::vec3(0, 1, 0));
+	glm::mat4 VP = Projection * View;
+	float Planes[6][4];
+	ExtractFrustumPlanes(&VP[0][0], Planes);
+
+	Bvh Tree;
+	double BuildMs = TimeMs([&]() { BuildBvh(Tree, &Bounds[0], count); }, 1);
+
+	std::vector<uint32_t> BruteVisible, BvhVisible;
+	BruteVisible.reserve(count);
+	BvhVisible.reserve(count);
+	double BruteMs = TimeMs([&]() { BruteVisible.clear(); CullObjectsBruteForce(&Bounds[0], count, Planes, BruteVisible); }, iterations);
+	BvhCullStats Stats;
+	double CullMs = TimeMs([&]() { BvhVisible.clear(); CullBvh(Tree, Planes, BvhVisible, Stats); }, iterations);
+	std::sort(BruteVisible.begin(), BruteVisible.end());
+	std::sort(BvhVisible.begin(), BvhVisible.end());
+	bool SameVisible = BruteVisible == BvhVisible;
+
+	// 1% of the objects move a little every frame: incremental refit, from the dirty leaves up
+	size_t Movers = count / 100 > 0 ? count / 100 : 1;
+	int Frame = 0;
+	double PartialRefitMs = TimeMs([&]() {
+		for (size_t k = 0; k < Movers; k++) {
+			uint32_t Object = (uint32_t)((k * 7919 + Frame * 104729) % count);
+			const float* Bounds = &Tree.ObjectBounds[Tree.ObjectSlots[Object] * 6];
+			float Moved[6];
+			for (int Axis = 0; Axis < 3; Axis++) {
+				float Step = (Axis == Frame % 3) ? 0.25f : -0.1f;
+				Moved[Axis] = Bounds[Axis] + Step;
+				Moved[3 + Axis] = Bounds[3 + Axis] + Step;
+			}
+			UpdateBvhObject(Tree, Object, Moved);
+		}
+		RefitBvh(Tree);
+		Frame++;
+	}, iterations);
+
+	// Everything moves: the refit sweeps the whole tree once
+	double FullRefitMs = TimeMs([&]() {
+		for (size_t Object = 0; Object < count; Object++) {
+			const float* Bounds = &Tree.ObjectBounds[Tree.ObjectSlots[Object] * 6];
+			float Moved[6];
+			for (int k = 0; k < 6; k++) {
+				Moved[k] = Bounds[k] + 0.05f;
+			}
+			UpdateBvhObject(Tree, (uint32_t)Object, Moved);
+		}
+		RefitBvh(Tree);
+	}, iterations);
+
+	BvhCullStats RefitStats;
+	double CullAfterRefitMs = TimeMs([&]() { BvhVisible.clear(); CullBvh(Tree, Planes, BvhVisible, RefitStats); }, iterations);
+	// The refit tree must still find exactly what testing the moved boxes finds (they're stored in tree order)
+	BruteVisible.clear();
+	CullObjectsBruteForce(&Tree.ObjectBounds[0], count, Planes, BruteVisible);
+	for (size_t i = 0; i < BruteVisible.size(); i++) {
+		BruteVisible[i] = Tree.ObjectIndices[BruteVisible[i]];
+	}
+	std::sort(BruteVisible.begin(), BruteVisible.end());
+	std::sort(BvhVisible.begin(), BvhVisible.end());
+	bool SameAfterRefits = BruteVisible == BvhVisible;
+
+	int Leaves = 0;
+	for (size_t i = 0; i < Tree.Nodes.size(); i++) {
+		Leaves += Tree.Nodes[i].Count > 0 ? 1 : 0;
+	}
+
+	printf("{\n  \"objects\": %d,\n  \"visible\": %d,\n  \"visible_same_as_brute_force\": %s,\n", (int)count, Stats.Visible, SameVisible ? "true" : "false");
+	printf("  \"nodes\": %d,\n  \"leaves\": %d,\n  \"node_bytes\": %d,\n  \"build_ms\": %.2f,\n", (int)Tree.Nodes.size(), Leaves, (int)(Tree.Nodes.size() * sizeof(BvhNode)), BuildMs);
+	printf("  \"brute_force_cull_ms\": %.3f,\n  \"bvh_cull_ms\": %.3f,\n  \"speedup\": %.1f,\n", BruteMs, CullMs, BruteMs / CullMs);
+	printf("  \"nodes_visited\": %d,\n  \"subtrees_inside\": %d,\n  \"objects_tested\": %d,\n", Stats.NodesVisited, Stats.NodesInside, Stats.ObjectsTested);
+	printf("  \"refit_1_percent_moved_ms\": %.3f,\n  \"refit_all_moved_ms\": %.3f,\n", PartialRefitMs, FullRefitMs);
+	printf("  \"bvh_cull_after_refits_ms\": %.3f,\n  \"visible_same_after_refits\": %s\n}\n", CullAfterRefitMs, SameAfterRefits ? "true" : "false");
+}
@@ -0,0 +1,77 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "TransformBatch.hpp"
+
+// Bounding volume hierarchy over object AABBs, to find the objects inside the view frustum without
+// testing all of them. Built top-down with binned SAH (surface area heuristic), and refit in place
+// when objects move: only the leaves that changed and their ancestors are touched.
+// The nodes live in one flat array, 32 bytes each, every node before its children and the two children
+// of a node next to each other, so a traversal mostly walks forward in memory.
+// The frustum test is SSE (4 planes per register) with a scalar fallback for other CPUs.
+//
+// Refitting keeps the tree valid but not good: once objects moved far from where they were at build time,
+// boxes overlap more and culling slows down, that's when to build again.
+
+#define BVH_BINS 16
+// Leaves never hold more than this, unless the objects can't be split at all (same centroid)
+#define BVH_MAX_LEAF_OBJECTS 8
+
+struct BvhNode
+{
+	float BoundsMin[3];
+	uint32_t LeftOrFirst;	// Interior: index of the left child, the right one is right after it. Leaf: first entry of ObjectIndices.
+	float BoundsMax[3];
+	uint32_t Count;			// Objects of the leaf, 0 for an interior node
+};
+
+struct Bvh
+{
+	std::vector<BvhNode> Nodes;				// Nodes[0] is the root
+	std::vector<uint32_t> Parents;			// Parent of each node, the root's is itself
+	std::vector<uint32_t> ObjectIndices;	// Object ids, each leaf owns a range. A subtree owns a contiguous range too.
+	std::vector<float> ObjectBounds;		// Min xyz then max xyz, 6 floats per entry of ObjectIndices (same order, so a leaf reads them in a row)
+	std::vector<uint32_t> ObjectSlots;		// Entry of ObjectIndices (and ObjectBounds) of each object
+	std::vector<uint32_t> ObjectLeaves;		// Leaf holding each object
+	std::vector<uint32_t> DirtyLeaves;		// Leaves with objects that moved since the last refit
+	std::vector<unsigned char> NodeDirty;
+};
+
+struct BvhCullStats
+{
+	int NodesVisited;
+	int NodesInside;		// Subtrees accepted whole, without testing what's below
+	int ObjectsTested;
+	int Visible;
+};
+
+// bounds: min xyz, max xyz of each object (6 floats per object)
+void BuildBvh(Bvh& bvh, const float* bounds, size_t count);
+
+// Moves an object. The tree is only fixed by the next RefitBvh().
+void UpdateBvhObject(Bvh& bvh, uint32_t object, const float bounds[6]);
+void RefitBvh(Bvh& bvh);
+
+// Appends the objects whose AABB touches the frustum (planes as from ExtractFrustumPlanes(), normals pointing inside).
+// Only looks below root, to cull separate subtrees on separate threads.
+void CullBvh(const Bvh& bvh, const float planes[6][4], std::vector<uint32_t>& visible, BvhCullStats& stats, uint32_t root = 0);
+
+// Cuts the tree into at least count subtrees (fewer if it doesn't have that many leaves) that together
+// hold every object, left to right: culling them in that order gives the objects in the same order as culling the root
+void SplitBvh(const Bvh& bvh, int count, std::vector<uint32_t>& roots);
+
+// Same result without the tree, every object is tested. The reference the BVH is compared against.
+void CullObjectsBruteForce(const float* bounds, size_t count, const float planes[6][4], std::vector<uint32_t>& visible);
+
+// Bounds of every object of a batch: the sphere of meshRadius (times its scale) around its position,
+// which holds the mesh whatever the rotation
+void ComputeBatchBounds(const TransformBatch& batch, float meshRadius, std::vector<float>& bounds);
+
+// Builds, culls and refits a scene of count objects much bigger than the view, and prints the timings as JSON
+void RunBvhBenchmark(size_t count, int iterations);
+
+#endif
@@ -0,0 +1,306 @@
+// Generated by tools/EmbedShaders.py from the files in shaders/, don't edit it by hand.
+#ifndef EMBEDDED_SHADERS_HPP
+#define EMBEDDED_SHADERS_HPP
+
+#include <string_view>
+
+struct EmbeddedShader
+{
+	std::string_view Name;
+	std::string_view Source;
+};
+
+inline constexpr EmbeddedShader EmbeddedShaders[] = {
+	{ "shaders/ColorFragmentShader.fragmentshader",
+		R"SHADER(#version 330 core
+
+// Interpolated values from the vertex shaders
+in vec3 fragmentColor;
+
+// Output data ; will be interpolated for each 
+out vec3 color;
+
+void main() {
+	// Output color = color specified in the vertex shader,
+	// interpolated between all 3 surrounding vertices
+	color = fragmentColor;
+})SHADER" },
+	{ "shaders/FrustumCull.computeshader",
+		R"SHADER(#version 430 core
+
+// GPU-driven culling: one invocation per object tests its bounding sphere against the frustum (and the
+// hierarchical depth buffer), and writes the draw command of the object for glMultiDrawElementsIndirect().
+// See common/GpuCulling.hpp
+layout(local_size_x = 64) in;
+
+// Shared by every draw of the frame, see common/UniformBlocks.hpp
+layout(std140) uniform FrameUniforms {
+	mat4 Projection;
+	mat4 View;
+	mat4 ViewProjection;
+	vec3 CameraPosition;
+	float Time;
+	vec4 FrustumPlanes[6];
+};
+
+struct DrawElementsIndirectCommand {
+	uint Count;
+	uint InstanceCount;
+	uint FirstIndex;
+	int BaseVertex;
+	uint BaseInstance;
+};
+
+// Bounding sphere of each object, world space: center in xyz, radius in w
+layout(std430, binding = 0) readonly buffer ObjectBounds {
+	vec4 Bounds[];
+};
+
+layout(std430, binding = 1) writeonly buffer DrawCommands {
+	DrawElementsIndirectCommand Commands[];
+};
+
+// Cleared to 0 before the dispatch, ends up as the number of visible objects (and of those the depth hid)
+layout(std430, binding = 2) buffer DrawCount {
+	uint VisibleCount;
+	uint OccludedCount;
+};
+
+// 1 for the objects the last frame drew, they are the occluders of the depth pre-pass
+layout(std430, binding = 3) buffer LastVisible {
+	uint WasVisible[];
+};
+
+// Farthest depth of each texel, level 0 is HiZSize, see shaders/HiZBuild.computeshader
+uniform sampler2D HiZ;
+uniform ivec2 HiZSize;
+uniform int HiZLevels;
+
+uniform uint ObjectCount;
+uniform uint IndexCount;
+// Where the per-instance data of object 0 starts, the instance attributes are read at BaseInstance
+uniform uint FirstInstance;
+// With a draw count (glMultiDrawElementsIndirectCount), visible objects are packed at the start.
+// Without, every object keeps its own command and the hidden ones draw 0 instances.
+uniform bool Compact;
+// The occluder pass only keeps what the last frame drew, for the depth pre-pass.
+// The main pass tests the depth of the occluders if there's OcclusionTest, and remembers what it drew.
+uniform bool OccluderPass;
+uniform bool OcclusionTest;
+
+// True when the whole sphere is behind the depth in the pyramid
+bool Occluded(vec4 Sphere) {
+	// Screen rectangle and nearest depth of the box around the sphere
+	vec3 Low = vec3(1.0);
+	vec3 High = vec3(-1.0);
+	for (int i = 0; i < 8; i++) {
+		vec3 Corner = Sphere.xyz + Sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 Clip = ViewProjection * vec4(Corner, 1.0);
+		// Reaches the camera plane: the projection would wrap around, keep it
+		if (Clip.w <= 0.0)
+			return false;
+		vec3 Ndc = Clip.xyz / Clip.w;
+		Low = min(Low, Ndc);
+		High = max(High, Ndc);
+	}
+	vec2 Min = clamp(Low.xy * 0.5 + 0.5, 0.0, 1.0) * vec2(HiZSize);
+	vec2 Max = clamp(High.xy * 0.5 + 0.5, 0.0, 1.0) * vec2(HiZSize);
+	float Nearest = Low.z * 0.5 + 0.5;
+
+	// The level where the rectangle is at most 2x2 texels, so 4 reads cover it
+	float Extent = max(Max.x - Min.x, Max.y - Min.y);
+	int Level = clamp(int(ceil(log2(max(Extent, 1.0)))), 0, HiZLevels - 1);
+	ivec2 LevelSize = max(HiZSize >> Level, ivec2(1));
+	ivec2 First = clamp(ivec2(Min) >> Level, ivec2(0), LevelSize - 1);
+	ivec2 Last = clamp(ivec2(Max) >> Level, ivec2(0), LevelSize - 1);
+	float Farthest = max(max(texelFetch(HiZ, First, Level).r, texelFetch(HiZ, ivec2(Last.x, First.y), Level).r),
+		max(texelFetch(HiZ, ivec2(First.x, Last.y), Level).r, texelFetch(HiZ, Last, Level).r));
+	return Nearest > Farthest;
+}
+
+void main() {
+	uint Object = gl_GlobalInvocationID.x;
+	if (Object >= ObjectCount)
+		return;
+
+	vec4 Sphere = Bounds[Object];
+	bool Visible = true;
+	for (int i = 0; i < 6; i++)
+		Visible = Visible && dot(FrustumPlanes[i].xyz, Sphere.xyz) + FrustumPlanes[i].w >= -Sphere.w;
+
+	if (OccluderPass)
+		Visible = Visible && WasVisible[Object] != 0u;
+	else {
+		if (Visible && OcclusionTest && Occluded(Sphere)) {
+			Visible = false;
+			atomicAdd(OccludedCount, 1u);
+		}
+		WasVisible[Object] = Visible ? 1u : 0u;
+	}
+
+	if (Visible) {
+		// Counted in both modes, the CPU reads it back for the stats
+		uint Slot = atomicAdd(VisibleCount, 1u);
+		if (Compact)
+			Commands[Slot] = DrawElementsIndirectCommand(IndexCount, 1u, 0u, 0, FirstInstance + Object);
+	}
+	if (!Compact)
+		Commands[Object] = DrawElementsIndirectCommand(IndexCount, Visible ? 1u : 0u, 0u, 0, FirstInstance + Object);
+}
+)SHADER" },
+	{ "shaders/HiZBuild.computeshader",
+		R"SHADER(#version 430 core
+
+// One level of the hierarchical depth buffer, each texel the farthest depth under it. See common/HiZBuffer.hpp
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// Level 0 reads the depth pass (any size), the other levels the level above (exactly twice as big)
+uniform sampler2D Depth;
+layout(r32f) readonly uniform image2D Source;
+layout(r32f) writeonly uniform image2D Destination;
+uniform bool FromDepth;
+
+void main() {
+	ivec2 Texel = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 Size = imageSize(Destination);
+	if (Texel.x >= Size.x || Texel.y >= Size.y)
+		return;
+
+	float Farthest = 0.0;
+	if (FromDepth) {
+		// Level 0 is a power of two smaller than the depth, so a texel covers a fraction of depth texels:
+		// every one it touches counts, or a sliver of background could be missed
+		ivec2 DepthSize = textureSize(Depth, 0);
+		ivec2 First = (Texel * DepthSize) / Size;
+		ivec2 Last = min(((Texel + 1) * DepthSize + Size - 1) / Size, DepthSize) - 1;
+		for (int y = First.y; y <= Last.y; y++)
+			for (int x = First.x; x <= Last.x; x++)
+				Farthest = max(Farthest, texelFetch(Depth, ivec2(x, y), 0).r);
+	}
+	else {
+		ivec2 Corner = Texel * 2;
+		Farthest = max(max(imageLoad(Source, Corner).r, imageLoad(Source, Corner + ivec2(1, 0)).r),
+			max(imageLoad(Source, Corner + ivec2(0, 1)).r, imageLoad(Source, Corner + ivec2(1, 1)).r));
+	}
+	imageStore(Destination, Texel, vec4(Farthest));
+}
+)SHADER" },
+	{ "shaders/InstancedTransformVertexShader.vertexshader",
+		R"SHADER(#version 330 core
+
+// Input vertex data, different for all executions of this shader
+layout(location = 0) in vec3 vertexPosition_modelspace;
+
+// Notice that the "1" here equals the "1" in glVertexAttribPointer
+layout(location = 1) in vec3 vertexColor;
+
+// Per-instance data: the model matrix of the cube being drawn.
+// A mat4 attribute takes 4 locations, one per column, so this is 2, 3, 4 and 5.
+layout(location = 2) in mat4 instanceModel;
+
+// Output data ; will be interpolated for each fragment
+out vec3 fragmentColor;
+// Shared by every draw of the frame, see common/UniformBlocks.hpp
+layout(std140) uniform FrameUniforms {
+	mat4 Projection;
+	mat4 View;
+	mat4 ViewProjection;
+	vec3 CameraPosition;
+	float Time;
+	vec4 FrustumPlanes[6];
+};
+// The object being drawn. Quantized positions are relative to the mesh bounds:
+// model space = PositionBias + position * PositionScale (scale 1 and bias 0 for float positions).
+layout(std140) uniform ObjectUniforms {
+	mat4 Model;
+	mat4 ModelViewProjection;
+	vec3 PositionScale;
+	vec3 PositionBias;
+};
+
+void main() {
+
+	// Output position of the vertex, in clip space : VP * Model * position
+	gl_Position = ViewProjection * instanceModel * vec4(PositionBias + vertexPosition_modelspace * PositionScale, 1);
+
+	// The color of each vertex will be interpolated
+	// to produce the color of each fragment
+	fragmentColor = vertexColor;
+}
+)SHADER" },
+	{ "shaders/SimpleFragmentShader.fragmentshader",
+		R"SHADER(#version 330 core
+
+out vec3 color;
+
+void main() {
+	color = vec3(1,0,0);
+})SHADER" },
+	{ "shaders/SimpleTransform.vertexshader",
+		R"SHADER(#version 330 core
+
+// Input vertex data, different for all executions of this shader.
+layout(location = 0) in vec3 vertexPosition_modelspace;
+
+// Values that stay constant for the whole mesh.
+uniform mat4 MVP;
+
+void main() {
+
+	// Output position of the vertex, in clip space : MVP * position
+	gl_Position = MVP * vec4(vertexPosition_modelspace, 1);
+
+})SHADER" },
+	{ "shaders/SimpleVertexShader.vertexshader",
+		R"SHADER(#version 330 core
+
+layout(location = 0) in vec3 vertexPosition_modelspace;
+
+void main() {
+	gl_Position.xyz = vertexPosition_modelspace;
+	gl_Position.w = 1.0;
+})SHADER" },
+	{ "shaders/TransformVertexShader.vertexshader",
+		R"SHADER(#version 330 core
+
+// Input vertex data, different for all executions of this shader
+layout(location = 0) in vec3 vertexPosition_modelspace;
+
+// Notice that the "1" here equals the "1" in glVertexAttribPointer
+layout(location = 1) in vec3 vertexColor;
+
+// Output data ; will be interpolated for each fragment
+out vec3 fragmentColor;
+// The object being drawn. Quantized positions are relative to the mesh bounds:
+// model space = PositionBias + position * PositionScale (scale 1 and bias 0 for float positions).
+layout(std140) uniform ObjectUniforms {
+	mat4 Model;
+	mat4 ModelViewProjection;
+	vec3 PositionScale;
+	vec3 PositionBias;
+};
+
+void main() {
+
+	// Output position of the vertex, in clip space : MVP * position
+	gl_Position = ModelViewProjection * vec4(PositionBias + vertexPosition_modelspace * PositionScale, 1);
+
+	// The color of each vertex will be interpolated
+	// to produce the color of each fragment
+	fragmentColor = vertexColor;
+})SHADER" },
+	{ std::string_view(), std::string_view() } // Keeps the array valid when there's no shader at all
+};
+
+// Returns NULL when there's no shader with that name
+constexpr const EmbeddedShader* FindEmbeddedShader(std::string_view name)
+{
+	for (const EmbeddedShader& Shader : EmbeddedShaders) {
+		if (!Shader.Name.empty() && Shader.Name == name) {
+			return &Shader;
+		}
+	}
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,491 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <GL/glew.h>
+
+#include "FrameCapture.hpp"
+#include "StateCache.hpp"
+#include "GlTrace.hpp"
+
+struct CaptureEncoder
+{
+	std::thread Thread;
+	std::mutex Mutex;
+	std::condition_variable Queued;		// A slot was queued, or it's time to stop
+	std::condition_variable Encoded;	// A slot was given back
+	std::deque<int> Slots;
+	bool Stopping;
+	FILE* RawFile;
+	std::vector<unsigned char> Scratch;	// The PNG being built, kept from one frame to the next
+	double EncodeMs;
+	int EncodedFrames;
+};
+
+bool ParseCaptureFormat(const char* name, CaptureFormat& format)
+{
+	if (strcmp(name, "png") == 0) {
+		format = CapturePNG;
+	}
+	else if (strcmp(name, "raw") == 0) {
+		format = CaptureRaw;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+// PNG without zlib: the image data is a zlib stream of "stored" (uncompressed) deflate blocks, which every
+// decoder reads. The files are as big as the raw pixels, but writing them costs about as much as a memcpy.
+
+// Four bytes at a time ("slicing by 4"): Table[k] is the CRC of a byte followed by k zero bytes
+static uint32_t Crc32(uint32_t crc, const unsigned char* data, size_t size)
+{
+	static uint32_t Table[4][256];
+	static bool TableReady = false;
+	if (!TableReady) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			Table[0][i] = c;
+		}
+		for (uint32_t i = 0; i < 256; i++) {
+			for (int k = 1; k < 4; k++) {
+				Table[k][i] = Table[0][Table[k - 1][i] & 0xFF] ^ (Table[k - 1][i] >> 8);
+			}
+		}
+		TableReady = true;
+	}
+	crc = ~crc;
+	while (size >= 4) {
+		crc ^= (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+		crc = Table[3][crc & 0xFF] ^ Table[2][(crc >> 8) & 0xFF] ^ Table[1][(crc >> 16) & 0xFF] ^ Table[0][crc >> 24];
+		data += 4;
+		size -= 4;
+	}
+	while (size-- > 0) {
+		crc = Table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void PutBigEndian(unsigned char* out, uint32_t value)
+{
+	out[0] = (unsigned char)(value >> 24);
+	out[1] = (unsigned char)(value >> 16);
+	out[2] = (unsigned char)(value >> 8);
+	out[3] = (unsigned char)value;
+}
+
+// Writes a chunk: length, type, data, and the CRC of type + data. Returns where the next one goes.
+static unsigned char* PutChunk(unsigned char* out, const char* type, const unsigned char* data, size_t size)
+{
+	PutBigEndian(out, (uint32_t)size);
+	memcpy(out + 4, type, 4);
+	if (size > 0) {
+		memcpy(out + 8, data, size);
+	}
+	PutBigEndian(out + 8 + size, Crc32(0, out + 4, size + 4));
+	return out + 12 + size;
+}
+
+static uint32_t Adler32(uint32_t adler, const unsigned char* data, size_t size)
+{
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+	while (size > 0) {
+		// The sums fit in 32 bits for up to 5552 bytes between two reductions
+		size_t Run = size < 5552 ? size : 5552;
+		size -= Run;
+		while (Run-- > 0) {
+			a += *data++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+// pixels: RGBA, bottom row first as glReadPixels() gives them. The PNG is RGB, the alpha of the
+// framebuffer is whatever the clear left there and would make the image transparent.
+static void EncodePng(std::vector<unsigned char>& out, const unsigned char* pixels, int width, int height)
+{
+	const size_t RowSize = (size_t)width * 3 + 1;		// A filter byte (0, none) in front of every row
+	const size_t ImageSize = RowSize * height;
+	const size_t MaxStoredBlock = 65535;
+	const size_t Blocks = (ImageSize + MaxStoredBlock - 1) / MaxStoredBlock;
+	const size_t ZlibSize = 2 + Blocks * 5 + ImageSize + 4;
+
+	static const unsigned char Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	unsigned char Header[13];
+	PutBigEndian(Header, (uint32_t)width);
+	PutBigEndian(Header + 4, (uint32_t)height);
+	Header[8] = 8;		// Bits per channel
+	Header[9] = 2;		// RGB
+	Header[10] = 0;		// Deflate
+	Header[11] = 0;		// Adaptive filtering (every row says "none" here)
+	Header[12] = 0;		// Not interlaced
+
+	out.resize(8 + (12 + sizeof(Header)) + (12 + ZlibSize) + 12);
+	unsigned char* Out = &out[0];
+	memcpy(Out, Signature, 8);
+	Out = PutChunk(Out + 8, "IHDR", Header, sizeof(Header));
+
+	// The IDAT chunk is written in place, its CRC comes at the end
+	PutBigEndian(Out, (uint32_t)ZlibSize);
+	unsigned char* ChunkType = Out + 4;
+	memcpy(ChunkType, "IDAT", 4);
+	unsigned char* Zlib = ChunkType + 4;
+	unsigned char* z = Zlib;
+	*z++ = 0x78;	// Deflate, 32K window
+	*z++ = 0x01;	// No compression level claimed, header check bits
+
+	// Rows go top first, so from the end of what glReadPixels() gave. Stored blocks cut rows anywhere.
+	std::vector<unsigned char> Row(RowSize);
+	uint32_t Adler = 1;
+	size_t BlockLeft = 0;
+	size_t Written = 0;
+	for (int y = height - 1; y >= 0; y--) {
+		const unsigned char* Source = pixels + (size_t)y * width * 4;
+		unsigned char* r = &Row[0];
+		*r++ = 0;
+		for (int x = 0; x < width; x++) {
+			r[0] = Source[0];
+			r[1] = Source[1];
+			r[2] = Source[2];
+			r += 3;
+			Source += 4;
+		}
+		Adler = Adler32(Adler, &Row[0], RowSize);
+
+		size_t Done = 0;
+		while (Done < RowSize) {
+			if (BlockLeft == 0) {
+				BlockLeft = ImageSize - Written < MaxStoredBlock ? ImageSize - Written : MaxStoredBlock;
+				*z++ = Written + BlockLeft == ImageSize ? 1 : 0;	// Last block flag, stored
+				*z++ = (unsigned char)BlockLeft;
+				*z++ = (unsigned char)(BlockLeft >> 8);
+				*z++ = (unsigned char)~BlockLeft;
+				*z++ = (unsigned char)(~BlockLeft >> 8);
+			}
+			size_t Take = RowSize - Done < BlockLeft ? RowSize - Done : BlockLeft;
+			memcpy(z, &Row[Done], Take);
+			z += Take;
+			Done += Take;
+			BlockLeft -= Take;
+			Written += Take;
+		}
+	}
+	PutBigEndian(z, Adler);
+	z += 4;
+	PutBigEndian(z, Crc32(0, ChunkType, 4 + ZlibSize));
+	Out = z + 4;
+
+	PutChunk(Out, "IEND", NULL, 0);
+}
+
+static void EncodeFrame(FrameCapture& capture, int slot)
+{
+	CaptureEncoder& Encoder = *capture.Encoder;
+	const unsigned char* Pixels = capture.Pixels[slot];
+	if (capture.Format == CaptureRaw) {
+		// Top row first, like every video tool expects
+		size_t RowSize = (size_t)capture.Width * 4;
+		for (int Row = capture.Height - 1; Row >= 0; Row--) {
+			fwrite(Pixels + Row * RowSize, 1, RowSize, Encoder.RawFile);
+		}
+		return;
+	}
+
+	EncodePng(Encoder.Scratch, Pixels, capture.Width, capture.Height);
+	char FileName[1024];
+	snprintf(FileName, sizeof(FileName), "%s/frame_%05d.png", capture.Path, capture.Frames[slot]);
+	FILE* File = fopen(FileName, "wb");
+	if (File == NULL) {
+		fprintf(stderr, "Capture: can't write %s\n", FileName);
+		return;
+	}
+	fwrite(&Encoder.Scratch[0], 1, Encoder.Scratch.size(), File);
+	fclose(File);
+}
+
+static void EncoderMain(FrameCapture* capture)
+{
+	CaptureEncoder& Encoder = *capture->Encoder;
+	std::unique_lock<std::mutex> Lock(Encoder.Mutex);
+	while (true) {
+		Encoder.Queued.wait(Lock, [&] { return !Encoder.Slots.empty() || Encoder.Stopping; });
+		if (Encoder.Slots.empty()) {
+			break; // Stopping, and nothing left to write
+		}
+		int Slot = Encoder.Slots.front();
+		Encoder.Slots.pop_front();
+		Lock.unlock();
+
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		EncodeFrame(*capture, Slot);
+		double Ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+		Lock.lock();
+		Encoder.EncodeMs += Ms;
+		Encoder.EncodedFrames++;
+		capture->States[Slot] = CaptureSlotEncoded;
+		Encoder.Encoded.notify_all();
+	}
+}
+
+static void QueueForEncoding(FrameCapture& capture, int slot)
+{
+	capture.States[slot] = CaptureSlotEncoding;
+	{
+		std::lock_guard<std::mutex> Lock(capture.Encoder->Mutex);
+		capture.Encoder->Slots.push_back(slot);
+	}
+	capture.Encoder->Queued.notify_one();
+	capture.FramesCaptured++;
+}
+
+// The copy of slot is done: hand its memory to the encoder
+static void HandOver(FrameCapture& capture, int slot)
+{
+	glDeleteSync(capture.Fences[slot]);
+	capture.Fences[slot] = 0;
+	if (!capture.Persistent) {
+		CachedBindBuffer(GL_PIXEL_PACK_BUFFER, GpuName(capture.Buffers[slot]));
+		capture.Pixels[slot] = (unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)capture.Width * capture.Height * 4, GL_MAP_READ_BIT);
+		CachedBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (capture.Pixels[slot] == NULL) {
+			// Nothing to encode, and nothing to unmap: the slot is free again and the frame is lost
+			fprintf(stderr, "Capture: can't map the pixels of a frame, skipping it\n");
+			capture.States[slot] = CaptureSlotFree;
+			return;
+		}
+	}
+	QueueForEncoding(capture, slot);
+}
+
+// The encoder gave slot back
+static void Recycle(FrameCapture& capture, int slot)
+{
+	if (!capture.Persistent && !capture.Synchronous) {
+		CachedBindBuffer(GL_PIXEL_PACK_BUFFER, GpuName(capture.Buffers[slot]));
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		CachedBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		capture.Pixels[slot] = NULL;
+	}
+	capture.States[slot] = CaptureSlotFree;
+}
+
+// Non-blocking: hands over the reads that are done (oldest first, so the encoder gets the frames in order)
+// and takes back the slots the encoder finished with
+static void PollSlots(FrameCapture& capture)
+{
+	bool InOrder = true;
+	for (int i = 0; i < FRAME_CAPTURE_SLOTS; i++) {
+		int Slot = (capture.Next + i) % FRAME_CAPTURE_SLOTS;
+		int State = capture.States[Slot];
+		if (State == CaptureSlotReading && InOrder) {
+			// Flushing, so the fence is sure to be signaled eventually
+			GLenum Result = glClientWaitSync(capture.Fences[Slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			if (Result == GL_ALREADY_SIGNALED || Result == GL_CONDITION_SATISFIED) {
+				HandOver(capture, Slot);
+			}
+			else {
+				InOrder = false;
+			}
+		}
+		else if (State == CaptureSlotEncoded) {
+			Recycle(capture, Slot);
+		}
+	}
+}
+
+// Blocking: waits until slot is free
+static void WaitForSlot(FrameCapture& capture, int slot)
+{
+	if (capture.States[slot] == CaptureSlotReading) {
+		GLenum Result;
+		do {
+			Result = glClientWaitSync(capture.Fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms, in nanoseconds
+		} while (Result == GL_TIMEOUT_EXPIRED);
+		HandOver(capture, slot);
+	}
+	if (capture.States[slot] == CaptureSlotEncoding) {
+		std::unique_lock<std::mutex> Lock(capture.Encoder->Mutex);
+		capture.Encoder->Encoded.wait(Lock, [&] { return capture.States[slot] == CaptureSlotEncoded; });
+	}
+	if (capture.States[slot] == CaptureSlotEncoded) {
+		Recycle(capture, slot);
+	}
+}
+
+// Frees the pixels or releases the buffers of every slot, whichever were made
+static void ReleaseSlots(FrameCapture& capture)
+{
+	for (int i = 0; i < FRAME_CAPTURE_SLOTS; i++) {
+		if (capture.Synchronous) {
+			free(capture.Pixels[i]);
+		}
+		else {
+			if (capture.Persistent && capture.Pixels[i] != NULL) {
+				CachedBindBuffer(GL_PIXEL_PACK_BUFFER, GpuName(capture.Buffers[i]));
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			ReleaseGpuResource(capture.Buffers[i]);
+		}
+		capture.Pixels[i] = NULL;
+	}
+	CachedBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+bool CreateFrameCapture(FrameCapture& capture, int width, int height, const char* path, CaptureFormat format, bool synchronous)
+{
+	capture.Width = width;
+	capture.Height = height;
+	capture.Format = format;
+	capture.Path = path;
+	capture.Synchronous = synchronous;
+	capture.Persistent = !synchronous && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+	capture.Next = 0;
+	capture.FramesCaptured = 0;
+	capture.Stalls = 0;
+	capture.StallMs = 0.0;
+	capture.Encoder = new CaptureEncoder();
+	capture.Encoder->Stopping = false;
+	capture.Encoder->RawFile = NULL;
+	capture.Encoder->EncodeMs = 0.0;
+	capture.Encoder->EncodedFrames = 0;
+
+	if (format == CaptureRaw) {
+		capture.Encoder->RawFile = fopen(path, "wb");
+		if (capture.Encoder->RawFile == NULL) {
+			fprintf(stderr, "Capture: can't write %s\n", path);
+			delete capture.Encoder;
+			capture.Encoder = NULL;
+			return false;
+		}
+	}
+
+	GLsizeiptr Size = (GLsizeiptr)width * height * 4;
+	for (int i = 0; i < FRAME_CAPTURE_SLOTS; i++) {
+		capture.Buffers[i].Index = 0;
+		capture.Buffers[i].Generation = 0;
+		capture.Fences[i] = 0;
+		capture.Pixels[i] = NULL;
+		capture.Frames[i] = -1;
+		capture.States[i] = CaptureSlotFree;
+	}
+	bool Allocated = true;
+	for (int i = 0; i < FRAME_CAPTURE_SLOTS && Allocated; i++) {
+		if (synchronous) {
+			capture.Pixels[i] = (unsigned char*)malloc(Size);
+			Allocated = capture.Pixels[i] != NULL;
+			continue;
+		}
+		capture.Buffers[i] = CreateGpuBuffer("capture pixels");
+		CachedBindBuffer(GL_PIXEL_PACK_BUFFER, GpuName(capture.Buffers[i]));
+		SetGpuBufferSize(capture.Buffers[i], Size);
+		if (capture.Persistent) {
+			GLbitfield Flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_PACK_BUFFER, Size, NULL, Flags | GL_CLIENT_STORAGE_BIT);
+			capture.Pixels[i] = (unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, Size, Flags);
+			Allocated = capture.Pixels[i] != NULL;
+		}
+		else {
+			glBufferData(GL_PIXEL_PACK_BUFFER, Size, NULL, GL_STREAM_READ);
+		}
+	}
+	CachedBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (!Allocated) {
+		fprintf(stderr, "Capture: can't %s the pixels of %d %dx%d frames\n", synchronous ? "allocate" : "map", FRAME_CAPTURE_SLOTS, width, height);
+		ReleaseSlots(capture);
+		if (capture.Encoder->RawFile != NULL) {
+			fclose(capture.Encoder->RawFile);
+		}
+		delete capture.Encoder;
+		capture.Encoder = NULL;
+		return false;
+	}
+
+	capture.Encoder->Thread = std::thread(EncoderMain, &capture);
+	printf("Capturing %dx%d frames to %s (%s, %s)\n", width, height, path, format == CapturePNG ? "png" : "raw",
+		synchronous ? "synchronous glReadPixels" : capture.Persistent ? "persistent PBO ring" : "PBO ring");
+	return true;
+}
+
+void CaptureFrame(FrameCapture& capture, int frame)
+{
+	PollSlots(capture);
+
+	int Slot = capture.Next;
+	if (capture.States[Slot] != CaptureSlotFree) {
+		// Every slot is busy: either the GPU or the encoder is FRAME_CAPTURE_SLOTS frames behind
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		WaitForSlot(capture, Slot);
+		capture.StallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		capture.Stalls++;
+	}
+	capture.Next = (Slot + 1) % FRAME_CAPTURE_SLOTS;
+	capture.Frames[Slot] = frame;
+
+	if (capture.Synchronous) {
+		// Waits for the frame to finish rendering, then copies it
+		glReadPixels(0, 0, capture.Width, capture.Height, GL_RGBA, GL_UNSIGNED_BYTE, capture.Pixels[Slot]);
+		QueueForEncoding(capture, Slot);
+		return;
+	}
+
+	// Into the buffer: only queued, the copy happens when the GPU gets there
+	CachedBindBuffer(GL_PIXEL_PACK_BUFFER, GpuName(capture.Buffers[Slot]));
+	glReadPixels(0, 0, capture.Width, capture.Height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	CachedBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	capture.Fences[Slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	capture.States[Slot] = CaptureSlotReading;
+}
+
+void FinishFrameCapture(FrameCapture& capture)
+{
+	// Oldest first, the frames reach the encoder in order
+	for (int i = 0; i < FRAME_CAPTURE_SLOTS; i++) {
+		WaitForSlot(capture, (capture.Next + i) % FRAME_CAPTURE_SLOTS);
+	}
+}
+
+void DestroyFrameCapture(FrameCapture& capture)
+{
+	if (capture.Encoder == NULL) {
+		return;
+	}
+	FinishFrameCapture(capture);
+	{
+		std::lock_guard<std::mutex> Lock(capture.Encoder->Mutex);
+		capture.Encoder->Stopping = true;
+	}
+	capture.Encoder->Queued.notify_one();
+	capture.Encoder->Thread.join();
+	if (capture.Encoder->RawFile != NULL) {
+		fclose(capture.Encoder->RawFile);
+	}
+
+	ReleaseSlots(capture);
+	delete capture.Encoder;
+	capture.Encoder = NULL;
+}
+
+double CaptureEncodeMsPerFrame(const FrameCapture& capture)
+{
+	if (capture.Encoder == NULL || capture.Encoder->EncodedFrames == 0) {
+		return 0.0;
+	}
+	return capture.Encoder->EncodeMs / capture.Encoder->EncodedFrames;
+}
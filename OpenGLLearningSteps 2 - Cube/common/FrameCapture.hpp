@@ -0,0 +1,72 @@
+#ifndef FRAMECAPTURE_HPP
+#define FRAMECAPTURE_HPP
+
+#include <atomic>
+
+#include "GpuResources.hpp"
+
+// Records the rendered frames (regression images, video) without draining the pipeline like a plain glReadPixels().
+// The read goes into one of a ring of pixel buffer objects, so glReadPixels() only queues a copy and returns,
+// and a fence after it tells when the copy is done. A few frames later the buffer's memory is handed, mapped,
+// to an encoder thread that writes the file. The buffer comes back to the ring once the encoder is done with it.
+// The render loop only waits when every slot is still busy, and that's counted as a stall.
+// With GL 4.4 / ARB_buffer_storage the buffers stay mapped (persistent and coherent), otherwise each one is
+// mapped once its fence passed and unmapped when the encoder gives it back.
+//
+// Synchronous mode does the usual glReadPixels() into memory instead, the baseline to compare against.
+
+// Frames in flight: the read of frame N is handed to the encoder at the latest when frame N + FRAME_CAPTURE_SLOTS starts
+#define FRAME_CAPTURE_SLOTS 4
+
+enum CaptureFormat
+{
+	CapturePNG,		// One PNG per frame in a directory, frame_00000.png...
+	CaptureRaw		// Every frame appended to one file, RGBA top row first (ffmpeg -f rawvideo -pix_fmt rgba -s WxH)
+};
+
+enum CaptureSlotState
+{
+	CaptureSlotFree,
+	CaptureSlotReading,		// The GPU is copying the frame into the buffer
+	CaptureSlotEncoding,	// The encoder thread has it
+	CaptureSlotEncoded		// The encoder is done, the GL thread can unmap it and use it again
+};
+
+struct CaptureEncoder;
+
+struct FrameCapture
+{
+	int Width;
+	int Height;
+	CaptureFormat Format;
+	const char* Path;			// Directory for PNG, file for raw
+	bool Synchronous;
+	bool Persistent;
+	GpuBufferHandle Buffers[FRAME_CAPTURE_SLOTS];
+	GLsync Fences[FRAME_CAPTURE_SLOTS];
+	unsigned char* Pixels[FRAME_CAPTURE_SLOTS];		// Mapped buffer, or plain memory when synchronous
+	int Frames[FRAME_CAPTURE_SLOTS];				// Frame number of what's in each slot
+	std::atomic<int> States[FRAME_CAPTURE_SLOTS];	// CaptureSlotState, the encoder thread changes it too
+	int Next;					// Slot of the next frame, also the oldest one in flight
+	CaptureEncoder* Encoder;
+
+	int FramesCaptured;
+	int Stalls;					// Frames that had to wait for a slot
+	double StallMs;
+};
+
+bool ParseCaptureFormat(const char* name, CaptureFormat& format);
+
+bool CreateFrameCapture(FrameCapture& capture, int width, int height, const char* path, CaptureFormat format, bool synchronous);
+
+// Reads the current frame back from the read framebuffer. Call it after the last draw, before swapping buffers.
+void CaptureFrame(FrameCapture& capture, int frame);
+
+// Waits for every frame still in flight to be written
+void FinishFrameCapture(FrameCapture& capture);
+void DestroyFrameCapture(FrameCapture& capture);
+
+// Average time the encoder thread spent on a frame
+double CaptureEncodeMsPerFrame(const FrameCapture& capture);
+
+#endif
@@ -0,0 +1,816 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <utility>
+
+#include <GL/glew.h>
+
+// This file calls the real GL 1.1 functions, and sets up the pointers everything else calls them through
+#define GL_TRACE_NO_REDIRECT
+#include "GlTrace.hpp"
+#include "GlTraceFormat.hpp"
+
+GlTraceClearProc GlTraceClear = glClear;
+GlTraceClearColorProc GlTraceClearColor = glClearColor;
+GlTraceCapabilityProc GlTraceEnable = glEnable;
+GlTraceCapabilityProc GlTraceDisable = glDisable;
+GlTraceDrawElementsProc GlTraceDrawElements = glDrawElements;
+GlTraceReadPixelsProc GlTraceReadPixels = glReadPixels;
+
+// The GLEW pointers that get swapped, by name without the gl prefix, and their type
+#define GL_TRACE_GLEW_FUNCTIONS(X) \
+	X(GenBuffers, PFNGLGENBUFFERSPROC) \
+	X(DeleteBuffers, PFNGLDELETEBUFFERSPROC) \
+	X(BindBuffer, PFNGLBINDBUFFERPROC) \
+	X(BindBufferRange, PFNGLBINDBUFFERRANGEPROC) \
+	X(BufferData, PFNGLBUFFERDATAPROC) \
+	X(BufferStorage, PFNGLBUFFERSTORAGEPROC) \
+	X(MapBufferRange, PFNGLMAPBUFFERRANGEPROC) \
+	X(UnmapBuffer, PFNGLUNMAPBUFFERPROC) \
+	X(CopyBufferSubData, PFNGLCOPYBUFFERSUBDATAPROC) \
+	X(ClearBufferData, PFNGLCLEARBUFFERDATAPROC) \
+	X(GenVertexArrays, PFNGLGENVERTEXARRAYSPROC) \
+	X(DeleteVertexArrays, PFNGLDELETEVERTEXARRAYSPROC) \
+	X(BindVertexArray, PFNGLBINDVERTEXARRAYPROC) \
+	X(EnableVertexAttribArray, PFNGLENABLEVERTEXATTRIBARRAYPROC) \
+	X(VertexAttribPointer, PFNGLVERTEXATTRIBPOINTERPROC) \
+	X(VertexAttribDivisor, PFNGLVERTEXATTRIBDIVISORPROC) \
+	X(CreateShader, PFNGLCREATESHADERPROC) \
+	X(ShaderSource, PFNGLSHADERSOURCEPROC) \
+	X(CompileShader, PFNGLCOMPILESHADERPROC) \
+	X(AttachShader, PFNGLATTACHSHADERPROC) \
+	X(DetachShader, PFNGLDETACHSHADERPROC) \
+	X(DeleteShader, PFNGLDELETESHADERPROC) \
+	X(CreateProgram, PFNGLCREATEPROGRAMPROC) \
+	X(LinkProgram, PFNGLLINKPROGRAMPROC) \
+	X(DeleteProgram, PFNGLDELETEPROGRAMPROC) \
+	X(ProgramBinary, PFNGLPROGRAMBINARYPROC) \
+	X(ProgramParameteri, PFNGLPROGRAMPARAMETERIPROC) \
+	X(UseProgram, PFNGLUSEPROGRAMPROC) \
+	X(GetUniformLocation, PFNGLGETUNIFORMLOCATIONPROC) \
+	X(GetUniformBlockIndex, PFNGLGETUNIFORMBLOCKINDEXPROC) \
+	X(UniformBlockBinding, PFNGLUNIFORMBLOCKBINDINGPROC) \
+	X(Uniform1i, PFNGLUNIFORM1IPROC) \
+	X(Uniform1ui, PFNGLUNIFORM1UIPROC) \
+	X(DrawElementsInstanced, PFNGLDRAWELEMENTSINSTANCEDPROC) \
+	X(DrawElementsInstancedBaseInstance, PFNGLDRAWELEMENTSINSTANCEDBASEINSTANCEPROC) \
+	X(MultiDrawElementsIndirect, PFNGLMULTIDRAWELEMENTSINDIRECTPROC) \
+	X(MultiDrawElementsIndirectCountARB, PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC) \
+	X(DispatchCompute, PFNGLDISPATCHCOMPUTEPROC) \
+	X(MemoryBarrier, PFNGLMEMORYBARRIERPROC) \
+	X(FenceSync, PFNGLFENCESYNCPROC) \
+	X(ClientWaitSync, PFNGLCLIENTWAITSYNCPROC) \
+	X(DeleteSync, PFNGLDELETESYNCPROC)
+
+// The functions the calls really go to while recording
+#define GL_TRACE_DECLARE_REAL(Name, Type) static Type Real##Name;
+GL_TRACE_GLEW_FUNCTIONS(GL_TRACE_DECLARE_REAL)
+static GlTraceClearProc RealClear;
+static GlTraceClearColorProc RealClearColor;
+static GlTraceCapabilityProc RealEnable;
+static GlTraceCapabilityProc RealDisable;
+static GlTraceDrawElementsProc RealDrawElements;
+static GlTraceReadPixelsProc RealReadPixels;
+
+// Pending bytes are written out at the end of every frame, or as soon as there are this many
+static const size_t FlushSize = 16 * 1024 * 1024;
+
+struct TraceMapping
+{
+	GLuint Buffer;
+	GLintptr Offset;
+	GLsizeiptr Length;
+	GLbitfield Access;
+	const unsigned char* Pointer;
+};
+
+// A buffer range that was mapped for writing, and what it held when it was last unmapped
+typedef std::pair<GLuint, std::pair<GLintptr, GLsizeiptr> > ShadowKey;
+
+struct TraceRecorder
+{
+	FILE* File;
+	const char* Path;
+	std::vector<unsigned char> Pending;
+	GLuint Bound[GL_TRACE_TARGETS];
+	std::vector<TraceMapping> Mappings;
+	std::map<ShadowKey, std::vector<unsigned char> > Shadows;
+	unsigned long long Calls;
+	unsigned long long Frames;
+	unsigned long long BytesWritten;
+	unsigned long long MappedBytes;		// Unmapped write ranges, all of them
+	unsigned long long ChangedBytes;	// What of them was saved
+};
+
+static TraceRecorder Recorder;
+static bool Recording = false;
+
+static void FlushPending()
+{
+	if (!Recorder.Pending.empty()) {
+		fwrite(&Recorder.Pending[0], 1, Recorder.Pending.size(), Recorder.File);
+		Recorder.BytesWritten += Recorder.Pending.size();
+		Recorder.Pending.clear();
+	}
+}
+
+static void PutBytes(const void* data, size_t size)
+{
+	const unsigned char* Bytes = (const unsigned char*)data;
+	Recorder.Pending.insert(Recorder.Pending.end(), Bytes, Bytes + size);
+}
+
+static void Put32(uint32_t value)
+{
+	PutBytes(&value, sizeof(value));
+}
+
+static void PutFloat(float value)
+{
+	PutBytes(&value, sizeof(value));
+}
+
+static void Put64(uint64_t value)
+{
+	PutBytes(&value, sizeof(value));
+}
+
+static void PutPointer(const void* pointer)
+{
+	Put64((uint64_t)(uintptr_t)pointer);
+}
+
+static void PutData(const void* data, uint64_t size)
+{
+	Put64(size);
+	PutBytes(data, (size_t)size);
+	if (Recorder.Pending.size() >= FlushSize) {
+		FlushPending();
+	}
+}
+
+static void PutString(const char* text, GLint length)
+{
+	PutData(text, length >= 0 ? (uint64_t)length : strlen(text));
+}
+
+static void BeginCall(GlTraceCall call)
+{
+	Recorder.Pending.push_back((unsigned char)call);
+	Recorder.Calls++;
+}
+
+static void PutNames(GLsizei n, const GLuint* names)
+{
+	Put32((uint32_t)n);
+	PutBytes(names, n * sizeof(GLuint));
+}
+
+static int FindMapping(GLuint buffer)
+{
+	for (size_t i = 0; i < Recorder.Mappings.size(); i++) {
+		if (Recorder.Mappings[i].Buffer == buffer) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+// The chunks of the range that differ from the last time it was unmapped, as runs of chunks
+static void PutMappedChanges(const TraceMapping& mapping)
+{
+	ShadowKey Key(mapping.Buffer, std::make_pair(mapping.Offset, mapping.Length));
+	std::vector<unsigned char>& Shadow = Recorder.Shadows[Key];
+	size_t Length = (size_t)mapping.Length;
+	if (Shadow.size() != Length) {
+		Shadow.assign(Length, 0);
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t> > Runs;
+	uint32_t Chunks = (uint32_t)((Length + GL_TRACE_DELTA_CHUNK - 1) / GL_TRACE_DELTA_CHUNK);
+	for (uint32_t c = 0; c < Chunks; c++) {
+		size_t Start = (size_t)c * GL_TRACE_DELTA_CHUNK;
+		size_t Size = Length - Start < GL_TRACE_DELTA_CHUNK ? Length - Start : GL_TRACE_DELTA_CHUNK;
+		if (memcmp(mapping.Pointer + Start, &Shadow[Start], Size) == 0) {
+			continue;
+		}
+		if (!Runs.empty() && Runs.back().first + Runs.back().second == c) {
+			Runs.back().second++;
+		}
+		else {
+			Runs.push_back(std::make_pair(c, 1u));
+		}
+	}
+
+	Put32((uint32_t)Runs.size());
+	for (size_t r = 0; r < Runs.size(); r++) {
+		size_t Start = (size_t)Runs[r].first * GL_TRACE_DELTA_CHUNK;
+		size_t End = Start + (size_t)Runs[r].second * GL_TRACE_DELTA_CHUNK;
+		End = End < Length ? End : Length;
+		Put32(Runs[r].first);
+		Put32(Runs[r].second);
+		PutBytes(mapping.Pointer + Start, End - Start);
+		memcpy(&Shadow[Start], mapping.Pointer + Start, End - Start);
+		Recorder.ChangedBytes += End - Start;
+	}
+	Recorder.MappedBytes += Length;
+	if (Recorder.Pending.size() >= FlushSize) {
+		FlushPending();
+	}
+}
+
+// Bytes of one value of format and type, for glClearBufferData()
+static size_t ClearValueSize(GLenum format, GLenum type)
+{
+	size_t Components = 4;
+	switch (format) {
+	case GL_RED: case GL_RED_INTEGER: Components = 1; break;
+	case GL_RG: case GL_RG_INTEGER: Components = 2; break;
+	case GL_RGB: case GL_RGB_INTEGER: Components = 3; break;
+	default: break;
+	}
+	size_t TypeSize = 4;
+	switch (type) {
+	case GL_BYTE: case GL_UNSIGNED_BYTE: TypeSize = 1; break;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: TypeSize = 2; break;
+	default: break;
+	}
+	return Components * TypeSize;
+}
+
+static void GLAPIENTRY RecordGenBuffers(GLsizei n, GLuint* buffers)
+{
+	RealGenBuffers(n, buffers);
+	BeginCall(TraceGenBuffers);
+	PutNames(n, buffers);
+}
+
+static void GLAPIENTRY RecordDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+	for (GLsizei i = 0; i < n; i++) {
+		int Mapping = FindMapping(buffers[i]);
+		if (Mapping >= 0) {
+			Recorder.Mappings.erase(Recorder.Mappings.begin() + Mapping);
+		}
+		std::map<ShadowKey, std::vector<unsigned char> >::iterator It = Recorder.Shadows.lower_bound(ShadowKey(buffers[i], std::make_pair((GLintptr)0, (GLsizeiptr)0)));
+		while (It != Recorder.Shadows.end() && It->first.first == buffers[i]) {
+			It = Recorder.Shadows.erase(It);
+		}
+		for (int t = 0; t < GL_TRACE_TARGETS; t++) {
+			if (Recorder.Bound[t] == buffers[i]) {
+				Recorder.Bound[t] = 0;
+			}
+		}
+	}
+	BeginCall(TraceDeleteBuffers);
+	PutNames(n, buffers);
+	RealDeleteBuffers(n, buffers);
+}
+
+static void GLAPIENTRY RecordBindBuffer(GLenum target, GLuint buffer)
+{
+	int Slot = GlTraceTargetSlot(target);
+	if (Slot >= 0) {
+		Recorder.Bound[Slot] = buffer;
+	}
+	BeginCall(TraceBindBuffer);
+	Put32(target);
+	Put32(buffer);
+	RealBindBuffer(target, buffer);
+}
+
+static void GLAPIENTRY RecordBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	// Binds the generic binding point too
+	int Slot = GlTraceTargetSlot(target);
+	if (Slot >= 0) {
+		Recorder.Bound[Slot] = buffer;
+	}
+	BeginCall(TraceBindBufferRange);
+	Put32(target);
+	Put32(index);
+	Put32(buffer);
+	Put64((uint64_t)offset);
+	Put64((uint64_t)size);
+	RealBindBufferRange(target, index, buffer, offset, size);
+}
+
+static void GLAPIENTRY RecordBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	BeginCall(TraceBufferData);
+	Put32(target);
+	Put64((uint64_t)size);
+	Put32(usage);
+	Put32(data != NULL);
+	if (data != NULL) {
+		PutData(data, (uint64_t)size);
+	}
+	RealBufferData(target, size, data, usage);
+}
+
+static void GLAPIENTRY RecordBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+	BeginCall(TraceBufferStorage);
+	Put32(target);
+	Put64((uint64_t)size);
+	Put32(flags);
+	Put32(data != NULL);
+	if (data != NULL) {
+		PutData(data, (uint64_t)size);
+	}
+	RealBufferStorage(target, size, data, flags);
+}
+
+static void* GLAPIENTRY RecordMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	void* Pointer = RealMapBufferRange(target, offset, length, access);
+	int Slot = GlTraceTargetSlot(target);
+	if (Pointer == NULL || Slot < 0) {
+		return Pointer;
+	}
+	if ((access & GL_MAP_WRITE_BIT) && (access & GL_MAP_PERSISTENT_BIT)) {
+		fprintf(stderr, "GL trace: buffer %u is mapped persistently for writing, what's written to it won't be in the trace\n", Recorder.Bound[Slot]);
+	}
+	TraceMapping Mapping = { Recorder.Bound[Slot], offset, length, access, (const unsigned char*)Pointer };
+	Recorder.Mappings.push_back(Mapping);
+	BeginCall(TraceMapBufferRange);
+	Put32(target);
+	Put64((uint64_t)offset);
+	Put64((uint64_t)length);
+	Put32(access);
+	return Pointer;
+}
+
+static GLboolean GLAPIENTRY RecordUnmapBuffer(GLenum target)
+{
+	// What was written has to be saved while it's still mapped
+	int Slot = GlTraceTargetSlot(target);
+	int Mapping = Slot >= 0 ? FindMapping(Recorder.Bound[Slot]) : -1;
+	if (Mapping >= 0) {
+		BeginCall(TraceUnmapBuffer);
+		Put32(target);
+		if (Recorder.Mappings[Mapping].Access & GL_MAP_WRITE_BIT) {
+			PutMappedChanges(Recorder.Mappings[Mapping]);
+		}
+		Recorder.Mappings.erase(Recorder.Mappings.begin() + Mapping);
+	}
+	return RealUnmapBuffer(target);
+}
+
+static void GLAPIENTRY RecordCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+	BeginCall(TraceCopyBufferSubData);
+	Put32(readTarget);
+	Put32(writeTarget);
+	Put64((uint64_t)readOffset);
+	Put64((uint64_t)writeOffset);
+	Put64((uint64_t)size);
+	RealCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+}
+
+static void GLAPIENTRY RecordClearBufferData(GLenum target, GLenum internalformat, GLenum format, GLenum type, const void* data)
+{
+	BeginCall(TraceClearBufferData);
+	Put32(target);
+	Put32(internalformat);
+	Put32(format);
+	Put32(type);
+	Put32(data != NULL);
+	if (data != NULL) {
+		PutData(data, ClearValueSize(format, type));
+	}
+	RealClearBufferData(target, internalformat, format, type, data);
+}
+
+static void GLAPIENTRY RecordGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+	RealGenVertexArrays(n, arrays);
+	BeginCall(TraceGenVertexArrays);
+	PutNames(n, arrays);
+}
+
+static void GLAPIENTRY RecordDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+	BeginCall(TraceDeleteVertexArrays);
+	PutNames(n, arrays);
+	RealDeleteVertexArrays(n, arrays);
+}
+
+static void GLAPIENTRY RecordBindVertexArray(GLuint array)
+{
+	BeginCall(TraceBindVertexArray);
+	Put32(array);
+	RealBindVertexArray(array);
+}
+
+static void GLAPIENTRY RecordEnableVertexAttribArray(GLuint index)
+{
+	BeginCall(TraceEnableVertexAttribArray);
+	Put32(index);
+	RealEnableVertexAttribArray(index);
+}
+
+static void GLAPIENTRY RecordVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+	// Always an offset into the bound array buffer here, client side arrays don't exist in the core profile
+	BeginCall(TraceVertexAttribPointer);
+	Put32(index);
+	Put32((uint32_t)size);
+	Put32(type);
+	Put32(normalized);
+	Put32((uint32_t)stride);
+	PutPointer(pointer);
+	RealVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static void GLAPIENTRY RecordVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	BeginCall(TraceVertexAttribDivisor);
+	Put32(index);
+	Put32(divisor);
+	RealVertexAttribDivisor(index, divisor);
+}
+
+static GLuint GLAPIENTRY RecordCreateShader(GLenum type)
+{
+	GLuint Shader = RealCreateShader(type);
+	BeginCall(TraceCreateShader);
+	Put32(type);
+	Put32(Shader);
+	return Shader;
+}
+
+static void GLAPIENTRY RecordShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+	BeginCall(TraceShaderSource);
+	Put32(shader);
+	Put32((uint32_t)count);
+	for (GLsizei i = 0; i < count; i++) {
+		PutString(string[i], length != NULL ? length[i] : -1);
+	}
+	RealShaderSource(shader, count, string, length);
+}
+
+static void GLAPIENTRY RecordCompileShader(GLuint shader)
+{
+	BeginCall(TraceCompileShader);
+	Put32(shader);
+	RealCompileShader(shader);
+}
+
+static void GLAPIENTRY RecordAttachShader(GLuint program, GLuint shader)
+{
+	BeginCall(TraceAttachShader);
+	Put32(program);
+	Put32(shader);
+	RealAttachShader(program, shader);
+}
+
+static void GLAPIENTRY RecordDetachShader(GLuint program, GLuint shader)
+{
+	BeginCall(TraceDetachShader);
+	Put32(program);
+	Put32(shader);
+	RealDetachShader(program, shader);
+}
+
+static void GLAPIENTRY RecordDeleteShader(GLuint shader)
+{
+	BeginCall(TraceDeleteShader);
+	Put32(shader);
+	RealDeleteShader(shader);
+}
+
+static GLuint GLAPIENTRY RecordCreateProgram()
+{
+	GLuint Program = RealCreateProgram();
+	BeginCall(TraceCreateProgram);
+	Put32(Program);
+	return Program;
+}
+
+static void GLAPIENTRY RecordLinkProgram(GLuint program)
+{
+	BeginCall(TraceLinkProgram);
+	Put32(program);
+	RealLinkProgram(program);
+}
+
+static void GLAPIENTRY RecordDeleteProgram(GLuint program)
+{
+	BeginCall(TraceDeleteProgram);
+	Put32(program);
+	RealDeleteProgram(program);
+}
+
+static void GLAPIENTRY RecordProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)
+{
+	BeginCall(TraceProgramBinary);
+	Put32(program);
+	Put32(binaryFormat);
+	PutData(binary, (uint64_t)length);
+	RealProgramBinary(program, binaryFormat, binary, length);
+}
+
+static void GLAPIENTRY RecordProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+	BeginCall(TraceProgramParameteri);
+	Put32(program);
+	Put32(pname);
+	Put32((uint32_t)value);
+	RealProgramParameteri(program, pname, value);
+}
+
+static void GLAPIENTRY RecordUseProgram(GLuint program)
+{
+	BeginCall(TraceUseProgram);
+	Put32(program);
+	RealUseProgram(program);
+}
+
+static GLint GLAPIENTRY RecordGetUniformLocation(GLuint program, const GLchar* name)
+{
+	GLint Location = RealGetUniformLocation(program, name);
+	BeginCall(TraceGetUniformLocation);
+	Put32(program);
+	PutString(name, -1);
+	Put32((uint32_t)Location);
+	return Location;
+}
+
+static GLuint GLAPIENTRY RecordGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName)
+{
+	GLuint Index = RealGetUniformBlockIndex(program, uniformBlockName);
+	BeginCall(TraceGetUniformBlockIndex);
+	Put32(program);
+	PutString(uniformBlockName, -1);
+	Put32(Index);
+	return Index;
+}
+
+static void GLAPIENTRY RecordUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+{
+	BeginCall(TraceUniformBlockBinding);
+	Put32(program);
+	Put32(uniformBlockIndex);
+	Put32(uniformBlockBinding);
+	RealUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+}
+
+static void GLAPIENTRY RecordUniform1i(GLint location, GLint v0)
+{
+	BeginCall(TraceUniform1i);
+	Put32((uint32_t)location);
+	Put32((uint32_t)v0);
+	RealUniform1i(location, v0);
+}
+
+static void GLAPIENTRY RecordUniform1ui(GLint location, GLuint v0)
+{
+	BeginCall(TraceUniform1ui);
+	Put32((uint32_t)location);
+	Put32(v0);
+	RealUniform1ui(location, v0);
+}
+
+static void GLAPIENTRY RecordClear(GLbitfield mask)
+{
+	BeginCall(TraceClear);
+	Put32(mask);
+	RealClear(mask);
+}
+
+static void GLAPIENTRY RecordClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	BeginCall(TraceClearColor);
+	PutFloat(red);
+	PutFloat(green);
+	PutFloat(blue);
+	PutFloat(alpha);
+	RealClearColor(red, green, blue, alpha);
+}
+
+static void GLAPIENTRY RecordEnable(GLenum cap)
+{
+	BeginCall(TraceEnable);
+	Put32(cap);
+	RealEnable(cap);
+}
+
+static void GLAPIENTRY RecordDisable(GLenum cap)
+{
+	BeginCall(TraceDisable);
+	Put32(cap);
+	RealDisable(cap);
+}
+
+static void GLAPIENTRY RecordDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	BeginCall(TraceDrawElements);
+	Put32(mode);
+	Put32((uint32_t)count);
+	Put32(type);
+	PutPointer(indices);
+	RealDrawElements(mode, count, type, indices);
+}
+
+static void GLAPIENTRY RecordDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount)
+{
+	BeginCall(TraceDrawElementsInstanced);
+	Put32(mode);
+	Put32((uint32_t)count);
+	Put32(type);
+	PutPointer(indices);
+	Put32((uint32_t)instancecount);
+	RealDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
+
+static void GLAPIENTRY RecordDrawElementsInstancedBaseInstance(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLuint baseinstance)
+{
+	BeginCall(TraceDrawElementsInstancedBaseInstance);
+	Put32(mode);
+	Put32((uint32_t)count);
+	Put32(type);
+	PutPointer(indices);
+	Put32((uint32_t)instancecount);
+	Put32(baseinstance);
+	RealDrawElementsInstancedBaseInstance(mode, count, type, indices, instancecount, baseinstance);
+}
+
+static void GLAPIENTRY RecordMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride)
+{
+	BeginCall(TraceMultiDrawElementsIndirect);
+	Put32(mode);
+	Put32(type);
+	PutPointer(indirect);
+	Put32((uint32_t)drawcount);
+	Put32((uint32_t)stride);
+	RealMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+}
+
+static void GLAPIENTRY RecordMultiDrawElementsIndirectCountARB(GLenum mode, GLenum type, const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride)
+{
+	BeginCall(TraceMultiDrawElementsIndirectCount);
+	Put32(mode);
+	Put32(type);
+	PutPointer(indirect);
+	Put64((uint64_t)drawcount);
+	Put32((uint32_t)maxdrawcount);
+	Put32((uint32_t)stride);
+	RealMultiDrawElementsIndirectCountARB(mode, type, indirect, drawcount, maxdrawcount, stride);
+}
+
+static void GLAPIENTRY RecordDispatchCompute(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ)
+{
+	BeginCall(TraceDispatchCompute);
+	Put32(numGroupsX);
+	Put32(numGroupsY);
+	Put32(numGroupsZ);
+	RealDispatchCompute(numGroupsX, numGroupsY, numGroupsZ);
+}
+
+static void GLAPIENTRY RecordMemoryBarrier(GLbitfield barriers)
+{
+	BeginCall(TraceMemoryBarrier);
+	Put32(barriers);
+	RealMemoryBarrier(barriers);
+}
+
+static void GLAPIENTRY RecordReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+	// Into a pixel pack buffer pixels is an offset, otherwise the replay reads into memory of its own
+	bool PackBuffer = Recorder.Bound[GlTraceTargetSlot(GL_PIXEL_PACK_BUFFER)] != 0;
+	BeginCall(TraceReadPixels);
+	Put32((uint32_t)x);
+	Put32((uint32_t)y);
+	Put32((uint32_t)width);
+	Put32((uint32_t)height);
+	Put32(format);
+	Put32(type);
+	Put32(PackBuffer);
+	PutPointer(PackBuffer ? pixels : NULL);
+	RealReadPixels(x, y, width, height, format, type, pixels);
+}
+
+static GLsync GLAPIENTRY RecordFenceSync(GLenum condition, GLbitfield flags)
+{
+	GLsync Sync = RealFenceSync(condition, flags);
+	BeginCall(TraceFenceSync);
+	Put32(condition);
+	Put32(flags);
+	PutPointer(Sync);
+	return Sync;
+}
+
+static GLenum GLAPIENTRY RecordClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	GLenum Result = RealClientWaitSync(sync, flags, timeout);
+	BeginCall(TraceClientWaitSync);
+	PutPointer(sync);
+	Put32(flags);
+	Put64(timeout);
+	Put32(Result);
+	return Result;
+}
+
+static void GLAPIENTRY RecordDeleteSync(GLsync sync)
+{
+	BeginCall(TraceDeleteSync);
+	PutPointer(sync);
+	RealDeleteSync(sync);
+}
+
+bool StartGlTrace(const char* path, int width, int height)
+{
+	if (Recording) {
+		fprintf(stderr, "Already recording a GL trace\n");
+		return false;
+	}
+	FILE* File = fopen(path, "wb");
+	if (File == NULL) {
+		fprintf(stderr, "Can't write the GL trace to %s\n", path);
+		return false;
+	}
+
+	Recorder.File = File;
+	Recorder.Path = path;
+	Recorder.Pending.clear();
+	memset(Recorder.Bound, 0, sizeof(Recorder.Bound));
+	Recorder.Mappings.clear();
+	Recorder.Shadows.clear();
+	Recorder.Calls = 0;
+	Recorder.Frames = 0;
+	Recorder.BytesWritten = 0;
+	Recorder.MappedBytes = 0;
+	Recorder.ChangedBytes = 0;
+
+	GlTraceHeader Header;
+	memcpy(Header.Magic, "GLTR", 4);
+	Header.Version = GL_TRACE_VERSION;
+	Header.Width = (uint32_t)width;
+	Header.Height = (uint32_t)height;
+	PutBytes(&Header, sizeof(Header));
+
+#define GL_TRACE_INSTALL(Name, Type) Real##Name = __glew##Name; __glew##Name = Record##Name;
+	GL_TRACE_GLEW_FUNCTIONS(GL_TRACE_INSTALL)
+#undef GL_TRACE_INSTALL
+	RealClear = GlTraceClear;
+	GlTraceClear = RecordClear;
+	RealClearColor = GlTraceClearColor;
+	GlTraceClearColor = RecordClearColor;
+	RealEnable = GlTraceEnable;
+	GlTraceEnable = RecordEnable;
+	RealDisable = GlTraceDisable;
+	GlTraceDisable = RecordDisable;
+	RealDrawElements = GlTraceDrawElements;
+	GlTraceDrawElements = RecordDrawElements;
+	RealReadPixels = GlTraceReadPixels;
+	GlTraceReadPixels = RecordReadPixels;
+
+	Recording = true;
+	printf("Recording a GL trace to %s\n", path);
+	return true;
+}
+
+bool GlTraceRecording()
+{
+	return Recording;
+}
+
+void GlTraceEndFrame()
+{
+	if (!Recording) {
+		return;
+	}
+	BeginCall(TraceEndFrame);
+	Recorder.Frames++;
+	FlushPending();
+}
+
+void StopGlTrace()
+{
+	if (!Recording) {
+		return;
+	}
+#define GL_TRACE_RESTORE(Name, Type) __glew##Name = Real##Name;
+	GL_TRACE_GLEW_FUNCTIONS(GL_TRACE_RESTORE)
+#undef GL_TRACE_RESTORE
+	GlTraceClear = RealClear;
+	GlTraceClearColor = RealClearColor;
+	GlTraceEnable = RealEnable;
+	GlTraceDisable = RealDisable;
+	GlTraceDrawElements = RealDrawElements;
+	GlTraceReadPixels = RealReadPixels;
+	Recording = false;
+
+	FlushPending();
+	fclose(Recorder.File);
+	printf("GL trace %s: %llu frames, %llu calls, %.2f MB. Mapped writes: %.2f MB unmapped, %.2f MB of it changed and saved\n",
+		Recorder.Path, Recorder.Frames, Recorder.Calls, Recorder.BytesWritten / (1024.0 * 1024.0),
+		Recorder.MappedBytes / (1024.0 * 1024.0), Recorder.ChangedBytes / (1024.0 * 1024.0));
+	Recorder.Mappings.clear();
+	Recorder.Shadows.clear();
+	std::vector<unsigned char>().swap(Recorder.Pending);
+}
@@ -0,0 +1,54 @@
+#ifndef GLTRACE_HPP
+#define GLTRACE_HPP
+
+// GL call recorder: while it's on, the GL calls the frames are made of go into a binary trace along with
+// the data they upload, and --replay runs the trace again headless, as fast as the GPU goes, timing every frame.
+//
+//  - Recording swaps the GLEW function pointers for ones that write the call down, then call the real function.
+//    GLEW doesn't load the GL 1.1 functions, they're plain exports of the GL library, so the ones a frame uses
+//    get pointers here instead, behind the same kind of macro GLEW puts in front of its own. The files that
+//    issue them include this header after GL/glew.h.
+//  - Object names, syncs, uniform locations and block indices are whatever GL returned when recording, the
+//    replay maps them to its own.
+//  - What is written through a mapping is saved when it's unmapped, as the changes since the last time the same
+//    range was unmapped. A persistent mapping has no unmap, so the stream buffer maps each frame while recording.
+//  - Queries and the glGet*() that read something back (glGetBufferSubData() included) aren't recorded,
+//    they don't change what the GPU draws.
+//  - Program binaries are replayed as they were loaded from the shader cache, so a trace replays on the driver
+//    that recorded it. Empty the shader cache (SHADER_CACHE_DIR) first for a trace that travels.
+
+// Starts recording into path. width and height are the framebuffer's, the replay checks it has the same.
+bool StartGlTrace(const char* path, int width, int height);
+bool GlTraceRecording();
+// Marks the end of a frame (after it was presented)
+void GlTraceEndFrame();
+// Puts the GLEW pointers back, writes what's left and prints the size of the trace
+void StopGlTrace();
+
+// Needs a context and the headless framebuffer. Replays the trace, then writes the frame times as JSON
+// (to jsonPath, stdout if NULL), leaving the first warmupFrames out of the stats.
+bool RunGlTraceReplay(const char* path, int warmupFrames, const char* jsonPath);
+
+typedef void (GLAPIENTRY * GlTraceClearProc)(GLbitfield mask);
+typedef void (GLAPIENTRY * GlTraceClearColorProc)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+typedef void (GLAPIENTRY * GlTraceCapabilityProc)(GLenum cap);
+typedef void (GLAPIENTRY * GlTraceDrawElementsProc)(GLenum mode, GLsizei count, GLenum type, const void* indices);
+typedef void (GLAPIENTRY * GlTraceReadPixelsProc)(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels);
+
+extern GlTraceClearProc GlTraceClear;
+extern GlTraceClearColorProc GlTraceClearColor;
+extern GlTraceCapabilityProc GlTraceEnable;
+extern GlTraceCapabilityProc GlTraceDisable;
+extern GlTraceDrawElementsProc GlTraceDrawElements;
+extern GlTraceReadPixelsProc GlTraceReadPixels;
+
+#ifndef GL_TRACE_NO_REDIRECT
+#define glClear GlTraceClear
+#define glClearColor GlTraceClearColor
+#define glEnable GlTraceEnable
+#define glDisable GlTraceDisable
+#define glDrawElements GlTraceDrawElements
+#define glReadPixels GlTraceReadPixels
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef GLTRACEFORMAT_HPP
+#define GLTRACEFORMAT_HPP
+
+#include <stdint.h>
+
+// Layout of a trace file, shared by the recorder and the replay:
+//
+//   GlTraceHeader
+//   commands, up to the end of the file: one GlTraceCall byte, then the arguments of the call in order
+//
+// Arguments are little endian: 32 bits for enums, names, ints, sizes, bitfields and floats, 64 bits for
+// GLintptr / GLsizeiptr, offsets given as pointers and syncs. Data (a glBufferData() payload, a string...)
+// is a 64-bit size then the bytes. Calls that create names are followed by the names GL gave back.
+
+#define GL_TRACE_VERSION 1
+
+// Bytes compared at a time when saving what changed in a mapped range
+#define GL_TRACE_DELTA_CHUNK 64
+
+struct GlTraceHeader
+{
+	char Magic[4];			// "GLTR"
+	uint32_t Version;
+	uint32_t Width;
+	uint32_t Height;
+};
+
+enum GlTraceCall
+{
+	TraceEndFrame,
+	// Buffers
+	TraceGenBuffers,				// n, names
+	TraceDeleteBuffers,				// n, names
+	TraceBindBuffer,
+	TraceBindBufferRange,
+	TraceBufferData,				// target, size, usage, a 32-bit flag telling if there was data, the data
+	TraceBufferStorage,				// target, size, flags, the same flag, the data
+	TraceMapBufferRange,			// target, offset, length, access
+	TraceUnmapBuffer,				// target, then for a write mapping the changed runs: their count, then for each its first chunk, chunk count and bytes
+	TraceCopyBufferSubData,
+	TraceClearBufferData,			// target, internal format, format, type, the value (its size depends on format and type)
+	// Vertex arrays
+	TraceGenVertexArrays,
+	TraceDeleteVertexArrays,
+	TraceBindVertexArray,
+	TraceEnableVertexAttribArray,
+	TraceVertexAttribPointer,
+	TraceVertexAttribDivisor,
+	// Shaders and programs
+	TraceCreateShader,				// type, the name it got
+	TraceShaderSource,				// shader, count, each string
+	TraceCompileShader,
+	TraceAttachShader,
+	TraceDetachShader,
+	TraceDeleteShader,
+	TraceCreateProgram,				// the name it got
+	TraceLinkProgram,
+	TraceDeleteProgram,
+	TraceProgramBinary,
+	TraceProgramParameteri,
+	TraceUseProgram,
+	TraceGetUniformLocation,		// program, name, the location it got
+	TraceGetUniformBlockIndex,		// program, name, the index it got
+	TraceUniformBlockBinding,
+	TraceUniform1i,
+	TraceUniform1ui,
+	// Draws and compute
+	TraceClear,
+	TraceClearColor,
+	TraceEnable,
+	TraceDisable,
+	TraceDrawElements,
+	TraceDrawElementsInstanced,
+	TraceDrawElementsInstancedBaseInstance,
+	TraceMultiDrawElementsIndirect,
+	TraceMultiDrawElementsIndirectCount,
+	TraceDispatchCompute,
+	TraceMemoryBarrier,
+	TraceReadPixels,				// x, y, width, height, format, type, whether it went to a pixel pack buffer, offset
+	// Syncs
+	TraceFenceSync,					// condition, flags, the sync it got
+	TraceClientWaitSync,			// sync, flags, timeout, what it returned
+	TraceDeleteSync,
+	NumGlTraceCalls
+};
+
+// Buffer binding points the recorder and the replay keep track of, to know what a mapping or a pixel pack
+// refers to. Not the element array one: that binding belongs to the VAO, and nothing maps through it.
+inline int GlTraceTargetSlot(GLenum target)
+{
+	switch (target) {
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_COPY_READ_BUFFER: return 1;
+	case GL_COPY_WRITE_BUFFER: return 2;
+	case GL_PIXEL_PACK_BUFFER: return 3;
+	case GL_PIXEL_UNPACK_BUFFER: return 4;
+	case GL_UNIFORM_BUFFER: return 5;
+	case GL_SHADER_STORAGE_BUFFER: return 6;
+	case GL_DRAW_INDIRECT_BUFFER: return 7;
+	case GL_DISPATCH_INDIRECT_BUFFER: return 8;
+	case GL_PARAMETER_BUFFER_ARB: return 9;
+	default: return -1;
+	}
+}
+#define GL_TRACE_TARGETS 10
+
+#endif
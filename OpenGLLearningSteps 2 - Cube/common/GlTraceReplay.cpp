@@ -0,0 +1,702 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <map>
+#include <vector>
+#include <utility>
+
+#include <GL/glew.h>
+
+// The replay calls GL directly, never through the recorder
+#define GL_TRACE_NO_REDIRECT
+#include "GlTrace.hpp"
+#include "GlTraceFormat.hpp"
+#include "Benchmark.hpp"
+
+struct ReplayMapping
+{
+	GLuint Buffer;
+	GLintptr Offset;
+	GLsizeiptr Length;
+	GLbitfield Access;
+	unsigned char* Pointer;
+};
+
+typedef std::pair<GLuint, std::pair<GLintptr, GLsizeiptr> > ReplayShadowKey;
+
+struct TraceReplay
+{
+	// The trace, all of it in memory so reading the file isn't timed
+	std::vector<unsigned char> Data;
+	size_t Position;
+	bool Truncated;
+
+	// Recorded name -> name here, 0 when unknown
+	std::vector<GLuint> Buffers;
+	std::vector<GLuint> VertexArrays;
+	std::vector<GLuint> Shaders;
+	std::vector<GLuint> Programs;
+	std::map<uint64_t, GLsync> Syncs;
+	// (recorded program, recorded location or block index) -> the one here
+	std::map<std::pair<GLuint, GLint>, GLint> Locations;
+	std::map<std::pair<GLuint, GLuint>, GLuint> BlockIndices;
+	GLuint CurrentProgram;		// Recorded name, uniforms are looked up with it
+
+	GLuint Bound[GL_TRACE_TARGETS];
+	std::vector<ReplayMapping> Mappings;
+	// What was in a mapped range when it was last unmapped, the changes of the next unmap apply to it
+	std::map<ReplayShadowKey, std::vector<unsigned char> > Shadows;
+	std::vector<unsigned char> ReadBack;
+};
+
+static const unsigned char* GetBytes(TraceReplay& replay, size_t size)
+{
+	if (replay.Data.size() - replay.Position < size) {
+		replay.Truncated = true;
+		replay.Position = replay.Data.size();
+		return NULL;
+	}
+	const unsigned char* Bytes = &replay.Data[0] + replay.Position;
+	replay.Position += size;
+	return Bytes;
+}
+
+static uint32_t Get32(TraceReplay& replay)
+{
+	uint32_t Value = 0;
+	const unsigned char* Bytes = GetBytes(replay, sizeof(Value));
+	if (Bytes != NULL) {
+		memcpy(&Value, Bytes, sizeof(Value));
+	}
+	return Value;
+}
+
+static uint64_t Get64(TraceReplay& replay)
+{
+	uint64_t Value = 0;
+	const unsigned char* Bytes = GetBytes(replay, sizeof(Value));
+	if (Bytes != NULL) {
+		memcpy(&Value, Bytes, sizeof(Value));
+	}
+	return Value;
+}
+
+static float GetFloat(TraceReplay& replay)
+{
+	float Value = 0.0f;
+	const unsigned char* Bytes = GetBytes(replay, sizeof(Value));
+	if (Bytes != NULL) {
+		memcpy(&Value, Bytes, sizeof(Value));
+	}
+	return Value;
+}
+
+static const void* GetPointer(TraceReplay& replay)
+{
+	return (const void*)(uintptr_t)Get64(replay);
+}
+
+static const unsigned char* GetData(TraceReplay& replay, uint64_t& size)
+{
+	size = Get64(replay);
+	return GetBytes(replay, (size_t)size);
+}
+
+// Names are read into a scratch array, n of them
+static bool GetNames(TraceReplay& replay, std::vector<GLuint>& names)
+{
+	uint32_t Count = Get32(replay);
+	const unsigned char* Bytes = GetBytes(replay, (size_t)Count * sizeof(GLuint));
+	if (Bytes == NULL) {
+		return false;
+	}
+	names.resize(Count);
+	if (Count > 0) {
+		memcpy(&names[0], Bytes, Count * sizeof(GLuint));
+	}
+	return true;
+}
+
+static GLuint MapName(const std::vector<GLuint>& names, GLuint recorded)
+{
+	return recorded < names.size() ? names[recorded] : 0;
+}
+
+static void SetName(std::vector<GLuint>& names, GLuint recorded, GLuint name)
+{
+	if (recorded >= names.size()) {
+		names.resize(recorded + 1, 0);
+	}
+	names[recorded] = name;
+}
+
+static void ForgetBuffer(TraceReplay& replay, GLuint buffer)
+{
+	for (size_t i = 0; i < replay.Mappings.size(); i++) {
+		if (replay.Mappings[i].Buffer == buffer) {
+			replay.Mappings.erase(replay.Mappings.begin() + i);
+			break;
+		}
+	}
+	std::map<ReplayShadowKey, std::vector<unsigned char> >::iterator It = replay.Shadows.lower_bound(ReplayShadowKey(buffer, std::make_pair((GLintptr)0, (GLsizeiptr)0)));
+	while (It != replay.Shadows.end() && It->first.first == buffer) {
+		It = replay.Shadows.erase(It);
+	}
+	for (int t = 0; t < GL_TRACE_TARGETS; t++) {
+		if (replay.Bound[t] == buffer) {
+			replay.Bound[t] = 0;
+		}
+	}
+}
+
+// Applies the changed runs to the shadow of the range, then writes the whole range to the mapping
+static bool ReplayMappedChanges(TraceReplay& replay, ReplayMapping& mapping)
+{
+	ReplayShadowKey Key(mapping.Buffer, std::make_pair(mapping.Offset, mapping.Length));
+	std::vector<unsigned char>& Shadow = replay.Shadows[Key];
+	size_t Length = (size_t)mapping.Length;
+	if (Shadow.size() != Length) {
+		Shadow.assign(Length, 0);
+	}
+
+	uint32_t Runs = Get32(replay);
+	for (uint32_t r = 0; r < Runs; r++) {
+		size_t Start = (size_t)Get32(replay) * GL_TRACE_DELTA_CHUNK;
+		size_t End = Start + (size_t)Get32(replay) * GL_TRACE_DELTA_CHUNK;
+		if (Start > Length) {
+			return false;
+		}
+		End = End < Length ? End : Length;
+		const unsigned char* Bytes = GetBytes(replay, End - Start);
+		if (Bytes == NULL) {
+			return false;
+		}
+		memcpy(&Shadow[Start], Bytes, End - Start);
+	}
+	if (Length > 0) {
+		memcpy(mapping.Pointer, &Shadow[0], Length);
+	}
+	return true;
+}
+
+// Runs one call. False on something the replay can't make sense of.
+static bool ReplayCall(TraceReplay& replay, GlTraceCall call)
+{
+	std::vector<GLuint> Names;
+	uint64_t Size = 0;
+
+	switch (call) {
+	case TraceGenBuffers:
+	case TraceGenVertexArrays: {
+		if (!GetNames(replay, Names)) {
+			return false;
+		}
+		std::vector<GLuint> Created(Names.size());
+		if (Names.empty()) {
+			return true;
+		}
+		if (call == TraceGenBuffers) {
+			glGenBuffers((GLsizei)Created.size(), &Created[0]);
+		}
+		else {
+			glGenVertexArrays((GLsizei)Created.size(), &Created[0]);
+		}
+		for (size_t i = 0; i < Names.size(); i++) {
+			SetName(call == TraceGenBuffers ? replay.Buffers : replay.VertexArrays, Names[i], Created[i]);
+		}
+		return true;
+	}
+	case TraceDeleteBuffers:
+	case TraceDeleteVertexArrays: {
+		if (!GetNames(replay, Names)) {
+			return false;
+		}
+		std::vector<GLuint>& Map = call == TraceDeleteBuffers ? replay.Buffers : replay.VertexArrays;
+		for (size_t i = 0; i < Names.size(); i++) {
+			GLuint Name = MapName(Map, Names[i]);
+			if (Name != 0) {
+				SetName(Map, Names[i], 0);
+			}
+			Names[i] = Name;
+			if (call == TraceDeleteBuffers) {
+				ForgetBuffer(replay, Name);
+			}
+		}
+		if (call == TraceDeleteBuffers) {
+			glDeleteBuffers((GLsizei)Names.size(), Names.empty() ? NULL : &Names[0]);
+		}
+		else {
+			glDeleteVertexArrays((GLsizei)Names.size(), Names.empty() ? NULL : &Names[0]);
+		}
+		return true;
+	}
+	case TraceBindBuffer: {
+		GLenum Target = Get32(replay);
+		GLuint Buffer = MapName(replay.Buffers, Get32(replay));
+		int Slot = GlTraceTargetSlot(Target);
+		if (Slot >= 0) {
+			replay.Bound[Slot] = Buffer;
+		}
+		glBindBuffer(Target, Buffer);
+		return true;
+	}
+	case TraceBindBufferRange: {
+		GLenum Target = Get32(replay);
+		GLuint Index = Get32(replay);
+		GLuint Buffer = MapName(replay.Buffers, Get32(replay));
+		GLintptr Offset = (GLintptr)Get64(replay);
+		GLsizeiptr Length = (GLsizeiptr)Get64(replay);
+		int Slot = GlTraceTargetSlot(Target);
+		if (Slot >= 0) {
+			replay.Bound[Slot] = Buffer;
+		}
+		glBindBufferRange(Target, Index, Buffer, Offset, Length);
+		return true;
+	}
+	case TraceBufferData:
+	case TraceBufferStorage: {
+		GLenum Target = Get32(replay);
+		GLsizeiptr BufferSize = (GLsizeiptr)Get64(replay);
+		GLenum UsageOrFlags = Get32(replay);
+		const unsigned char* Bytes = NULL;
+		if (Get32(replay) != 0) {
+			Bytes = GetData(replay, Size);
+			if (Bytes == NULL || Size != (uint64_t)BufferSize) {
+				return false;
+			}
+		}
+		if (call == TraceBufferData) {
+			glBufferData(Target, BufferSize, Bytes, UsageOrFlags);
+		}
+		else {
+			glBufferStorage(Target, BufferSize, Bytes, UsageOrFlags);
+		}
+		return true;
+	}
+	case TraceMapBufferRange: {
+		GLenum Target = Get32(replay);
+		GLintptr Offset = (GLintptr)Get64(replay);
+		GLsizeiptr Length = (GLsizeiptr)Get64(replay);
+		GLbitfield Access = Get32(replay);
+		int Slot = GlTraceTargetSlot(Target);
+		void* Pointer = glMapBufferRange(Target, Offset, Length, Access);
+		if (Pointer == NULL || Slot < 0) {
+			fprintf(stderr, "Replay: mapping a range of buffer %u failed\n", Slot >= 0 ? replay.Bound[Slot] : 0);
+			return false;
+		}
+		ReplayMapping Mapping = { replay.Bound[Slot], Offset, Length, Access, (unsigned char*)Pointer };
+		replay.Mappings.push_back(Mapping);
+		return true;
+	}
+	case TraceUnmapBuffer: {
+		GLenum Target = Get32(replay);
+		int Slot = GlTraceTargetSlot(Target);
+		size_t Mapping = 0;
+		while (Slot >= 0 && Mapping < replay.Mappings.size() && replay.Mappings[Mapping].Buffer != replay.Bound[Slot]) {
+			Mapping++;
+		}
+		if (Slot < 0 || Mapping == replay.Mappings.size()) {
+			return false;
+		}
+		if ((replay.Mappings[Mapping].Access & GL_MAP_WRITE_BIT) && !ReplayMappedChanges(replay, replay.Mappings[Mapping])) {
+			return false;
+		}
+		replay.Mappings.erase(replay.Mappings.begin() + Mapping);
+		glUnmapBuffer(Target);
+		return true;
+	}
+	case TraceCopyBufferSubData: {
+		GLenum ReadTarget = Get32(replay);
+		GLenum WriteTarget = Get32(replay);
+		GLintptr ReadOffset = (GLintptr)Get64(replay);
+		GLintptr WriteOffset = (GLintptr)Get64(replay);
+		GLsizeiptr Length = (GLsizeiptr)Get64(replay);
+		glCopyBufferSubData(ReadTarget, WriteTarget, ReadOffset, WriteOffset, Length);
+		return true;
+	}
+	case TraceClearBufferData: {
+		GLenum Target = Get32(replay);
+		GLenum InternalFormat = Get32(replay);
+		GLenum Format = Get32(replay);
+		GLenum Type = Get32(replay);
+		const unsigned char* Value = NULL;
+		if (Get32(replay) != 0 && (Value = GetData(replay, Size)) == NULL) {
+			return false;
+		}
+		glClearBufferData(Target, InternalFormat, Format, Type, Value);
+		return true;
+	}
+	case TraceBindVertexArray:
+		glBindVertexArray(MapName(replay.VertexArrays, Get32(replay)));
+		return true;
+	case TraceEnableVertexAttribArray:
+		glEnableVertexAttribArray(Get32(replay));
+		return true;
+	case TraceVertexAttribPointer: {
+		GLuint Index = Get32(replay);
+		GLint Components = (GLint)Get32(replay);
+		GLenum Type = Get32(replay);
+		GLboolean Normalized = (GLboolean)Get32(replay);
+		GLsizei Stride = (GLsizei)Get32(replay);
+		const void* Offset = GetPointer(replay);
+		glVertexAttribPointer(Index, Components, Type, Normalized, Stride, Offset);
+		return true;
+	}
+	case TraceVertexAttribDivisor: {
+		GLuint Index = Get32(replay);
+		glVertexAttribDivisor(Index, Get32(replay));
+		return true;
+	}
+	case TraceCreateShader: {
+		GLenum Type = Get32(replay);
+		SetName(replay.Shaders, Get32(replay), glCreateShader(Type));
+		return true;
+	}
+	case TraceShaderSource: {
+		GLuint Shader = MapName(replay.Shaders, Get32(replay));
+		uint32_t Count = Get32(replay);
+		std::vector<const GLchar*> Strings;
+		std::vector<GLint> Lengths;
+		for (uint32_t i = 0; i < Count; i++) {
+			const unsigned char* Text = GetData(replay, Size);
+			if (Text == NULL) {
+				return false;
+			}
+			Strings.push_back((const GLchar*)Text);
+			Lengths.push_back((GLint)Size);
+		}
+		glShaderSource(Shader, (GLsizei)Count, Count > 0 ? &Strings[0] : NULL, Count > 0 ? &Lengths[0] : NULL);
+		return true;
+	}
+	case TraceCompileShader:
+		glCompileShader(MapName(replay.Shaders, Get32(replay)));
+		return true;
+	case TraceAttachShader:
+	case TraceDetachShader: {
+		GLuint Program = MapName(replay.Programs, Get32(replay));
+		GLuint Shader = MapName(replay.Shaders, Get32(replay));
+		if (call == TraceAttachShader) {
+			glAttachShader(Program, Shader);
+		}
+		else {
+			glDetachShader(Program, Shader);
+		}
+		return true;
+	}
+	case TraceDeleteShader: {
+		GLuint Recorded = Get32(replay);
+		glDeleteShader(MapName(replay.Shaders, Recorded));
+		SetName(replay.Shaders, Recorded, 0);
+		return true;
+	}
+	case TraceCreateProgram:
+		SetName(replay.Programs, Get32(replay), glCreateProgram());
+		return true;
+	case TraceLinkProgram:
+		glLinkProgram(MapName(replay.Programs, Get32(replay)));
+		return true;
+	case TraceDeleteProgram: {
+		GLuint Recorded = Get32(replay);
+		glDeleteProgram(MapName(replay.Programs, Recorded));
+		SetName(replay.Programs, Recorded, 0);
+		return true;
+	}
+	case TraceProgramBinary: {
+		GLuint Program = MapName(replay.Programs, Get32(replay));
+		GLenum Format = Get32(replay);
+		const unsigned char* Binary = GetData(replay, Size);
+		if (Binary == NULL) {
+			return false;
+		}
+		glProgramBinary(Program, Format, Binary, (GLsizei)Size);
+		GLint Linked = GL_FALSE;
+		glGetProgramiv(Program, GL_LINK_STATUS, &Linked);
+		if (!Linked) {
+			fprintf(stderr, "Replay: the driver refused a program binary of the trace, it was recorded with another one\n");
+			return false;
+		}
+		return true;
+	}
+	case TraceProgramParameteri: {
+		GLuint Program = MapName(replay.Programs, Get32(replay));
+		GLenum Name = Get32(replay);
+		glProgramParameteri(Program, Name, (GLint)Get32(replay));
+		return true;
+	}
+	case TraceUseProgram:
+		replay.CurrentProgram = Get32(replay);
+		glUseProgram(MapName(replay.Programs, replay.CurrentProgram));
+		return true;
+	case TraceGetUniformLocation:
+	case TraceGetUniformBlockIndex: {
+		GLuint Recorded = Get32(replay);
+		const unsigned char* Name = GetData(replay, Size);
+		if (Name == NULL) {
+			return false;
+		}
+		std::string NameString((const char*)Name, (size_t)Size);
+		uint32_t Result = Get32(replay);
+		GLuint Program = MapName(replay.Programs, Recorded);
+		if (call == TraceGetUniformLocation) {
+			replay.Locations[std::make_pair(Recorded, (GLint)Result)] = glGetUniformLocation(Program, NameString.c_str());
+		}
+		else {
+			replay.BlockIndices[std::make_pair(Recorded, (GLuint)Result)] = glGetUniformBlockIndex(Program, NameString.c_str());
+		}
+		return true;
+	}
+	case TraceUniformBlockBinding: {
+		GLuint Recorded = Get32(replay);
+		GLuint Index = Get32(replay);
+		GLuint Binding = Get32(replay);
+		std::map<std::pair<GLuint, GLuint>, GLuint>::iterator It = replay.BlockIndices.find(std::make_pair(Recorded, Index));
+		glUniformBlockBinding(MapName(replay.Programs, Recorded), It != replay.BlockIndices.end() ? It->second : Index, Binding);
+		return true;
+	}
+	case TraceUniform1i:
+	case TraceUniform1ui: {
+		GLint Recorded = (GLint)Get32(replay);
+		uint32_t Value = Get32(replay);
+		std::map<std::pair<GLuint, GLint>, GLint>::iterator It = replay.Locations.find(std::make_pair(replay.CurrentProgram, Recorded));
+		GLint Location = It != replay.Locations.end() ? It->second : Recorded;
+		if (call == TraceUniform1i) {
+			glUniform1i(Location, (GLint)Value);
+		}
+		else {
+			glUniform1ui(Location, Value);
+		}
+		return true;
+	}
+	case TraceClear:
+		glClear(Get32(replay));
+		return true;
+	case TraceClearColor: {
+		GLfloat Red = GetFloat(replay);
+		GLfloat Green = GetFloat(replay);
+		GLfloat Blue = GetFloat(replay);
+		glClearColor(Red, Green, Blue, GetFloat(replay));
+		return true;
+	}
+	case TraceEnable:
+		glEnable(Get32(replay));
+		return true;
+	case TraceDisable:
+		glDisable(Get32(replay));
+		return true;
+	case TraceDrawElements:
+	case TraceDrawElementsInstanced:
+	case TraceDrawElementsInstancedBaseInstance: {
+		GLenum Mode = Get32(replay);
+		GLsizei Count = (GLsizei)Get32(replay);
+		GLenum Type = Get32(replay);
+		const void* Indices = GetPointer(replay);
+		if (call == TraceDrawElements) {
+			glDrawElements(Mode, Count, Type, Indices);
+			return true;
+		}
+		GLsizei InstanceCount = (GLsizei)Get32(replay);
+		if (call == TraceDrawElementsInstanced) {
+			glDrawElementsInstanced(Mode, Count, Type, Indices, InstanceCount);
+		}
+		else {
+			glDrawElementsInstancedBaseInstance(Mode, Count, Type, Indices, InstanceCount, Get32(replay));
+		}
+		return true;
+	}
+	case TraceMultiDrawElementsIndirect: {
+		GLenum Mode = Get32(replay);
+		GLenum Type = Get32(replay);
+		const void* Indirect = GetPointer(replay);
+		GLsizei DrawCount = (GLsizei)Get32(replay);
+		glMultiDrawElementsIndirect(Mode, Type, Indirect, DrawCount, (GLsizei)Get32(replay));
+		return true;
+	}
+	case TraceMultiDrawElementsIndirectCount: {
+		GLenum Mode = Get32(replay);
+		GLenum Type = Get32(replay);
+		const void* Indirect = GetPointer(replay);
+		GLintptr DrawCount = (GLintptr)Get64(replay);
+		GLsizei MaxDrawCount = (GLsizei)Get32(replay);
+		glMultiDrawElementsIndirectCountARB(Mode, Type, Indirect, DrawCount, MaxDrawCount, (GLsizei)Get32(replay));
+		return true;
+	}
+	case TraceDispatchCompute: {
+		GLuint X = Get32(replay);
+		GLuint Y = Get32(replay);
+		glDispatchCompute(X, Y, Get32(replay));
+		return true;
+	}
+	case TraceMemoryBarrier:
+		glMemoryBarrier(Get32(replay));
+		return true;
+	case TraceReadPixels: {
+		GLint X = (GLint)Get32(replay);
+		GLint Y = (GLint)Get32(replay);
+		GLsizei Width = (GLsizei)Get32(replay);
+		GLsizei Height = (GLsizei)Get32(replay);
+		GLenum Format = Get32(replay);
+		GLenum Type = Get32(replay);
+		bool PackBuffer = Get32(replay) != 0;
+		void* Pixels = (void*)GetPointer(replay);
+		if (!PackBuffer) {
+			// Big enough for any format and type the app reads with: 4 components of 4 bytes
+			replay.ReadBack.resize((size_t)Width * Height * 16);
+			Pixels = replay.ReadBack.empty() ? NULL : &replay.ReadBack[0];
+		}
+		glReadPixels(X, Y, Width, Height, Format, Type, Pixels);
+		return true;
+	}
+	case TraceFenceSync: {
+		GLenum Condition = Get32(replay);
+		GLbitfield Flags = Get32(replay);
+		uint64_t Recorded = Get64(replay);
+		replay.Syncs[Recorded] = glFenceSync(Condition, Flags);
+		return true;
+	}
+	case TraceClientWaitSync: {
+		std::map<uint64_t, GLsync>::iterator It = replay.Syncs.find(Get64(replay));
+		GLbitfield Flags = Get32(replay);
+		Get64(replay);
+		GLenum Result = Get32(replay);
+		if (It == replay.Syncs.end()) {
+			return true;
+		}
+		if (Result == GL_ALREADY_SIGNALED || Result == GL_CONDITION_SATISFIED) {
+			// The app went on once it was signaled, so the replay has to wait for it too
+			while (glClientWaitSync(It->second, Flags | GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {
+			}
+		}
+		else {
+			glClientWaitSync(It->second, Flags, 0);
+		}
+		return true;
+	}
+	case TraceDeleteSync: {
+		std::map<uint64_t, GLsync>::iterator It = replay.Syncs.find(Get64(replay));
+		if (It != replay.Syncs.end()) {
+			glDeleteSync(It->second);
+			replay.Syncs.erase(It);
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+// Deletes what the trace left alive
+static void DestroyReplayObjects(TraceReplay& replay)
+{
+	for (size_t i = 0; i < replay.Mappings.size(); i++) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, replay.Mappings[i].Buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	for (size_t i = 0; i < replay.Buffers.size(); i++) {
+		if (replay.Buffers[i] != 0) {
+			glDeleteBuffers(1, &replay.Buffers[i]);
+		}
+	}
+	for (size_t i = 0; i < replay.VertexArrays.size(); i++) {
+		if (replay.VertexArrays[i] != 0) {
+			glDeleteVertexArrays(1, &replay.VertexArrays[i]);
+		}
+	}
+	for (size_t i = 0; i < replay.Shaders.size(); i++) {
+		if (replay.Shaders[i] != 0) {
+			glDeleteShader(replay.Shaders[i]);
+		}
+	}
+	for (size_t i = 0; i < replay.Programs.size(); i++) {
+		if (replay.Programs[i] != 0) {
+			glDeleteProgram(replay.Programs[i]);
+		}
+	}
+	for (std::map<uint64_t, GLsync>::iterator It = replay.Syncs.begin(); It != replay.Syncs.end(); ++It) {
+		glDeleteSync(It->second);
+	}
+}
+
+bool RunGlTraceReplay(const char* path, int warmupFrames, const char* jsonPath)
+{
+	TraceReplay Replay;
+	Replay.Position = 0;
+	Replay.Truncated = false;
+	Replay.CurrentProgram = 0;
+	memset(Replay.Bound, 0, sizeof(Replay.Bound));
+
+	FILE* File = fopen(path, "rb");
+	if (File == NULL) {
+		fprintf(stderr, "Can't open the GL trace %s\n", path);
+		return false;
+	}
+	fseek(File, 0, SEEK_END);
+	long FileSize = ftell(File);
+	fseek(File, 0, SEEK_SET);
+	Replay.Data.resize(FileSize > 0 ? (size_t)FileSize : 0);
+	bool Read = FileSize > 0 && fread(&Replay.Data[0], 1, Replay.Data.size(), File) == Replay.Data.size();
+	fclose(File);
+
+	GlTraceHeader Header;
+	if (!Read || Replay.Data.size() < sizeof(Header)) {
+		fprintf(stderr, "Can't read the GL trace %s\n", path);
+		return false;
+	}
+	memcpy(&Header, &Replay.Data[0], sizeof(Header));
+	if (memcmp(Header.Magic, "GLTR", 4) != 0 || Header.Version != GL_TRACE_VERSION) {
+		fprintf(stderr, "%s isn't a GL trace of version %d\n", path, GL_TRACE_VERSION);
+		return false;
+	}
+	GLint Viewport[4];
+	glGetIntegerv(GL_VIEWPORT, Viewport);
+	if ((uint32_t)Viewport[2] != Header.Width || (uint32_t)Viewport[3] != Header.Height) {
+		fprintf(stderr, "The GL trace was recorded at %ux%u, the framebuffer is %dx%d\n", Header.Width, Header.Height, Viewport[2], Viewport[3]);
+		return false;
+	}
+	Replay.Position = sizeof(Header);
+
+	std::vector<double> FrameTimesMs;
+	unsigned long long Calls = 0;
+	int Frames = 0;
+	bool Failed = false;
+	std::chrono::steady_clock::time_point FrameStart = std::chrono::steady_clock::now();
+	while (Replay.Position < Replay.Data.size()) {
+		GlTraceCall Call = (GlTraceCall)Replay.Data[Replay.Position++];
+		Calls++;
+		if (Call == TraceEndFrame) {
+			// Same as a headless frame of the app: done when the GPU is
+			glFinish();
+			std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+			if (Frames >= warmupFrames) {
+				FrameTimesMs.push_back(std::chrono::duration<double, std::milli>(Now - FrameStart).count());
+			}
+			Frames++;
+			FrameStart = Now;
+			continue;
+		}
+		if (Call >= NumGlTraceCalls || !ReplayCall(Replay, Call) || Replay.Truncated) {
+			fprintf(stderr, "Replay of %s stopped at byte %llu: call %d is %s\n", path, (unsigned long long)Replay.Position,
+				(int)Call, Replay.Truncated ? "cut short" : "unknown or failed");
+			Failed = true;
+			break;
+		}
+	}
+	glFinish();
+	DestroyReplayObjects(Replay);
+	if (Failed) {
+		return false;
+	}
+
+	BenchmarkReport Report;
+	Report.Scene = "replay";
+	Report.Width = (int)Header.Width;
+	Report.Height = (int)Header.Height;
+	Report.FrameTimes = ComputeFrameTimeStats(FrameTimesMs);
+	Report.Counters.push_back(std::make_pair(std::string("trace_frames"), (double)Frames));
+	Report.Counters.push_back(std::make_pair(std::string("trace_calls"), (double)Calls));
+	Report.Counters.push_back(std::make_pair(std::string("trace_bytes"), (double)Replay.Data.size()));
+	Report.Counters.push_back(std::make_pair(std::string("calls_per_frame"), Frames > 0 ? (double)Calls / Frames : 0.0));
+	return WriteBenchmarkJson(jsonPath, Report);
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GpuCulling.hpp"
+#include "Shader.hpp"
+#include "StateCache.hpp"
+#include "UniformBlocks.hpp"
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must be tightly packed");
+
+// Binding points of the storage buffers, as declared in the compute shader
+#define BOUNDS_BINDING 0
+#define COMMANDS_BINDING 1
+#define COUNT_BINDING 2
+#define VISIBILITY_BINDING 3
+// Texture unit of the depth pyramid
+#define HIZ_UNIT 0
+
+static bool IndirectCountAvailable()
+{
+	return GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters;
+}
+
+bool GpuCullingAvailable()
+{
+	return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_multi_draw_indirect);
+}
+
+bool CreateGpuCuller(GpuCuller& culler, const TransformBatch& objects, float meshRadius, GLsizei indexCount)
+{
+	memset(&culler, 0, sizeof(culler));
+	if (!GpuCullingAvailable()) {
+		printf("GPU culling needs GL 4.3 (compute shaders and multi draw indirect)\n");
+		return false;
+	}
+
+	culler.Program = LoadComputeShader("shaders/FrustumCull.computeshader");
+	if (culler.Program == 0) {
+		return false;
+	}
+	culler.ProgramHandle = AdoptGpuProgram(culler.Program, "frustum culling");
+	BindUniformBlocks(culler.Program);
+	culler.ObjectCountID = glGetUniformLocation(culler.Program, "ObjectCount");
+	culler.IndexCountID = glGetUniformLocation(culler.Program, "IndexCount");
+	culler.FirstInstanceID = glGetUniformLocation(culler.Program, "FirstInstance");
+	culler.CompactID = glGetUniformLocation(culler.Program, "Compact");
+	culler.OccluderPassID = glGetUniformLocation(culler.Program, "OccluderPass");
+	culler.OcclusionTestID = glGetUniformLocation(culler.Program, "OcclusionTest");
+	culler.HiZSizeID = glGetUniformLocation(culler.Program, "HiZSize");
+	culler.HiZLevelsID = glGetUniformLocation(culler.Program, "HiZLevels");
+	culler.ObjectCount = (int)objects.Count;
+	culler.IndexCount = indexCount;
+	culler.Compact = IndirectCountAvailable();
+
+	std::vector<float> Bounds(objects.Count * 4);
+	for (size_t i = 0; i < objects.Count; i++) {
+		Bounds[i * 4] = objects.PositionX[i];
+		Bounds[i * 4 + 1] = objects.PositionY[i];
+		Bounds[i * 4 + 2] = objects.PositionZ[i];
+		Bounds[i * 4 + 3] = meshRadius * objects.Scale[i];
+	}
+
+	// Only the GPU writes the commands and the count, the CPU never needs to map them
+	culler.BoundsBuffer = CreateGpuBuffer("culling bounds");
+	GpuBufferData(culler.BoundsBuffer, GL_COPY_WRITE_BUFFER, Bounds.size() * sizeof(float), &Bounds[0], GL_STATIC_DRAW);
+	culler.CommandBuffer = CreateGpuBuffer("indirect commands");
+	GpuBufferData(culler.CommandBuffer, GL_COPY_WRITE_BUFFER, objects.Count * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_COPY);
+	culler.CountBuffer = CreateGpuBuffer("indirect draw count");
+	GpuBufferData(culler.CountBuffer, GL_COPY_WRITE_BUFFER, 2 * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	// Nothing was drawn before the first frame, so it has no occluders
+	const GLuint Zero = 0;
+	culler.VisibilityBuffer = CreateGpuBuffer("last frame visibility");
+	GpuBufferData(culler.VisibilityBuffer, GL_COPY_WRITE_BUFFER, objects.Count * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &Zero);
+
+	printf("GPU culling of %d objects, %s\n", culler.ObjectCount,
+		culler.Compact ? "packed commands with a GPU draw count" : "one command per object (no ARB_indirect_parameters)");
+	return true;
+}
+
+void DestroyGpuCuller(GpuCuller& culler)
+{
+	ReleaseGpuResource(culler.ProgramHandle);
+	ReleaseGpuResource(culler.BoundsBuffer);
+	ReleaseGpuResource(culler.CommandBuffer);
+	ReleaseGpuResource(culler.CountBuffer);
+	ReleaseGpuResource(culler.VisibilityBuffer);
+	memset(&culler, 0, sizeof(culler));
+}
+
+static void Dispatch(GpuCuller& culler, GLuint firstInstance, bool occluderPass, const HiZBuffer* hiz)
+{
+	const GLuint Zero = 0;
+	CachedBindBuffer(GL_COPY_WRITE_BUFFER, GpuName(culler.CountBuffer));
+	glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &Zero);
+
+	CachedUseProgram(culler.Program);
+	glUniform1ui(culler.ObjectCountID, (GLuint)culler.ObjectCount);
+	glUniform1ui(culler.IndexCountID, (GLuint)culler.IndexCount);
+	glUniform1ui(culler.FirstInstanceID, firstInstance);
+	glUniform1i(culler.CompactID, culler.Compact ? 1 : 0);
+	glUniform1i(culler.OccluderPassID, occluderPass ? 1 : 0);
+	glUniform1i(culler.OcclusionTestID, hiz != NULL ? 1 : 0);
+	if (hiz != NULL) {
+		glUniform2i(culler.HiZSizeID, hiz->PyramidWidth, hiz->PyramidHeight);
+		glUniform1i(culler.HiZLevelsID, hiz->Levels);
+		glActiveTexture(GL_TEXTURE0 + HIZ_UNIT);
+		glBindTexture(GL_TEXTURE_2D, hiz->PyramidTexture);
+	}
+	CachedBindBufferRange(GL_SHADER_STORAGE_BUFFER, BOUNDS_BINDING, GpuName(culler.BoundsBuffer), 0, culler.ObjectCount * 4 * sizeof(float));
+	CachedBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, GpuName(culler.CommandBuffer), 0, culler.ObjectCount * sizeof(DrawElementsIndirectCommand));
+	CachedBindBufferRange(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, GpuName(culler.CountBuffer), 0, 2 * sizeof(GLuint));
+	CachedBindBufferRange(GL_SHADER_STORAGE_BUFFER, VISIBILITY_BINDING, GpuName(culler.VisibilityBuffer), 0, culler.ObjectCount * sizeof(GLuint));
+	glDispatchCompute((culler.ObjectCount + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+
+	// The draw reads what the shader wrote as commands (and as parameters, for the count)
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void DispatchGpuCulling(GpuCuller& culler, GLuint firstInstance, const HiZBuffer* hiz)
+{
+	Dispatch(culler, firstInstance, false, hiz);
+}
+
+void DispatchGpuOccluders(GpuCuller& culler, GLuint firstInstance)
+{
+	Dispatch(culler, firstInstance, true, NULL);
+}
+
+void DrawGpuCulled(GpuCuller& culler, GLenum indexType)
+{
+	CachedBindBuffer(GL_DRAW_INDIRECT_BUFFER, GpuName(culler.CommandBuffer));
+	if (culler.Compact) {
+		CachedBindBuffer(GL_PARAMETER_BUFFER_ARB, GpuName(culler.CountBuffer));
+		glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, indexType, (void*)0, 0, culler.ObjectCount, 0);
+	}
+	else {
+		glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (void*)0, culler.ObjectCount, 0);
+	}
+}
+
+int ReadGpuVisibleCount(GpuCuller& culler)
+{
+	GLuint Count = 0;
+	CachedBindBuffer(GL_COPY_WRITE_BUFFER, GpuName(culler.CountBuffer));
+	glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(Count), &Count);
+	return (int)Count;
+}
+
+int ReadGpuOccludedCount(GpuCuller& culler)
+{
+	GLuint Count = 0;
+	CachedBindBuffer(GL_COPY_WRITE_BUFFER, GpuName(culler.CountBuffer));
+	glGetBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(Count), sizeof(Count), &Count);
+	return (int)Count;
+}
+
+void ExtractFrustumPlanes(const float* viewProjection, float planes[6][4])
+{
+	// Gribb & Hartmann: with clip = M * p, the planes are row 3 +/- rows 0, 1 and 2.
+	// Column-major, so row r is elements r, r + 4, r + 8 and r + 12.
+	for (int Plane = 0; Plane < 6; Plane++) {
+		int Row = Plane / 2;
+		float Sign = Plane % 2 == 0 ? 1.0f : -1.0f;
+		for (int Column = 0; Column < 4; Column++) {
+			planes[Plane][Column] = viewProjection[Column * 4 + 3] + Sign * viewProjection[Column * 4 + Row];
+		}
+		float Length = sqrtf(planes[Plane][0] * planes[Plane][0] + planes[Plane][1] * planes[Plane][1] + planes[Plane][2] * planes[Plane][2]);
+		for (int Column = 0; Column < 4; Column++) {
+			planes[Plane][Column] /= Length;
+		}
+	}
+}
+
+bool SphereInFrustum(const float planes[6][4], float x, float y, float z, float radius)
+{
+	for (int Plane = 0; Plane < 6; Plane++) {
+		if (planes[Plane][0] * x + planes[Plane][1] * y + planes[Plane][2] * z + planes[Plane][3] < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,81 @@
+#ifndef GPUCULLING_HPP
+#define GPUCULLING_HPP
+
+#include "TransformBatch.hpp"
+#include "GpuResources.hpp"
+#include "HiZBuffer.hpp"
+
+// GPU-driven drawing of many copies of a mesh. Each frame a compute shader (shaders/FrustumCull.computeshader)
+// tests every object's bounding sphere against the frustum in FrameUniforms, and writes one
+// DrawElementsIndirectCommand per visible object. A single glMultiDrawElementsIndirect() then draws them,
+// so the CPU cost of a frame doesn't depend on how many objects there are or how many are visible.
+// Needs GL 4.3 (compute shaders, storage buffers, multi draw indirect). With GL 4.6 or ARB_indirect_parameters
+// the visible commands are packed and the draw count comes from the GPU too.
+//
+// Occlusion culling, with a HiZBuffer: an occluder pass first writes the commands of the objects the last frame
+// drew (still in the frustum, at this frame's instance offset), they're drawn into the depth pre-pass and the
+// pyramid is built from it. Then the main pass also drops the objects whose bounds are behind that depth.
+// The occluders are drawn where they are this frame, so nothing visible is ever culled: an object that
+// wasn't drawn last frame just can't hide anything yet.
+
+// Must match local_size_x in the compute shader
+#define GPU_CULLING_GROUP_SIZE 64
+
+// Layout glMultiDrawElementsIndirect() reads
+struct DrawElementsIndirectCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
+
+struct GpuCuller
+{
+	GLuint Program;
+	GpuProgramHandle ProgramHandle;
+	GpuBufferHandle BoundsBuffer;	// One vec4 per object: bounding sphere center and radius
+	GpuBufferHandle CommandBuffer;	// One DrawElementsIndirectCommand per object
+	GpuBufferHandle CountBuffer;	// Visible and occluded objects of the last dispatch
+	GpuBufferHandle VisibilityBuffer;	// One uint per object: drawn by the last main pass
+	GLint ObjectCountID;
+	GLint IndexCountID;
+	GLint FirstInstanceID;
+	GLint CompactID;
+	GLint OccluderPassID;
+	GLint OcclusionTestID;
+	GLint HiZSizeID;
+	GLint HiZLevelsID;
+	int ObjectCount;
+	GLsizei IndexCount;
+	bool Compact;			// Draw count read from CountBuffer by the GPU
+};
+
+bool GpuCullingAvailable();
+
+// The objects only rotate, so their bounding spheres (meshRadius around each position) never change
+bool CreateGpuCuller(GpuCuller& culler, const TransformBatch& objects, float meshRadius, GLsizei indexCount);
+void DestroyGpuCuller(GpuCuller& culler);
+
+// Culls against the frustum of the FrameUniforms bound for this frame, and against the depth pyramid of hiz
+// unless it's NULL. firstInstance is the instance (in the bound instance attributes) of object 0.
+void DispatchGpuCulling(GpuCuller& culler, GLuint firstInstance, const HiZBuffer* hiz);
+// Writes the commands of the objects the last DispatchGpuCulling() drew, for DrawGpuCulled() to draw the
+// occluders of the depth pre-pass. Call it before this frame's DispatchGpuCulling(), which overwrites them.
+void DispatchGpuOccluders(GpuCuller& culler, GLuint firstInstance);
+
+// Draws every visible object, in one call, with the instanced program and VAO bound
+void DrawGpuCulled(GpuCuller& culler, GLenum indexType);
+
+// Reads the visible count of the last dispatch back. It waits for the GPU, it's only meant for stats.
+int ReadGpuVisibleCount(GpuCuller& culler);
+// Same for the objects in the frustum that the depth hid
+int ReadGpuOccludedCount(GpuCuller& culler);
+
+// Frustum planes from a column-major viewProjection matrix, normalized, normals pointing inside
+void ExtractFrustumPlanes(const float* viewProjection, float planes[6][4]);
+// Same test the compute shader does, for culling on the CPU
+bool SphereInFrustum(const float planes[6][4], float x, float y, float z, float radius);
+
+#endif
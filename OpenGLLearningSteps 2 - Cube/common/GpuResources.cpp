@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+
+#include <GL/glew.h>
+
+#include "GpuResources.hpp"
+#include "StateCache.hpp"
+
+struct GpuResourceSlot
+{
+	GLuint Name;
+	uint32_t Generation;	// Of the object in the slot, or of the next one when it's free
+	bool Live;
+	long long Bytes;
+	const char* Label;
+};
+
+struct GpuResourceTable
+{
+	std::vector<GpuResourceSlot> Slots;
+	std::vector<uint32_t> FreeSlots;
+	std::vector<GLuint> FreeNames;		// Generated, never handed out yet
+	std::vector<GLuint> Released;		// Released during this frame
+	GpuResourceStats Stats;
+};
+
+// What was released during one frame, deleted once the GPU passed the fence after it
+struct DeletionBatch
+{
+	GLsync Fence;
+	std::vector<GLuint> Names[NumGpuResourceTypes];
+};
+
+static GpuResourceTable Tables[NumGpuResourceTypes];
+static std::deque<DeletionBatch> PendingBatches;
+
+static const char* const TypeNames[NumGpuResourceTypes] = { "buffer", "vertex array", "program" };
+
+static void DeleteNames(GpuResourceType type, const std::vector<GLuint>& names)
+{
+	if (names.empty()) {
+		return;
+	}
+	switch (type) {
+	case GpuResourceBuffer:
+		glDeleteBuffers((GLsizei)names.size(), &names[0]);
+		break;
+	case GpuResourceVertexArray:
+		glDeleteVertexArrays((GLsizei)names.size(), &names[0]);
+		break;
+	case GpuResourceProgram:
+		for (size_t i = 0; i < names.size(); i++) {
+			glDeleteProgram(names[i]);
+		}
+		break;
+	default:
+		break;
+	}
+	// Deleting a bound object unbinds it, and glGen*() can hand the name out again: the cache mustn't
+	// think it's still bound
+	StateCacheInvalidate();
+}
+
+static uint32_t AddObject(GpuResourceType type, GLuint name, const char* label)
+{
+	GpuResourceTable& Table = Tables[type];
+	uint32_t Index;
+	if (!Table.FreeSlots.empty()) {
+		Index = Table.FreeSlots.back();
+		Table.FreeSlots.pop_back();
+	}
+	else {
+		Index = (uint32_t)Table.Slots.size();
+		GpuResourceSlot Slot = { 0, 1, false, 0, NULL };
+		Table.Slots.push_back(Slot);
+	}
+	GpuResourceSlot& Slot = Table.Slots[Index];
+	Slot.Name = name;
+	Slot.Live = true;
+	Slot.Bytes = 0;
+	Slot.Label = label;
+	Table.Stats.Live++;
+	Table.Stats.Created++;
+	return Index;
+}
+
+// Next name from the pool, generating a new batch when it's empty
+static GLuint PooledName(GpuResourceType type)
+{
+	std::vector<GLuint>& FreeNames = Tables[type].FreeNames;
+	if (FreeNames.empty()) {
+		GLuint Names[GPU_RESOURCE_NAME_BATCH];
+		if (type == GpuResourceBuffer) {
+			glGenBuffers(GPU_RESOURCE_NAME_BATCH, Names);
+		}
+		else {
+			glGenVertexArrays(GPU_RESOURCE_NAME_BATCH, Names);
+		}
+		// Handed out from the back, so in the order they were generated
+		for (int i = GPU_RESOURCE_NAME_BATCH - 1; i >= 0; i--) {
+			FreeNames.push_back(Names[i]);
+		}
+	}
+	GLuint Name = FreeNames.back();
+	FreeNames.pop_back();
+	return Name;
+}
+
+static GpuResourceSlot* FindSlot(GpuResourceType type, uint32_t index, uint32_t generation)
+{
+	GpuResourceTable& Table = Tables[type];
+	if (generation == 0 || index >= Table.Slots.size()) {
+		return NULL;
+	}
+	GpuResourceSlot& Slot = Table.Slots[index];
+	return Slot.Live && Slot.Generation == generation ? &Slot : NULL;
+}
+
+GpuBufferHandle CreateGpuBuffer(const char* label)
+{
+	GpuBufferHandle Handle;
+	Handle.Index = AddObject(GpuResourceBuffer, PooledName(GpuResourceBuffer), label);
+	Handle.Generation = Tables[GpuResourceBuffer].Slots[Handle.Index].Generation;
+	return Handle;
+}
+
+GpuVertexArrayHandle CreateGpuVertexArray(const char* label)
+{
+	GpuVertexArrayHandle Handle;
+	Handle.Index = AddObject(GpuResourceVertexArray, PooledName(GpuResourceVertexArray), label);
+	Handle.Generation = Tables[GpuResourceVertexArray].Slots[Handle.Index].Generation;
+	return Handle;
+}
+
+GpuProgramHandle AdoptGpuProgram(GLuint program, const char* label)
+{
+	GpuProgramHandle Handle;
+	Handle.Index = 0;
+	Handle.Generation = 0;
+	if (program == 0) {
+		return Handle;
+	}
+	Handle.Index = AddObject(GpuResourceProgram, program, label);
+	Handle.Generation = Tables[GpuResourceProgram].Slots[Handle.Index].Generation;
+	return Handle;
+}
+
+void SetGpuBufferSize(GpuBufferHandle handle, GLsizeiptr size)
+{
+	GpuResourceSlot* Slot = FindSlot(GpuResourceBuffer, handle.Index, handle.Generation);
+	if (Slot == NULL) {
+		return;
+	}
+	GpuResourceStats& Stats = Tables[GpuResourceBuffer].Stats;
+	Stats.Bytes += (long long)size - Slot->Bytes;
+	Slot->Bytes = (long long)size;
+	if (Stats.Bytes > Stats.PeakBytes) {
+		Stats.PeakBytes = Stats.Bytes;
+	}
+}
+
+void GpuBufferData(GpuBufferHandle handle, GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	CachedBindBuffer(target, GpuName(handle));
+	glBufferData(target, size, data, usage);
+	SetGpuBufferSize(handle, size);
+}
+
+void ReleaseGpuResource(GpuResourceType type, uint32_t index, uint32_t generation)
+{
+	GpuResourceSlot* Slot = FindSlot(type, index, generation);
+	if (Slot == NULL) {
+		return;
+	}
+	GpuResourceTable& Table = Tables[type];
+	Table.Released.push_back(Slot->Name);
+	Table.Stats.Live--;
+	Table.Stats.PendingDeletes++;
+	Table.Stats.Bytes -= Slot->Bytes;
+	Slot->Name = 0;
+	Slot->Live = false;
+	Slot->Bytes = 0;
+	Slot->Label = NULL;
+	// The old handles stop resolving right away
+	Slot->Generation = Slot->Generation == 0xFFFFFFFFu ? 1 : Slot->Generation + 1;
+	Table.FreeSlots.push_back(index);
+}
+
+GLuint GpuResourceName(GpuResourceType type, uint32_t index, uint32_t generation)
+{
+	GpuResourceSlot* Slot = FindSlot(type, index, generation);
+	return Slot != NULL ? Slot->Name : 0;
+}
+
+void GpuResourcesEndFrame()
+{
+	bool Released = false;
+	for (int t = 0; t < NumGpuResourceTypes; t++) {
+		Released = Released || !Tables[t].Released.empty();
+	}
+	if (Released) {
+		PendingBatches.push_back(DeletionBatch());
+		DeletionBatch& Batch = PendingBatches.back();
+		for (int t = 0; t < NumGpuResourceTypes; t++) {
+			Batch.Names[t].swap(Tables[t].Released);
+		}
+		Batch.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Fences pass in order, the first one that didn't stops the search
+	while (!PendingBatches.empty()) {
+		DeletionBatch& Batch = PendingBatches.front();
+		GLenum Status = glClientWaitSync(Batch.Fence, 0, 0);
+		if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(Batch.Fence);
+		for (int t = 0; t < NumGpuResourceTypes; t++) {
+			DeleteNames((GpuResourceType)t, Batch.Names[t]);
+			Tables[t].Stats.PendingDeletes -= (long long)Batch.Names[t].size();
+		}
+		PendingBatches.pop_front();
+	}
+}
+
+GpuResourceStats GetGpuResourceStats(GpuResourceType type)
+{
+	return Tables[type].Stats;
+}
+
+const char* GpuResourceTypeName(GpuResourceType type)
+{
+	return TypeNames[type];
+}
+
+int ShutdownGpuResources()
+{
+	glFinish();
+	while (!PendingBatches.empty()) {
+		DeletionBatch& Batch = PendingBatches.front();
+		glDeleteSync(Batch.Fence);
+		for (int t = 0; t < NumGpuResourceTypes; t++) {
+			DeleteNames((GpuResourceType)t, Batch.Names[t]);
+		}
+		PendingBatches.pop_front();
+	}
+
+	int Leaks = 0;
+	for (int t = 0; t < NumGpuResourceTypes; t++) {
+		GpuResourceTable& Table = Tables[t];
+		DeleteNames((GpuResourceType)t, Table.Released);
+		DeleteNames((GpuResourceType)t, Table.FreeNames);
+		for (size_t i = 0; i < Table.Slots.size(); i++) {
+			const GpuResourceSlot& Slot = Table.Slots[i];
+			if (!Slot.Live) {
+				continue;
+			}
+			fprintf(stderr, "GPU resource leak: %s %u \"%s\" (%lld bytes)\n", TypeNames[t], Slot.Name, Slot.Label != NULL ? Slot.Label : "", Slot.Bytes);
+			Leaks++;
+		}
+		// Leaks included: the context is about to go, and every handle left stops resolving
+		std::vector<GLuint> Names;
+		for (size_t i = 0; i < Table.Slots.size(); i++) {
+			if (Table.Slots[i].Live) {
+				Names.push_back(Table.Slots[i].Name);
+			}
+		}
+		DeleteNames((GpuResourceType)t, Names);
+		Table.Slots.clear();
+		Table.FreeSlots.clear();
+		Table.FreeNames.clear();
+		Table.Released.clear();
+		memset(&Table.Stats, 0, sizeof(Table.Stats));
+	}
+	return Leaks;
+}
@@ -0,0 +1,118 @@
+#ifndef GPURESOURCES_HPP
+#define GPURESOURCES_HPP
+
+#include <stdint.h>
+
+// Owner of the GL objects (buffers, vertex arrays, programs), so they can be counted and none is forgotten.
+//
+//  - Code holds handles instead of GL names: a slot index and a generation. Releasing an object bumps the
+//    generation of its slot, so a handle kept after that resolves to 0 instead of whatever reused the slot.
+//  - Buffer and vertex array names are generated GPU_RESOURCE_NAME_BATCH at a time and handed out from a pool.
+//  - Releasing doesn't call GL: the name waits in a queue until the fence of the frame it was released in
+//    has passed (GpuResourcesEndFrame()), so nothing is deleted while the GPU may still read it.
+//    Then the whole batch is deleted with one glDelete*() call per type.
+//  - Live objects and buffer memory are counted per type. ShutdownGpuResources() prints what's still alive.
+//
+// GL thread only, like everything that calls GL.
+
+#define GPU_RESOURCE_NAME_BATCH 16
+
+enum GpuResourceType
+{
+	GpuResourceBuffer,
+	GpuResourceVertexArray,
+	GpuResourceProgram,
+	NumGpuResourceTypes
+};
+
+// Generation 0 is never used, a zeroed handle is the null handle
+template <GpuResourceType Type>
+struct GpuHandle
+{
+	uint32_t Index;
+	uint32_t Generation;
+};
+
+typedef GpuHandle<GpuResourceBuffer> GpuBufferHandle;
+typedef GpuHandle<GpuResourceVertexArray> GpuVertexArrayHandle;
+typedef GpuHandle<GpuResourceProgram> GpuProgramHandle;
+
+struct GpuResourceStats
+{
+	long long Live;
+	long long Created;			// Since the start, so Created - Live is what was released
+	long long PendingDeletes;	// Released, waiting for their frame's fence
+	long long Bytes;			// Buffer memory (what SetGpuBufferSize() was told)
+	long long PeakBytes;
+};
+
+// label is kept as is (use a string literal), it names the object in the leak report
+GpuBufferHandle CreateGpuBuffer(const char* label);
+GpuVertexArrayHandle CreateGpuVertexArray(const char* label);
+// Takes ownership of a program linked elsewhere (LoadShaders()...), there's no batch of program names
+GpuProgramHandle AdoptGpuProgram(GLuint program, const char* label);
+
+// For the memory accounting, call it after glBufferData() / glBufferStorage()
+void SetGpuBufferSize(GpuBufferHandle handle, GLsizeiptr size);
+
+// Binds the buffer to target (through the state cache, so GL_COPY_WRITE_BUFFER rather than a target the VAO
+// remembers) and fills it with glBufferData(), accounting for the size
+void GpuBufferData(GpuBufferHandle handle, GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+
+// Deletion is deferred, see above. The handle is reset to the null handle. Releasing the null handle does nothing.
+void ReleaseGpuResource(GpuResourceType type, uint32_t index, uint32_t generation);
+template <GpuResourceType Type>
+inline void ReleaseGpuResource(GpuHandle<Type>& handle)
+{
+	ReleaseGpuResource(Type, handle.Index, handle.Generation);
+	handle.Index = 0;
+	handle.Generation = 0;
+}
+
+// The GL name, 0 for the null handle or one that was released
+GLuint GpuResourceName(GpuResourceType type, uint32_t index, uint32_t generation);
+template <GpuResourceType Type>
+inline GLuint GpuName(GpuHandle<Type> handle)
+{
+	return GpuResourceName(Type, handle.Index, handle.Generation);
+}
+
+// Call once per frame after the last draw: fences what was released during the frame,
+// and deletes what was released in frames the GPU is done with. Never waits.
+void GpuResourcesEndFrame();
+
+GpuResourceStats GetGpuResourceStats(GpuResourceType type);
+const char* GpuResourceTypeName(GpuResourceType type);
+
+// Waits for the GPU, deletes everything still pending and the unused pooled names, and prints the objects
+// that are still alive, which are leaks. Returns how many. Call it before the context goes away.
+int ShutdownGpuResources();
+
+// Owns one object and releases it when it goes out of scope (an early return included)
+template <GpuResourceType Type>
+class GpuObject
+{
+public:
+	GpuObject() { Handle.Index = 0; Handle.Generation = 0; }
+	explicit GpuObject(GpuHandle<Type> handle) : Handle(handle) {}
+	~GpuObject() { ReleaseGpuResource(Handle); }
+
+	GLuint Name() const { return GpuName(Handle); }
+	GpuHandle<Type> Get() const { return Handle; }
+
+	// Releases the object now, or swaps in another one
+	void Reset() { ReleaseGpuResource(Handle); }
+	void Reset(GpuHandle<Type> handle) { ReleaseGpuResource(Handle); Handle = handle; }
+
+private:
+	GpuObject(const GpuObject&);
+	GpuObject& operator=(const GpuObject&);
+
+	GpuHandle<Type> Handle;
+};
+
+typedef GpuObject<GpuResourceBuffer> GpuBuffer;
+typedef GpuObject<GpuResourceVertexArray> GpuVertexArray;
+typedef GpuObject<GpuResourceProgram> GpuProgram;
+
+#endif
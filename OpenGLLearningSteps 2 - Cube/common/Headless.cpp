@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "Headless.hpp"
+
+#ifndef _WIN32
+static EGLDisplay HeadlessDisplay = EGL_NO_DISPLAY;
+static EGLContext HeadlessContext = EGL_NO_CONTEXT;
+#endif
+
+static GLuint HeadlessFramebuffer = 0;
+static GLuint HeadlessColorbuffer = 0;
+static GLuint HeadlessDepthbuffer = 0;
+
+#ifndef _WIN32
+static bool HasExtension(const char* extensions, const char* name)
+{
+	if (extensions == NULL) {
+		return false;
+	}
+
+	// Extensions are a space separated list, so match whole words only
+	size_t NameLength = strlen(name);
+	for (const char* p = strstr(extensions, name); p != NULL; p = strstr(p + NameLength, name)) {
+		if ((p == extensions || p[-1] == ' ') && (p[NameLength] == ' ' || p[NameLength] == '\0')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static EGLDisplay GetHeadlessDisplay()
+{
+	// The surfaceless platform doesn't need X11 or Wayland, or even a GPU, which is exactly what build machines have
+	const char* ClientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (HasExtension(ClientExtensions, "EGL_MESA_platform_surfaceless") && HasExtension(ClientExtensions, "EGL_EXT_platform_base")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (eglGetPlatformDisplayEXT != NULL) {
+			EGLDisplay Display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+			if (Display != EGL_NO_DISPLAY) {
+				return Display;
+			}
+		}
+	}
+
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+#endif
+
+bool CreateHeadlessContext()
+{
+#ifdef _WIN32
+	fprintf(stderr, "Headless mode needs EGL, which isn't available on Windows\n");
+	return false;
+#else
+	HeadlessDisplay = GetHeadlessDisplay();
+	EGLint Major, Minor;
+	if (HeadlessDisplay == EGL_NO_DISPLAY || !eglInitialize(HeadlessDisplay, &Major, &Minor)) {
+		fprintf(stderr, "Failed to initialize EGL\n");
+		return false;
+	}
+
+	if (!HasExtension(eglQueryString(HeadlessDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+		fprintf(stderr, "EGL_KHR_surfaceless_context is not supported, can't render without a window\n");
+		eglTerminate(HeadlessDisplay);
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "Failed to bind the OpenGL API in EGL\n");
+		eglTerminate(HeadlessDisplay);
+		return false;
+	}
+
+	// We draw into our own framebuffer, so any config that can render OpenGL will do.
+	// The surface type has to be given anyway, the default is a window and surfaceless displays have none.
+	const EGLint ConfigAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig Config;
+	EGLint NumConfigs = 0;
+	if (!eglChooseConfig(HeadlessDisplay, ConfigAttribs, &Config, 1, &NumConfigs) || NumConfigs == 0) {
+		fprintf(stderr, "Failed to find an EGL config that supports OpenGL\n");
+		eglTerminate(HeadlessDisplay);
+		return false;
+	}
+
+	// Same context as the window gets: OpenGL 3.3 Core Profile
+	const EGLint ContextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	HeadlessContext = eglCreateContext(HeadlessDisplay, Config, EGL_NO_CONTEXT, ContextAttribs);
+	if (HeadlessContext == EGL_NO_CONTEXT) {
+		fprintf(stderr, "Failed to create an OpenGL 3.3 context with EGL\n");
+		eglTerminate(HeadlessDisplay);
+		return false;
+	}
+
+	if (!eglMakeCurrent(HeadlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, HeadlessContext)) {
+		fprintf(stderr, "Failed to make the EGL context current\n");
+		DestroyHeadlessContext();
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+bool CreateHeadlessFramebuffer(int width, int height)
+{
+	// A surfaceless context has no default framebuffer, so this one takes its place
+	glGenRenderbuffers(1, &HeadlessColorbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, HeadlessColorbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &HeadlessDepthbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, HeadlessDepthbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &HeadlessFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, HeadlessFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, HeadlessColorbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, HeadlessDepthbuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "The offscreen framebuffer is not complete\n");
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+}
+
+void DestroyHeadlessContext()
+{
+	if (HeadlessFramebuffer != 0) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &HeadlessFramebuffer);
+		glDeleteRenderbuffers(1, &HeadlessColorbuffer);
+		glDeleteRenderbuffers(1, &HeadlessDepthbuffer);
+		HeadlessFramebuffer = HeadlessColorbuffer = HeadlessDepthbuffer = 0;
+	}
+
+#ifndef _WIN32
+	if (HeadlessDisplay != EGL_NO_DISPLAY) {
+		eglMakeCurrent(HeadlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (HeadlessContext != EGL_NO_CONTEXT) {
+			eglDestroyContext(HeadlessDisplay, HeadlessContext);
+		}
+		eglTerminate(HeadlessDisplay);
+		HeadlessDisplay = EGL_NO_DISPLAY;
+		HeadlessContext = EGL_NO_CONTEXT;
+	}
+#endif
+}
@@ -0,0 +1,18 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+// Headless rendering: instead of a GLFW window, an EGL context without any surface is created
+// (EGL_MESA_platform_surfaceless when available, so it also works with Mesa's llvmpipe on machines
+// without a display or a GPU), and everything is drawn into an offscreen framebuffer.
+// Only available where EGL is, so not on Windows.
+
+// Creates the EGL context and makes it current. Call it instead of glfwInit()/glfwCreateWindow().
+bool CreateHeadlessContext();
+
+// Creates the offscreen framebuffer (color + depth) and binds it. GLEW must be initialized already.
+bool CreateHeadlessFramebuffer(int width, int height);
+
+// Deletes the offscreen framebuffer and destroys the EGL context.
+void DestroyHeadlessContext();
+
+#endif
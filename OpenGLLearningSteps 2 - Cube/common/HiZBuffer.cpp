@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "HiZBuffer.hpp"
+#include "Shader.hpp"
+#include "StateCache.hpp"
+
+// Must match local_size_x and local_size_y in the compute shader
+#define HIZ_GROUP_SIZE 8
+
+// Texture unit of the depth, image units of the level read and the level written
+#define HIZ_DEPTH_UNIT 0
+#define HIZ_SOURCE_IMAGE 0
+#define HIZ_DESTINATION_IMAGE 1
+
+static int LargestPowerOfTwo(int size)
+{
+	int Power = 1;
+	while (Power * 2 <= size) {
+		Power *= 2;
+	}
+	return Power;
+}
+
+bool CreateHiZBuffer(HiZBuffer& hiz, int width, int height)
+{
+	memset(&hiz, 0, sizeof(hiz));
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &hiz.MainFramebuffer);
+
+	hiz.Program = LoadComputeShader("shaders/HiZBuild.computeshader");
+	if (hiz.Program == 0) {
+		return false;
+	}
+	hiz.ProgramHandle = AdoptGpuProgram(hiz.Program, "hi-z pyramid");
+	hiz.FromDepthID = glGetUniformLocation(hiz.Program, "FromDepth");
+	CachedUseProgram(hiz.Program);
+	glUniform1i(glGetUniformLocation(hiz.Program, "Depth"), HIZ_DEPTH_UNIT);
+	glUniform1i(glGetUniformLocation(hiz.Program, "Source"), HIZ_SOURCE_IMAGE);
+	glUniform1i(glGetUniformLocation(hiz.Program, "Destination"), HIZ_DESTINATION_IMAGE);
+
+	hiz.Width = width;
+	hiz.Height = height;
+	hiz.PyramidWidth = LargestPowerOfTwo(width);
+	hiz.PyramidHeight = LargestPowerOfTwo(height);
+	hiz.Levels = 1;
+	while ((hiz.PyramidWidth >> hiz.Levels) > 0 || (hiz.PyramidHeight >> hiz.Levels) > 0) {
+		hiz.Levels++;
+	}
+
+	// Sampled with texelFetch() only, so no filtering and no comparison
+	glGenTextures(1, &hiz.DepthTexture);
+	glBindTexture(GL_TEXTURE_2D, hiz.DepthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+	glGenTextures(1, &hiz.PyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, hiz.PyramidTexture);
+	glTexStorage2D(GL_TEXTURE_2D, hiz.Levels, GL_R32F, hiz.PyramidWidth, hiz.PyramidHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &hiz.Framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, hiz.Framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, hiz.DepthTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	bool Complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, hiz.MainFramebuffer);
+	if (!Complete) {
+		fprintf(stderr, "The depth pre-pass framebuffer is not complete\n");
+		DestroyHiZBuffer(hiz);
+		return false;
+	}
+
+	printf("Hi-Z occlusion culling: %dx%d depth pre-pass, pyramid of %d levels from %dx%d\n",
+		width, height, hiz.Levels, hiz.PyramidWidth, hiz.PyramidHeight);
+	return true;
+}
+
+void DestroyHiZBuffer(HiZBuffer& hiz)
+{
+	if (hiz.Framebuffer != 0) {
+		glDeleteFramebuffers(1, &hiz.Framebuffer);
+	}
+	if (hiz.DepthTexture != 0) {
+		glDeleteTextures(1, &hiz.DepthTexture);
+	}
+	if (hiz.PyramidTexture != 0) {
+		glDeleteTextures(1, &hiz.PyramidTexture);
+	}
+	ReleaseGpuResource(hiz.ProgramHandle);
+	memset(&hiz, 0, sizeof(hiz));
+}
+
+void BeginHiZDepthPass(HiZBuffer& hiz)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, hiz.Framebuffer);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void EndHiZDepthPass(HiZBuffer& hiz)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, hiz.MainFramebuffer);
+}
+
+void BuildHiZPyramid(HiZBuffer& hiz)
+{
+	CachedUseProgram(hiz.Program);
+	glActiveTexture(GL_TEXTURE0 + HIZ_DEPTH_UNIT);
+	glBindTexture(GL_TEXTURE_2D, hiz.DepthTexture);
+	for (int Level = 0; Level < hiz.Levels; Level++) {
+		int LevelWidth = hiz.PyramidWidth >> Level > 0 ? hiz.PyramidWidth >> Level : 1;
+		int LevelHeight = hiz.PyramidHeight >> Level > 0 ? hiz.PyramidHeight >> Level : 1;
+		glUniform1i(hiz.FromDepthID, Level == 0 ? 1 : 0);
+		if (Level > 0) {
+			glBindImageTexture(HIZ_SOURCE_IMAGE, hiz.PyramidTexture, Level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		}
+		glBindImageTexture(HIZ_DESTINATION_IMAGE, hiz.PyramidTexture, Level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((LevelWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (LevelHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+		// The next level reads this one as an image, the culling as a texture
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+}
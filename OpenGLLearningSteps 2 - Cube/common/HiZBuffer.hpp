@@ -0,0 +1,43 @@
+#ifndef HIZBUFFER_HPP
+#define HIZBUFFER_HPP
+
+#include "GpuResources.hpp"
+
+// Hierarchical depth buffer for occlusion culling (see GpuCulling.hpp).
+//  - The depth pre-pass draws the occluders into a depth texture of its own, the size of the framebuffer.
+//    It's never drawn to the screen, the main pass clears and tests its own depth as usual.
+//  - BuildHiZPyramid() reduces it into a mip chain of the farthest depth: level 0 is the largest power of two
+//    that fits in the framebuffer, then each level halves it down to 1x1 (shaders/HiZBuild.computeshader).
+//    An object whose nearest depth is farther than the pyramid over its screen rectangle is hidden.
+// Needs GL 4.3 like the GPU culling (compute shaders, image load/store, immutable textures).
+// The textures and the framebuffer aren't resource manager types, this owns their GL names.
+
+struct HiZBuffer
+{
+	GLuint Framebuffer;			// Depth only, DepthTexture attached
+	GLuint DepthTexture;
+	GLuint PyramidTexture;		// R32F, Levels levels
+	GLuint Program;
+	GpuProgramHandle ProgramHandle;
+	GLint FromDepthID;
+	int Width;
+	int Height;
+	int PyramidWidth;			// Level 0
+	int PyramidHeight;
+	int Levels;
+	GLint MainFramebuffer;		// Bound when the pre-pass ends: 0, or the headless framebuffer
+};
+
+// width x height is the framebuffer's. Call it with the main framebuffer bound.
+bool CreateHiZBuffer(HiZBuffer& hiz, int width, int height);
+void DestroyHiZBuffer(HiZBuffer& hiz);
+
+// Binds the depth texture and clears it, then draw the occluders
+void BeginHiZDepthPass(HiZBuffer& hiz);
+// Binds the main framebuffer back
+void EndHiZDepthPass(HiZBuffer& hiz);
+
+// One dispatch per level, from the depth pass. The culling reads it right after, no wait on the CPU.
+void BuildHiZPyramid(HiZBuffer& hiz);
+
+#endif
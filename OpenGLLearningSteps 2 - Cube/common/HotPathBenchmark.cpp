@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "HotPathBenchmark.hpp"
+#include "Benchmark.hpp"
+#include "Shader.hpp"
+#include "GpuResources.hpp"
+
+// The program of the single cube
+static const char* VertexShaderPath = "shaders/TransformVertexShader.vertexshader";
+static const char* FragmentShaderPath = "shaders/ColorFragmentShader.fragmentshader";
+
+static const int MvpCompositions = 10000;
+
+// Where the MVP checksum goes, a volatile store the compiler has to keep (and so every composition before it)
+static volatile float MvpChecksumSink;
+
+// Same as LoadShaders() reads a shader file
+static bool ReadFile(const char* path, std::string& code)
+{
+	std::ifstream Stream(path, std::ios::in);
+	if (!Stream.is_open()) {
+		return false;
+	}
+	std::stringstream sstr;
+	sstr << Stream.rdbuf();
+	code = sstr.str();
+	return true;
+}
+
+// A comment right after the #version line, so no two samples compile the same source
+static std::string UniqueSource(const std::string& code, int sample)
+{
+	size_t LineEnd = code.find('\n');
+	if (LineEnd == std::string::npos) {
+		return code;
+	}
+	char Comment[64];
+	snprintf(Comment, sizeof(Comment), "// benchmark sample %d\n", sample);
+	return code.substr(0, LineEnd + 1) + Comment + code.substr(LineEnd + 1);
+}
+
+// Compiles and waits for the result, 0 if it didn't compile
+static GLuint CompileShader(GLenum type, const std::string& code)
+{
+	GLuint Shader = glCreateShader(type);
+	const char* Source = code.c_str();
+	glShaderSource(Shader, 1, &Source, NULL);
+	glCompileShader(Shader);
+	GLint Compiled = GL_FALSE;
+	glGetShaderiv(Shader, GL_COMPILE_STATUS, &Compiled);
+	if (!Compiled) {
+		glDeleteShader(Shader);
+		return 0;
+	}
+	return Shader;
+}
+
+// Times run() samples times after warmupSamples untimed calls. run() gets the sample number (warmup ones
+// included, so it never repeats), setup() and teardown() are called around it, outside of the timing.
+template <typename Setup, typename Run, typename Teardown>
+static BenchmarkCase TimeCase(const char* name, int samples, int warmupSamples, Setup setup, Run run, Teardown teardown)
+{
+	std::vector<double> TimesMs;
+	for (int i = 0; i < warmupSamples + samples; i++) {
+		setup(i);
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		run(i);
+		double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		teardown(i);
+		if (i >= warmupSamples) {
+			TimesMs.push_back(ElapsedMs);
+		}
+	}
+	BenchmarkCase Case;
+	Case.Name = name;
+	Case.Times = ComputeFrameTimeStats(TimesMs);
+	return Case;
+}
+
+static void Nothing(int)
+{
+}
+
+bool RunHotPathBenchmark(int samples, int warmupSamples, const char* jsonPath)
+{
+	std::string VertexCode, FragmentCode;
+	if (!ReadFile(VertexShaderPath, VertexCode) || !ReadFile(FragmentShaderPath, FragmentCode)) {
+		fprintf(stderr, "Impossible to open %s or %s, run from the project folder\n", VertexShaderPath, FragmentShaderPath);
+		return false;
+	}
+
+	std::vector<BenchmarkCase> Cases;
+	bool Failed = false;
+
+	// The whole startup path. The first (warmup) call fills the program cache, so it's the warm start that's timed.
+	GLuint LoadedProgram = 0;
+	Cases.push_back(TimeCase("load_shaders", samples, warmupSamples, Nothing,
+		[&](int) { LoadedProgram = LoadShaders(VertexShaderPath, FragmentShaderPath); },
+		[&](int) {
+			Failed |= LoadedProgram == 0;
+			GpuProgramHandle Handle = AdoptGpuProgram(LoadedProgram, "benchmark program");
+			ReleaseGpuResource(Handle);
+			GpuResourcesEndFrame();
+		}));
+
+	Cases.push_back(TimeCase("shader_read", samples, warmupSamples, Nothing,
+		[&](int) { Failed |= !ReadFile(VertexShaderPath, VertexCode) || !ReadFile(FragmentShaderPath, FragmentCode); },
+		Nothing));
+
+	GLuint VertexShader = 0, FragmentShader = 0;
+	Cases.push_back(TimeCase("shader_compile", samples, warmupSamples, Nothing,
+		[&](int sample) {
+			VertexShader = CompileShader(GL_VERTEX_SHADER, UniqueSource(VertexCode, sample));
+			FragmentShader = CompileShader(GL_FRAGMENT_SHADER, UniqueSource(FragmentCode, sample));
+		},
+		[&](int) { Failed |= VertexShader == 0 || FragmentShader == 0; glDeleteShader(VertexShader); glDeleteShader(FragmentShader); }));
+
+	// Fresh shaders for every link, a link of the same ones could come from a cache as well
+	GLuint Program = 0;
+	GLint Linked = GL_FALSE;
+	Cases.push_back(TimeCase("shader_link", samples, warmupSamples,
+		[&](int sample) {
+			VertexShader = CompileShader(GL_VERTEX_SHADER, UniqueSource(VertexCode, warmupSamples + samples + sample));
+			FragmentShader = CompileShader(GL_FRAGMENT_SHADER, UniqueSource(FragmentCode, warmupSamples + samples + sample));
+		},
+		[&](int) {
+			Program = glCreateProgram();
+			glAttachShader(Program, VertexShader);
+			glAttachShader(Program, FragmentShader);
+			glLinkProgram(Program);
+			glGetProgramiv(Program, GL_LINK_STATUS, &Linked);
+		},
+		[&](int) {
+			Failed |= Linked != GL_TRUE;
+			GpuProgramHandle Handle = AdoptGpuProgram(Program, "benchmark program");
+			ReleaseGpuResource(Handle);
+			GpuResourcesEndFrame();
+			glDeleteShader(VertexShader);
+			glDeleteShader(FragmentShader);
+		}));
+
+	// Creation and upload, done once the GPU has the data
+	const GLsizeiptr UploadSizes[4] = { 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+	const char* UploadNames[4] = { "buffer_upload_4k", "buffer_upload_64k", "buffer_upload_1m", "buffer_upload_16m" };
+	std::vector<unsigned char> UploadData((size_t)UploadSizes[3]);
+	for (size_t i = 0; i < UploadData.size(); i++) {
+		UploadData[i] = (unsigned char)(i * 31);
+	}
+	for (int s = 0; s < 4; s++) {
+		GpuBufferHandle Buffer;
+		Cases.push_back(TimeCase(UploadNames[s], samples, warmupSamples, Nothing,
+			[&](int) {
+				Buffer = CreateGpuBuffer("benchmark upload");
+				GpuBufferData(Buffer, GL_COPY_WRITE_BUFFER, UploadSizes[s], &UploadData[0], GL_STATIC_DRAW);
+				glFinish();
+			},
+			[&](int) { ReleaseGpuResource(Buffer); GpuResourcesEndFrame(); }));
+	}
+
+	// What main.cpp does for the single cube, MvpCompositions times with a different model matrix each
+	glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	glm::mat4 View = glm::lookAt(glm::vec3(4, 3, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+	glm::mat4 Sum(0.0f);
+	Cases.push_back(TimeCase("mvp_compose_x10000", samples, warmupSamples, Nothing,
+		[&](int) {
+			for (int i = 0; i < MvpCompositions; i++) {
+				glm::mat4 Model = glm::rotate(glm::mat4(1.0f), i * 0.001f, glm::vec3(0, 1, 0));
+				glm::mat4 MVP = Projection * View * Model;
+				Sum += MVP;
+			}
+		},
+		Nothing));
+	// Every element used, so none of the compositions can be optimized away
+	float Checksum = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		Checksum += Sum[i / 4][i % 4];
+	}
+	MvpChecksumSink = Checksum;
+
+	// Let everything released above really go
+	glFinish();
+	for (int i = 0; i < 4; i++) {
+		GpuResourcesEndFrame();
+	}
+
+	if (Failed) {
+		fprintf(stderr, "A shader didn't compile or link during the benchmark\n");
+		return false;
+	}
+	return WriteBenchmarkCasesJson(jsonPath, (const char*)glGetString(GL_RENDERER), Cases);
+}
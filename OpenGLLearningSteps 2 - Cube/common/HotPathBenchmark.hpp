@@ -0,0 +1,18 @@
+#ifndef HOTPATHBENCHMARK_HPP
+#define HOTPATHBENCHMARK_HPP
+
+// Microbenchmarks of what the cube does at startup and every frame, run one after the other on the current
+// context (headless, so llvmpipe works):
+//  - LoadShaders() of the cube program, then its three steps on their own: reading the files, compiling,
+//    linking. Every compile gets a different comment in the source, or the driver's own shader cache would
+//    make all but the first one free.
+//  - Creating a buffer and uploading 4 KB, 64 KB, 1 MB and 16 MB into it, waiting until the GPU has it.
+//  - Composing 10000 MVP matrices with glm the way main.cpp does.
+// A full frame of the cube is the plain --benchmark scene, tools/BenchmarkSuite.py runs both and compares
+// them with a stored baseline.
+//
+// Each case runs warmupSamples times untimed, then samples times. Writes the stats of every case as JSON
+// (to jsonPath, stdout if NULL).
+bool RunHotPathBenchmark(int samples, int warmupSamples, const char* jsonPath);
+
+#endif
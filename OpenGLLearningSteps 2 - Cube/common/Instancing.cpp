@@ -0,0 +1,72 @@
+#include <math.h>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Instancing.hpp"
+#include "StateCache.hpp"
+
+bool BuildInstanceGrid(TransformBatch& batch, int count, float spacing, float meshRadius, float& radius)
+{
+	if (!CreateTransformBatch(batch, count)) {
+		return false;
+	}
+
+	// Smallest cube of cells that holds them all
+	int Side = 1;
+	while (Side * Side * Side < count) {
+		Side++;
+	}
+
+	float Half = (Side - 1) * spacing * 0.5f;
+	for (int i = 0; i < count; i++) {
+		int x = i % Side;
+		int y = (i / Side) % Side;
+		int z = i / (Side * Side);
+		batch.PositionX[i] = x * spacing - Half;
+		batch.PositionY[i] = y * spacing - Half;
+		batch.PositionZ[i] = z * spacing - Half;
+	}
+
+	// Corner of the grid plus the bounding sphere of the object there
+	radius = sqrtf(3.0f) * Half + meshRadius;
+	return true;
+}
+
+void AnimateInstances(TransformBatch& batch, float time, size_t first)
+{
+	const glm::vec3 Axis = glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f));
+	for (size_t i = 0; i < batch.Count; i++) {
+		// Quaternion of a rotation of Angle around Axis
+		float HalfAngle = 0.5f * (time + (first + i) * 0.1f);
+		float Sin = sinf(HalfAngle);
+		batch.RotationX[i] = Axis.x * Sin;
+		batch.RotationY[i] = Axis.y * Sin;
+		batch.RotationZ[i] = Axis.z * Sin;
+		batch.RotationW[i] = cosf(HalfAngle);
+	}
+}
+
+void SetupInstanceAttributes(GLuint instanceBuffer, GLintptr offset)
+{
+	CachedBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	// A mat4 attribute is really 4 vec4 attributes, one per column
+	for (int Column = 0; Column < 4; Column++) {
+		GLuint Location = INSTANCE_MODEL_LOCATION + Column;
+		glEnableVertexAttribArray(Location);
+		glVertexAttribPointer(
+			Location,				// attribute
+			4,						// size: one column
+			GL_FLOAT,				// type
+			GL_FALSE,				// normalized?
+			sizeof(glm::mat4),		// stride: from one instance to the next
+			(void*)(offset + sizeof(glm::vec4) * Column)	// array buffer offset
+		);
+		// Advance once per instance, not once per vertex
+		glVertexAttribDivisor(Location, 1);
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef INSTANCING_HPP
+#define INSTANCING_HPP
+
+#include "TransformBatch.hpp"
+
+// First attribute location of the per-instance model matrix, it takes this one and the next 3
+#define INSTANCE_MODEL_LOCATION 2
+
+// Creates the transforms of count objects laid out on a cubic grid centered on the origin, spacing units apart.
+// meshRadius is the bounding radius of one object, radius receives the radius of a sphere around the origin
+// holding all of them.
+// Returns false if the transforms can't be allocated.
+bool BuildInstanceGrid(TransformBatch& batch, int count, float spacing, float meshRadius, float& radius);
+
+// Spins every cube around the same tilted axis, each one time + its own phase radians.
+// When batch is a slice, first is where it starts in the whole batch (the phase depends on it).
+void AnimateInstances(TransformBatch& batch, float time, size_t first = 0);
+
+// Points the instance model matrix attributes of the currently bound VAO at instanceBuffer
+// (tightly packed glm::mat4s, starting offset bytes in), advancing once per instance instead of once per vertex.
+void SetupInstanceAttributes(GLuint instanceBuffer, GLintptr offset = 0);
+
+#endif
@@ -0,0 +1,201 @@
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "JobSystem.hpp"
+
+struct Job
+{
+	JobFunction Function;
+	void* Data;
+	size_t Begin;
+	size_t End;
+	size_t Grain;		// ParallelFor jobs split down to this, 0 for a plain job
+	JobCounter* Counter;
+};
+
+struct JobQueue
+{
+	std::mutex Mutex;
+	std::deque<Job> Jobs;
+};
+
+static std::vector<JobQueue*> Queues;
+static std::vector<std::thread> Workers;
+static std::atomic<bool> Stopping(false);
+static std::atomic<int> QueuedJobs(0);
+// Idle workers sleep on this until a job is queued
+static std::mutex SleepMutex;
+static std::condition_variable WakeUp;
+static thread_local int ThreadIndex = 0;
+
+static void PushJob(const Job& job)
+{
+	JobQueue& Queue = *Queues[ThreadIndex];
+	{
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		Queue.Jobs.push_back(job);
+	}
+	QueuedJobs++;
+	// Taking the lock makes sure a worker about to sleep either sees the job or gets the notification
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+	}
+	WakeUp.notify_one();
+}
+
+static bool PopJob(int thread, Job& job)
+{
+	JobQueue& Queue = *Queues[thread];
+	std::lock_guard<std::mutex> Lock(Queue.Mutex);
+	if (Queue.Jobs.empty()) {
+		return false;
+	}
+	job = Queue.Jobs.back();
+	Queue.Jobs.pop_back();
+	return true;
+}
+
+static bool StealJob(int thread, Job& job)
+{
+	int Count = (int)Queues.size();
+	for (int i = 1; i < Count; i++) {
+		JobQueue& Queue = *Queues[(thread + i) % Count];
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		if (!Queue.Jobs.empty()) {
+			job = Queue.Jobs.front();
+			Queue.Jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+static void ExecuteJob(Job& job, int thread)
+{
+	// A ParallelFor job gives the upper half of its chunks to a child until it has a single one left.
+	// The child is counted before this job finishes, so the counter can't reach 0 in between.
+	while (job.Grain > 0 && job.End - job.Begin > job.Grain) {
+		size_t Chunks = (job.End - job.Begin + job.Grain - 1) / job.Grain;
+		Job Child = job;
+		Child.Begin = job.Begin + Chunks / 2 * job.Grain;
+		job.End = Child.Begin;
+		job.Counter->Pending++;
+		PushJob(Child);
+	}
+	job.Function(job.Data, job.Begin, job.End, thread);
+	job.Counter->Pending--;
+}
+
+static bool TryRunJob(int thread)
+{
+	Job Next;
+	if (!PopJob(thread, Next) && !StealJob(thread, Next)) {
+		return false;
+	}
+	QueuedJobs--;
+	ExecuteJob(Next, thread);
+	return true;
+}
+
+static void WorkerMain(int thread)
+{
+	ThreadIndex = thread;
+	while (!Stopping) {
+		if (TryRunJob(thread)) {
+			continue;
+		}
+		std::unique_lock<std::mutex> Lock(SleepMutex);
+		WakeUp.wait(Lock, [] { return QueuedJobs > 0 || Stopping; });
+	}
+}
+
+void StartJobSystem(int threads)
+{
+	StopJobSystem();
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+		threads = threads > 0 ? threads : 1;
+	}
+	Stopping = false;
+	ThreadIndex = 0;
+	for (int i = 0; i < threads; i++) {
+		Queues.push_back(new JobQueue());
+	}
+	for (int i = 1; i < threads; i++) {
+		Workers.push_back(std::thread(WorkerMain, i));
+	}
+}
+
+void StopJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		Stopping = true;
+	}
+	WakeUp.notify_all();
+	for (size_t i = 0; i < Workers.size(); i++) {
+		Workers[i].join();
+	}
+	Workers.clear();
+	for (size_t i = 0; i < Queues.size(); i++) {
+		delete Queues[i];
+	}
+	Queues.clear();
+}
+
+int JobThreadCount()
+{
+	return Queues.empty() ? 1 : (int)Queues.size();
+}
+
+void InitJobCounter(JobCounter& counter)
+{
+	counter.Pending = 0;
+}
+
+void RunJob(JobFunction function, void* data, size_t begin, size_t end, JobCounter& counter)
+{
+	Job NewJob = { function, data, begin, end, 0, &counter };
+	counter.Pending++;
+	if (Queues.empty()) {
+		// No job system, it's done right away
+		ExecuteJob(NewJob, 0);
+		return;
+	}
+	PushJob(NewJob);
+}
+
+void WaitForJobs(JobCounter& counter)
+{
+	while (counter.Pending > 0) {
+		if (!TryRunJob(ThreadIndex)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ParallelFor(size_t count, size_t grain, JobFunction function, void* data)
+{
+	if (count == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = 1;
+	}
+	if (Queues.size() <= 1) {
+		for (size_t Begin = 0; Begin < count; Begin += grain) {
+			function(data, Begin, Begin + grain < count ? Begin + grain : count, 0);
+		}
+		return;
+	}
+
+	JobCounter Counter;
+	InitJobCounter(Counter);
+	Job Root = { function, data, 0, count, grain, &Counter };
+	Counter.Pending++;
+	PushJob(Root);
+	WaitForJobs(Counter);
+}
@@ -0,0 +1,42 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <stddef.h>
+#include <atomic>
+
+// Work-stealing job scheduler for the CPU side of a frame. Every thread, the main one included, has its own
+// deque of jobs: it pushes and pops at the back, so it keeps working on what it just split off while that's
+// still in its cache, and an idle thread steals from the front of the others, where the biggest pieces are.
+// Jobs are counted on a JobCounter. A job can start children on its own counter before it returns, so waiting
+// on a counter waits for the whole tree. A thread that waits runs jobs meanwhile instead of blocking.
+//
+// The deques are a mutex each rather than lock-free: jobs here are a few thousand objects at least,
+// taking the lock is nowhere near what they cost.
+// Only the main thread talks to OpenGL, jobs never do.
+
+struct JobCounter
+{
+	std::atomic<int> Pending;
+};
+
+// Runs the items [begin, end) of a job. thread is the index of the thread running it, 0 is the main one.
+typedef void (*JobFunction)(void* data, size_t begin, size_t end, int thread);
+
+// threads counts the calling thread, which becomes thread 0. 0 means one per hardware thread, 1 runs everything inline.
+void StartJobSystem(int threads);
+void StopJobSystem();
+int JobThreadCount();
+
+void InitJobCounter(JobCounter& counter);
+// Queues a job on the calling thread's deque. Can be called from a job.
+void RunJob(JobFunction function, void* data, size_t begin, size_t end, JobCounter& counter);
+// Returns once every job of counter (and their children) finished
+void WaitForJobs(JobCounter& counter);
+
+// Runs function over [0, count) in chunks of grain items and returns when they're all done. Chunk k is
+// [k * grain, (k + 1) * grain), the last one may be shorter, and each one is a separate call.
+// It starts as one job that hands half of its chunks to a child job until it's down to one, so the splitting
+// itself is spread over the threads.
+void ParallelFor(size_t count, size_t grain, JobFunction function, void* data);
+
+#endif
@@ -0,0 +1,270 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "Mesh.hpp"
+
+// Key used to weld vertices: the exact bits of the attributes compared
+struct WeldKey
+{
+	float Values[6];
+
+	bool operator<(const WeldKey& other) const
+	{
+		return memcmp(Values, other.Values, sizeof(Values)) < 0;
+	}
+};
+
+Mesh BuildIndexedMesh(const float* positions, const float* colors, size_t vertexCount, bool weldByPosition)
+{
+	Mesh Result;
+	std::map<WeldKey, unsigned int> Welded;
+	std::vector<unsigned int> Remap(vertexCount);
+
+	for (size_t i = 0; i < vertexCount; i++) {
+		WeldKey Key;
+		memset(&Key, 0, sizeof(Key));
+		memcpy(Key.Values, &positions[i * 3], 3 * sizeof(float));
+		if (!weldByPosition) {
+			memcpy(Key.Values + 3, &colors[i * 3], 3 * sizeof(float));
+		}
+
+		std::map<WeldKey, unsigned int>::iterator Found = Welded.find(Key);
+		if (Found != Welded.end()) {
+			Remap[i] = Found->second;
+			continue;
+		}
+
+		MeshVertex Vertex;
+		memcpy(Vertex.Position, &positions[i * 3], sizeof(Vertex.Position));
+		memcpy(Vertex.Color, &colors[i * 3], sizeof(Vertex.Color));
+		Remap[i] = (unsigned int)Result.Vertices.size();
+		Welded[Key] = Remap[i];
+		Result.Vertices.push_back(Vertex);
+	}
+
+	Result.Indices.reserve(vertexCount);
+	for (size_t i = 0; i + 2 < vertexCount; i += 3) {
+		unsigned int A = Remap[i], B = Remap[i + 1], C = Remap[i + 2];
+		if (A == B || B == C || A == C) {
+			continue;
+		}
+		Result.Indices.push_back(A);
+		Result.Indices.push_back(B);
+		Result.Indices.push_back(C);
+	}
+
+	return Result;
+}
+
+// Scoring constants from Forsyth's article
+#define FORSYTH_CACHE_SIZE 32
+static const float CacheDecayPower = 1.5f;
+static const float LastTriScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+struct ForsythVertex
+{
+	int CachePosition;		// -1 when not in the cache
+	int LiveTriangles;		// Triangles using it that are not emitted yet
+	int FirstTriangle;		// Offset in the vertex -> triangles adjacency list
+	float Score;
+};
+
+static float ForsythScore(const ForsythVertex& vertex)
+{
+	// Nothing left to draw with this vertex, it's worthless
+	if (vertex.LiveTriangles == 0) {
+		return -1.0f;
+	}
+
+	float Score = 0.0f;
+	if (vertex.CachePosition >= 0) {
+		if (vertex.CachePosition < 3) {
+			// Used by the last triangle: fixed score, so the strip-like order isn't favored too much
+			Score = LastTriScore;
+		}
+		else {
+			const float Scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			Score = powf(1.0f - (vertex.CachePosition - 3) * Scaler, CacheDecayPower);
+		}
+	}
+
+	// Boost vertices with few triangles left, so they get finished instead of lingering around
+	Score += ValenceBoostScale * powf((float)vertex.LiveTriangles, -ValenceBoostPower);
+	return Score;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t NumTriangles = indices.size() / 3;
+	size_t NumVertices = vertexCount;
+	if (NumTriangles == 0) {
+		return;
+	}
+
+	std::vector<ForsythVertex> Vertices(NumVertices);
+	for (size_t i = 0; i < NumVertices; i++) {
+		Vertices[i].CachePosition = -1;
+		Vertices[i].LiveTriangles = 0;
+	}
+	for (size_t i = 0; i < indices.size(); i++) {
+		Vertices[indices[i]].LiveTriangles++;
+	}
+
+	// Vertex -> triangles adjacency, as one flat array
+	std::vector<int> Adjacency(indices.size());
+	std::vector<int> AdjacencyCount(NumVertices, 0);
+	int Offset = 0;
+	for (size_t i = 0; i < NumVertices; i++) {
+		Vertices[i].FirstTriangle = Offset;
+		Offset += Vertices[i].LiveTriangles;
+	}
+	for (size_t t = 0; t < NumTriangles; t++) {
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = indices[t * 3 + k];
+			Adjacency[Vertices[v].FirstTriangle + AdjacencyCount[v]++] = (int)t;
+		}
+	}
+
+	for (size_t i = 0; i < NumVertices; i++) {
+		Vertices[i].Score = ForsythScore(Vertices[i]);
+	}
+
+	std::vector<float> TriangleScores(NumTriangles);
+	std::vector<bool> Emitted(NumTriangles, false);
+	for (size_t t = 0; t < NumTriangles; t++) {
+		TriangleScores[t] = Vertices[indices[t * 3]].Score + Vertices[indices[t * 3 + 1]].Score + Vertices[indices[t * 3 + 2]].Score;
+	}
+
+	// 3 extra slots for the triangle being pushed in before the overflow is dropped
+	int Cache[FORSYTH_CACHE_SIZE + 3];
+	int CacheSize = 0;
+
+	std::vector<unsigned int> NewIndices;
+	NewIndices.reserve(indices.size());
+
+	size_t NextUnemitted = 0;
+	for (size_t Emitting = 0; Emitting < NumTriangles; Emitting++) {
+		// Best triangle among the ones touching the cache. Only if there is none, fall back to the
+		// next triangle not emitted yet, that's what keeps the whole thing linear.
+		int Best = -1;
+		float BestScore = -1.0f;
+		for (int i = 0; i < CacheSize; i++) {
+			const ForsythVertex& Vertex = Vertices[Cache[i]];
+			for (int j = 0; j < Vertex.LiveTriangles; j++) {
+				int t = Adjacency[Vertex.FirstTriangle + j];
+				if (TriangleScores[t] > BestScore) {
+					Best = t;
+					BestScore = TriangleScores[t];
+				}
+			}
+		}
+		if (Best < 0) {
+			while (Emitted[NextUnemitted]) {
+				NextUnemitted++;
+			}
+			Best = (int)NextUnemitted;
+		}
+
+		Emitted[Best] = true;
+		TriangleScores[Best] = -1.0f;
+
+		// Emit it, move its vertices to the front of the cache and take it out of their live triangles
+		int NewCache[FORSYTH_CACHE_SIZE + 3];
+		int NewCacheSize = 0;
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = indices[Best * 3 + k];
+			NewIndices.push_back(v);
+			NewCache[NewCacheSize++] = (int)v;
+
+			ForsythVertex& Vertex = Vertices[v];
+			int* Triangles = &Adjacency[Vertex.FirstTriangle];
+			for (int j = 0; j < Vertex.LiveTriangles; j++) {
+				if (Triangles[j] == Best) {
+					Triangles[j] = Triangles[Vertex.LiveTriangles - 1];
+					Vertex.LiveTriangles--;
+					break;
+				}
+			}
+		}
+		for (int i = 0; i < CacheSize; i++) {
+			int v = Cache[i];
+			if (v != NewCache[0] && v != NewCache[1] && v != NewCache[2]) {
+				NewCache[NewCacheSize++] = v;
+			}
+		}
+
+		// Vertices pushed out of the cache lose their cache score
+		for (int i = FORSYTH_CACHE_SIZE; i < NewCacheSize; i++) {
+			Vertices[NewCache[i]].CachePosition = -1;
+			Vertices[NewCache[i]].Score = ForsythScore(Vertices[NewCache[i]]);
+		}
+		CacheSize = std::min(NewCacheSize, FORSYTH_CACHE_SIZE);
+		for (int i = 0; i < CacheSize; i++) {
+			Cache[i] = NewCache[i];
+			Vertices[Cache[i]].CachePosition = i;
+			Vertices[Cache[i]].Score = ForsythScore(Vertices[Cache[i]]);
+		}
+
+		// Only the triangles of cached vertices changed score
+		for (int i = 0; i < CacheSize; i++) {
+			const ForsythVertex& Vertex = Vertices[Cache[i]];
+			for (int j = 0; j < Vertex.LiveTriangles; j++) {
+				int t = Adjacency[Vertex.FirstTriangle + j];
+				TriangleScores[t] = Vertices[indices[t * 3]].Score + Vertices[indices[t * 3 + 1]].Score + Vertices[indices[t * 3 + 2]].Score;
+			}
+		}
+	}
+
+	indices.swap(NewIndices);
+}
+
+void OptimizeVertexCache(Mesh& mesh)
+{
+	OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+}
+
+void OptimizeVertexFetch(Mesh& mesh)
+{
+	const unsigned int Unused = 0xFFFFFFFFu;
+	std::vector<unsigned int> Remap(mesh.Vertices.size(), Unused);
+	std::vector<MeshVertex> NewVertices;
+	NewVertices.reserve(mesh.Vertices.size());
+
+	for (size_t i = 0; i < mesh.Indices.size(); i++) {
+		unsigned int v = mesh.Indices[i];
+		if (Remap[v] == Unused) {
+			Remap[v] = (unsigned int)NewVertices.size();
+			NewVertices.push_back(mesh.Vertices[v]);
+		}
+		mesh.Indices[i] = Remap[v];
+	}
+
+	// Vertices no triangle uses are dropped on the way
+	mesh.Vertices.swap(NewVertices);
+}
+
+float ComputeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize)
+{
+	size_t NumTriangles = indices.size() / 3;
+	if (NumTriangles == 0) {
+		return 0.0f;
+	}
+
+	// FIFO cache: a vertex is in the cache if it was put there less than cacheSize misses ago
+	std::vector<long long> InsertedAt(vertexCount, -1);
+	long long Misses = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		long long& Inserted = InsertedAt[indices[i]];
+		if (Inserted < 0 || Misses - Inserted >= cacheSize) {
+			Inserted = Misses;
+			Misses++;
+		}
+	}
+
+	return (float)Misses / NumTriangles;
+}
@@ -0,0 +1,44 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <stddef.h>
+#include <vector>
+
+// Interleaved vertex: position then color, matching the attribute locations 0 and 1 of the shaders
+struct MeshVertex
+{
+	float Position[3];
+	float Color[3];
+};
+
+// Indexed triangle list
+struct Mesh
+{
+	std::vector<MeshVertex> Vertices;
+	std::vector<unsigned int> Indices;
+};
+
+// Post-transform cache size used to compute the ACMR. Real GPUs are somewhere between 16 and 32.
+#define MESH_ACMR_CACHE_SIZE 16
+
+// Builds an indexed mesh from a non-indexed triangle list given as separate position and color
+// arrays (3 floats per vertex each). Identical vertices are welded into one. With weldByPosition,
+// vertices only need the same position to be welded and the first color seen is kept.
+// Degenerate triangles (two corners welded together) are dropped.
+Mesh BuildIndexedMesh(const float* positions, const float* colors, size_t vertexCount, bool weldByPosition);
+
+// Reorders the triangles so that vertices are reused while still in the post-transform cache
+// (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation").
+void OptimizeVertexCache(Mesh& mesh);
+// Same on an index list alone, for the LODs that share the vertices of a mesh
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Reorders the vertices in the order the triangles first use them, so vertex fetch walks the buffer
+// forward. Run it after OptimizeVertexCache().
+void OptimizeVertexFetch(Mesh& mesh);
+
+// Average cache miss ratio: vertices transformed per triangle with a FIFO cache of cacheSize entries.
+// 3 is the worst possible, a non-indexed mesh always gets it. 0.5 is about the best on big regular meshes.
+float ComputeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize);
+
+#endif
@@ -0,0 +1,616 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#endif
+
+#include <GL/glew.h>
+
+#include "MeshFile.hpp"
+#include "ObjLoader.hpp"
+#include "MeshLod.hpp"
+#include "StateCache.hpp"
+#include "StreamBuffer.hpp"
+
+static const char MeshFileMagic[4] = { 'G', 'L', 'M', 'S' };
+
+// The tables are read in place from the mapping, so their layout must not depend on the compiler
+static_assert(sizeof(MeshFileHeader) == 88, "MeshFileHeader must have no padding");
+static_assert(sizeof(MeshFileAttribute) == 20 && sizeof(MeshFileLod) == 12, "mesh file tables must have no padding");
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static GLsizei AttributeTypeSize(GLenum type)
+{
+	switch (type) {
+	case GL_FLOAT: return 4;
+	case GL_HALF_FLOAT: return 2;
+	case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+	case GL_INT: case GL_UNSIGNED_INT: case GL_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_2_10_10_10_REV: return 4;
+	default: return 0;
+	}
+}
+
+static void ComputeMeshBounds(const Mesh& mesh, float boundsMin[3], float boundsMax[3])
+{
+	for (int Axis = 0; Axis < 3; Axis++) {
+		boundsMin[Axis] = mesh.Vertices[0].Position[Axis];
+		boundsMax[Axis] = mesh.Vertices[0].Position[Axis];
+	}
+	for (size_t i = 1; i < mesh.Vertices.size(); i++) {
+		for (int Axis = 0; Axis < 3; Axis++) {
+			float Value = mesh.Vertices[i].Position[Axis];
+			boundsMin[Axis] = Value < boundsMin[Axis] ? Value : boundsMin[Axis];
+			boundsMax[Axis] = Value > boundsMax[Axis] ? Value : boundsMax[Axis];
+		}
+	}
+}
+
+// Positions stored as normalized integers are relative to the bounds, anything else is used as it is
+static void ComputeMeshDequantize(GpuMesh& mesh)
+{
+	PositionDequantize& Dequantize = mesh.Dequantize;
+	for (int Axis = 0; Axis < 3; Axis++) {
+		Dequantize.Scale[Axis] = 1.0f;
+		Dequantize.Bias[Axis] = 0.0f;
+	}
+	for (int i = 0; i < mesh.AttributeCount; i++) {
+		const MeshFileAttribute& Attribute = mesh.Attributes[i];
+		if (Attribute.Location != 0 || !Attribute.Normalized) {
+			continue;
+		}
+		if (Attribute.Type == GL_BYTE || Attribute.Type == GL_SHORT || Attribute.Type == GL_INT) {
+			// [-1, 1] covers the bounds
+			ComputePositionDequantize(mesh.BoundsMin, mesh.BoundsMax, Dequantize);
+		}
+		else {
+			// [0, 1] covers the bounds
+			for (int Axis = 0; Axis < 3; Axis++) {
+				Dequantize.Bias[Axis] = mesh.BoundsMin[Axis];
+				Dequantize.Scale[Axis] = mesh.BoundsMax[Axis] - mesh.BoundsMin[Axis];
+			}
+		}
+	}
+}
+
+// The vertex blob of a mesh and how to read it: MeshVertex as it is, or PackedVertex
+struct VertexLayout
+{
+	std::vector<PackedVertex> Packed;
+	const void* Data;
+	uint32_t Stride;
+	MeshFileAttribute Attributes[2];
+};
+
+static void BuildVertexLayout(const Mesh& mesh, PositionEncoding encoding, VertexLayout& layout, QuantizationReport& report)
+{
+	PositionDequantize Dequantize;
+	QuantizeVertices(mesh, encoding, layout.Packed, Dequantize, report);
+	if (encoding == PositionFloat) {
+		layout.Data = &mesh.Vertices[0];
+		layout.Stride = sizeof(MeshVertex);
+		layout.Attributes[0] = { 0, 3, GL_FLOAT, 0, (uint32_t)offsetof(MeshVertex, Position) };
+		layout.Attributes[1] = { 1, 3, GL_FLOAT, 0, (uint32_t)offsetof(MeshVertex, Color) };
+	}
+	else {
+		// The snorm16 dequantization is the one ComputeMeshDequantize() finds back from the bounds
+		layout.Data = &layout.Packed[0];
+		layout.Stride = sizeof(PackedVertex);
+		layout.Attributes[0] = { 0, 3, (uint32_t)(encoding == PositionHalf ? GL_HALF_FLOAT : GL_SHORT),
+			encoding == PositionSnorm16 ? 1u : 0u, (uint32_t)offsetof(PackedVertex, Position) };
+		layout.Attributes[1] = { 1, 4, GL_UNSIGNED_BYTE, 1, (uint32_t)offsetof(PackedVertex, Color) };
+	}
+}
+
+static void UnmapMemory(MappedMeshFile& file)
+{
+	if (file.Mapping == NULL) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(file.Mapping);
+	CloseHandle((HANDLE)file.MappingObject);
+	CloseHandle((HANDLE)file.File);
+#else
+	munmap(file.Mapping, file.MappingSize);
+#endif
+	file.Mapping = NULL;
+	file.MappingSize = 0;
+}
+
+// Everything the header says has to fit in the file, so a truncated or foreign file is rejected here
+// instead of crashing in the middle of an upload
+static bool ValidateMeshFile(const char* path, const MappedMeshFile& file)
+{
+	const MeshFileHeader& Header = *file.Header;
+	if (file.MappingSize < sizeof(MeshFileHeader) || memcmp(Header.Magic, MeshFileMagic, sizeof(Header.Magic)) != 0) {
+		printf("%s is not a mesh file\n", path);
+		return false;
+	}
+	if (Header.Version != MESH_FILE_VERSION) {
+		printf("%s is a version %u mesh file, only version %d is supported\n", path, Header.Version, MESH_FILE_VERSION);
+		return false;
+	}
+	if (Header.AttributeCount == 0 || Header.AttributeCount > MESH_FILE_MAX_ATTRIBUTES
+		|| Header.LodCount == 0 || Header.LodCount > MESH_FILE_MAX_LODS
+		|| sizeof(MeshFileHeader) + Header.AttributeCount * sizeof(MeshFileAttribute) + Header.LodCount * sizeof(MeshFileLod) > file.MappingSize) {
+		printf("%s has an invalid attribute or LOD table\n", path);
+		return false;
+	}
+
+	GLsizei IndexSize = Header.IndexType == GL_UNSIGNED_SHORT ? 2 : Header.IndexType == GL_UNSIGNED_INT ? 4 : 0;
+	if (IndexSize == 0
+		|| Header.VertexDataOffset % MESH_FILE_ALIGNMENT != 0 || Header.IndexDataOffset % MESH_FILE_ALIGNMENT != 0
+		|| Header.VertexDataSize != (uint64_t)Header.VertexCount * Header.VertexStride
+		|| Header.IndexDataSize != (uint64_t)Header.IndexCount * IndexSize
+		|| Header.VertexDataSize > file.MappingSize || Header.VertexDataOffset > file.MappingSize - Header.VertexDataSize
+		|| Header.IndexDataSize > file.MappingSize || Header.IndexDataOffset > file.MappingSize - Header.IndexDataSize) {
+		printf("%s has invalid or truncated vertex and index data\n", path);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < Header.AttributeCount; i++) {
+		const MeshFileAttribute& Attribute = file.Attributes[i];
+		GLsizei TypeSize = AttributeTypeSize(Attribute.Type);
+		if (TypeSize == 0 || Attribute.Components < 1 || Attribute.Components > 4
+			|| (uint64_t)Attribute.Offset + (uint64_t)TypeSize * Attribute.Components > Header.VertexStride) {
+			printf("%s: attribute %u doesn't fit in a vertex\n", path, i);
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < Header.LodCount; i++) {
+		const MeshFileLod& Lod = file.Lods[i];
+		if ((uint64_t)Lod.FirstIndex + Lod.IndexCount > Header.IndexCount || Lod.IndexCount % 3 != 0) {
+			printf("%s: LOD %u is out of the index data\n", path, i);
+			return false;
+		}
+	}
+
+	// An index past the vertices would have the GPU (or the simplifier) read out of the vertex buffer.
+	// It reads every index once, the upload reads them again while the pages are still in.
+	const unsigned char* Indices = (const unsigned char*)file.Mapping + Header.IndexDataOffset;
+	for (uint32_t i = 0; i < Header.IndexCount; i++) {
+		uint32_t Index;
+		if (IndexSize == 2) {
+			uint16_t ShortIndex;
+			memcpy(&ShortIndex, Indices + (size_t)i * 2, sizeof(ShortIndex));
+			Index = ShortIndex;
+		}
+		else {
+			memcpy(&Index, Indices + (size_t)i * 4, sizeof(Index));
+		}
+		if (Index >= Header.VertexCount) {
+			printf("%s: index %u is %u, there are only %u vertices\n", path, i, Index, Header.VertexCount);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MapMeshFile(const char* path, MappedMeshFile& file)
+{
+	memset(&file, 0, sizeof(file));
+
+#ifdef _WIN32
+	HANDLE File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (File == INVALID_HANDLE_VALUE) {
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+	LARGE_INTEGER Size;
+	GetFileSizeEx(File, &Size);
+	HANDLE MappingObject = Size.QuadPart > 0 ? CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	void* Mapping = MappingObject != NULL ? MapViewOfFile(MappingObject, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (Mapping == NULL) {
+		printf("Impossible to map %s\n", path);
+		if (MappingObject != NULL)
+			CloseHandle(MappingObject);
+		CloseHandle(File);
+		return false;
+	}
+	file.File = File;
+	file.MappingObject = MappingObject;
+	file.MappingSize = (size_t)Size.QuadPart;
+#else
+	int Fd = open(path, O_RDONLY);
+	if (Fd < 0) {
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+	struct stat Info;
+	void* Mapping = MAP_FAILED;
+	if (fstat(Fd, &Info) == 0 && Info.st_size > 0) {
+		Mapping = mmap(NULL, (size_t)Info.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+	}
+	// The mapping keeps the file alive by itself
+	close(Fd);
+	if (Mapping == MAP_FAILED) {
+		printf("Impossible to map %s\n", path);
+		return false;
+	}
+	// The blobs are read once, front to back
+	madvise(Mapping, (size_t)Info.st_size, MADV_SEQUENTIAL);
+	file.MappingSize = (size_t)Info.st_size;
+#endif
+
+	file.Mapping = Mapping;
+	const unsigned char* Bytes = (const unsigned char*)Mapping;
+	file.Header = (const MeshFileHeader*)Bytes;
+	file.Attributes = (const MeshFileAttribute*)(Bytes + sizeof(MeshFileHeader));
+	file.Lods = (const MeshFileLod*)(file.Attributes + (file.MappingSize >= sizeof(MeshFileHeader) ? file.Header->AttributeCount : 0));
+	if (!ValidateMeshFile(path, file)) {
+		UnmapMemory(file);
+		return false;
+	}
+	file.Vertices = Bytes + file.Header->VertexDataOffset;
+	file.Indices = Bytes + file.Header->IndexDataOffset;
+	return true;
+}
+
+void UnmapMeshFile(MappedMeshFile& file)
+{
+	UnmapMemory(file);
+	file.Header = NULL;
+	file.Attributes = NULL;
+	file.Lods = NULL;
+	file.Vertices = NULL;
+	file.Indices = NULL;
+}
+
+// Pages that were uploaded already aren't needed anymore, give them back instead of letting the whole file pile up in memory
+static void ReleasePages(const unsigned char* data, size_t size)
+{
+#ifndef _WIN32
+	static const size_t PageSize = (size_t)sysconf(_SC_PAGESIZE);
+	uintptr_t Begin = AlignUp((uintptr_t)data, PageSize);
+	uintptr_t End = ((uintptr_t)data + size) / PageSize * PageSize;
+	if (End > Begin) {
+		madvise((void*)Begin, End - Begin, MADV_DONTNEED);
+	}
+#else
+	(void)data;
+	(void)size;
+#endif
+}
+
+// Small blobs go to glBufferData() straight from the mapping. Big ones go through a stream buffer
+// a chunk at a time, with STREAM_BUFFER_REGIONS chunks in flight, so the driver never stages the whole blob.
+static GpuBufferHandle UploadBlob(const unsigned char* data, uint64_t size, StreamBuffer& stream, const char* label)
+{
+	GpuBufferHandle Handle = CreateGpuBuffer(label);
+	GLuint Buffer = GpuName(Handle);
+	CachedBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+	SetGpuBufferSize(Handle, (GLsizeiptr)size);
+	if (size <= MESH_UPLOAD_CHUNK) {
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, data, GL_STATIC_DRAW);
+		return Handle;
+	}
+
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, NULL, GL_STATIC_DRAW);
+	if (stream.Buffer == 0 && !CreateStreamBuffer(stream, MESH_UPLOAD_CHUNK)) {
+		ReleaseGpuResource(Handle);
+		return Handle;
+	}
+
+	for (uint64_t Offset = 0; Offset < size; Offset += MESH_UPLOAD_CHUNK) {
+		GLsizeiptr ChunkSize = (GLsizeiptr)(size - Offset < MESH_UPLOAD_CHUNK ? size - Offset : MESH_UPLOAD_CHUNK);
+		StreamBeginFrame(stream);
+		GLintptr StagingOffset = 0;
+		void* Staging = StreamAllocate(stream, ChunkSize, 4, StagingOffset);
+		if (Staging == NULL) {
+			printf("Couldn't map the staging region for the %s\n", label);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			ReleaseGpuResource(Handle);
+			return Handle;
+		}
+		memcpy(Staging, data + Offset, ChunkSize);
+		StreamFinishWrites(stream);
+
+		// The read side isn't cached, nothing else in the render loop binds GL_COPY_READ_BUFFER
+		glBindBuffer(GL_COPY_READ_BUFFER, stream.Buffer);
+		CachedBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, StagingOffset, (GLintptr)Offset, ChunkSize);
+		StreamEndFrame(stream);
+
+		ReleasePages(data + Offset, ChunkSize);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	return Handle;
+}
+
+bool UploadMeshFile(MappedMeshFile& file, GpuMesh& mesh)
+{
+	const MeshFileHeader& Header = *file.Header;
+	memset(&mesh, 0, sizeof(mesh));
+
+	// The file can be read without a context, so the locations are checked against this GL here
+	GLint MaxAttributes = 0;
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &MaxAttributes);
+	for (uint32_t i = 0; i < Header.AttributeCount; i++) {
+		if (file.Attributes[i].Location >= (uint32_t)MaxAttributes) {
+			printf("Mesh attribute %u is at location %u, this GL has only %d\n", i, file.Attributes[i].Location, MaxAttributes);
+			return false;
+		}
+	}
+
+	StreamBuffer Stream;
+	Stream.Buffer = 0;
+	mesh.VertexBuffer = UploadBlob(file.Vertices, Header.VertexDataSize, Stream, "mesh vertices");
+	if (GpuName(mesh.VertexBuffer) != 0) {
+		mesh.IndexBuffer = UploadBlob(file.Indices, Header.IndexDataSize, Stream, "mesh indices");
+	}
+	if (Stream.Buffer != 0) {
+		DestroyStreamBuffer(Stream);
+	}
+	if (GpuName(mesh.IndexBuffer) == 0) {
+		DestroyGpuMesh(mesh);
+		return false;
+	}
+
+	mesh.VertexStride = (GLsizei)Header.VertexStride;
+	mesh.AttributeCount = (int)Header.AttributeCount;
+	memcpy(mesh.Attributes, file.Attributes, Header.AttributeCount * sizeof(MeshFileAttribute));
+	mesh.IndexType = Header.IndexType;
+	mesh.LodCount = (int)Header.LodCount;
+	memcpy(mesh.Lods, file.Lods, Header.LodCount * sizeof(MeshFileLod));
+	memcpy(mesh.BoundsMin, Header.BoundsMin, sizeof(mesh.BoundsMin));
+	memcpy(mesh.BoundsMax, Header.BoundsMax, sizeof(mesh.BoundsMax));
+	ComputeMeshDequantize(mesh);
+	return true;
+}
+
+bool LoadMeshFile(const char* path, GpuMesh& mesh)
+{
+	MappedMeshFile File;
+	if (!MapMeshFile(path, File)) {
+		return false;
+	}
+	bool Result = UploadMeshFile(File, mesh);
+	UnmapMeshFile(File);
+	return Result;
+}
+
+void DestroyGpuMesh(GpuMesh& mesh)
+{
+	ReleaseGpuResource(mesh.VertexBuffer);
+	ReleaseGpuResource(mesh.IndexBuffer);
+}
+
+void SetupMeshAttributes(const GpuMesh& mesh)
+{
+	// Plain binds, like the rest of the VAO setup: the element binding goes into the VAO, and the cache
+	// doesn't know which VAO is bound here (it's invalidated before the render loop anyway)
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GpuName(mesh.IndexBuffer));
+	glBindBuffer(GL_ARRAY_BUFFER, GpuName(mesh.VertexBuffer));
+	for (int i = 0; i < mesh.AttributeCount; i++) {
+		const MeshFileAttribute& Attribute = mesh.Attributes[i];
+		glEnableVertexAttribArray(Attribute.Location);
+		glVertexAttribPointer(Attribute.Location, Attribute.Components, Attribute.Type, Attribute.Normalized ? GL_TRUE : GL_FALSE,
+			mesh.VertexStride, (void*)(uintptr_t)Attribute.Offset);
+	}
+}
+
+GLsizei MeshIndexSize(const GpuMesh& mesh)
+{
+	return mesh.IndexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+bool UploadMesh(const Mesh& mesh, PositionEncoding encoding, GpuMesh& gpuMesh, QuantizationReport& report)
+{
+	memset(&gpuMesh, 0, sizeof(gpuMesh));
+	if (mesh.Vertices.empty() || mesh.Indices.empty()) {
+		printf("Nothing to upload\n");
+		return false;
+	}
+
+	VertexLayout Layout;
+	BuildVertexLayout(mesh, encoding, Layout, report);
+
+	gpuMesh.VertexBuffer = CreateGpuBuffer("mesh vertices");
+	gpuMesh.IndexBuffer = CreateGpuBuffer("mesh indices");
+	GpuBufferData(gpuMesh.VertexBuffer, GL_COPY_WRITE_BUFFER, (GLsizeiptr)mesh.Vertices.size() * Layout.Stride, Layout.Data, GL_STATIC_DRAW);
+	GpuBufferData(gpuMesh.IndexBuffer, GL_COPY_WRITE_BUFFER, (GLsizeiptr)(mesh.Indices.size() * sizeof(unsigned int)), &mesh.Indices[0], GL_STATIC_DRAW);
+
+	gpuMesh.VertexStride = (GLsizei)Layout.Stride;
+	gpuMesh.AttributeCount = 2;
+	memcpy(gpuMesh.Attributes, Layout.Attributes, sizeof(Layout.Attributes));
+	gpuMesh.IndexType = GL_UNSIGNED_INT;
+	gpuMesh.LodCount = 1;
+	gpuMesh.Lods[0].FirstIndex = 0;
+	gpuMesh.Lods[0].IndexCount = (uint32_t)mesh.Indices.size();
+	gpuMesh.Lods[0].Error = 0.0f;
+	ComputeMeshBounds(mesh, gpuMesh.BoundsMin, gpuMesh.BoundsMax);
+	ComputeMeshDequantize(gpuMesh);
+	return true;
+}
+
+bool WriteMeshFile(const char* path, const Mesh& mesh, const MeshFileLod* lods, int lodCount, PositionEncoding encoding, QuantizationReport& report)
+{
+	if (mesh.Vertices.empty() || mesh.Indices.empty()) {
+		printf("Nothing to write to %s\n", path);
+		return false;
+	}
+
+	VertexLayout Layout;
+	BuildVertexLayout(mesh, encoding, Layout, report);
+
+	MeshFileHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.Magic, MeshFileMagic, sizeof(Header.Magic));
+	Header.Version = MESH_FILE_VERSION;
+	Header.VertexCount = (uint32_t)mesh.Vertices.size();
+	Header.VertexStride = Layout.Stride;
+	Header.AttributeCount = 2;
+	Header.LodCount = (uint32_t)lodCount;
+	bool ShortIndices = mesh.Vertices.size() <= 65536;
+	Header.IndexType = ShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	Header.IndexCount = (uint32_t)mesh.Indices.size();
+
+	ComputeMeshBounds(mesh, Header.BoundsMin, Header.BoundsMax);
+
+	uint64_t TablesEnd = sizeof(Header) + sizeof(Layout.Attributes) + lodCount * sizeof(MeshFileLod);
+	Header.VertexDataOffset = AlignUp(TablesEnd, MESH_FILE_ALIGNMENT);
+	Header.VertexDataSize = (uint64_t)Header.VertexCount * Header.VertexStride;
+	Header.IndexDataOffset = AlignUp(Header.VertexDataOffset + Header.VertexDataSize, MESH_FILE_ALIGNMENT);
+	Header.IndexDataSize = (uint64_t)Header.IndexCount * (ShortIndices ? 2 : 4);
+
+	std::ofstream MeshStream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!MeshStream.is_open()) {
+		printf("Impossible to write %s\n", path);
+		return false;
+	}
+
+	static const char Padding[MESH_FILE_ALIGNMENT] = { 0 };
+	MeshStream.write((const char*)&Header, sizeof(Header));
+	MeshStream.write((const char*)Layout.Attributes, sizeof(Layout.Attributes));
+	MeshStream.write((const char*)lods, lodCount * sizeof(MeshFileLod));
+	MeshStream.write(Padding, Header.VertexDataOffset - TablesEnd);
+	MeshStream.write((const char*)Layout.Data, Header.VertexDataSize);
+	MeshStream.write(Padding, Header.IndexDataOffset - (Header.VertexDataOffset + Header.VertexDataSize));
+	if (ShortIndices) {
+		std::vector<uint16_t> ShortIndexData(mesh.Indices.begin(), mesh.Indices.end());
+		MeshStream.write((const char*)&ShortIndexData[0], Header.IndexDataSize);
+	}
+	else {
+		MeshStream.write((const char*)&mesh.Indices[0], Header.IndexDataSize);
+	}
+
+	if (!MeshStream) {
+		printf("Writing %s failed\n", path);
+		return false;
+	}
+	return true;
+}
+
+bool ConvertObjToMeshFile(const char* objPath, const char* meshPath, int maxLods, PositionEncoding encoding)
+{
+	std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+	Mesh ObjMesh;
+	if (!LoadObj(objPath, ObjMesh)) {
+		return false;
+	}
+	float AcmrBefore = ComputeACMR(ObjMesh.Indices, ObjMesh.Vertices.size(), MESH_ACMR_CACHE_SIZE);
+	OptimizeVertexCache(ObjMesh);
+	OptimizeVertexFetch(ObjMesh);
+	float AcmrAfter = ComputeACMR(ObjMesh.Indices, ObjMesh.Vertices.size(), MESH_ACMR_CACHE_SIZE);
+	int Triangles = (int)ObjMesh.Indices.size() / 3;
+
+	// Simplified after the vertex reordering, the LODs share the vertex buffer as it ends up
+	std::chrono::steady_clock::time_point LodStartTime = std::chrono::steady_clock::now();
+	std::vector<unsigned int> LodIndices;
+	MeshFileLod Lods[MESH_FILE_MAX_LODS];
+	int LodCount = BuildLodChain(ObjMesh, maxLods, LodIndices, Lods);
+	ObjMesh.Indices.swap(LodIndices);
+	double LodMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - LodStartTime).count();
+
+	QuantizationReport Quantization;
+	if (!WriteMeshFile(meshPath, ObjMesh, Lods, LodCount, encoding, Quantization)) {
+		return false;
+	}
+
+	double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+	printf("Converted %s to %s: %d vertices, %d triangles, ACMR %.3f -> %.3f, in %.1f ms\n", objPath, meshPath,
+		(int)ObjMesh.Vertices.size(), Triangles, AcmrBefore, AcmrAfter, ElapsedMs);
+	printf("%d LODs, simplified in %.1f ms:\n", LodCount, LodMs);
+	for (int i = 0; i < LodCount; i++) {
+		printf("  LOD %d: %d triangles, error %g\n", i, (int)Lods[i].IndexCount / 3, Lods[i].Error);
+	}
+	printf("Vertices: %s positions, %d -> %d bytes each, max position error %g, max color error %g\n", PositionEncodingName(encoding),
+		Quantization.BytesPerVertexBefore, Quantization.BytesPerVertexAfter, Quantization.MaxPositionError, Quantization.MaxColorError);
+	return true;
+}
+
+static long long PeakResidentKb()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS Counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+		return 0;
+	return (long long)(Counters.PeakWorkingSetSize / 1024);
+#else
+	struct rusage Usage;
+	getrusage(RUSAGE_SELF, &Usage);
+	return (long long)Usage.ru_maxrss; // Already in KB on Linux
+#endif
+}
+
+static long long FileSize(const char* path)
+{
+	std::ifstream Stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+	return Stream.is_open() ? (long long)Stream.tellg() : 0;
+}
+
+bool RunMeshLoadBenchmark(const char* path)
+{
+	size_t PathLength = strlen(path);
+	bool IsObj = PathLength > 4 && strcmp(path + PathLength - 4, ".obj") == 0;
+	long long RssBefore = PeakResidentKb();
+
+	GpuMesh Loaded;
+	memset(&Loaded, 0, sizeof(Loaded));
+	double ParseMs = 0.0, UploadMs = 0.0;
+	int Vertices = 0, Indices = 0;
+	std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+	if (IsObj) {
+		// What it takes without the binary format: parse, weld, then upload from the vectors
+		Mesh ObjMesh;
+		if (!LoadObj(path, ObjMesh)) {
+			return false;
+		}
+		std::chrono::steady_clock::time_point ParsedTime = std::chrono::steady_clock::now();
+		ParseMs = std::chrono::duration<double, std::milli>(ParsedTime - StartTime).count();
+		Loaded.VertexBuffer = CreateGpuBuffer("mesh vertices");
+		Loaded.IndexBuffer = CreateGpuBuffer("mesh indices");
+		GpuBufferData(Loaded.VertexBuffer, GL_COPY_WRITE_BUFFER, ObjMesh.Vertices.size() * sizeof(MeshVertex), &ObjMesh.Vertices[0], GL_STATIC_DRAW);
+		GpuBufferData(Loaded.IndexBuffer, GL_COPY_WRITE_BUFFER, ObjMesh.Indices.size() * sizeof(unsigned int), &ObjMesh.Indices[0], GL_STATIC_DRAW);
+		glFinish();
+		UploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ParsedTime).count();
+		Vertices = (int)ObjMesh.Vertices.size();
+		Indices = (int)ObjMesh.Indices.size();
+	}
+	else {
+		MappedMeshFile File;
+		if (!MapMeshFile(path, File)) {
+			return false;
+		}
+		std::chrono::steady_clock::time_point MappedTime = std::chrono::steady_clock::now();
+		ParseMs = std::chrono::duration<double, std::milli>(MappedTime - StartTime).count();
+		Vertices = (int)File.Header->VertexCount;
+		Indices = (int)File.Header->IndexCount;
+		bool Uploaded = UploadMeshFile(File, Loaded);
+		glFinish();
+		UnmapMeshFile(File);
+		if (!Uploaded) {
+			return false;
+		}
+		UploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - MappedTime).count();
+	}
+	double TotalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+	long long RssAfter = PeakResidentKb();
+	DestroyGpuMesh(Loaded);
+
+	printf("{\n  \"file\": \"%s\",\n  \"loader\": \"%s\",\n  \"file_bytes\": %lld,\n  \"vertices\": %d,\n  \"indices\": %d,\n",
+		path, IsObj ? "obj_ifstream" : "mesh_mmap", FileSize(path), Vertices, Indices);
+	printf("  \"%s_ms\": %.3f,\n  \"upload_ms\": %.3f,\n  \"total_ms\": %.3f,\n  \"peak_rss_kb\": %lld,\n  \"peak_rss_growth_kb\": %lld\n}\n",
+		IsObj ? "parse" : "map", ParseMs, UploadMs, TotalMs, RssAfter, RssAfter - RssBefore);
+	return true;
+}
@@ -0,0 +1,132 @@
+#ifndef MESHFILE_HPP
+#define MESHFILE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Mesh.hpp"
+#include "VertexQuantize.hpp"
+#include "GpuResources.hpp"
+
+// Binary mesh container (.mesh), laid out so it can be mapped and handed to GL as it is:
+//
+//   MeshFileHeader
+//   MeshFileAttribute[AttributeCount]	how to read one vertex, in glVertexAttribPointer() terms
+//   MeshFileLod[LodCount]				index ranges, LOD 0 is the full mesh
+//   vertex blob						VertexCount * VertexStride bytes, aligned to MESH_FILE_ALIGNMENT
+//   index blob							all the LODs' indices one after the other, aligned too
+//
+// Everything is little endian, which is what every platform these tutorials run on uses.
+// A position (location 0) stored as a normalized integer is relative to the bounds: the shader gets
+// it back as Bias + Value * Scale, with Bias the center of the bounds and Scale half their size.
+
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGNMENT 64
+#define MESH_FILE_MAX_ATTRIBUTES 8
+#define MESH_FILE_MAX_LODS 8
+
+// Blobs bigger than this are uploaded in chunks of this size, so the driver never needs
+// a staging copy of the whole thing and the mapped pages can be dropped as we go
+#define MESH_UPLOAD_CHUNK (4 * 1024 * 1024)
+
+struct MeshFileHeader
+{
+	char Magic[4];				// "GLMS"
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t VertexStride;
+	uint32_t AttributeCount;
+	uint32_t LodCount;
+	uint32_t IndexType;			// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t IndexCount;		// All LODs together
+	uint64_t VertexDataOffset;
+	uint64_t VertexDataSize;
+	uint64_t IndexDataOffset;
+	uint64_t IndexDataSize;
+	float BoundsMin[3];
+	float BoundsMax[3];
+};
+
+struct MeshFileAttribute
+{
+	uint32_t Location;			// Shader attribute location
+	uint32_t Components;		// 1 to 4
+	uint32_t Type;				// GL_FLOAT, GL_HALF_FLOAT, GL_SHORT, GL_UNSIGNED_BYTE...
+	uint32_t Normalized;		// Integer types read as [0, 1] or [-1, 1]
+	uint32_t Offset;			// From the start of the vertex
+};
+
+struct MeshFileLod
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	float Error;				// Object space error against LOD 0, 0 for LOD 0 itself
+};
+
+// A .mesh file mapped in memory. Nothing is copied, the pointers go straight into the mapping.
+struct MappedMeshFile
+{
+	const MeshFileHeader* Header;
+	const MeshFileAttribute* Attributes;
+	const MeshFileLod* Lods;
+	const unsigned char* Vertices;
+	const unsigned char* Indices;
+
+	void* Mapping;
+	size_t MappingSize;
+#ifdef _WIN32
+	void* File;
+	void* MappingObject;
+#endif
+};
+
+// The GL side of a mesh file: its buffers, and what's needed to point attributes at them and draw
+struct GpuMesh
+{
+	GpuBufferHandle VertexBuffer;
+	GpuBufferHandle IndexBuffer;
+	GLsizei VertexStride;
+	int AttributeCount;
+	MeshFileAttribute Attributes[MESH_FILE_MAX_ATTRIBUTES];
+	GLenum IndexType;
+	int LodCount;
+	MeshFileLod Lods[MESH_FILE_MAX_LODS];
+	float BoundsMin[3];
+	float BoundsMax[3];
+	PositionDequantize Dequantize;	// For the PositionScale and PositionBias uniforms
+};
+
+// Maps and validates a file. On failure the reason is printed and nothing stays mapped.
+bool MapMeshFile(const char* path, MappedMeshFile& file);
+void UnmapMeshFile(MappedMeshFile& file);
+
+// Creates the buffers and uploads straight from the mapping
+bool UploadMeshFile(MappedMeshFile& file, GpuMesh& mesh);
+
+// MapMeshFile() + UploadMeshFile() + UnmapMeshFile()
+bool LoadMeshFile(const char* path, GpuMesh& mesh);
+void DestroyGpuMesh(GpuMesh& mesh);
+
+// Points the attributes of the bound VAO at the mesh, and binds its index buffer to it
+void SetupMeshAttributes(const GpuMesh& mesh);
+
+// Size in bytes of one index of the mesh
+GLsizei MeshIndexSize(const GpuMesh& mesh);
+
+// Uploads an in-memory mesh, with its vertices encoded as asked (see VertexQuantize.hpp)
+bool UploadMesh(const Mesh& mesh, PositionEncoding encoding, GpuMesh& gpuMesh, QuantizationReport& report);
+
+// Writes an indexed mesh with its vertices encoded as asked. mesh.Indices holds every LOD, lods tells where each one is.
+// Indices are stored as 16 bits when they fit.
+bool WriteMeshFile(const char* path, const Mesh& mesh, const MeshFileLod* lods, int lodCount, PositionEncoding encoding, QuantizationReport& report);
+
+// Loads a Wavefront OBJ (see ObjLoader.hpp), optimizes it for the vertex cache, simplifies it into up to
+// maxLods LODs (see MeshLod.hpp) and writes it as a .mesh
+bool ConvertObjToMeshFile(const char* objPath, const char* meshPath, int maxLods, PositionEncoding encoding);
+
+// Needs a context. Loads path once (.obj through the text parser, anything else as a .mesh),
+// then prints the load time and the peak resident memory of the process as JSON.
+// Run it once per file, in separate processes: the peak memory only ever grows.
+bool RunMeshLoadBenchmark(const char* path);
+
+#endif
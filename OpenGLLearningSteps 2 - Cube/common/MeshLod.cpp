@@ -0,0 +1,411 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <queue>
+
+#include <GL/glew.h>
+
+#include "MeshLod.hpp"
+
+// Symmetric 4x4 matrix of the plane equations summed up, in doubles: the terms get big on big meshes.
+// Error at x is x.A.x + 2 B.x + C. Weight is the area the planes came from, the error is divided by it.
+struct Quadric
+{
+	double A00, A01, A02, A11, A12, A22;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+};
+
+struct Collapse
+{
+	float Cost;
+	uint32_t From;		// Moves onto To
+	uint32_t To;
+	uint32_t FromStamp;	// The stamps of both ends when it was pushed, it's stale if either changed
+	uint32_t ToStamp;
+};
+
+// Cheapest first, ties in a fixed order so the result doesn't depend on the heap
+struct CollapseGreater
+{
+	bool operator()(const Collapse& a, const Collapse& b) const
+	{
+		if (a.Cost != b.Cost) {
+			return a.Cost > b.Cost;
+		}
+		if (a.From != b.From) {
+			return a.From > b.From;
+		}
+		return a.To > b.To;
+	}
+};
+
+// Edges of a border get planes this many times heavier than their length squared
+static const double BorderWeight = 10.0;
+
+static void AddPlane(Quadric& q, const double n[3], double d, double weight)
+{
+	q.A00 += weight * n[0] * n[0];
+	q.A01 += weight * n[0] * n[1];
+	q.A02 += weight * n[0] * n[2];
+	q.A11 += weight * n[1] * n[1];
+	q.A12 += weight * n[1] * n[2];
+	q.A22 += weight * n[2] * n[2];
+	q.B0 += weight * n[0] * d;
+	q.B1 += weight * n[1] * d;
+	q.B2 += weight * n[2] * d;
+	q.C += weight * d * d;
+	q.Weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.A00 += other.A00;
+	q.A01 += other.A01;
+	q.A02 += other.A02;
+	q.A11 += other.A11;
+	q.A12 += other.A12;
+	q.A22 += other.A22;
+	q.B0 += other.B0;
+	q.B1 += other.B1;
+	q.B2 += other.B2;
+	q.C += other.C;
+	q.Weight += other.Weight;
+}
+
+// Mean squared distance to the planes
+static double QuadricError(const Quadric& q, const float p[3])
+{
+	double x = p[0], y = p[1], z = p[2];
+	double Error = q.A00 * x * x + q.A11 * y * y + q.A22 * z * z
+		+ 2.0 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z)
+		+ 2.0 * (q.B0 * x + q.B1 * y + q.B2 * z) + q.C;
+	if (q.Weight <= 0.0) {
+		return 0.0;
+	}
+	Error /= q.Weight;
+	return Error > 0.0 ? Error : 0.0;
+}
+
+static void Cross(const double a[3], const double b[3], double result[3])
+{
+	result[0] = a[1] * b[2] - a[2] * b[1];
+	result[1] = a[2] * b[0] - a[0] * b[2];
+	result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Unnormalized normal, its length is twice the area
+static void TriangleNormal(const float* p0, const float* p1, const float* p2, double normal[3])
+{
+	double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+	double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+	Cross(e1, e2, normal);
+}
+
+// Vertices that share their position with another one sit on a seam
+static std::vector<bool> FindSeamVertices(const std::vector<MeshVertex>& vertices)
+{
+	std::vector<uint32_t> Order(vertices.size());
+	for (size_t i = 0; i < Order.size(); i++) {
+		Order[i] = (uint32_t)i;
+	}
+	std::sort(Order.begin(), Order.end(), [&vertices](uint32_t a, uint32_t b) {
+		return memcmp(vertices[a].Position, vertices[b].Position, sizeof(vertices[a].Position)) < 0;
+	});
+	std::vector<bool> Seam(vertices.size(), false);
+	for (size_t i = 1; i < Order.size(); i++) {
+		if (memcmp(vertices[Order[i - 1]].Position, vertices[Order[i]].Position, sizeof(vertices[0].Position)) == 0) {
+			Seam[Order[i - 1]] = true;
+			Seam[Order[i]] = true;
+		}
+	}
+	return Seam;
+}
+
+struct Simplifier
+{
+	const std::vector<MeshVertex>* Vertices;
+	std::vector<unsigned int> Indices;
+	std::vector<bool> TriangleLive;
+	std::vector<std::vector<uint32_t> > VertexTriangles;
+	std::vector<Quadric> Quadrics;
+	std::vector<uint32_t> Stamps;
+	std::vector<bool> Locked;
+	std::vector<bool> Removed;
+	std::priority_queue<Collapse, std::vector<Collapse>, CollapseGreater> Heap;
+
+	const float* Position(uint32_t v) const { return (*Vertices)[v].Position; }
+};
+
+// Pushes the cheaper way to collapse the edge, if either end may move
+static void PushEdge(Simplifier& s, uint32_t a, uint32_t b)
+{
+	Collapse Best;
+	Best.Cost = -1.0f;
+	for (int Direction = 0; Direction < 2; Direction++) {
+		uint32_t From = Direction == 0 ? a : b;
+		uint32_t To = Direction == 0 ? b : a;
+		if (s.Locked[From]) {
+			continue;
+		}
+		Quadric Q = s.Quadrics[From];
+		AddQuadric(Q, s.Quadrics[To]);
+		float Cost = (float)QuadricError(Q, s.Position(To));
+		if (Best.Cost < 0.0f || Cost < Best.Cost) {
+			Best.Cost = Cost;
+			Best.From = From;
+			Best.To = To;
+		}
+	}
+	if (Best.Cost < 0.0f) {
+		return;
+	}
+	Best.FromStamp = s.Stamps[Best.From];
+	Best.ToStamp = s.Stamps[Best.To];
+	s.Heap.push(Best);
+}
+
+// True if moving from onto to would turn a triangle around
+static bool CollapseFlips(const Simplifier& s, uint32_t from, uint32_t to)
+{
+	const std::vector<uint32_t>& Triangles = s.VertexTriangles[from];
+	for (size_t i = 0; i < Triangles.size(); i++) {
+		uint32_t t = Triangles[i];
+		if (!s.TriangleLive[t]) {
+			continue;
+		}
+		const unsigned int* Corners = &s.Indices[t * 3];
+		if (Corners[0] == to || Corners[1] == to || Corners[2] == to) {
+			continue;	// Degenerates and goes away
+		}
+		const float* Before[3];
+		const float* After[3];
+		for (int k = 0; k < 3; k++) {
+			Before[k] = s.Position(Corners[k]);
+			After[k] = Corners[k] == from ? s.Position(to) : Before[k];
+		}
+		double NormalBefore[3], NormalAfter[3];
+		TriangleNormal(Before[0], Before[1], Before[2], NormalBefore);
+		TriangleNormal(After[0], After[1], After[2], NormalAfter);
+		double Dot = NormalBefore[0] * NormalAfter[0] + NormalBefore[1] * NormalAfter[1] + NormalBefore[2] * NormalAfter[2];
+		if (Dot <= 0.0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+float SimplifyMesh(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices, size_t targetIndexCount, std::vector<unsigned int>& result)
+{
+	Simplifier s;
+	s.Vertices = &vertices;
+	s.Indices = indices;
+	size_t NumTriangles = indices.size() / 3;
+	size_t NumVertices = vertices.size();
+	s.TriangleLive.assign(NumTriangles, true);
+	s.VertexTriangles.resize(NumVertices);
+	Quadric Zero;
+	memset(&Zero, 0, sizeof(Zero));
+	s.Quadrics.assign(NumVertices, Zero);
+	s.Stamps.assign(NumVertices, 0);
+	s.Locked = FindSeamVertices(vertices);
+	s.Removed.assign(NumVertices, false);
+
+	// Plane of each triangle, weighted by its area, on its three corners
+	for (size_t t = 0; t < NumTriangles; t++) {
+		const unsigned int* Corners = &s.Indices[t * 3];
+		double Normal[3];
+		TriangleNormal(s.Position(Corners[0]), s.Position(Corners[1]), s.Position(Corners[2]), Normal);
+		double Length = sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+		if (Length > 0.0) {
+			Normal[0] /= Length;
+			Normal[1] /= Length;
+			Normal[2] /= Length;
+			const float* p = s.Position(Corners[0]);
+			double d = -(Normal[0] * p[0] + Normal[1] * p[1] + Normal[2] * p[2]);
+			for (int k = 0; k < 3; k++) {
+				AddPlane(s.Quadrics[Corners[k]], Normal, d, Length * 0.5);
+			}
+		}
+		for (int k = 0; k < 3; k++) {
+			s.VertexTriangles[Corners[k]].push_back((uint32_t)t);
+		}
+	}
+
+	// Directed edges, sorted: an edge is on a border when the way back isn't there
+	std::vector<uint64_t> Edges(NumTriangles * 3);
+	for (size_t t = 0; t < NumTriangles; t++) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = s.Indices[t * 3 + k], b = s.Indices[t * 3 + (k + 1) % 3];
+			Edges[t * 3 + k] = (a << 32) | b;
+		}
+	}
+	std::sort(Edges.begin(), Edges.end());
+	for (size_t t = 0; t < NumTriangles; t++) {
+		const unsigned int* Corners = &s.Indices[t * 3];
+		for (int k = 0; k < 3; k++) {
+			uint32_t a = Corners[k], b = Corners[(k + 1) % 3];
+			uint64_t Back = ((uint64_t)b << 32) | a;
+			bool Border = !std::binary_search(Edges.begin(), Edges.end(), Back);
+			if (Border) {
+				// A plane through the edge, at a right angle to the triangle
+				double FaceNormal[3];
+				TriangleNormal(s.Position(Corners[0]), s.Position(Corners[1]), s.Position(Corners[2]), FaceNormal);
+				const float* pa = s.Position(a);
+				const float* pb = s.Position(b);
+				double Edge[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+				double Normal[3];
+				Cross(Edge, FaceNormal, Normal);
+				double Length = sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+				if (Length > 0.0) {
+					Normal[0] /= Length;
+					Normal[1] /= Length;
+					Normal[2] /= Length;
+					double d = -(Normal[0] * pa[0] + Normal[1] * pa[1] + Normal[2] * pa[2]);
+					double Weight = BorderWeight * (Edge[0] * Edge[0] + Edge[1] * Edge[1] + Edge[2] * Edge[2]);
+					AddPlane(s.Quadrics[a], Normal, d, Weight);
+					AddPlane(s.Quadrics[b], Normal, d, Weight);
+				}
+			}
+			// Each edge once: from its smaller end, or from the only triangle that has it
+			if (a < b || Border) {
+				PushEdge(s, a, b);
+			}
+		}
+	}
+
+	size_t LiveTriangles = NumTriangles;
+	double MaxError = 0.0;
+	std::vector<uint32_t> Neighbors;
+	while (LiveTriangles * 3 > targetIndexCount && !s.Heap.empty()) {
+		Collapse Next = s.Heap.top();
+		s.Heap.pop();
+		uint32_t From = Next.From, To = Next.To;
+		if (s.Removed[From] || s.Removed[To] || s.Stamps[From] != Next.FromStamp || s.Stamps[To] != Next.ToStamp) {
+			continue;
+		}
+		if (CollapseFlips(s, From, To)) {
+			continue;
+		}
+
+		if (Next.Cost > MaxError) {
+			MaxError = Next.Cost;
+		}
+		AddQuadric(s.Quadrics[To], s.Quadrics[From]);
+		s.Removed[From] = true;
+		s.Stamps[To]++;
+
+		std::vector<uint32_t>& FromTriangles = s.VertexTriangles[From];
+		std::vector<uint32_t>& ToTriangles = s.VertexTriangles[To];
+		for (size_t i = 0; i < FromTriangles.size(); i++) {
+			uint32_t t = FromTriangles[i];
+			if (!s.TriangleLive[t]) {
+				continue;
+			}
+			unsigned int* Corners = &s.Indices[t * 3];
+			if (Corners[0] == To || Corners[1] == To || Corners[2] == To) {
+				s.TriangleLive[t] = false;
+				LiveTriangles--;
+				continue;
+			}
+			for (int k = 0; k < 3; k++) {
+				if (Corners[k] == From) {
+					Corners[k] = To;
+				}
+			}
+			ToTriangles.push_back(t);
+		}
+		std::vector<uint32_t>().swap(FromTriangles);
+
+		// Drop the dead triangles, and queue the edges around To again with its new quadric
+		size_t Kept = 0;
+		Neighbors.clear();
+		for (size_t i = 0; i < ToTriangles.size(); i++) {
+			uint32_t t = ToTriangles[i];
+			if (!s.TriangleLive[t]) {
+				continue;
+			}
+			ToTriangles[Kept++] = t;
+			for (int k = 0; k < 3; k++) {
+				uint32_t v = s.Indices[t * 3 + k];
+				if (v != To) {
+					Neighbors.push_back(v);
+				}
+			}
+		}
+		ToTriangles.resize(Kept);
+		std::sort(Neighbors.begin(), Neighbors.end());
+		Neighbors.erase(std::unique(Neighbors.begin(), Neighbors.end()), Neighbors.end());
+		for (size_t i = 0; i < Neighbors.size(); i++) {
+			PushEdge(s, To, Neighbors[i]);
+		}
+	}
+
+	result.clear();
+	result.reserve(LiveTriangles * 3);
+	for (size_t t = 0; t < NumTriangles; t++) {
+		if (s.TriangleLive[t]) {
+			result.insert(result.end(), &s.Indices[t * 3], &s.Indices[t * 3] + 3);
+		}
+	}
+	return (float)sqrt(MaxError);
+}
+
+int BuildLodChain(const Mesh& mesh, int maxLods, std::vector<unsigned int>& indices, MeshFileLod lods[MESH_FILE_MAX_LODS])
+{
+	if (maxLods > MESH_FILE_MAX_LODS) {
+		maxLods = MESH_FILE_MAX_LODS;
+	}
+	indices = mesh.Indices;
+	lods[0].FirstIndex = 0;
+	lods[0].IndexCount = (uint32_t)mesh.Indices.size();
+	lods[0].Error = 0.0f;
+
+	int LodCount = 1;
+	std::vector<unsigned int> Previous = mesh.Indices;
+	std::vector<unsigned int> Simplified;
+	while (LodCount < maxLods) {
+		size_t Target = Previous.size() / 6 * 3;
+		if (Target / 3 < MESH_LOD_MIN_TRIANGLES) {
+			break;
+		}
+		float Error = SimplifyMesh(mesh.Vertices, Previous, Target, Simplified);
+		if (Simplified.size() > Previous.size() / 4 * 3) {
+			break;
+		}
+		OptimizeVertexCache(Simplified, mesh.Vertices.size());
+
+		MeshFileLod& Lod = lods[LodCount];
+		Lod.FirstIndex = (uint32_t)indices.size();
+		Lod.IndexCount = (uint32_t)Simplified.size();
+		Lod.Error = lods[LodCount - 1].Error + Error;
+		indices.insert(indices.end(), Simplified.begin(), Simplified.end());
+		Previous.swap(Simplified);
+		LodCount++;
+	}
+	return LodCount;
+}
+
+float LodPixelsPerUnit(float fovY, int viewportHeight)
+{
+	return (float)viewportHeight / (2.0f * tanf(fovY * 0.5f));
+}
+
+float ProjectedLodError(const MeshFileLod& lod, float objectScale, float distance, float pixelsPerUnit)
+{
+	if (distance <= 0.0f) {
+		return lod.Error > 0.0f ? INFINITY : 0.0f;
+	}
+	return lod.Error * objectScale * pixelsPerUnit / distance;
+}
+
+int SelectLod(const MeshFileLod* lods, int lodCount, float objectScale, float distance, float pixelsPerUnit, float maxPixelError)
+{
+	for (int i = lodCount - 1; i > 0; i--) {
+		if (ProjectedLodError(lods[i], objectScale, distance, pixelsPerUnit) <= maxPixelError) {
+			return i;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef MESHLOD_HPP
+#define MESHLOD_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+
+// Levels of detail that all share the vertex buffer of the full mesh: only the index list changes.
+//
+// They're made offline by edge collapse with quadric error metrics (Garland & Heckbert, "Surface
+// Simplification Using Quadric Error Metrics"). Every vertex keeps the sum of the planes of the triangles
+// around it, and collapsing an edge moves one end onto the other (never to a new position, so no vertex
+// has to be added) at the cost of the squared distance to those planes. The cheapest collapse goes first.
+//  - Open borders get extra planes standing on the border edge, so they don't shrink away.
+//  - Vertices split on a color seam (same position, another vertex) never move, or the seam would crack.
+//  - A collapse that would flip a triangle is skipped.
+//
+// At runtime an object draws the coarsest LOD whose error, projected on the screen, stays under a number of pixels.
+
+// Triangles below which there's no point in one more LOD
+#define MESH_LOD_MIN_TRIANGLES 64
+
+// Simplifies indices (a triangle list over vertices) down to targetIndexCount indices or as close as it
+// gets without flips. The result only uses vertices of the input. Returns the error: the RMS distance,
+// in object space, between the vertices that moved and the planes of the triangles they came from.
+float SimplifyMesh(const std::vector<MeshVertex>& vertices, const std::vector<unsigned int>& indices, size_t targetIndexCount, std::vector<unsigned int>& result);
+
+// Up to maxLods LODs, each simplified from the one before to about half its triangles. The error of a LOD
+// is its own plus the one it came from, so it stays an upper bound against LOD 0.
+// Stops early below MESH_LOD_MIN_TRIANGLES or when the simplification can't get down to 3/4 of the last LOD.
+// indices gets every LOD one after the other (LOD 0 is mesh.Indices as it is), each one optimized for the
+// vertex cache. Returns the LOD count.
+int BuildLodChain(const Mesh& mesh, int maxLods, std::vector<unsigned int>& indices, MeshFileLod lods[MESH_FILE_MAX_LODS]);
+
+// Pixels on the screen per object space unit at distance 1, for a vertical field of view (in radians)
+// and a viewport height (in pixels). Divide by the distance to get it at that distance.
+float LodPixelsPerUnit(float fovY, int viewportHeight);
+
+// Error of lod in pixels, for an object scaled by objectScale at distance from the camera
+float ProjectedLodError(const MeshFileLod& lod, float objectScale, float distance, float pixelsPerUnit);
+
+// The coarsest LOD whose projected error is at most maxPixelError pixels, 0 when none is
+int SelectLod(const MeshFileLod* lods, int lodCount, float objectScale, float distance, float pixelsPerUnit, float maxPixelError);
+
+#endif
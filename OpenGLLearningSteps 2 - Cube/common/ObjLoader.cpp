@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include "ObjLoader.hpp"
+
+// OBJ indices start at 1, and negative ones count back from the last element read so far
+static bool ResolveIndex(int index, size_t count, size_t& resolved)
+{
+	if (index > 0 && (size_t)index <= count) {
+		resolved = (size_t)index - 1;
+		return true;
+	}
+	if (index < 0 && (size_t)(-index) <= count) {
+		resolved = count + index;
+		return true;
+	}
+	return false;
+}
+
+bool LoadObj(const char* path, Mesh& mesh)
+{
+	std::ifstream ObjStream(path, std::ios::in);
+	if (!ObjStream.is_open()) {
+		printf("Impossible to open %s\n", path);
+		return false;
+	}
+
+	std::vector<float> Positions;
+	std::vector<float> VertexColors;	// Only if every "v" line had one
+	std::vector<float> Normals;
+	bool HasVertexColors = true;
+
+	// Position and normal of each triangle corner, -1 for a corner without normal
+	std::vector<size_t> TriangleCorners;
+	std::vector<long long> TriangleNormals;
+
+	float BoundsMin[3] = { HUGE_VALF, HUGE_VALF, HUGE_VALF };
+	float BoundsMax[3] = { -HUGE_VALF, -HUGE_VALF, -HUGE_VALF };
+
+	std::string Line;
+	int LineNumber = 0;
+	while (std::getline(ObjStream, Line)) {
+		LineNumber++;
+		std::istringstream LineStream(Line);
+		std::string Type;
+		LineStream >> Type;
+
+		if (Type == "v") {
+			float x = 0.0f, y = 0.0f, z = 0.0f, r, g, b;
+			LineStream >> x >> y >> z;
+			Positions.push_back(x);
+			Positions.push_back(y);
+			Positions.push_back(z);
+			if (LineStream >> r >> g >> b) {
+				VertexColors.push_back(r);
+				VertexColors.push_back(g);
+				VertexColors.push_back(b);
+			}
+			else {
+				HasVertexColors = false;
+			}
+			float Position[3] = { x, y, z };
+			for (int Axis = 0; Axis < 3; Axis++) {
+				BoundsMin[Axis] = Position[Axis] < BoundsMin[Axis] ? Position[Axis] : BoundsMin[Axis];
+				BoundsMax[Axis] = Position[Axis] > BoundsMax[Axis] ? Position[Axis] : BoundsMax[Axis];
+			}
+		}
+		else if (Type == "vn") {
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			LineStream >> x >> y >> z;
+			Normals.push_back(x);
+			Normals.push_back(y);
+			Normals.push_back(z);
+		}
+		else if (Type == "f") {
+			// Every corner is "v", "v/vt", "v//vn" or "v/vt/vn"
+			std::vector<size_t> CornerPositions;
+			std::vector<long long> CornerNormals;
+			std::string Corner;
+			while (LineStream >> Corner) {
+				size_t PositionIndex;
+				if (!ResolveIndex(atoi(Corner.c_str()), Positions.size() / 3, PositionIndex)) {
+					printf("%s:%d: invalid vertex index %s\n", path, LineNumber, Corner.c_str());
+					return false;
+				}
+				long long NormalIndex = -1;
+				size_t LastSlash = Corner.rfind('/');
+				size_t FirstSlash = Corner.find('/');
+				if (LastSlash != std::string::npos && LastSlash != FirstSlash) {
+					size_t Resolved;
+					if (ResolveIndex(atoi(Corner.c_str() + LastSlash + 1), Normals.size() / 3, Resolved))
+						NormalIndex = (long long)Resolved;
+				}
+				CornerPositions.push_back(PositionIndex);
+				CornerNormals.push_back(NormalIndex);
+			}
+
+			for (size_t i = 1; i + 1 < CornerPositions.size(); i++) {
+				size_t Fan[3] = { 0, i, i + 1 };
+				for (int k = 0; k < 3; k++) {
+					TriangleCorners.push_back(CornerPositions[Fan[k]]);
+					TriangleNormals.push_back(CornerNormals[Fan[k]]);
+				}
+			}
+		}
+		// Everything else (texture coordinates, groups, materials, comments...) is ignored
+	}
+
+	if (TriangleCorners.empty()) {
+		printf("%s has no faces\n", path);
+		return false;
+	}
+
+	// Non-indexed triangle list, BuildIndexedMesh() welds it afterwards.
+	// Colors are only picked now, since vertex colors are only used if every vertex had one.
+	size_t CornerCount = TriangleCorners.size();
+	std::vector<float> TrianglePositions(CornerCount * 3);
+	std::vector<float> TriangleColors(CornerCount * 3);
+	for (size_t i = 0; i < CornerCount; i++) {
+		const float* Position = &Positions[TriangleCorners[i] * 3];
+		float* Color = &TriangleColors[i * 3];
+		for (int Axis = 0; Axis < 3; Axis++)
+			TrianglePositions[i * 3 + Axis] = Position[Axis];
+
+		if (HasVertexColors) {
+			for (int Axis = 0; Axis < 3; Axis++)
+				Color[Axis] = VertexColors[TriangleCorners[i] * 3 + Axis];
+		}
+		else if (TriangleNormals[i] >= 0) {
+			const float* Normal = &Normals[TriangleNormals[i] * 3];
+			for (int Axis = 0; Axis < 3; Axis++)
+				Color[Axis] = 0.5f + 0.5f * Normal[Axis];
+		}
+		else {
+			for (int Axis = 0; Axis < 3; Axis++) {
+				float Size = BoundsMax[Axis] - BoundsMin[Axis];
+				Color[Axis] = Size > 0.0f ? (Position[Axis] - BoundsMin[Axis]) / Size : 0.5f;
+			}
+		}
+	}
+
+	mesh = BuildIndexedMesh(&TrianglePositions[0], &TriangleColors[0], CornerCount, false);
+	return true;
+}
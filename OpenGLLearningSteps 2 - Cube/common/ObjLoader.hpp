@@ -0,0 +1,13 @@
+#ifndef OBJLOADER_HPP
+#define OBJLOADER_HPP
+
+#include "Mesh.hpp"
+
+// The straightforward way to read a Wavefront OBJ: std::ifstream, one line at a time through
+// a std::istringstream. Only "v" (with the optional "r g b" colors some exporters add), "vn"
+// and "f" lines are used; faces with more than 3 corners are split into a fan.
+// Without vertex colors, each corner gets its normal (or its position in the bounds) as a color,
+// so the shapes still show up with the color shaders.
+bool LoadObj(const char* path, Mesh& mesh);
+
+#endif
@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "Options.hpp"
+#include "MeshFile.hpp"
+
+// Frames rendered when running without a window and no --frames was given, since there's no ESC key to stop
+static const int DefaultHeadlessFrames = 300;
+static const int DefaultBenchmarkFrames = 1000;
+static const int DefaultWarmupFrames = 10;
+static const int DefaultLods = 6;
+static const float DefaultLodError = 1.0f;
+
+static void PrintUsage(const char* program)
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --headless      render offscreen (EGL), without opening a window\n");
+	printf("  --benchmark     render a fixed number of frames headless and print frame times as JSON\n");
+	printf("  --frames N      number of frames to render (default: until closed, %d headless, %d benchmark)\n", DefaultHeadlessFrames, DefaultBenchmarkFrames);
+	printf("  --warmup N      frames left out of the benchmark stats (default: %d)\n", DefaultWarmupFrames);
+	printf("  --json FILE     write the benchmark results to FILE instead of stdout\n");
+	printf("  --profile-csv FILE    profile CPU and GPU time of each render pass, write the last frames as CSV\n");
+	printf("  --profile-trace FILE  same as --profile-csv, written as a Chrome trace JSON\n");
+	printf("  --instances N   draw a grid of N cubes with a single instanced draw call\n");
+	printf("  --animate       spin the instanced cubes (matrices recomputed and uploaded every frame)\n");
+	printf("  --bench-transforms N  compare the SIMD transform kernels with per-object glm on N objects, then exit\n");
+	printf("  --threads N     threads for the CPU side of the frame (default: one per hardware thread)\n");
+	printf("  --bench-jobs N  time the CPU side of a frame of N direct draws on 1, 2, 4... up to --threads threads, then exit\n");
+	printf("  --bench-bvh N   compare BVH frustum culling with testing every object, on a scene of N objects, then exit\n");
+	printf("  --hot-reload    reload the shaders when they're saved, keeping the old program if they don't compile\n");
+	printf("  --mesh FILE     draw a .mesh file instead of the cube\n");
+	printf("  --convert-obj OBJ MESH  convert a Wavefront OBJ to a .mesh file, then exit\n");
+	printf("  --bench-mesh-load FILE  time loading FILE (.obj with the text parser, else .mesh), print it as JSON, then exit\n");
+	printf("  --bench-hot-paths N  time LoadShaders() (read, compile, link), buffer uploads and MVP composition N times each,\n");
+	printf("                  print the stats as JSON, then exit (tools/BenchmarkSuite.py compares them with a baseline)\n");
+	printf("  --quantize FORMAT  float, half or snorm16 positions (and RGBA8 colors) for the cube and --convert-obj\n");
+	printf("  --draw MODE     how --instances are drawn: instanced (default), direct (a draw call each, BVH culling on the CPU)\n");
+	printf("                  or indirect (compute shader culling, frustum and Hi-Z occlusion, one multi draw indirect call)\n");
+	printf("  --capture PATH  record every frame: PNGs in the PATH directory (it must exist), or one raw RGBA file\n");
+	printf("  --capture-format FORMAT  png (default) or raw\n");
+	printf("  --capture-sync  read the frames back with a plain glReadPixels() instead of the PBO ring, to compare\n");
+	printf("  --mixed-scene   with --draw direct: cubes and octahedra, half of them drawn flat by a second program\n");
+	printf("  --no-sort       draw in the order the draws were recorded instead of sorting them by state\n");
+	printf("  --lods N        LODs --convert-obj makes by simplifying the mesh, the full one included (default: %d, 1 for none)\n", DefaultLods);
+	printf("  --lod-error PIXELS  draw the coarsest LOD whose error on screen is at most PIXELS (default: %g)\n", DefaultLodError);
+	printf("  --no-lod        always draw the full mesh\n");
+	printf("  --no-occlusion  with --draw indirect: only frustum culling, no depth pre-pass and Hi-Z occlusion test\n");
+	printf("  --fov DEGREES   vertical field of view (default: 45)\n");
+	printf("  --trace FILE    record the GL calls and the data they upload into FILE\n");
+	printf("  --replay FILE   replay a trace made with --trace headless, as fast as it goes, print the frame times as JSON, then exit\n");
+}
+
+static bool ParseDrawMode(const char* name, DrawMode& mode)
+{
+	if (strcmp(name, "instanced") == 0) {
+		mode = DrawInstanced;
+	}
+	else if (strcmp(name, "direct") == 0) {
+		mode = DrawDirect;
+	}
+	else if (strcmp(name, "indirect") == 0) {
+		mode = DrawIndirect;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+bool ParseOptions(int argc, char** argv, AppOptions& options)
+{
+	options.Headless = false;
+	options.Benchmark = false;
+	options.Frames = 0;
+	options.WarmupFrames = DefaultWarmupFrames;
+	options.JsonPath = NULL;
+	options.ProfileCsvPath = NULL;
+	options.ProfileTracePath = NULL;
+	options.Instances = 0;
+	options.Animate = false;
+	options.BenchTransforms = 0;
+	options.BenchBvh = 0;
+	options.Threads = 0;
+	options.BenchJobs = 0;
+	options.HotReload = false;
+	options.MeshPath = NULL;
+	options.ConvertObjPath = NULL;
+	options.ConvertOutputPath = NULL;
+	options.BenchMeshLoad = NULL;
+	options.BenchHotPaths = 0;
+	options.Quantize = PositionFloat;
+	options.Draw = DrawInstanced;
+	options.MixedScene = false;
+	options.NoSort = false;
+	options.Lods = DefaultLods;
+	options.LodError = DefaultLodError;
+	options.NoLod = false;
+	options.NoOcclusion = false;
+	options.FieldOfView = 45.0f;
+	options.TracePath = NULL;
+	options.ReplayPath = NULL;
+	options.CapturePath = NULL;
+	options.CaptureFileFormat = CapturePNG;
+	options.CaptureSync = false;
+
+	for (int i = 1; i < argc; i++) {
+		bool HasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--headless") == 0) {
+			options.Headless = true;
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0) {
+			options.Benchmark = true;
+			options.Headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && HasValue) {
+			options.Frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && HasValue) {
+			options.WarmupFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--json") == 0 && HasValue) {
+			options.JsonPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--profile-csv") == 0 && HasValue) {
+			options.ProfileCsvPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--profile-trace") == 0 && HasValue) {
+			options.ProfileTracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--instances") == 0 && HasValue) {
+			options.Instances = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--animate") == 0) {
+			options.Animate = true;
+		}
+		else if (strcmp(argv[i], "--bench-transforms") == 0 && HasValue) {
+			options.BenchTransforms = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && HasValue) {
+			options.Threads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-jobs") == 0 && HasValue) {
+			options.BenchJobs = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-bvh") == 0 && HasValue) {
+			options.BenchBvh = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--hot-reload") == 0) {
+			options.HotReload = true;
+		}
+		else if (strcmp(argv[i], "--mesh") == 0 && HasValue) {
+			options.MeshPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--convert-obj") == 0 && i + 2 < argc) {
+			options.ConvertObjPath = argv[++i];
+			options.ConvertOutputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--bench-mesh-load") == 0 && HasValue) {
+			options.BenchMeshLoad = argv[++i];
+			options.Headless = true;
+		}
+		else if (strcmp(argv[i], "--bench-hot-paths") == 0 && HasValue) {
+			options.BenchHotPaths = atoi(argv[++i]);
+			options.Headless = true;
+		}
+		else if (strcmp(argv[i], "--quantize") == 0 && HasValue && ParsePositionEncoding(argv[i + 1], options.Quantize)) {
+			i++;
+		}
+		else if (strcmp(argv[i], "--draw") == 0 && HasValue && ParseDrawMode(argv[i + 1], options.Draw)) {
+			i++;
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && HasValue) {
+			options.CapturePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-format") == 0 && HasValue && ParseCaptureFormat(argv[i + 1], options.CaptureFileFormat)) {
+			i++;
+		}
+		else if (strcmp(argv[i], "--capture-sync") == 0) {
+			options.CaptureSync = true;
+		}
+		else if (strcmp(argv[i], "--mixed-scene") == 0) {
+			options.MixedScene = true;
+		}
+		else if (strcmp(argv[i], "--no-sort") == 0) {
+			options.NoSort = true;
+		}
+		else if (strcmp(argv[i], "--lods") == 0 && HasValue) {
+			options.Lods = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--lod-error") == 0 && HasValue) {
+			options.LodError = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-lod") == 0) {
+			options.NoLod = true;
+		}
+		else if (strcmp(argv[i], "--no-occlusion") == 0) {
+			options.NoOcclusion = true;
+		}
+		else if (strcmp(argv[i], "--fov") == 0 && HasValue) {
+			options.FieldOfView = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && HasValue) {
+			options.TracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && HasValue) {
+			options.ReplayPath = argv[++i];
+			options.Headless = true;
+		}
+		else {
+			fprintf(stderr, "Unknown or incomplete option: %s\n", argv[i]);
+			PrintUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (options.Frames < 0 || options.WarmupFrames < 0 || options.Instances < 0 || options.Threads < 0 || options.BenchHotPaths < 0) {
+		fprintf(stderr, "--frames, --warmup, --instances, --threads and --bench-hot-paths can't be negative\n");
+		return false;
+	}
+
+	if (options.Draw != DrawInstanced && options.Instances == 0) {
+		fprintf(stderr, "--draw direct and --draw indirect need --instances\n");
+		return false;
+	}
+
+	// The octahedra are plain float vertices, they can't share the dequantization of a packed or loaded mesh
+	if (options.MixedScene && (options.Draw != DrawDirect || options.MeshPath != NULL || options.Quantize != PositionFloat)) {
+		fprintf(stderr, "--mixed-scene needs --draw direct, and can't be used with --mesh or --quantize\n");
+		return false;
+	}
+
+	if (options.Lods < 1 || options.Lods > MESH_FILE_MAX_LODS) {
+		fprintf(stderr, "--lods must be between 1 and %d\n", MESH_FILE_MAX_LODS);
+		return false;
+	}
+
+	if (options.LodError < 0.0f) {
+		fprintf(stderr, "--lod-error can't be negative\n");
+		return false;
+	}
+
+	if (options.FieldOfView <= 0.0f || options.FieldOfView >= 180.0f) {
+		fprintf(stderr, "--fov must be between 0 and 180 degrees\n");
+		return false;
+	}
+
+	if (options.Frames == 0 && options.Headless) {
+		options.Frames = options.Benchmark ? DefaultBenchmarkFrames : DefaultHeadlessFrames;
+	}
+
+	return true;
+}
@@ -0,0 +1,56 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "VertexQuantize.hpp"
+#include "FrameCapture.hpp"
+
+// How the --instances objects are drawn
+enum DrawMode
+{
+	DrawInstanced,	// One instanced draw call for all of them
+	DrawDirect,		// One draw call per object, culled on the CPU, each with its own uniform block
+	DrawIndirect	// Culled by a compute shader, drawn with one multi draw indirect call
+};
+
+// Command line options shared by the render loop and the benchmark runner
+struct AppOptions
+{
+	bool Headless;			// --headless: render offscreen with EGL, no window needed
+	bool Benchmark;			// --benchmark: time every frame and print the stats as JSON (implies --headless)
+	int Frames;				// --frames N: frames to render, 0 renders until the window is closed
+	int WarmupFrames;		// --warmup N: first frames left out of the stats
+	const char* JsonPath;	// --json FILE: where the benchmark results go, stdout if not given
+	const char* ProfileCsvPath;		// --profile-csv FILE: profile every frame and write the scopes as CSV
+	const char* ProfileTracePath;	// --profile-trace FILE: same, as a Chrome trace (chrome://tracing)
+	int Instances;			// --instances N: draw N cubes with one instanced draw call, 0 draws the single cube
+	bool Animate;			// --animate: spin the instanced cubes, recomputing and uploading their matrices every frame
+	int BenchTransforms;	// --bench-transforms N: time the transform kernels on N objects and exit, no GL needed
+	int Threads;			// --threads N: threads of the job system, main one included. 0 (default): one per hardware thread
+	int BenchJobs;			// --bench-jobs N: time the CPU side of a frame of N direct draws with 1 to --threads threads and exit
+	int BenchBvh;			// --bench-bvh N: time building, culling and refitting a BVH of N objects and exit, no GL needed
+	bool HotReload;			// --hot-reload: rebuild the program when a file in shaders/ is saved
+	const char* MeshPath;			// --mesh FILE: draw a .mesh file instead of the cube
+	const char* ConvertObjPath;		// --convert-obj OBJ MESH: convert a Wavefront OBJ to a .mesh file and exit
+	const char* ConvertOutputPath;
+	const char* BenchMeshLoad;		// --bench-mesh-load FILE: time loading a .obj or a .mesh and report the peak memory (implies --headless)
+	int BenchHotPaths;				// --bench-hot-paths N: time shader loading, buffer uploads and MVP composition N times each and exit (implies --headless)
+	PositionEncoding Quantize;		// --quantize float|half|snorm16: vertex format of the cube and of --convert-obj
+	DrawMode Draw;			// --draw instanced|direct|indirect
+	const char* CapturePath;		// --capture PATH: record every frame, PNGs in the PATH directory or one raw file
+	CaptureFormat CaptureFileFormat;	// --capture-format png|raw
+	bool CaptureSync;				// --capture-sync: read the frames back with a plain glReadPixels(), to compare
+	bool MixedScene;		// --mixed-scene: direct draws of cubes and octahedra with two programs, for the render queue to sort
+	bool NoSort;			// --no-sort: submit the render queue in the order the draws were recorded, to compare
+	int Lods;				// --lods N: LODs --convert-obj makes, the full mesh included. 1 makes none.
+	float LodError;			// --lod-error PIXELS: an object draws the coarsest LOD that is off by at most this much on screen
+	bool NoLod;				// --no-lod: always draw LOD 0, to compare
+	bool NoOcclusion;		// --no-occlusion: indirect draws only cull against the frustum, no depth pre-pass nor Hi-Z, to compare
+	float FieldOfView;		// --fov DEGREES: vertical field of view, a narrow one leaves more objects out of the frustum
+	const char* TracePath;		// --trace FILE: record the GL calls of every frame into a trace
+	const char* ReplayPath;		// --replay FILE: replay a trace as fast as possible, print the frame times as JSON and exit (implies --headless)
+};
+
+// Fills options from argv. Prints the usage and returns false on a bad or unknown argument.
+bool ParseOptions(int argc, char** argv, AppOptions& options);
+
+#endif
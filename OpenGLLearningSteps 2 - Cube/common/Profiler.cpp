@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "Profiler.hpp"
+
+// Where the GPU result of a scope has to go once its query is available
+struct PendingQuery
+{
+	GLuint Query;
+	bool Issued;
+	int FrameSlot;		// Slot in the history ring buffer
+	int Sample;
+	unsigned long long FrameIndex;	// To notice the history slot was reused in the meantime
+};
+
+static ProfileFrame Frames[PROFILER_HISTORY_FRAMES];
+static PendingQuery Queries[PROFILER_QUERY_LATENCY][PROFILER_MAX_SCOPES];
+
+static bool Initialized = false;
+static unsigned long long FrameIndex = 0;	// Frame being recorded
+static int CurrentDepth = 0;
+static bool GpuQueryActive = false;
+static std::chrono::steady_clock::time_point StartTime;
+
+static double NowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+}
+
+static ProfileFrame& CurrentFrame()
+{
+	return Frames[FrameIndex % PROFILER_HISTORY_FRAMES];
+}
+
+// Copies the results of every available query of a latency slot back into the history
+static void CollectQueries(int latencySlot, bool discard)
+{
+	for (int i = 0; i < PROFILER_MAX_SCOPES; i++) {
+		PendingQuery& Pending = Queries[latencySlot][i];
+		if (!Pending.Issued) {
+			continue;
+		}
+		Pending.Issued = false;
+
+		ProfileFrame& Frame = Frames[Pending.FrameSlot];
+		if (Frame.Index != Pending.FrameIndex) {
+			continue;
+		}
+
+		// After PROFILER_QUERY_LATENCY frames the result is basically always there. If it isn't we
+		// drop it rather than waiting, a stall here would distort exactly what we are measuring.
+		GLint Available = GL_FALSE;
+		glGetQueryObjectiv(Pending.Query, GL_QUERY_RESULT_AVAILABLE, &Available);
+		if (Available && !discard) {
+			GLuint64 Nanoseconds = 0;
+			glGetQueryObjectui64v(Pending.Query, GL_QUERY_RESULT, &Nanoseconds);
+			Frame.Samples[Pending.Sample].GpuMs = Nanoseconds / 1000000.0;
+		}
+	}
+}
+
+void ProfilerInit()
+{
+	memset(Frames, 0, sizeof(Frames));
+	memset(Queries, 0, sizeof(Queries));
+
+	for (int i = 0; i < PROFILER_QUERY_LATENCY; i++) {
+		GLuint Ids[PROFILER_MAX_SCOPES];
+		glGenQueries(PROFILER_MAX_SCOPES, Ids);
+		for (int j = 0; j < PROFILER_MAX_SCOPES; j++) {
+			Queries[i][j].Query = Ids[j];
+		}
+	}
+
+	FrameIndex = 0;
+	CurrentDepth = 0;
+	GpuQueryActive = false;
+	StartTime = std::chrono::steady_clock::now();
+	Initialized = true;
+}
+
+void ProfilerShutdown()
+{
+	if (!Initialized) {
+		return;
+	}
+
+	// Whatever is still in flight gets collected, this only happens once so waiting is fine
+	glFinish();
+	for (int i = 0; i < PROFILER_QUERY_LATENCY; i++) {
+		CollectQueries(i, false);
+		for (int j = 0; j < PROFILER_MAX_SCOPES; j++) {
+			glDeleteQueries(1, &Queries[i][j].Query);
+		}
+	}
+	Initialized = false;
+}
+
+void ProfilerBeginFrame()
+{
+	if (!Initialized) {
+		return;
+	}
+
+	// The queries of this latency slot were issued PROFILER_QUERY_LATENCY frames ago
+	CollectQueries((int)(FrameIndex % PROFILER_QUERY_LATENCY), false);
+
+	ProfileFrame& Frame = CurrentFrame();
+	Frame.Index = FrameIndex;
+	Frame.CpuStartMs = NowMs();
+	Frame.CpuMs = 0.0;
+	Frame.NumSamples = 0;
+	CurrentDepth = 0;
+}
+
+void ProfilerEndFrame()
+{
+	if (!Initialized) {
+		return;
+	}
+
+	ProfileFrame& Frame = CurrentFrame();
+	Frame.CpuMs = NowMs() - Frame.CpuStartMs;
+	FrameIndex++;
+}
+
+int ProfilerBeginScope(const char* name)
+{
+	if (!Initialized) {
+		return -1;
+	}
+
+	ProfileFrame& Frame = CurrentFrame();
+	if (Frame.NumSamples >= PROFILER_MAX_SCOPES) {
+		return -1;
+	}
+
+	int Scope = Frame.NumSamples++;
+	ProfileSample& Sample = Frame.Samples[Scope];
+	Sample.Name = name;
+	Sample.Depth = CurrentDepth++;
+	Sample.CpuMs = 0.0;
+	Sample.GpuMs = -1.0;
+
+	if (!GpuQueryActive) {
+		PendingQuery& Pending = Queries[FrameIndex % PROFILER_QUERY_LATENCY][Scope];
+		Pending.Issued = true;
+		Pending.FrameSlot = (int)(FrameIndex % PROFILER_HISTORY_FRAMES);
+		Pending.Sample = Scope;
+		Pending.FrameIndex = FrameIndex;
+		glBeginQuery(GL_TIME_ELAPSED, Pending.Query);
+		GpuQueryActive = true;
+	}
+
+	// Start the CPU clock last, so the query setup isn't counted
+	Sample.CpuStartMs = NowMs();
+	return Scope;
+}
+
+void ProfilerEndScope(int scope)
+{
+	if (!Initialized || scope < 0) {
+		return;
+	}
+
+	ProfileSample& Sample = CurrentFrame().Samples[scope];
+	Sample.CpuMs = NowMs() - Sample.CpuStartMs;
+	CurrentDepth--;
+
+	// Only the scope that started the query can end it
+	PendingQuery& Pending = Queries[FrameIndex % PROFILER_QUERY_LATENCY][scope];
+	if (Pending.Issued && Pending.FrameIndex == FrameIndex && GpuQueryActive) {
+		glEndQuery(GL_TIME_ELAPSED);
+		GpuQueryActive = false;
+	}
+}
+
+int ProfilerFrameCount()
+{
+	return FrameIndex < PROFILER_HISTORY_FRAMES ? (int)FrameIndex : PROFILER_HISTORY_FRAMES;
+}
+
+const ProfileFrame& ProfilerGetFrame(int i)
+{
+	unsigned long long Oldest = FrameIndex - ProfilerFrameCount();
+	return Frames[(Oldest + i) % PROFILER_HISTORY_FRAMES];
+}
+
+bool ProfilerWriteCsv(const char* path)
+{
+	FILE* Out = fopen(path, "w");
+	if (Out == NULL) {
+		fprintf(stderr, "Impossible to open %s to write the profile\n", path);
+		return false;
+	}
+
+	fprintf(Out, "frame,scope,depth,cpu_start_ms,cpu_ms,gpu_ms\n");
+	for (int i = 0; i < ProfilerFrameCount(); i++) {
+		const ProfileFrame& Frame = ProfilerGetFrame(i);
+		fprintf(Out, "%llu,frame,0,%.4f,%.4f,\n", Frame.Index, Frame.CpuStartMs, Frame.CpuMs);
+		for (int j = 0; j < Frame.NumSamples; j++) {
+			const ProfileSample& Sample = Frame.Samples[j];
+			fprintf(Out, "%llu,%s,%d,%.4f,%.4f,", Frame.Index, Sample.Name, Sample.Depth + 1, Sample.CpuStartMs, Sample.CpuMs);
+			if (Sample.GpuMs >= 0.0) {
+				fprintf(Out, "%.4f", Sample.GpuMs);
+			}
+			fprintf(Out, "\n");
+		}
+	}
+
+	fclose(Out);
+	return true;
+}
+
+bool ProfilerWriteChromeTrace(const char* path)
+{
+	FILE* Out = fopen(path, "w");
+	if (Out == NULL) {
+		fprintf(stderr, "Impossible to open %s to write the trace\n", path);
+		return false;
+	}
+
+	// Chrome trace timestamps are in microseconds. Track 1 is the CPU, track 2 the GPU.
+	fprintf(Out, "{\"traceEvents\":[\n");
+	fprintf(Out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(Out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for (int i = 0; i < ProfilerFrameCount(); i++) {
+		const ProfileFrame& Frame = ProfilerGetFrame(i);
+		fprintf(Out, ",\n{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			Frame.Index, Frame.CpuStartMs * 1000.0, Frame.CpuMs * 1000.0);
+		for (int j = 0; j < Frame.NumSamples; j++) {
+			const ProfileSample& Sample = Frame.Samples[j];
+			fprintf(Out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				Sample.Name, Sample.CpuStartMs * 1000.0, Sample.CpuMs * 1000.0);
+			if (Sample.GpuMs >= 0.0) {
+				fprintf(Out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+					Sample.Name, Sample.CpuStartMs * 1000.0, Sample.GpuMs * 1000.0);
+			}
+		}
+	}
+	fprintf(Out, "\n]}\n");
+
+	fclose(Out);
+	return true;
+}
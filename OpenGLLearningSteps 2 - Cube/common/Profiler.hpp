@@ -0,0 +1,70 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+// Frame profiler: every scope records its CPU time and, through a GL_TIME_ELAPSED query, its GPU time.
+// The queries are only read back PROFILER_QUERY_LATENCY frames later, when the GPU is long done with them,
+// so profiling never makes the CPU wait for the GPU. Everything lives in fixed-size arrays: nothing is
+// allocated while frames are being recorded.
+//
+// GL_TIME_ELAPSED queries can't be nested, so only the outermost scope gets a GPU time,
+// scopes opened inside another one just record the CPU side.
+
+#define PROFILER_MAX_SCOPES 32			// Scopes recorded per frame, the extra ones are ignored
+#define PROFILER_HISTORY_FRAMES 512		// Frames kept in the ring buffer (and exported)
+#define PROFILER_QUERY_LATENCY 4		// Frames to wait before reading the GPU queries
+
+struct ProfileSample
+{
+	const char* Name;	// Must outlive the profiler, string literals are perfect
+	int Depth;			// 0 for top-level scopes
+	double CpuStartMs;	// Since ProfilerInit()
+	double CpuMs;
+	double GpuMs;		// Negative when there's no GPU time (nested scope, or the result never arrived)
+};
+
+struct ProfileFrame
+{
+	unsigned long long Index;
+	double CpuStartMs;
+	double CpuMs;
+	int NumSamples;
+	ProfileSample Samples[PROFILER_MAX_SCOPES];
+};
+
+// Creates the query objects. Needs a current GL context.
+void ProfilerInit();
+void ProfilerShutdown();
+
+void ProfilerBeginFrame();
+void ProfilerEndFrame();
+
+// Returns the scope id to give to ProfilerEndScope(), or -1 if the frame ran out of scopes
+int ProfilerBeginScope(const char* name);
+void ProfilerEndScope(int scope);
+
+// Frames still in the ring buffer, oldest first. Frames whose queries are pending have GpuMs < 0.
+int ProfilerFrameCount();
+const ProfileFrame& ProfilerGetFrame(int i);
+
+// One line per scope and frame: frame,scope,depth,cpu_start_ms,cpu_ms,gpu_ms
+bool ProfilerWriteCsv(const char* path);
+// Chrome trace event format, open it in chrome://tracing or https://ui.perfetto.dev
+// GPU scopes go in their own track, placed at the CPU time the scope was opened.
+bool ProfilerWriteChromeTrace(const char* path);
+
+// Scope that closes itself at the end of the block
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name) : Scope(ProfilerBeginScope(name)) {}
+	~ProfileScope() { ProfilerEndScope(Scope); }
+
+private:
+	int Scope;
+};
+
+#define PROFILE_SCOPE_CONCAT_(a, b) a##b
+#define PROFILE_SCOPE_CONCAT(a, b) PROFILE_SCOPE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_CONCAT(ProfileScope_, __LINE__)(name)
+
+#endif
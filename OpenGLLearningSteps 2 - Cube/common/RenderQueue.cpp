@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "RenderQueue.hpp"
+#include "StateCache.hpp"
+#include "GlTrace.hpp"
+
+bool CreateFrameArena(FrameArena& arena, size_t size)
+{
+	arena.Memory = (unsigned char*)malloc(size);
+	arena.Size = arena.Memory != NULL ? size : 0;
+	arena.Used = 0;
+	arena.HighWater = 0;
+	if (arena.Memory == NULL) {
+		fprintf(stderr, "Can't allocate a frame arena of %zu bytes\n", size);
+		return false;
+	}
+	return true;
+}
+
+void DestroyFrameArena(FrameArena& arena)
+{
+	free(arena.Memory);
+	arena.Memory = NULL;
+	arena.Size = 0;
+	arena.Used = 0;
+}
+
+void ResetFrameArena(FrameArena& arena)
+{
+	arena.Used = 0;
+}
+
+void* ArenaAllocate(FrameArena& arena, size_t size, size_t alignment)
+{
+	size_t Start = (arena.Used + alignment - 1) & ~(alignment - 1);
+	if (Start + size > arena.Size) {
+		return NULL;
+	}
+	arena.Used = Start + size;
+	if (arena.Used > arena.HighWater) {
+		arena.HighWater = arena.Used;
+	}
+	return arena.Memory + Start;
+}
+
+uint64_t MakeSortKey(unsigned int layer, unsigned int program, unsigned int material, unsigned int vertexArray, uint32_t depth)
+{
+	uint64_t Key = layer & ((1u << SORT_KEY_LAYER_BITS) - 1);
+	Key = (Key << SORT_KEY_PROGRAM_BITS) | (program & ((1u << SORT_KEY_PROGRAM_BITS) - 1));
+	Key = (Key << SORT_KEY_MATERIAL_BITS) | (material & ((1u << SORT_KEY_MATERIAL_BITS) - 1));
+	Key = (Key << SORT_KEY_VERTEX_ARRAY_BITS) | (vertexArray & ((1u << SORT_KEY_VERTEX_ARRAY_BITS) - 1));
+	Key = (Key << SORT_KEY_DEPTH_BITS) | (depth & ((1u << SORT_KEY_DEPTH_BITS) - 1));
+	return Key;
+}
+
+uint32_t SortKeyDepth(float distance, float farPlane, bool backToFront)
+{
+	const uint32_t MaxDepth = (1u << SORT_KEY_DEPTH_BITS) - 1;
+	float Normalized = distance / farPlane;
+	Normalized = Normalized < 0.0f ? 0.0f : Normalized > 1.0f ? 1.0f : Normalized;
+	uint32_t Depth = (uint32_t)(Normalized * MaxDepth);
+	return backToFront ? MaxDepth - Depth : Depth;
+}
+
+void InitRenderQueue(RenderQueue& queue)
+{
+	memset(&queue, 0, sizeof(queue));
+}
+
+bool BeginRenderQueue(RenderQueue& queue, FrameArena& arena, int capacity)
+{
+	queue.Packets = (DrawPacket*)ArenaAllocate(arena, capacity * sizeof(DrawPacket), 16);
+	queue.Order = (SortEntry*)ArenaAllocate(arena, capacity * sizeof(SortEntry), 16);
+	queue.Scratch = (SortEntry*)ArenaAllocate(arena, capacity * sizeof(SortEntry), 16);
+	queue.Count = 0;
+	queue.Capacity = queue.Scratch != NULL ? capacity : 0;
+	return queue.Capacity == capacity;
+}
+
+DrawPacket* PushDrawPacket(RenderQueue& queue)
+{
+	if (queue.Count >= queue.Capacity) {
+		return NULL;
+	}
+	return &queue.Packets[queue.Count++];
+}
+
+SortEntry* RadixSortEntries(SortEntry* entries, SortEntry* scratch, size_t count)
+{
+	// Every histogram in one pass over the keys
+	size_t Counts[8][256];
+	memset(Counts, 0, sizeof(Counts));
+	for (size_t i = 0; i < count; i++) {
+		uint64_t Key = entries[i].Key;
+		for (int Pass = 0; Pass < 8; Pass++) {
+			Counts[Pass][(Key >> (Pass * 8)) & 0xFF]++;
+		}
+	}
+
+	SortEntry* From = entries;
+	SortEntry* To = scratch;
+	for (int Pass = 0; Pass < 8; Pass++) {
+		size_t* Count = Counts[Pass];
+		// A byte that is the same in every key doesn't move anything
+		if (count == 0 || Count[(From[0].Key >> (Pass * 8)) & 0xFF] == count) {
+			continue;
+		}
+		size_t Offsets[256];
+		size_t Sum = 0;
+		for (int b = 0; b < 256; b++) {
+			Offsets[b] = Sum;
+			Sum += Count[b];
+		}
+		for (size_t i = 0; i < count; i++) {
+			To[Offsets[(From[i].Key >> (Pass * 8)) & 0xFF]++] = From[i];
+		}
+		SortEntry* Swap = From;
+		From = To;
+		To = Swap;
+	}
+	return From;
+}
+
+static void CountStateChanges(const RenderQueue& queue, const SortEntry* order, RenderQueueStats& stats, RenderQueueStats& total)
+{
+	const uint64_t MaterialMask = ((1ull << SORT_KEY_MATERIAL_BITS) - 1) << (SORT_KEY_VERTEX_ARRAY_BITS + SORT_KEY_DEPTH_BITS);
+	memset(&stats, 0, sizeof(stats));
+	const DrawPacket* Previous = NULL;
+	for (int i = 0; i < queue.Count; i++) {
+		const DrawPacket* Packet = &queue.Packets[order[i].Packet];
+		stats.Packets++;
+		stats.ProgramChanges += Previous == NULL || Packet->Program != Previous->Program;
+		stats.MaterialChanges += Previous == NULL || (Packet->Key & MaterialMask) != (Previous->Key & MaterialMask);
+		stats.VertexArrayChanges += Previous == NULL || Packet->VertexArray != Previous->VertexArray;
+		stats.UniformChanges += Previous == NULL || Packet->UniformOffset != Previous->UniformOffset;
+		Previous = Packet;
+	}
+	total.Packets += stats.Packets;
+	total.ProgramChanges += stats.ProgramChanges;
+	total.MaterialChanges += stats.MaterialChanges;
+	total.VertexArrayChanges += stats.VertexArrayChanges;
+	total.UniformChanges += stats.UniformChanges;
+}
+
+void SortRenderQueue(RenderQueue& queue, bool sort)
+{
+	for (int i = 0; i < queue.Count; i++) {
+		queue.Order[i].Key = queue.Packets[i].Key;
+		queue.Order[i].Packet = (uint32_t)i;
+	}
+	CountStateChanges(queue, queue.Order, queue.Unsorted, queue.TotalUnsorted);
+
+	if (sort) {
+		SortEntry* Sorted = RadixSortEntries(queue.Order, queue.Scratch, queue.Count);
+		if (Sorted != queue.Order) {
+			queue.Scratch = queue.Order;
+			queue.Order = Sorted;
+		}
+	}
+	CountStateChanges(queue, queue.Order, queue.Sorted, queue.TotalSorted);
+	queue.Frames++;
+}
+
+void SubmitRenderQueue(const RenderQueue& queue, UniformRing& ring)
+{
+	for (int i = 0; i < queue.Count; i++) {
+		const DrawPacket& Packet = queue.Packets[queue.Order[i].Packet];
+		CachedUseProgram(Packet.Program);
+		CachedBindVertexArray(Packet.VertexArray);
+		BindObjectUniforms(ring, Packet.UniformOffset);
+		if (Packet.InstanceCount == 0) {
+			glDrawElements(GL_TRIANGLES, Packet.IndexCount, Packet.IndexType, (void*)Packet.IndexOffset);
+		}
+		else if (Packet.BaseInstance != 0) {
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, Packet.IndexCount, Packet.IndexType, (void*)Packet.IndexOffset, Packet.InstanceCount, Packet.BaseInstance);
+		}
+		else {
+			glDrawElementsInstanced(GL_TRIANGLES, Packet.IndexCount, Packet.IndexType, (void*)Packet.IndexOffset, Packet.InstanceCount);
+		}
+	}
+}
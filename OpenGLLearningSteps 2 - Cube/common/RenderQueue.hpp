@@ -0,0 +1,110 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "UniformBlocks.hpp"
+
+// Draws aren't issued where the code decides to draw something: they're recorded as packets, sorted by
+// a 64-bit key once the frame is recorded, and submitted in that order. The key puts the most expensive
+// state first, so the packets that share a program come together, then those that share a material,
+// then a vertex array, and the distance to the camera last:
+//
+//   bits 63..60 layer | 59..48 program | 47..36 material | 35..24 vertex array | 23..0 depth
+//
+// Program, material and vertex array are small indices given by the caller, not GL names (those can be anything).
+// Everything the queue needs for a frame comes from a FrameArena, so recording never calls malloc.
+
+#define SORT_KEY_LAYER_BITS 4
+#define SORT_KEY_PROGRAM_BITS 12
+#define SORT_KEY_MATERIAL_BITS 12
+#define SORT_KEY_VERTEX_ARRAY_BITS 12
+#define SORT_KEY_DEPTH_BITS 24
+
+// Linear allocator, everything is given back at once when the frame starts again
+struct FrameArena
+{
+	unsigned char* Memory;
+	size_t Size;
+	size_t Used;
+	size_t HighWater;		// Most that was ever used in one frame
+};
+
+bool CreateFrameArena(FrameArena& arena, size_t size);
+void DestroyFrameArena(FrameArena& arena);
+void ResetFrameArena(FrameArena& arena);
+// NULL when the arena is full. alignment must be a power of two.
+void* ArenaAllocate(FrameArena& arena, size_t size, size_t alignment);
+
+struct DrawPacket
+{
+	uint64_t Key;
+	GLuint Program;
+	GLuint VertexArray;
+	GLintptr UniformOffset;		// Its ObjectUniforms block
+	GLsizei IndexCount;
+	GLenum IndexType;
+	GLintptr IndexOffset;		// In bytes into the index buffer, where its LOD starts
+	GLsizei InstanceCount;		// 0 for a plain glDrawElements()
+	GLuint BaseInstance;
+};
+
+// State changes of one frame, counted from one packet to the next (the first packet sets everything)
+struct RenderQueueStats
+{
+	unsigned long long Packets;
+	unsigned long long ProgramChanges;
+	unsigned long long MaterialChanges;
+	unsigned long long VertexArrayChanges;
+	unsigned long long UniformChanges;	// Object block rebinds, there's one per object whatever the order
+};
+
+// Key and packet index, what the radix sort actually moves around
+struct SortEntry
+{
+	uint64_t Key;
+	uint32_t Packet;
+};
+
+struct RenderQueue
+{
+	DrawPacket* Packets;		// In the order they were pushed
+	SortEntry* Order;			// In the order they're submitted
+	SortEntry* Scratch;
+	int Count;
+	int Capacity;
+
+	// Last frame, in the order the packets were pushed and in the order they were submitted
+	RenderQueueStats Unsorted;
+	RenderQueueStats Sorted;
+	// Summed over every frame
+	RenderQueueStats TotalUnsorted;
+	RenderQueueStats TotalSorted;
+	unsigned long long Frames;
+};
+
+uint64_t MakeSortKey(unsigned int layer, unsigned int program, unsigned int material, unsigned int vertexArray, uint32_t depth);
+// The depth bits of the key, near to far, or far to near with backToFront
+uint32_t SortKeyDepth(float distance, float farPlane, bool backToFront);
+
+void InitRenderQueue(RenderQueue& queue);
+
+// Takes room for up to capacity packets from the arena (reset it first). False if it doesn't fit.
+bool BeginRenderQueue(RenderQueue& queue, FrameArena& arena, int capacity);
+
+// The next packet to fill in, NULL when the queue is full
+DrawPacket* PushDrawPacket(RenderQueue& queue);
+
+// Sorts by key (stable, equal keys keep the order they were pushed in), or leaves them as pushed when sort is false.
+// Both orders are counted either way.
+void SortRenderQueue(RenderQueue& queue, bool sort);
+
+// Issues the draws through the state cache, each with its object block from ring
+void SubmitRenderQueue(const RenderQueue& queue, UniformRing& ring);
+
+// LSD radix sort on the 64-bit keys, 8 bits at a time. Passes where every key has the same byte are skipped.
+// Returns entries or scratch, whichever ended up holding the sorted entries.
+SortEntry* RadixSortEntries(SortEntry* entries, SortEntry* scratch, size_t count);
+
+#endif
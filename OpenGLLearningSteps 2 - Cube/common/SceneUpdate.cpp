@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneUpdate.hpp"
+#include "JobSystem.hpp"
+#include "Instancing.hpp"
+#include "GpuCulling.hpp"
+#include "UniformBlocks.hpp"
+
+struct TransformJob
+{
+	TransformBatch* Objects;
+	bool Animate;
+	float Time;
+	const float* ViewProjection;
+	float* Models;
+	float* Mvps;
+};
+
+static void RunTransformJob(void* data, size_t begin, size_t end, int thread)
+{
+	TransformJob& Job = *(TransformJob*)data;
+	TransformBatch Slice = SliceTransformBatch(*Job.Objects, begin, end - begin);
+	if (Job.Animate) {
+		AnimateInstances(Slice, Job.Time, begin);
+	}
+	ComputeTransforms(Slice, Job.ViewProjection, Job.Models != NULL ? Job.Models + begin * 16 : NULL, Job.Mvps != NULL ? Job.Mvps + begin * 16 : NULL);
+}
+
+void ParallelTransforms(TransformBatch& objects, bool animate, float time, const float* viewProjection, float* models, float* mvps)
+{
+	TransformJob Job = { &objects, animate, time, viewProjection, models, mvps };
+	ParallelFor(objects.Count, SCENE_UPDATE_GRAIN, RunTransformJob, &Job);
+}
+
+void CreateSceneUpdate(SceneUpdate& update, TransformBatch& objects, const Bvh& tree, float meshRadius, bool animate, const PositionDequantize& dequantize)
+{
+	update.Objects = &objects;
+	update.Tree = &tree;
+	update.MeshRadius = meshRadius;
+	update.Animate = animate;
+	update.Dequantize = dequantize;
+	update.TransformMs = 0.0;
+	update.CullMs = 0.0;
+	update.Models.resize(objects.Count * 16);
+	update.Mvps.resize(objects.Count * 16);
+	// A few subtrees per thread, so a thread whose subtrees are all off screen can steal some work
+	SplitBvh(tree, 4 * JobThreadCount(), update.CullRoots);
+	update.Lists.resize(update.CullRoots.size());
+	for (size_t i = 0; i < update.Lists.size(); i++) {
+		update.Lists[i].Draws.reserve(objects.Count / update.Lists.size() + 1);
+	}
+}
+
+// What the cull jobs need besides the SceneUpdate, for this frame
+struct CullJob
+{
+	SceneUpdate* Update;
+	const float (*Planes)[4];
+	unsigned char* Blocks;
+	GLintptr BlocksOffset;
+	GLsizeiptr Stride;
+};
+
+static void RunCullJob(void* data, size_t begin, size_t end, int thread)
+{
+	CullJob& Job = *(CullJob*)data;
+	SceneUpdate& Update = *Job.Update;
+	const TransformBatch& Objects = *Update.Objects;
+	for (size_t r = begin; r < end; r++) {
+		DrawCommandList& List = Update.Lists[r];
+		List.Draws.clear();
+		List.Candidates.clear();
+		CullBvh(*Update.Tree, Job.Planes, List.Candidates, List.Stats, Update.CullRoots[r]);
+		for (size_t v = 0; v < List.Candidates.size(); v++) {
+			// The tree works on boxes around the spheres, the sphere test drops their corners, same as the GPU culling
+			uint32_t i = List.Candidates[v];
+			if (!SphereInFrustum(Job.Planes, Objects.PositionX[i], Objects.PositionY[i], Objects.PositionZ[i], Update.MeshRadius * Objects.Scale[i])) {
+				continue;
+			}
+			ObjectUniforms* Block = (ObjectUniforms*)(Job.Blocks + i * Job.Stride);
+			memcpy(Block->Model, &Update.Models[i * 16], sizeof(Block->Model));
+			memcpy(Block->ModelViewProjection, &Update.Mvps[i * 16], sizeof(Block->ModelViewProjection));
+			memcpy(Block->PositionScale, Update.Dequantize.Scale, sizeof(Update.Dequantize.Scale));
+			memcpy(Block->PositionBias, Update.Dequantize.Bias, sizeof(Update.Dequantize.Bias));
+			DrawCommand Draw = { i, Job.BlocksOffset + (GLintptr)(i * Job.Stride) };
+			List.Draws.push_back(Draw);
+		}
+	}
+}
+
+void RunSceneUpdate(SceneUpdate& update, float time, const float* viewProjection, const float planes[6][4],
+	unsigned char* blocks, GLintptr blocksOffset, GLsizeiptr stride)
+{
+	// The matrices first: a subtree can hold objects of any slice
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	ParallelTransforms(*update.Objects, update.Animate, time, viewProjection, &update.Models[0], &update.Mvps[0]);
+	std::chrono::steady_clock::time_point TransformsDone = std::chrono::steady_clock::now();
+
+	CullJob Job = { &update, planes, blocks, blocksOffset, stride };
+	ParallelFor(update.CullRoots.size(), 1, RunCullJob, &Job);
+	update.TransformMs = std::chrono::duration<double, std::milli>(TransformsDone - Start).count();
+	update.CullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - TransformsDone).count();
+}
+
+int CountSceneDraws(const SceneUpdate& update)
+{
+	int Count = 0;
+	for (size_t i = 0; i < update.Lists.size(); i++) {
+		Count += (int)update.Lists[i].Draws.size();
+	}
+	return Count;
+}
+
+BvhCullStats SumSceneCullStats(const SceneUpdate& update)
+{
+	BvhCullStats Total;
+	memset(&Total, 0, sizeof(Total));
+	for (size_t i = 0; i < update.Lists.size(); i++) {
+		const BvhCullStats& Stats = update.Lists[i].Stats;
+		Total.NodesVisited += Stats.NodesVisited;
+		Total.NodesInside += Stats.NodesInside;
+		Total.ObjectsTested += Stats.ObjectsTested;
+		Total.Visible += Stats.Visible;
+	}
+	return Total;
+}
+
+void RunSceneUpdateBenchmark(size_t count, int maxThreads, int frames)
+{
+	// The scene of --instances count --draw direct --animate, seen from the same camera
+	TransformBatch Objects;
+	float SceneRadius = 0.0f;
+	float MeshRadius = sqrtf(3.0f);
+	if (!BuildInstanceGrid(Objects, (int)count, 3.0f, MeshRadius, SceneRadius)) {
+		return;
+	}
+	std::vector<float> Bounds;
+	ComputeBatchBounds(Objects, MeshRadius, Bounds);
+	Bvh Tree;
+	BuildBvh(Tree, &Bounds[0], count);
+
+	float CameraDistance = glm::length(glm::vec3(4, 3, 3)) + 2.5f * SceneRadius;
+	float FarPlane = CameraDistance + SceneRadius > 100.0f ? CameraDistance + SceneRadius : 100.0f;
+	glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, FarPlane);
+	glm::mat4 View = glm::lookAt(glm::normalize(glm::vec3(4, 3, 3)) * CameraDistance, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+	glm::mat4 VP = Projection * View;
+	float Planes[6][4];
+	ExtractFrustumPlanes(&VP[0][0], Planes);
+
+	// Stands in for the uniform buffer
+	const GLsizeiptr Stride = 256;
+	std::vector<unsigned char> Blocks(count * Stride);
+	PositionDequantize Dequantize = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+
+	int HardwareThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads <= 0) {
+		maxThreads = HardwareThreads > 0 ? HardwareThreads : 1;
+	}
+
+	printf("{\n  \"objects\": %d,\n  \"hardware_threads\": %d,\n  \"runs\": [\n", (int)count, HardwareThreads);
+	std::vector<DrawCommand> Reference;
+	double OneThreadMs = 0.0;
+	for (int Threads = 1; ; Threads = Threads * 2 < maxThreads ? Threads * 2 : maxThreads) {
+		StartJobSystem(Threads);
+		SceneUpdate Update;
+		CreateSceneUpdate(Update, Objects, Tree, MeshRadius, true, Dequantize);
+
+		// Frame 0 is left out, it's the one that faults the memory in
+		double TotalMs = 0.0;
+		for (int Frame = 0; Frame <= frames; Frame++) {
+			std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+			RunSceneUpdate(Update, Frame / 60.0f, &VP[0][0], Planes, &Blocks[0], 0, Stride);
+			if (Frame > 0) {
+				TotalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+			}
+		}
+		// No timed frame (frames <= 0) reports 0 rather than a nan the JSON can't hold
+		double FrameMs = frames > 0 ? TotalMs / frames : 0.0;
+
+		// Whatever the threads, the replay has to see the same draws in the same order
+		std::vector<DrawCommand> Draws;
+		for (size_t i = 0; i < Update.Lists.size(); i++) {
+			Draws.insert(Draws.end(), Update.Lists[i].Draws.begin(), Update.Lists[i].Draws.end());
+		}
+		bool SameDraws = true;
+		if (Threads == 1) {
+			Reference = Draws;
+			OneThreadMs = FrameMs;
+		}
+		else {
+			SameDraws = Draws.size() == Reference.size();
+			for (size_t i = 0; SameDraws && i < Draws.size(); i++) {
+				SameDraws = Draws[i].Object == Reference[i].Object && Draws[i].UniformOffset == Reference[i].UniformOffset;
+			}
+		}
+		StopJobSystem();
+
+		printf("    { \"threads\": %d, \"cpu_frame_ms\": %.3f, \"speedup\": %.2f, \"draws\": %d, \"command_lists\": %d, \"same_draws_as_one_thread\": %s }%s\n",
+			Threads, FrameMs, FrameMs > 0.0 ? OneThreadMs / FrameMs : 0.0, (int)Draws.size(), (int)Update.Lists.size(), SameDraws ? "true" : "false", Threads == maxThreads ? "" : ",");
+		if (Threads == maxThreads) {
+			break;
+		}
+	}
+	printf("  ]\n}\n");
+	DestroyTransformBatch(Objects);
+}
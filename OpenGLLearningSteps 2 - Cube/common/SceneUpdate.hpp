@@ -0,0 +1,68 @@
+#ifndef SCENEUPDATE_HPP
+#define SCENEUPDATE_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "TransformBatch.hpp"
+#include "Bvh.hpp"
+#include "VertexQuantize.hpp"
+
+// The CPU side of a frame of direct draws, spread over the job system (JobSystem.hpp): animating the objects,
+// computing their matrices, culling them and writing the ObjectUniforms block of each visible one.
+// Jobs can't call GL, so they record their draws in command lists, one per BVH subtree, and the GL thread
+// replays the lists in order afterwards. The subtrees go left to right, so the draws come out in the same
+// order whatever the number of threads.
+
+// Objects per job for the per-object work. A multiple of 8, the transform kernels need aligned slices.
+#define SCENE_UPDATE_GRAIN 1024
+
+// One recorded draw: the object, and where its ObjectUniforms block is in the uniform buffer
+struct DrawCommand
+{
+	uint32_t Object;
+	GLintptr UniformOffset;
+};
+
+struct DrawCommandList
+{
+	std::vector<DrawCommand> Draws;
+	std::vector<uint32_t> Candidates;	// What the BVH found, before the sphere test
+	BvhCullStats Stats;
+};
+
+struct SceneUpdate
+{
+	TransformBatch* Objects;
+	const Bvh* Tree;
+	float MeshRadius;
+	bool Animate;
+	PositionDequantize Dequantize;
+	std::vector<float> Models;			// 16 floats per object
+	std::vector<float> Mvps;
+	std::vector<uint32_t> CullRoots;	// BVH subtrees, each culled by its own job
+	std::vector<DrawCommandList> Lists;	// One per subtree
+	double TransformMs;					// Time of each step of the last RunSceneUpdate()
+	double CullMs;
+};
+
+// Splits the tree for the threads the job system has right now, call it again if that changes
+void CreateSceneUpdate(SceneUpdate& update, TransformBatch& objects, const Bvh& tree, float meshRadius, bool animate, const PositionDequantize& dequantize);
+
+// Runs the frame's jobs and returns once the command lists are ready. The ObjectUniforms of object i go to
+// blocks + i * stride, which is blocksOffset + i * stride in the uniform buffer.
+void RunSceneUpdate(SceneUpdate& update, float time, const float* viewProjection, const float planes[6][4],
+	unsigned char* blocks, GLintptr blocksOffset, GLsizeiptr stride);
+
+int CountSceneDraws(const SceneUpdate& update);
+BvhCullStats SumSceneCullStats(const SceneUpdate& update);
+
+// Animates (if animate) and computes the transforms of every object of the batch, in parallel.
+// Same arguments as ComputeTransforms(), models and mvps are laid out the same way.
+void ParallelTransforms(TransformBatch& objects, bool animate, float time, const float* viewProjection, float* models, float* mvps);
+
+// Times RunSceneUpdate() on a grid of count objects with 1, 2, 4... up to maxThreads threads
+// (0: one per hardware thread) and prints the CPU frame time of each as JSON. No GL needed.
+void RunSceneUpdateBenchmark(size_t count, int maxThreads, int frames);
+
+#endif
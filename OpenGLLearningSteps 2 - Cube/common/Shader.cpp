@@ -1,56 +1,298 @@
 #include <stdio.h>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <sstream>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <atomic>
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 #include <GL/glew.h>
 
-#include "shader.hpp"
+#include "Shader.hpp"
+// The CMake build generates it in its build folder and points this at it
+#ifdef EMBEDDED_SHADERS_HEADER
+#include EMBEDDED_SHADERS_HEADER
+#else
+#include "EmbeddedShaders.hpp"
+#endif
+
+// Header written in front of every cached program binary.
+// The key is repeated here so a renamed or corrupted file is never fed to the driver.
+struct ProgramBinaryHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Format;
+	uint32_t Length;
+};
+
+static const char ProgramBinaryMagic[4] = { 'G', 'L', 'P', 'B' };
+static const uint32_t ProgramBinaryVersion = 1;
+
+// FNV-1a 64 bits. It's not a cryptographic hash, but it's more than enough to tell shader sources apart.
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static uint64_t HashString(uint64_t hash, std::string_view str)
+{
+	// Hash a terminator as well, so "ab" + "c" and "a" + "bc" don't collide
+	hash = HashBytes(hash, str.data(), str.size());
+	return HashBytes(hash, "", 1);
+}
+
+static uint64_t HashString(uint64_t hash, const char* str)
+{
+	return HashString(hash, std::string_view(str ? str : ""));
+}
+
+// The key covers both sources and the driver that produced the binary,
+// since a binary from another GPU or driver version is useless (and may be rejected).
+static uint64_t ProgramCacheKey(std::string_view VertexShaderCode, std::string_view FragmentShaderCode)
+{
+	uint64_t Key = 14695981039346656037ULL;
+	Key = HashString(Key, VertexShaderCode);
+	Key = HashString(Key, FragmentShaderCode);
+	Key = HashString(Key, (const char*)glGetString(GL_VENDOR));
+	Key = HashString(Key, (const char*)glGetString(GL_RENDERER));
+	Key = HashString(Key, (const char*)glGetString(GL_VERSION));
+	return Key;
+}
+
+static std::string ProgramCachePath(uint64_t Key)
+{
+	char FileName[64];
+	snprintf(FileName, sizeof(FileName), "/%016llx.programbinary", (unsigned long long)Key);
+	return std::string(SHADER_CACHE_DIR) + FileName;
+}
+
+static bool ProgramBinarySupported()
+{
+	if (!GLEW_ARB_get_program_binary) {
+		return false;
+	}
 
+	// Some drivers expose the extension but no format at all, which means nothing can be cached
+	GLint NumFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &NumFormats);
+	return NumFormats > 0;
+}
+
+// Returns a linked program from the cache, or 0 if there's no usable entry.
+static GLuint LoadProgramBinary(uint64_t Key)
+{
+	std::string Path = ProgramCachePath(Key);
+	std::ifstream CacheStream(Path.c_str(), std::ios::in | std::ios::binary);
+	if (!CacheStream.is_open()) {
+		return 0;
+	}
+
+	ProgramBinaryHeader Header;
+	if (!CacheStream.read((char*)&Header, sizeof(Header))
+		|| memcmp(Header.Magic, ProgramBinaryMagic, sizeof(Header.Magic)) != 0
+		|| Header.Version != ProgramBinaryVersion
+		|| Header.Key != Key
+		|| Header.Length == 0) {
+		printf("Ignoring invalid program cache entry %s\n", Path.c_str());
+		return 0;
+	}
+
+	// The length comes from the file: check it against what's left of it before allocating anything
+	std::streamoff BinaryStart = CacheStream.tellg();
+	CacheStream.seekg(0, std::ios::end);
+	std::streamoff FileSize = CacheStream.tellg();
+	CacheStream.seekg(BinaryStart, std::ios::beg);
+	if (BinaryStart < 0 || FileSize < BinaryStart || (uint64_t)Header.Length > (uint64_t)(FileSize - BinaryStart)) {
+		printf("Ignoring truncated program cache entry %s\n", Path.c_str());
+		return 0;
+	}
+
+	std::vector<char> Binary(Header.Length);
+	if (!CacheStream.read(&Binary[0], Header.Length)) {
+		printf("Ignoring truncated program cache entry %s\n", Path.c_str());
+		return 0;
+	}
+
+	GLuint ProgramId = glCreateProgram();
+	glProgramBinary(ProgramId, Header.Format, &Binary[0], Header.Length);
+
+	// The driver is free to reject any binary (e.g. after a driver update), in that case we compile again
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramId, GL_LINK_STATUS, &Result);
+	if (Result != GL_TRUE) {
+		printf("Program cache entry %s was rejected by the driver\n", Path.c_str());
+		glDeleteProgram(ProgramId);
+		return 0;
+	}
+
+	return ProgramId;
+}
+
+static void SaveProgramBinary(uint64_t Key, GLuint ProgramId)
+{
+	GLint Length = 0;
+	glGetProgramiv(ProgramId, GL_PROGRAM_BINARY_LENGTH, &Length);
+	if (Length <= 0) {
+		return;
+	}
+
+	ProgramBinaryHeader Header;
+	memcpy(Header.Magic, ProgramBinaryMagic, sizeof(Header.Magic));
+	Header.Version = ProgramBinaryVersion;
+	Header.Key = Key;
+
+	std::vector<char> Binary(Length);
+	GLenum Format = 0;
+	glGetProgramBinary(ProgramId, Length, &Length, &Format, &Binary[0]);
+	Header.Format = Format;
+	Header.Length = (uint32_t)Length;
+
+#ifdef _WIN32
+	_mkdir(SHADER_CACHE_DIR);
+#else
+	mkdir(SHADER_CACHE_DIR, 0755);
+#endif
+
+	std::string Path = ProgramCachePath(Key);
+	std::ofstream CacheStream(Path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!CacheStream.is_open()) {
+		printf("Impossible to write program cache entry %s\n", Path.c_str());
+		return;
+	}
+	CacheStream.write((const char*)&Header, sizeof(Header));
+	CacheStream.write(&Binary[0], Length);
+}
+
+// The source of one shader, either embedded in the binary or read from the disk
+struct ShaderSource
+{
+	bool Found;
+	std::string_view Embedded; // Points straight into the binary, nothing to copy
+	std::string File;
+
+	std::string_view Code() const
+	{
+		return Found && Embedded.data() != NULL ? Embedded : std::string_view(File);
+	}
+};
+
+static bool ReadShaderFile(const char* path, std::string& Code)
+{
+	std::ifstream Stream(path, std::ios::in);
+	if (!Stream.is_open()) {
+		return false;
+	}
+	std::stringstream sstr;
+	sstr << Stream.rdbuf();
+	Code = sstr.str();
+	return true;
+}
+
+// Development builds look at the file first, so a shader can be edited without rebuilding.
+// Release builds only read a file for a shader that wasn't embedded when the program was built.
+static ShaderSource ReadShaderSource(const char* path)
+{
+	ShaderSource Source;
+	Source.Found = false;
+#if SHADER_FILE_OVERRIDE
+	if (ReadShaderFile(path, Source.File)) {
+		Source.Found = true;
+		return Source;
+	}
+#endif
+	const EmbeddedShader* Shader = FindEmbeddedShader(path);
+	if (Shader != NULL) {
+		Source.Embedded = Shader->Source;
+		Source.Found = true;
+		return Source;
+	}
+#if !SHADER_FILE_OVERRIDE
+	Source.Found = ReadShaderFile(path, Source.File);
+#endif
+	return Source;
+}
+
+static void PrintMissingShader(const char* path)
+{
+	printf("impossible to open %s, and it isn't embedded either. Are you in the right directory? Don't forget to read the FAQ!\n", path);
+}
+
+// glShaderSource() with an explicit length, string views aren't null terminated
+static void SetShaderSource(GLuint ShaderId, std::string_view Code)
+{
+	const char* SourcePointer = Code.data();
+	GLint SourceLength = (GLint)Code.size();
+	glShaderSource(ShaderId, 1, &SourcePointer, &SourceLength);
+}
 
 GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 {
-	// Create the shaders
-	GLuint VertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	// Startup time is measured from here, so it includes reading the files
+	std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if (VertexShaderStream.is_open()) {
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
-	}
-	else {
-		printf("impossible to open %s. Are you in the right directory? Don't forget to read the FAQ!\n", vertex_file_path);
+	// Get the Vertex Shader code
+	ShaderSource VertexSource = ReadShaderSource(vertex_file_path);
+	if (!VertexSource.Found) {
+		PrintMissingShader(vertex_file_path);
 		return 0;
 	}
+	std::string_view VertexShaderCode = VertexSource.Code();
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if (FragmentShaderStream.is_open()) {
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
+	// Get the Fragment Shader code
+	ShaderSource FragmentSource = ReadShaderSource(fragment_file_path);
+	if (!FragmentSource.Found) {
+		PrintMissingShader(fragment_file_path);
+		return 0;
 	}
+	std::string_view FragmentShaderCode = FragmentSource.Code();
+
+	// Try the program cache first, compiling is by far the slowest part of the startup
+	bool UseProgramCache = ProgramBinarySupported();
+	uint64_t CacheKey = 0;
+	if (UseProgramCache) {
+		CacheKey = ProgramCacheKey(VertexShaderCode, FragmentShaderCode);
+		GLuint CachedProgramId = LoadProgramBinary(CacheKey);
+		if (CachedProgramId != 0) {
+			double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+			printf("Loaded program %s + %s from cache in %.3f ms (warm start)\n", vertex_file_path, fragment_file_path, ElapsedMs);
+			return CachedProgramId;
+		}
+	}
+
+	// Create the shaders
+	GLuint VertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
 	// Compile Vertex Shader
 	printf("Compiling shader: %s\n", vertex_file_path);
-	char const* VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderId, 1, &VertexSourcePointer, NULL);
+	SetShaderSource(VertexShaderId, VertexShaderCode);
 	glCompileShader(VertexShaderId);
 
 	// Check Vertex Shader
@@ -64,8 +306,7 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 
 	// Compile Fragment Shader
 	printf("Compiling shader: %s\n", fragment_file_path);
-	char const* FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderId, 1, &FragmentSourcePointer, NULL);
+	SetShaderSource(FragmentShaderId, FragmentShaderCode);
 	glCompileShader(FragmentShaderId);
 
 	// Check Fragment Shader
@@ -82,6 +323,10 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 	GLuint ProgramId = glCreateProgram();
 	glAttachShader(ProgramId, VertexShaderId);
 	glAttachShader(ProgramId, FragmentShaderId);
+	if (UseProgramCache) {
+		// Tell the driver we'll ask for the binary, otherwise it may not keep one around
+		glProgramParameteri(ProgramId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(ProgramId);
 
 	// Check the program
@@ -93,6 +338,11 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
 
+	// Only a program that linked is worth caching, this also replaces a stale or rejected entry
+	if (UseProgramCache && Result == GL_TRUE) {
+		SaveProgramBinary(CacheKey, ProgramId);
+	}
+
 	// Unbind the shaders from the program
 	glDetachShader(ProgramId, VertexShaderId);
 	glDetachShader(ProgramId, FragmentShaderId);
@@ -101,5 +351,397 @@ GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path)
 	glDeleteShader(VertexShaderId);
 	glDeleteShader(FragmentShaderId);
 
+	double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - StartTime).count();
+	printf("Compiled program %s + %s in %.3f ms (cold start)\n", vertex_file_path, fragment_file_path, ElapsedMs);
+
+	return ProgramId;
+}
+
+GLuint LoadComputeShader(const char* compute_file_path)
+{
+	ShaderSource ComputeSource = ReadShaderSource(compute_file_path);
+	if (!ComputeSource.Found) {
+		PrintMissingShader(compute_file_path);
+		return 0;
+	}
+
+	printf("Compiling shader: %s\n", compute_file_path);
+	GLuint ComputeShaderId = glCreateShader(GL_COMPUTE_SHADER);
+	SetShaderSource(ComputeShaderId, ComputeSource.Code());
+	glCompileShader(ComputeShaderId);
+
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
+	glGetShaderiv(ComputeShaderId, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ComputeShaderId, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> ComputeShaderErrorMessage(InfoLogLength + 1);
+		glGetShaderInfoLog(ComputeShaderId, InfoLogLength, NULL, &ComputeShaderErrorMessage[0]);
+		printf("%s\n", &ComputeShaderErrorMessage[0]);
+	}
+
+	GLuint ProgramId = glCreateProgram();
+	glAttachShader(ProgramId, ComputeShaderId);
+	glLinkProgram(ProgramId);
+	glGetProgramiv(ProgramId, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramId, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
+		glGetProgramInfoLog(ProgramId, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("%s\n", &ProgramErrorMessage[0]);
+	}
+	glDetachShader(ProgramId, ComputeShaderId);
+	glDeleteShader(ComputeShaderId);
+
+	if (Result != GL_TRUE) {
+		glDeleteProgram(ProgramId);
+		return 0;
+	}
+	return ProgramId;
+}
+
+// Asynchronous loading
+
+// All the files of one LoadShadersAsync() call, shared with the reader threads.
+// The threads are detached, so the batch lives as long as the last one still holds it.
+struct ShaderReadBatch
+{
+	std::vector<std::string> Paths;
+	std::vector<std::promise<ShaderSource> > Results;
+	std::atomic<size_t> Next;
+};
+
+enum AsyncProgramState
+{
+	AsyncReading,	// Waiting for the reader threads
+	AsyncLinking,	// Compile and link were issued, the driver may still be working on them
+	AsyncDone
+};
+
+struct AsyncProgram
+{
+	std::string VertexPath;
+	std::string FragmentPath;
+	std::future<ShaderSource> VertexFile;
+	std::future<ShaderSource> FragmentFile;
+	AsyncProgramState State;
+	ShaderProgramStatus Status;
+	bool InUse;				// Between LoadShadersAsync() and GetShaderProgram(), then the slot is free
+	unsigned int Generation;	// Bumped when the slot is freed, so an old handle no longer matches
+	GLuint VertexShaderId;
+	GLuint FragmentShaderId;
+	GLuint ProgramId;
+	bool UseProgramCache;
+	uint64_t CacheKey;
+	std::chrono::steady_clock::time_point SubmitTime;
+};
+
+// A deque so the programs never move when more are submitted. A handle is the slot index + 1 in the low
+// bits and the generation of the slot above them. Collected slots go back to the free list, so
+// reloading shaders over and over keeps reusing the same few.
+#define ASYNC_PROGRAM_INDEX_BITS 16
+#define ASYNC_PROGRAM_INDEX_MASK ((1u << ASYNC_PROGRAM_INDEX_BITS) - 1)
+static std::deque<AsyncProgram> AsyncPrograms;
+static std::vector<size_t> FreeAsyncPrograms;
+static bool ParallelCompileChecked = false;
+static bool ParallelCompileSupported = false;
+
+static void ReadShaderFiles(std::shared_ptr<ShaderReadBatch> Batch)
+{
+	for (;;) {
+		size_t Index = Batch->Next++;
+		if (Index >= Batch->Paths.size()) {
+			return;
+		}
+
+		Batch->Results[Index].set_value(ReadShaderSource(Batch->Paths[Index].c_str()));
+	}
+}
+
+// With KHR_parallel_shader_compile the driver compiles and links on its own threads,
+// and GL_COMPLETION_STATUS_KHR tells whether it's done without waiting for it.
+static void EnableParallelShaderCompile()
+{
+	if (ParallelCompileChecked) {
+		return;
+	}
+	ParallelCompileChecked = true;
+
+	if (GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // As many threads as the driver likes
+		ParallelCompileSupported = true;
+	}
+	else if (GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		ParallelCompileSupported = true;
+	}
+	printf("Parallel shader compile %s\n", ParallelCompileSupported ? "enabled" : "not available, programs are checked when first needed");
+}
+
+bool ParallelShaderCompileAvailable()
+{
+	EnableParallelShaderCompile();
+	return ParallelCompileSupported;
+}
+
+static void PrintShaderLog(GLuint ShaderId)
+{
+	int InfoLogLength = 0;
+	glGetShaderiv(ShaderId, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> ShaderErrorMessage(InfoLogLength + 1);
+		glGetShaderInfoLog(ShaderId, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
+	}
+}
+
+static void FailProgram(AsyncProgram& Program)
+{
+	Program.State = AsyncDone;
+	Program.Status = ShaderProgramFailed;
+	Program.ProgramId = 0;
+}
+
+// Source files are in: try the cache, otherwise issue the compile and the link without asking for any status
+static void SubmitProgram(AsyncProgram& Program)
+{
+	ShaderSource VertexSource = Program.VertexFile.get();
+	ShaderSource FragmentSource = Program.FragmentFile.get();
+	if (!VertexSource.Found || !FragmentSource.Found) {
+		PrintMissingShader(!VertexSource.Found ? Program.VertexPath.c_str() : Program.FragmentPath.c_str());
+		FailProgram(Program);
+		return;
+	}
+
+	Program.UseProgramCache = ProgramBinarySupported();
+	if (Program.UseProgramCache) {
+		Program.CacheKey = ProgramCacheKey(VertexSource.Code(), FragmentSource.Code());
+		GLuint CachedProgramId = LoadProgramBinary(Program.CacheKey);
+		if (CachedProgramId != 0) {
+			double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Program.SubmitTime).count();
+			printf("Loaded program %s + %s from cache %.3f ms after submit (warm start)\n", Program.VertexPath.c_str(), Program.FragmentPath.c_str(), ElapsedMs);
+			Program.ProgramId = CachedProgramId;
+			Program.State = AsyncDone;
+			Program.Status = ShaderProgramReady;
+			return;
+		}
+	}
+
+	Program.VertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+	SetShaderSource(Program.VertexShaderId, VertexSource.Code());
+	glCompileShader(Program.VertexShaderId);
+
+	Program.FragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	SetShaderSource(Program.FragmentShaderId, FragmentSource.Code());
+	glCompileShader(Program.FragmentShaderId);
+
+	// Linking right away is fine, a failed compile just shows up as a failed link later
+	Program.ProgramId = glCreateProgram();
+	glAttachShader(Program.ProgramId, Program.VertexShaderId);
+	glAttachShader(Program.ProgramId, Program.FragmentShaderId);
+	if (Program.UseProgramCache) {
+		glProgramParameteri(Program.ProgramId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(Program.ProgramId);
+	Program.State = AsyncLinking;
+}
+
+// The only place the statuses are read. Without parallel compile this is where the wait happens.
+static void FinishProgram(AsyncProgram& Program)
+{
+	GLint Result = GL_FALSE;
+	glGetShaderiv(Program.VertexShaderId, GL_COMPILE_STATUS, &Result);
+	if (Result != GL_TRUE) {
+		printf("Compiling shader %s failed\n", Program.VertexPath.c_str());
+		PrintShaderLog(Program.VertexShaderId);
+	}
+	glGetShaderiv(Program.FragmentShaderId, GL_COMPILE_STATUS, &Result);
+	if (Result != GL_TRUE) {
+		printf("Compiling shader %s failed\n", Program.FragmentPath.c_str());
+		PrintShaderLog(Program.FragmentShaderId);
+	}
+
+	glGetProgramiv(Program.ProgramId, GL_LINK_STATUS, &Result);
+	int InfoLogLength = 0;
+	glGetProgramiv(Program.ProgramId, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0) {
+		std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
+		glGetProgramInfoLog(Program.ProgramId, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		printf("%s\n", &ProgramErrorMessage[0]);
+	}
+
+	if (Program.UseProgramCache && Result == GL_TRUE) {
+		SaveProgramBinary(Program.CacheKey, Program.ProgramId);
+	}
+
+	glDetachShader(Program.ProgramId, Program.VertexShaderId);
+	glDetachShader(Program.ProgramId, Program.FragmentShaderId);
+	glDeleteShader(Program.VertexShaderId);
+	glDeleteShader(Program.FragmentShaderId);
+	Program.VertexShaderId = 0;
+	Program.FragmentShaderId = 0;
+
+	if (Result != GL_TRUE) {
+		printf("Linking program %s + %s failed\n", Program.VertexPath.c_str(), Program.FragmentPath.c_str());
+		glDeleteProgram(Program.ProgramId);
+		FailProgram(Program);
+		return;
+	}
+
+	double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Program.SubmitTime).count();
+	printf("Compiled program %s + %s %.3f ms after submit (cold start)\n", Program.VertexPath.c_str(), Program.FragmentPath.c_str(), ElapsedMs);
+	Program.State = AsyncDone;
+	Program.Status = ShaderProgramReady;
+}
+
+static void AdvanceProgram(AsyncProgram& Program, bool Wait)
+{
+	if (Program.State == AsyncReading) {
+		if (!Wait && (Program.VertexFile.wait_for(std::chrono::seconds(0)) != std::future_status::ready
+			|| Program.FragmentFile.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+			return;
+		}
+		SubmitProgram(Program);
+	}
+
+	if (Program.State == AsyncLinking) {
+		// Without the extension any status query blocks, so there's no point in asking early
+		if (!Wait) {
+			if (!ParallelCompileSupported) {
+				return;
+			}
+			GLint Completed = GL_FALSE;
+			glGetProgramiv(Program.ProgramId, GL_COMPLETION_STATUS_KHR, &Completed);
+			if (Completed != GL_TRUE) {
+				return;
+			}
+		}
+		FinishProgram(Program);
+	}
+}
+
+static ShaderProgramHandle MakeProgramHandle(size_t index)
+{
+	return (AsyncPrograms[index].Generation << ASYNC_PROGRAM_INDEX_BITS) | (ShaderProgramHandle)(index + 1);
+}
+
+static AsyncProgram* FindProgram(ShaderProgramHandle handle)
+{
+	size_t Index = (size_t)(handle & ASYNC_PROGRAM_INDEX_MASK);
+	if (Index == 0 || Index > AsyncPrograms.size() || !AsyncPrograms[Index - 1].InUse
+		|| MakeProgramHandle(Index - 1) != handle) {
+		printf("Invalid shader program handle %u\n", handle);
+		return NULL;
+	}
+	return &AsyncPrograms[Index - 1];
+}
+
+// The program was handed over: drop the sources and the futures, and give the slot back
+static void FreeProgram(ShaderProgramHandle handle)
+{
+	size_t Index = (size_t)(handle & ASYNC_PROGRAM_INDEX_MASK) - 1;
+	unsigned int Generation = AsyncPrograms[Index].Generation;
+	AsyncPrograms[Index] = AsyncProgram();
+	AsyncPrograms[Index].InUse = false;
+	AsyncPrograms[Index].Generation = (Generation + 1) & (0xFFFFFFFFu >> ASYNC_PROGRAM_INDEX_BITS);
+	FreeAsyncPrograms.push_back(Index);
+}
+
+void LoadShadersAsync(const ShaderProgramSource* programs, int count, ShaderProgramHandle* handles)
+{
+	if (count <= 0) {
+		return;
+	}
+	EnableParallelShaderCompile();
+
+	std::shared_ptr<ShaderReadBatch> Batch = std::make_shared<ShaderReadBatch>();
+	Batch->Next = 0;
+	Batch->Paths.reserve(count * 2);
+	Batch->Results.resize(count * 2);
+	std::chrono::steady_clock::time_point SubmitTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++) {
+		size_t Index;
+		if (!FreeAsyncPrograms.empty()) {
+			Index = FreeAsyncPrograms.back();
+			FreeAsyncPrograms.pop_back();
+		}
+		else {
+			Index = AsyncPrograms.size();
+			AsyncPrograms.push_back(AsyncProgram());
+			AsyncPrograms[Index].Generation = 0;
+		}
+		AsyncProgram& Program = AsyncPrograms[Index];
+		Program.InUse = true;
+		Program.VertexPath = programs[i].VertexPath;
+		Program.FragmentPath = programs[i].FragmentPath;
+		Program.VertexFile = Batch->Results[i * 2].get_future();
+		Program.FragmentFile = Batch->Results[i * 2 + 1].get_future();
+		Program.State = AsyncReading;
+		Program.Status = ShaderProgramPending;
+		Program.VertexShaderId = 0;
+		Program.FragmentShaderId = 0;
+		Program.ProgramId = 0;
+		Program.UseProgramCache = false;
+		Program.CacheKey = 0;
+		Program.SubmitTime = SubmitTime;
+		Batch->Paths.push_back(Program.VertexPath);
+		Batch->Paths.push_back(Program.FragmentPath);
+		handles[i] = MakeProgramHandle(Index);
+	}
+
+	// Reading files is mostly waiting on the disk, a few threads are plenty
+	unsigned int ThreadCount = std::thread::hardware_concurrency();
+	if (ThreadCount == 0) {
+		ThreadCount = 4;
+	}
+	ThreadCount = std::min(ThreadCount, (unsigned int)Batch->Paths.size());
+	for (unsigned int i = 0; i < ThreadCount; i++) {
+		std::thread(ReadShaderFiles, Batch).detach();
+	}
+}
+
+ShaderProgramHandle LoadShadersAsync(const char* vertex_file_path, const char* fragment_file_path)
+{
+	ShaderProgramSource Source = { vertex_file_path, fragment_file_path };
+	ShaderProgramHandle Handle = 0;
+	LoadShadersAsync(&Source, 1, &Handle);
+	return Handle;
+}
+
+ShaderProgramStatus PollShaderProgram(ShaderProgramHandle handle)
+{
+	AsyncProgram* Program = FindProgram(handle);
+	if (Program == NULL) {
+		return ShaderProgramFailed;
+	}
+	AdvanceProgram(*Program, false);
+	return Program->Status;
+}
+
+int UpdateShaderPrograms()
+{
+	int Pending = 0;
+	for (size_t i = 0; i < AsyncPrograms.size(); i++) {
+		// Free slots and finished programs waiting to be collected have nothing left to do
+		if (!AsyncPrograms[i].InUse || AsyncPrograms[i].State == AsyncDone) {
+			continue;
+		}
+		AdvanceProgram(AsyncPrograms[i], false);
+		if (AsyncPrograms[i].Status == ShaderProgramPending) {
+			Pending++;
+		}
+	}
+	return Pending;
+}
+
+GLuint GetShaderProgram(ShaderProgramHandle handle)
+{
+	AsyncProgram* Program = FindProgram(handle);
+	if (Program == NULL) {
+		return 0;
+	}
+	AdvanceProgram(*Program, true);
+	GLuint ProgramId = Program->ProgramId;
+	FreeProgram(handle);
 	return ProgramId;
-}
\ No newline at end of file
+}
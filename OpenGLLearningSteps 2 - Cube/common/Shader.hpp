@@ -1,6 +1,56 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+// Folder (relative to the working directory) where linked program binaries are cached between runs.
+// Deleting it is always safe, the programs are just compiled from source again.
+#define SHADER_CACHE_DIR "shadercache"
+
+// Every file in shaders/ is embedded in the binary at build time (see tools/EmbedShaders.py).
+// Development builds still read the file first when it's there, so shaders can be edited without
+// rebuilding; release builds use the embedded copy and never touch the disk for it.
+#ifndef SHADER_FILE_OVERRIDE
+#ifdef NDEBUG
+#define SHADER_FILE_OVERRIDE 0
+#else
+#define SHADER_FILE_OVERRIDE 1
+#endif
+#endif
+
 GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path);
+// A program with a single compute shader (GL 4.3). Not cached, returns 0 if it doesn't compile or link.
+GLuint LoadComputeShader(const char* compute_file_path);
+
+// Asynchronous loading: submit many programs at once, and only wait for the ones actually needed.
+// The source files are read on worker threads, and the driver compiles in parallel when it supports
+// KHR_parallel_shader_compile. All the other calls must come from the thread that owns the context.
+
+// 0 is never a valid handle
+typedef unsigned int ShaderProgramHandle;
+
+struct ShaderProgramSource
+{
+	const char* VertexPath;
+	const char* FragmentPath;
+};
+
+enum ShaderProgramStatus
+{
+	ShaderProgramPending,
+	ShaderProgramReady,
+	ShaderProgramFailed
+};
+
+// Returns right away, handles[i] identifies programs[i]
+void LoadShadersAsync(const ShaderProgramSource* programs, int count, ShaderProgramHandle* handles);
+ShaderProgramHandle LoadShadersAsync(const char* vertex_file_path, const char* fragment_file_path);
+// Never blocks. Without parallel compile a program stays pending until GetShaderProgram() asks for it.
+ShaderProgramStatus PollShaderProgram(ShaderProgramHandle handle);
+// Moves every submitted program along (e.g. once per frame), returns how many are still pending
+int UpdateShaderPrograms();
+// Waits for the program if needed. Returns 0 if it failed, the logs were printed already.
+// This collects it: the program now belongs to the caller, and the handle is no longer valid.
+GLuint GetShaderProgram(ShaderProgramHandle handle);
+// True when PollShaderProgram() can tell a program finished linking without waiting for it
+bool ParallelShaderCompileAvailable();
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <map>
+#include <chrono>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#endif
+
+#include <GL/glew.h>
+
+#include "ShaderWatcher.hpp"
+
+// Every watched file, with the version of its last change. Versions come from one counter,
+// so a program is out of date as soon as one of its files has a version above SeenVersion.
+struct WatchedFile
+{
+	unsigned int Version;
+	long long ModifiedTime; // Only used when polling
+};
+
+static std::map<std::string, WatchedFile> WatchedFiles;
+static unsigned int LastVersion = 0;
+static bool WatcherRunning = false;
+
+#ifdef __linux__
+static int InotifyFd = -1;
+static int InotifyWatch = -1;
+#else
+// Polling the modification times every frame would be wasteful, a few times per second is plenty
+static const double PollIntervalMs = 250.0;
+static std::chrono::steady_clock::time_point LastPoll;
+#endif
+
+static const char* FileName(const std::string& path)
+{
+	size_t Slash = path.find_last_of("/\\");
+	return path.c_str() + (Slash == std::string::npos ? 0 : Slash + 1);
+}
+
+static void FileChanged(const char* name)
+{
+	for (std::map<std::string, WatchedFile>::iterator it = WatchedFiles.begin(); it != WatchedFiles.end(); ++it) {
+		if (strcmp(FileName(it->first), name) == 0) {
+			it->second.Version = ++LastVersion;
+			printf("Shader %s changed, reloading\n", it->first.c_str());
+		}
+	}
+}
+
+#ifndef __linux__
+static long long ModifiedTime(const std::string& path)
+{
+#ifdef _WIN32
+	struct _stat Info;
+	if (_stat(path.c_str(), &Info) != 0)
+		return 0;
+#else
+	struct stat Info;
+	if (stat(path.c_str(), &Info) != 0)
+		return 0;
+#endif
+	return (long long)Info.st_mtime;
+}
+#endif
+
+// Picks up what changed since the last call, without ever waiting
+static void PollShaderWatcher()
+{
+	if (!WatcherRunning) {
+		return;
+	}
+
+#ifdef __linux__
+	// Aligned, since the events are read in place
+	alignas(struct inotify_event) char Buffer[4096];
+	for (;;) {
+		ssize_t Length = read(InotifyFd, Buffer, sizeof(Buffer));
+		if (Length <= 0) {
+			if (Length < 0 && errno != EAGAIN && errno != EINTR) {
+				printf("Reading the shader watcher failed (%s), hot-reload stopped\n", strerror(errno));
+				StopShaderWatcher();
+			}
+			return;
+		}
+
+		for (char* Event = Buffer; Event < Buffer + Length; ) {
+			const struct inotify_event* Info = (const struct inotify_event*)Event;
+			if (Info->len > 0) {
+				FileChanged(Info->name);
+			}
+			Event += sizeof(struct inotify_event) + Info->len;
+		}
+	}
+#else
+	std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<double, std::milli>(Now - LastPoll).count() < PollIntervalMs) {
+		return;
+	}
+	LastPoll = Now;
+
+	for (std::map<std::string, WatchedFile>::iterator it = WatchedFiles.begin(); it != WatchedFiles.end(); ++it) {
+		long long Time = ModifiedTime(it->first);
+		if (Time != 0 && Time != it->second.ModifiedTime) {
+			it->second.ModifiedTime = Time;
+			FileChanged(FileName(it->first));
+		}
+	}
+#endif
+}
+
+bool StartShaderWatcher(const char* directory)
+{
+#if !SHADER_FILE_OVERRIDE
+	// Release builds use the embedded shaders, reloading would only bring the same sources back
+	printf("Shader hot-reload is only available in development builds\n");
+	(void)directory;
+	return false;
+#else
+	if (WatcherRunning) {
+		return true;
+	}
+
+#ifdef __linux__
+	InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (InotifyFd < 0) {
+		printf("inotify_init1 failed: %s\n", strerror(errno));
+		return false;
+	}
+	// The folder is watched rather than the files, because most editors save by writing
+	// a new file and renaming it over the old one. IN_CLOSE_WRITE means the file is complete.
+	InotifyWatch = inotify_add_watch(InotifyFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (InotifyWatch < 0) {
+		printf("Impossible to watch %s: %s\n", directory, strerror(errno));
+		close(InotifyFd);
+		InotifyFd = -1;
+		return false;
+	}
+#else
+	LastPoll = std::chrono::steady_clock::now();
+#endif
+
+	WatcherRunning = true;
+	printf("Watching %s for shader changes\n", directory);
+	return true;
+#endif
+}
+
+void StopShaderWatcher()
+{
+	if (!WatcherRunning) {
+		return;
+	}
+#ifdef __linux__
+	inotify_rm_watch(InotifyFd, InotifyWatch);
+	close(InotifyFd);
+	InotifyFd = -1;
+	InotifyWatch = -1;
+#endif
+	WatcherRunning = false;
+}
+
+static void WatchFile(const std::string& path)
+{
+	if (WatchedFiles.find(path) == WatchedFiles.end()) {
+		WatchedFile File;
+		File.Version = 0;
+#ifdef __linux__
+		File.ModifiedTime = 0;
+#else
+		File.ModifiedTime = ModifiedTime(path);
+#endif
+		WatchedFiles[path] = File;
+	}
+}
+
+static unsigned int ProgramVersion(const ReloadableProgram& program)
+{
+	unsigned int VertexVersion = WatchedFiles[program.VertexPath].Version;
+	unsigned int FragmentVersion = WatchedFiles[program.FragmentPath].Version;
+	return VertexVersion > FragmentVersion ? VertexVersion : FragmentVersion;
+}
+
+void WatchProgram(ReloadableProgram& program, const char* vertex_file_path, const char* fragment_file_path, GLuint programId)
+{
+	program.VertexPath = vertex_file_path;
+	program.FragmentPath = fragment_file_path;
+	program.Program = programId;
+	program.Handle = AdoptGpuProgram(programId, "hot-reloadable");
+	program.Pending = 0;
+	program.PendingFrames = 0;
+	program.Generation = 0;
+	WatchFile(program.VertexPath);
+	WatchFile(program.FragmentPath);
+	program.SeenVersion = ProgramVersion(program);
+}
+
+void ReleaseReloadableProgram(ReloadableProgram& program)
+{
+	ReleaseGpuResource(program.Handle);
+	program.Program = 0;
+}
+
+bool UpdateReloadableProgram(ReloadableProgram& program)
+{
+	PollShaderWatcher();
+
+	// Start a rebuild when a file changed. If it changes again meanwhile, the next one starts when this one is done.
+	if (program.Pending == 0) {
+		unsigned int Version = ProgramVersion(program);
+		if (Version == program.SeenVersion) {
+			return false;
+		}
+		program.SeenVersion = Version;
+		program.Pending = LoadShadersAsync(program.VertexPath.c_str(), program.FragmentPath.c_str());
+		program.PendingFrames = 0;
+		return false;
+	}
+
+	ShaderProgramStatus Status = PollShaderProgram(program.Pending);
+	program.PendingFrames++;
+	// Without parallel compile there's no way to ask without waiting. Most of these drivers compile
+	// inside glCompileShader/glLinkProgram anyway, so a frame later the answer is usually immediate.
+	if (Status == ShaderProgramPending && (ParallelShaderCompileAvailable() || program.PendingFrames <= 1)) {
+		return false;
+	}
+
+	// Collecting it frees the handle (and waits, in the case above)
+	GLuint NewProgram = GetShaderProgram(program.Pending);
+	program.Pending = 0;
+	if (NewProgram == 0) {
+		printf("Keeping the previous version of %s + %s\n", program.VertexPath.c_str(), program.FragmentPath.c_str());
+		return false;
+	}
+
+	// The frame in flight may still draw with the old one, the resource manager deletes it after its fence
+	ReleaseGpuResource(program.Handle);
+	program.Program = NewProgram;
+	program.Handle = AdoptGpuProgram(NewProgram, "hot-reloadable");
+	program.Generation++;
+	printf("Swapped in the new %s + %s\n", program.VertexPath.c_str(), program.FragmentPath.c_str());
+	return true;
+}
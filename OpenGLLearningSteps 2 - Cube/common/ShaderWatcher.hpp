@@ -0,0 +1,40 @@
+#ifndef SHADERWATCHER_HPP
+#define SHADERWATCHER_HPP
+
+#include <string>
+
+#include "Shader.hpp"
+#include "GpuResources.hpp"
+
+// Shader hot-reload. The watcher notices edited files in the shaders folder (inotify on Linux,
+// modification times everywhere else), and every ReloadableProgram that uses one of them is rebuilt
+// in the background with LoadShadersAsync(). The new program only replaces the old one at a frame
+// boundary, once it linked; if it doesn't compile, the old one keeps being used.
+// Only development builds (SHADER_FILE_OVERRIDE) read the files, so it's a no-op in release builds.
+
+struct ReloadableProgram
+{
+	std::string VertexPath;
+	std::string FragmentPath;
+	GLuint Program;					// Always the last program that linked, this is the one to draw with
+	GpuProgramHandle Handle;		// Program, owned by the resource manager
+	ShaderProgramHandle Pending;	// Rebuild in flight, 0 if none
+	int PendingFrames;				// Frames since the rebuild was submitted
+	unsigned int SeenVersion;		// Watcher version of the files when the last build was started
+	int Generation;					// Incremented on every swap, uniform locations must be looked up again
+};
+
+bool StartShaderWatcher(const char* directory);
+void StopShaderWatcher();
+
+// program is the already loaded version of the two files, it now belongs to the ReloadableProgram
+// (adopted by the resource manager)
+void WatchProgram(ReloadableProgram& program, const char* vertex_file_path, const char* fragment_file_path, GLuint programId);
+// Releases the current program, it's deleted once the GPU is done with it
+void ReleaseReloadableProgram(ReloadableProgram& program);
+
+// Call once per frame, before the program is used. Never waits for the compiler.
+// Returns true when program.Program was swapped (the old one is released, and deleted after the frame's fence).
+bool UpdateReloadableProgram(ReloadableProgram& program);
+
+#endif
@@ -0,0 +1,211 @@
+#include <GL/glew.h>
+
+#include "StateCache.hpp"
+#include "GlTrace.hpp"
+
+// A binding nobody could have, so the first call is never skipped
+static const GLuint UnknownBinding = 0xFFFFFFFFu;
+
+enum CachedBufferTarget
+{
+	CachedArrayBuffer,
+	CachedElementArrayBuffer,
+	CachedUniformBuffer,
+	CachedShaderStorageBuffer,
+	CachedDrawIndirectBuffer,
+	CachedPixelPackBuffer,
+	CachedCopyWriteBuffer,
+	NumCachedBufferTargets
+};
+
+struct BufferRange
+{
+	GLuint Buffer;
+	GLintptr Offset;
+	GLsizeiptr Size;
+};
+
+enum CachedCapability
+{
+	CachedDepthTest,
+	CachedCullFace,
+	CachedBlend,
+	NumCachedCapabilities
+};
+
+enum CapabilityState
+{
+	CapabilityUnknown,
+	CapabilityDisabled,
+	CapabilityEnabled
+};
+
+static GLuint CurrentProgram = UnknownBinding;
+static GLuint CurrentVertexArray = UnknownBinding;
+static GLuint CurrentBuffers[NumCachedBufferTargets] = { UnknownBinding, UnknownBinding, UnknownBinding, UnknownBinding, UnknownBinding, UnknownBinding, UnknownBinding };
+static BufferRange CurrentUniformRanges[STATE_CACHE_UNIFORM_BINDINGS] = {
+	{ UnknownBinding, 0, 0 }, { UnknownBinding, 0, 0 }, { UnknownBinding, 0, 0 }, { UnknownBinding, 0, 0 },
+	{ UnknownBinding, 0, 0 }, { UnknownBinding, 0, 0 }, { UnknownBinding, 0, 0 }, { UnknownBinding, 0, 0 }
+};
+static CapabilityState CurrentCapabilities[NumCachedCapabilities] = { CapabilityUnknown, CapabilityUnknown, CapabilityUnknown };
+
+static StateCacheCounters FrameCounters = { 0, 0 };
+static StateCacheCounters TotalCounters = { 0, 0 };
+
+static void CountIssued()
+{
+	FrameCounters.Issued++;
+	TotalCounters.Issued++;
+}
+
+static void CountElided()
+{
+	FrameCounters.Elided++;
+	TotalCounters.Elided++;
+}
+
+static int BufferTargetIndex(GLenum target)
+{
+	switch (target) {
+	case GL_ARRAY_BUFFER: return CachedArrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER: return CachedElementArrayBuffer;
+	case GL_UNIFORM_BUFFER: return CachedUniformBuffer;
+	case GL_SHADER_STORAGE_BUFFER: return CachedShaderStorageBuffer;
+	case GL_DRAW_INDIRECT_BUFFER: return CachedDrawIndirectBuffer;
+	case GL_PIXEL_PACK_BUFFER: return CachedPixelPackBuffer;
+	case GL_COPY_WRITE_BUFFER: return CachedCopyWriteBuffer;
+	default: return -1;
+	}
+}
+
+static int CapabilityIndex(GLenum capability)
+{
+	switch (capability) {
+	case GL_DEPTH_TEST: return CachedDepthTest;
+	case GL_CULL_FACE: return CachedCullFace;
+	case GL_BLEND: return CachedBlend;
+	default: return -1;
+	}
+}
+
+void StateCacheInvalidate()
+{
+	CurrentProgram = UnknownBinding;
+	CurrentVertexArray = UnknownBinding;
+	for (int i = 0; i < NumCachedBufferTargets; i++) {
+		CurrentBuffers[i] = UnknownBinding;
+	}
+	for (int i = 0; i < STATE_CACHE_UNIFORM_BINDINGS; i++) {
+		CurrentUniformRanges[i].Buffer = UnknownBinding;
+	}
+	for (int i = 0; i < NumCachedCapabilities; i++) {
+		CurrentCapabilities[i] = CapabilityUnknown;
+	}
+}
+
+void StateCacheBeginFrame()
+{
+	FrameCounters.Issued = 0;
+	FrameCounters.Elided = 0;
+}
+
+StateCacheCounters StateCacheFrameCounters()
+{
+	return FrameCounters;
+}
+
+StateCacheCounters StateCacheTotalCounters()
+{
+	return TotalCounters;
+}
+
+void CachedUseProgram(GLuint program)
+{
+	if (program == CurrentProgram) {
+		CountElided();
+		return;
+	}
+	glUseProgram(program);
+	CurrentProgram = program;
+	CountIssued();
+}
+
+void CachedBindVertexArray(GLuint vertexArray)
+{
+	if (vertexArray == CurrentVertexArray) {
+		CountElided();
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	CurrentVertexArray = vertexArray;
+	// The element array binding belongs to the VAO, so it changed with it
+	CurrentBuffers[CachedElementArrayBuffer] = UnknownBinding;
+	CountIssued();
+}
+
+void CachedBindBuffer(GLenum target, GLuint buffer)
+{
+	int Index = BufferTargetIndex(target);
+	if (Index >= 0 && CurrentBuffers[Index] == buffer) {
+		CountElided();
+		return;
+	}
+	glBindBuffer(target, buffer);
+	if (Index >= 0) {
+		CurrentBuffers[Index] = buffer;
+	}
+	CountIssued();
+}
+
+void CachedBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	bool Cached = target == GL_UNIFORM_BUFFER && index < STATE_CACHE_UNIFORM_BINDINGS;
+	if (Cached) {
+		const BufferRange& Current = CurrentUniformRanges[index];
+		if (Current.Buffer == buffer && Current.Offset == offset && Current.Size == size) {
+			CountElided();
+			return;
+		}
+	}
+	glBindBufferRange(target, index, buffer, offset, size);
+	if (Cached) {
+		BufferRange& Current = CurrentUniformRanges[index];
+		Current.Buffer = buffer;
+		Current.Offset = offset;
+		Current.Size = size;
+	}
+	// The generic binding point changed as well
+	int Index = BufferTargetIndex(target);
+	if (Index >= 0) {
+		CurrentBuffers[Index] = buffer;
+	}
+	CountIssued();
+}
+
+void CachedEnable(GLenum capability)
+{
+	int Index = CapabilityIndex(capability);
+	if (Index >= 0 && CurrentCapabilities[Index] == CapabilityEnabled) {
+		CountElided();
+		return;
+	}
+	glEnable(capability);
+	if (Index >= 0) {
+		CurrentCapabilities[Index] = CapabilityEnabled;
+	}
+	CountIssued();
+}
+
+void CachedDisable(GLenum capability)
+{
+	int Index = CapabilityIndex(capability);
+	if (Index >= 0 && CurrentCapabilities[Index] == CapabilityDisabled) {
+		CountElided();
+		return;
+	}
+	glDisable(capability);
+	if (Index >= 0) {
+		CurrentCapabilities[Index] = CapabilityDisabled;
+	}
+	CountIssued();
+}
@@ -0,0 +1,35 @@
+#ifndef STATECACHE_HPP
+#define STATECACHE_HPP
+
+// Thin layer over the GL calls that bind state. It remembers what is bound and skips
+// the calls that wouldn't change anything, counting both kinds so we can see how many
+// driver calls it saves. Everything that binds state in the render loop must go through it,
+// if some code calls GL directly, call StateCacheInvalidate() afterwards.
+
+struct StateCacheCounters
+{
+	unsigned long long Issued;	// Calls that reached the driver
+	unsigned long long Elided;	// Calls skipped because the state was already set
+};
+
+// Forgets everything, so the next call of each kind always reaches the driver
+void StateCacheInvalidate();
+
+// Starts a new frame for the per-frame counters
+void StateCacheBeginFrame();
+StateCacheCounters StateCacheFrameCounters();
+StateCacheCounters StateCacheTotalCounters();
+
+void CachedUseProgram(GLuint program);
+void CachedBindVertexArray(GLuint vertexArray);
+// GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, ... anything else is passed through
+void CachedBindBuffer(GLenum target, GLuint buffer);
+// Indexed GL_UNIFORM_BUFFER bindings below STATE_CACHE_UNIFORM_BINDINGS, anything else is passed through.
+// Like glBindBufferRange(), it binds the generic GL_UNIFORM_BUFFER target too.
+#define STATE_CACHE_UNIFORM_BINDINGS 8
+void CachedBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+// GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, ... anything else is passed through
+void CachedEnable(GLenum capability);
+void CachedDisable(GLenum capability);
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "StreamBuffer.hpp"
+#include "StateCache.hpp"
+#include "GlTrace.hpp"
+
+bool CreateStreamBuffer(StreamBuffer& stream, GLsizeiptr regionSize)
+{
+	memset(&stream, 0, sizeof(stream));
+
+	// Keep regions aligned for anything we could put at their start (a mat4 is 64 bytes)
+	stream.RegionSize = (regionSize + 255) & ~(GLsizeiptr)255;
+	stream.Region = STREAM_BUFFER_REGIONS - 1;
+	// The GL trace only sees what's written through a mapping when it's unmapped, so no persistent one while recording
+	stream.Persistent = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) && !GlTraceRecording();
+
+	GLsizeiptr TotalSize = stream.RegionSize * STREAM_BUFFER_REGIONS;
+	stream.Handle = CreateGpuBuffer("stream buffer");
+	stream.Buffer = GpuName(stream.Handle);
+	// The copy target is only used to create and map the buffer, so the vertex bindings aren't disturbed
+	CachedBindBuffer(GL_COPY_WRITE_BUFFER, stream.Buffer);
+
+	if (stream.Persistent) {
+		// Mapped once for the whole life of the buffer. Coherent means our writes are visible to
+		// the GPU without flushing, as long as they happen before the draw call is issued.
+		GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, TotalSize, NULL, Flags);
+		stream.Mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, TotalSize, Flags);
+		if (stream.Mapped == NULL) {
+			fprintf(stderr, "Failed to map the stream buffer persistently\n");
+			DestroyStreamBuffer(stream);
+			return false;
+		}
+	}
+	else {
+		printf("%s, the stream buffer maps each region unsynchronized instead\n", GlTraceRecording() ? "Recording a GL trace" : "No ARB_buffer_storage");
+		glBufferData(GL_COPY_WRITE_BUFFER, TotalSize, NULL, GL_STREAM_DRAW);
+	}
+	SetGpuBufferSize(stream.Handle, TotalSize);
+
+	return true;
+}
+
+void DestroyStreamBuffer(StreamBuffer& stream)
+{
+	for (int i = 0; i < STREAM_BUFFER_REGIONS; i++) {
+		if (stream.Fences[i] != 0) {
+			glDeleteSync(stream.Fences[i]);
+		}
+	}
+	if (stream.Buffer != 0) {
+		if (stream.Mapped != NULL) {
+			CachedBindBuffer(GL_COPY_WRITE_BUFFER, stream.Buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		ReleaseGpuResource(stream.Handle);
+	}
+	memset(&stream, 0, sizeof(stream));
+}
+
+void StreamBeginFrame(StreamBuffer& stream)
+{
+	stream.Region = (stream.Region + 1) % STREAM_BUFFER_REGIONS;
+	stream.Used = 0;
+	stream.LastWaitMs = 0.0;
+	stream.Frames++;
+
+	// The fence was placed right after the last draw reading this region, STREAM_BUFFER_REGIONS frames ago
+	GLsync& Fence = stream.Fences[stream.Region];
+	if (Fence != 0) {
+		// First a free check (flushing, so the fence is sure to be signaled eventually), then actual waiting
+		GLenum Result = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (Result == GL_TIMEOUT_EXPIRED) {
+			std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+			do {
+				Result = glClientWaitSync(Fence, 0, 1000000); // 1 ms, in nanoseconds
+			} while (Result == GL_TIMEOUT_EXPIRED);
+			stream.LastWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+			stream.TotalWaitMs += stream.LastWaitMs;
+			stream.Waits++;
+		}
+		glDeleteSync(Fence);
+		Fence = 0;
+	}
+
+	if (!stream.Persistent) {
+		// The fence already made sure the GPU is done with the region, so the driver doesn't need to check
+		CachedBindBuffer(GL_COPY_WRITE_BUFFER, stream.Buffer);
+		GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+		stream.Mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, stream.Region * stream.RegionSize, stream.RegionSize, Flags);
+	}
+}
+
+void* StreamAllocate(StreamBuffer& stream, GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset)
+{
+	GLsizeiptr Start = (stream.Used + alignment - 1) / alignment * alignment;
+	if (stream.Mapped == NULL || Start + size > stream.RegionSize) {
+		return NULL;
+	}
+	stream.Used = Start + size;
+
+	offset = stream.Region * stream.RegionSize + Start;
+	// Persistent: Mapped is the start of the buffer. Otherwise it's the start of the region.
+	return stream.Mapped + (stream.Persistent ? offset : Start);
+}
+
+void StreamFinishWrites(StreamBuffer& stream)
+{
+	if (!stream.Persistent && stream.Mapped != NULL) {
+		CachedBindBuffer(GL_COPY_WRITE_BUFFER, stream.Buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		stream.Mapped = NULL;
+	}
+}
+
+void StreamEndFrame(StreamBuffer& stream)
+{
+	stream.Fences[stream.Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
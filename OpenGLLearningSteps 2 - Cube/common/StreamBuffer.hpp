@@ -0,0 +1,50 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+// Buffer for data that changes every frame (instance matrices, dynamic geometry...).
+// It is split in STREAM_BUFFER_REGIONS regions, one per frame in flight: the CPU writes into one region
+// while the GPU still reads the previous ones, and a fence per region tells when it can be reused.
+// With GL 4.4 / ARB_buffer_storage the buffer is mapped once, persistent and coherent, and the CPU writes
+// straight into it. Without it, each region is mapped unsynchronized at the start of the frame instead.
+// Either way the driver never has to synchronize behind our back like it does for glBufferData/glBufferSubData.
+
+#include "GpuResources.hpp"
+
+#define STREAM_BUFFER_REGIONS 3
+
+struct StreamBuffer
+{
+	GpuBufferHandle Handle;
+	GLuint Buffer;				// GL name of Handle
+	GLsizeiptr RegionSize;
+	bool Persistent;
+	unsigned char* Mapped;		// Whole buffer when persistent, only the current region otherwise
+	int Region;					// Region of the current frame
+	GLsizeiptr Used;			// Bytes allocated in the current region
+	GLsync Fences[STREAM_BUFFER_REGIONS];
+
+	// How long the CPU waited for the GPU to release regions
+	double LastWaitMs;
+	double TotalWaitMs;
+	unsigned long long Waits;	// Frames that had to wait at all
+	unsigned long long Frames;
+};
+
+// regionSize is the most that can be allocated in one frame
+bool CreateStreamBuffer(StreamBuffer& stream, GLsizeiptr regionSize);
+void DestroyStreamBuffer(StreamBuffer& stream);
+
+// Moves to the next region, waiting for the GPU if it's still reading it
+void StreamBeginFrame(StreamBuffer& stream);
+
+// Returns where to write size bytes in the current region, and their offset in the buffer.
+// NULL if the region is full.
+void* StreamAllocate(StreamBuffer& stream, GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+
+// Call after writing and before drawing from the region (it unmaps it when not persistent)
+void StreamFinishWrites(StreamBuffer& stream);
+
+// Call after the draws that read the region were issued, it fences the region
+void StreamEndFrame(StreamBuffer& stream);
+
+#endif
@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "TransformBatch.hpp"
+
+// MSVC lets any function use AVX2 intrinsics, GCC and Clang have to be told which ones may
+#if defined(TRANSFORM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// Number of arrays in a batch, they all share one allocation
+#define TRANSFORM_BATCH_ARRAYS 8
+
+static float* AllocateAligned(size_t count)
+{
+#ifdef _MSC_VER
+	return (float*)_aligned_malloc(count * sizeof(float), 32);
+#else
+	void* Memory = NULL;
+	if (posix_memalign(&Memory, 32, count * sizeof(float)) != 0) {
+		return NULL;
+	}
+	return (float*)Memory;
+#endif
+}
+
+static void FreeAligned(float* memory)
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+bool CreateTransformBatch(TransformBatch& batch, size_t count)
+{
+	// Padding to 8 objects keeps every array 32-byte aligned, since they are laid out one after the other
+	size_t Capacity = (count + 7) & ~(size_t)7;
+	float* Memory = AllocateAligned(Capacity * TRANSFORM_BATCH_ARRAYS);
+	if (Memory == NULL) {
+		fprintf(stderr, "Couldn't allocate the transforms of %zu objects\n", count);
+		memset(&batch, 0, sizeof(batch));
+		return false;
+	}
+
+	batch.Count = count;
+	batch.Capacity = Capacity;
+	batch.PositionX = Memory;
+	batch.PositionY = Memory + Capacity;
+	batch.PositionZ = Memory + Capacity * 2;
+	batch.RotationX = Memory + Capacity * 3;
+	batch.RotationY = Memory + Capacity * 4;
+	batch.RotationZ = Memory + Capacity * 5;
+	batch.RotationW = Memory + Capacity * 6;
+	batch.Scale = Memory + Capacity * 7;
+
+	for (size_t i = 0; i < Capacity; i++) {
+		batch.PositionX[i] = batch.PositionY[i] = batch.PositionZ[i] = 0.0f;
+		batch.RotationX[i] = batch.RotationY[i] = batch.RotationZ[i] = 0.0f;
+		batch.RotationW[i] = 1.0f;
+		batch.Scale[i] = 1.0f;
+	}
+	return true;
+}
+
+void DestroyTransformBatch(TransformBatch& batch)
+{
+	// PositionX is the start of the allocation
+	FreeAligned(batch.PositionX);
+	memset(&batch, 0, sizeof(batch));
+}
+
+TransformBatch SliceTransformBatch(const TransformBatch& batch, size_t first, size_t count)
+{
+	TransformBatch Slice = batch;
+	Slice.Count = count;
+	Slice.Capacity = count;
+	Slice.PositionX += first;
+	Slice.PositionY += first;
+	Slice.PositionZ += first;
+	Slice.RotationX += first;
+	Slice.RotationY += first;
+	Slice.RotationZ += first;
+	Slice.RotationW += first;
+	Slice.Scale += first;
+	return Slice;
+}
+
+static bool CpuSupportsAVX2()
+{
+#if !defined(TRANSFORM_X86)
+	return false;
+#elif defined(_MSC_VER)
+	int Info[4];
+	__cpuid(Info, 0);
+	if (Info[0] < 7) {
+		return false;
+	}
+	// The OS has to save the YMM registers too (OSXSAVE set and XCR0 bits 1 and 2)
+	__cpuid(Info, 1);
+	bool OsSavesYmm = (Info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(Info, 7, 0);
+	return OsSavesYmm && (Info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+TransformKernel BestTransformKernel()
+{
+	static int Best = -1;
+	if (Best < 0) {
+#ifdef TRANSFORM_X86
+		// SSE2 is always there on x64, and every x86 CPU that can run OpenGL 3.3 has it
+		Best = CpuSupportsAVX2() ? TransformKernelAVX2 : TransformKernelSSE;
+#else
+		Best = TransformKernelScalar;
+#endif
+	}
+	return (TransformKernel)Best;
+}
+
+const char* TransformKernelName(TransformKernel kernel)
+{
+	switch (kernel) {
+	case TransformKernelScalar: return "scalar";
+	case TransformKernelSSE: return "sse";
+	case TransformKernelAVX2: return "avx2";
+	default: return TransformKernelName(BestTransformKernel());
+	}
+}
+
+// Reference version, one object at a time. The SIMD kernels compute exactly the same thing, lane by lane.
+static void ComputeTransformsScalar(const TransformBatch& batch, size_t first, const float* vp, float* models, float* mvps)
+{
+	for (size_t i = first; i < batch.Count; i++) {
+		float x = batch.RotationX[i], y = batch.RotationY[i], z = batch.RotationZ[i], w = batch.RotationW[i];
+		float s = batch.Scale[i];
+
+		// Rotation matrix of the quaternion, columns scaled by s, then the translation as the 4th column
+		float m[16];
+		m[0] = (1.0f - 2.0f * (y * y + z * z)) * s;
+		m[1] = 2.0f * (x * y + w * z) * s;
+		m[2] = 2.0f * (x * z - w * y) * s;
+		m[3] = 0.0f;
+		m[4] = 2.0f * (x * y - w * z) * s;
+		m[5] = (1.0f - 2.0f * (x * x + z * z)) * s;
+		m[6] = 2.0f * (y * z + w * x) * s;
+		m[7] = 0.0f;
+		m[8] = 2.0f * (x * z + w * y) * s;
+		m[9] = 2.0f * (y * z - w * x) * s;
+		m[10] = (1.0f - 2.0f * (x * x + y * y)) * s;
+		m[11] = 0.0f;
+		m[12] = batch.PositionX[i];
+		m[13] = batch.PositionY[i];
+		m[14] = batch.PositionZ[i];
+		m[15] = 1.0f;
+
+		if (models != NULL) {
+			memcpy(models + i * 16, m, sizeof(m));
+		}
+		if (mvps != NULL) {
+			float* Out = mvps + i * 16;
+			for (int c = 0; c < 4; c++) {
+				for (int r = 0; r < 4; r++) {
+					Out[c * 4 + r] = vp[r] * m[c * 4] + vp[4 + r] * m[c * 4 + 1] + vp[8 + r] * m[c * 4 + 2] + vp[12 + r] * m[c * 4 + 3];
+				}
+			}
+		}
+	}
+}
+
+#ifdef TRANSFORM_X86
+
+// Takes one column (4 rows, each holding that row for 4 objects) and writes it to the 4 objects' matrices
+static inline void StoreColumnSSE(float* out, size_t first, int column, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+{
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(out + (first + 0) * 16 + column * 4, r0);
+	_mm_storeu_ps(out + (first + 1) * 16 + column * 4, r1);
+	_mm_storeu_ps(out + (first + 2) * 16 + column * 4, r2);
+	_mm_storeu_ps(out + (first + 3) * 16 + column * 4, r3);
+}
+
+// 4 objects per iteration, returns the first object it didn't handle
+static size_t ComputeTransformsSSE(const TransformBatch& batch, const float* vp, float* models, float* mvps)
+{
+	__m128 VP[16];
+	for (int i = 0; i < 16; i++) {
+		VP[i] = _mm_set1_ps(vp[i]);
+	}
+	const __m128 One = _mm_set1_ps(1.0f);
+	const __m128 Two = _mm_set1_ps(2.0f);
+	const __m128 Zero = _mm_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 4 <= batch.Count; i += 4) {
+		__m128 x = _mm_load_ps(batch.RotationX + i);
+		__m128 y = _mm_load_ps(batch.RotationY + i);
+		__m128 z = _mm_load_ps(batch.RotationZ + i);
+		__m128 w = _mm_load_ps(batch.RotationW + i);
+		__m128 s = _mm_load_ps(batch.Scale + i);
+		__m128 px = _mm_load_ps(batch.PositionX + i);
+		__m128 py = _mm_load_ps(batch.PositionY + i);
+		__m128 pz = _mm_load_ps(batch.PositionZ + i);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+		__m128 s2 = _mm_mul_ps(Two, s);
+
+		// M[column][row], the last row of the first 3 columns is 0 and the 4th column is the translation
+		__m128 M00 = _mm_mul_ps(_mm_sub_ps(One, _mm_mul_ps(Two, _mm_add_ps(yy, zz))), s);
+		__m128 M01 = _mm_mul_ps(_mm_add_ps(xy, wz), s2);
+		__m128 M02 = _mm_mul_ps(_mm_sub_ps(xz, wy), s2);
+		__m128 M10 = _mm_mul_ps(_mm_sub_ps(xy, wz), s2);
+		__m128 M11 = _mm_mul_ps(_mm_sub_ps(One, _mm_mul_ps(Two, _mm_add_ps(xx, zz))), s);
+		__m128 M12 = _mm_mul_ps(_mm_add_ps(yz, wx), s2);
+		__m128 M20 = _mm_mul_ps(_mm_add_ps(xz, wy), s2);
+		__m128 M21 = _mm_mul_ps(_mm_sub_ps(yz, wx), s2);
+		__m128 M22 = _mm_mul_ps(_mm_sub_ps(One, _mm_mul_ps(Two, _mm_add_ps(xx, yy))), s);
+
+		if (models != NULL) {
+			StoreColumnSSE(models, i, 0, M00, M01, M02, Zero);
+			StoreColumnSSE(models, i, 1, M10, M11, M12, Zero);
+			StoreColumnSSE(models, i, 2, M20, M21, M22, Zero);
+			StoreColumnSSE(models, i, 3, px, py, pz, One);
+		}
+
+		if (mvps != NULL) {
+			__m128 Rows[4];
+			const __m128* Columns[3][3] = { { &M00, &M01, &M02 }, { &M10, &M11, &M12 }, { &M20, &M21, &M22 } };
+			for (int c = 0; c < 3; c++) {
+				for (int r = 0; r < 4; r++) {
+					Rows[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(VP[r], *Columns[c][0]), _mm_mul_ps(VP[4 + r], *Columns[c][1])), _mm_mul_ps(VP[8 + r], *Columns[c][2]));
+				}
+				StoreColumnSSE(mvps, i, c, Rows[0], Rows[1], Rows[2], Rows[3]);
+			}
+			for (int r = 0; r < 4; r++) {
+				Rows[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(VP[r], px), _mm_mul_ps(VP[4 + r], py)), _mm_add_ps(_mm_mul_ps(VP[8 + r], pz), VP[12 + r]));
+			}
+			StoreColumnSSE(mvps, i, 3, Rows[0], Rows[1], Rows[2], Rows[3]);
+		}
+	}
+	return i;
+}
+
+// Same as StoreColumnSSE for 8 objects: the transpose happens inside each 128-bit half,
+// the low half holds objects 0-3 and the high half objects 4-7
+TARGET_AVX2 static inline void StoreColumnAVX2(float* out, size_t first, int column, __m256 r0, __m256 r1, __m256 r2, __m256 r3)
+{
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+	__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+	__m256 o0 = _mm256_shuffle_ps(t0, t2, 0x44);
+	__m256 o1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+	__m256 o2 = _mm256_shuffle_ps(t1, t3, 0x44);
+	__m256 o3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+	float* Out = out + first * 16 + column * 4;
+	_mm_storeu_ps(Out + 0 * 16, _mm256_castps256_ps128(o0));
+	_mm_storeu_ps(Out + 1 * 16, _mm256_castps256_ps128(o1));
+	_mm_storeu_ps(Out + 2 * 16, _mm256_castps256_ps128(o2));
+	_mm_storeu_ps(Out + 3 * 16, _mm256_castps256_ps128(o3));
+	_mm_storeu_ps(Out + 4 * 16, _mm256_extractf128_ps(o0, 1));
+	_mm_storeu_ps(Out + 5 * 16, _mm256_extractf128_ps(o1, 1));
+	_mm_storeu_ps(Out + 6 * 16, _mm256_extractf128_ps(o2, 1));
+	_mm_storeu_ps(Out + 7 * 16, _mm256_extractf128_ps(o3, 1));
+}
+
+// 8 objects per iteration, returns the first object it didn't handle
+TARGET_AVX2 static size_t ComputeTransformsAVX2(const TransformBatch& batch, const float* vp, float* models, float* mvps)
+{
+	__m256 VP[16];
+	for (int i = 0; i < 16; i++) {
+		VP[i] = _mm256_set1_ps(vp[i]);
+	}
+	const __m256 One = _mm256_set1_ps(1.0f);
+	const __m256 Two = _mm256_set1_ps(2.0f);
+	const __m256 Zero = _mm256_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 8 <= batch.Count; i += 8) {
+		__m256 x = _mm256_load_ps(batch.RotationX + i);
+		__m256 y = _mm256_load_ps(batch.RotationY + i);
+		__m256 z = _mm256_load_ps(batch.RotationZ + i);
+		__m256 w = _mm256_load_ps(batch.RotationW + i);
+		__m256 s = _mm256_load_ps(batch.Scale + i);
+		__m256 px = _mm256_load_ps(batch.PositionX + i);
+		__m256 py = _mm256_load_ps(batch.PositionY + i);
+		__m256 pz = _mm256_load_ps(batch.PositionZ + i);
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+		__m256 s2 = _mm256_mul_ps(Two, s);
+
+		__m256 M00 = _mm256_mul_ps(_mm256_sub_ps(One, _mm256_mul_ps(Two, _mm256_add_ps(yy, zz))), s);
+		__m256 M01 = _mm256_mul_ps(_mm256_add_ps(xy, wz), s2);
+		__m256 M02 = _mm256_mul_ps(_mm256_sub_ps(xz, wy), s2);
+		__m256 M10 = _mm256_mul_ps(_mm256_sub_ps(xy, wz), s2);
+		__m256 M11 = _mm256_mul_ps(_mm256_sub_ps(One, _mm256_mul_ps(Two, _mm256_add_ps(xx, zz))), s);
+		__m256 M12 = _mm256_mul_ps(_mm256_add_ps(yz, wx), s2);
+		__m256 M20 = _mm256_mul_ps(_mm256_add_ps(xz, wy), s2);
+		__m256 M21 = _mm256_mul_ps(_mm256_sub_ps(yz, wx), s2);
+		__m256 M22 = _mm256_mul_ps(_mm256_sub_ps(One, _mm256_mul_ps(Two, _mm256_add_ps(xx, yy))), s);
+
+		if (models != NULL) {
+			StoreColumnAVX2(models, i, 0, M00, M01, M02, Zero);
+			StoreColumnAVX2(models, i, 1, M10, M11, M12, Zero);
+			StoreColumnAVX2(models, i, 2, M20, M21, M22, Zero);
+			StoreColumnAVX2(models, i, 3, px, py, pz, One);
+		}
+
+		if (mvps != NULL) {
+			__m256 Rows[4];
+			const __m256* Columns[3][3] = { { &M00, &M01, &M02 }, { &M10, &M11, &M12 }, { &M20, &M21, &M22 } };
+			for (int c = 0; c < 3; c++) {
+				for (int r = 0; r < 4; r++) {
+					Rows[r] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(VP[r], *Columns[c][0]), _mm256_mul_ps(VP[4 + r], *Columns[c][1])), _mm256_mul_ps(VP[8 + r], *Columns[c][2]));
+				}
+				StoreColumnAVX2(mvps, i, c, Rows[0], Rows[1], Rows[2], Rows[3]);
+			}
+			for (int r = 0; r < 4; r++) {
+				Rows[r] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(VP[r], px), _mm256_mul_ps(VP[4 + r], py)), _mm256_add_ps(_mm256_mul_ps(VP[8 + r], pz), VP[12 + r]));
+			}
+			StoreColumnAVX2(mvps, i, 3, Rows[0], Rows[1], Rows[2], Rows[3]);
+		}
+	}
+	return i;
+}
+
+#endif
+
+void ComputeTransforms(const TransformBatch& batch, const float* viewProjection, float* models, float* mvps, TransformKernel kernel)
+{
+	if (kernel == TransformKernelBest) {
+		kernel = BestTransformKernel();
+	}
+
+	// The SIMD kernels do as many whole registers as they can, the scalar one finishes the rest
+	size_t Done = 0;
+#ifdef TRANSFORM_X86
+	if (kernel == TransformKernelAVX2) {
+		Done = ComputeTransformsAVX2(batch, viewProjection, models, mvps);
+	}
+	else if (kernel == TransformKernelSSE) {
+		Done = ComputeTransformsSSE(batch, viewProjection, models, mvps);
+	}
+#endif
+	ComputeTransformsScalar(batch, Done, viewProjection, models, mvps);
+}
+
+// Best of a few runs, in nanoseconds per object. The best run is the one with the least noise from the rest of the system.
+template <typename Function>
+static double TimePerObject(Function function, size_t count, int iterations)
+{
+	double Best = 1e30;
+	for (int i = 0; i < iterations; i++) {
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		function();
+		double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+		Best = std::min(Best, Ns / count);
+	}
+	return Best;
+}
+
+static float MaxDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+	float Max = 0.0f;
+	for (size_t i = 0; i < a.size(); i++) {
+		Max = std::max(Max, fabsf(a[i] - b[i]));
+	}
+	return Max;
+}
+
+void RunTransformBenchmark(size_t count, int iterations)
+{
+	TransformBatch Batch;
+	if (!CreateTransformBatch(Batch, count)) {
+		return;
+	}
+
+	// Random positions, rotations and scales. Same seed every time, so runs can be compared.
+	srand(1234);
+	for (size_t i = 0; i < count; i++) {
+		Batch.PositionX[i] = (rand() / (float)RAND_MAX - 0.5f) * 100.0f;
+		Batch.PositionY[i] = (rand() / (float)RAND_MAX - 0.5f) * 100.0f;
+		Batch.PositionZ[i] = (rand() / (float)RAND_MAX - 0.5f) * 100.0f;
+		glm::vec3 Axis = glm::normalize(glm::vec3(rand() / (float)RAND_MAX + 0.01f, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX));
+		glm::quat Rotation = glm::angleAxis(rand() / (float)RAND_MAX * 6.28318f, Axis);
+		Batch.RotationX[i] = Rotation.x;
+		Batch.RotationY[i] = Rotation.y;
+		Batch.RotationZ[i] = Rotation.z;
+		Batch.RotationW[i] = Rotation.w;
+		Batch.Scale[i] = 0.5f + rand() / (float)RAND_MAX;
+	}
+
+	glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	glm::mat4 View = glm::lookAt(glm::vec3(4, 3, 3), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+	glm::mat4 VP = Projection * View;
+
+	// What main.cpp does today, once per object
+	std::vector<glm::mat4> NaiveModels(count), NaiveMVPs(count);
+	double NaiveNs = TimePerObject([&]() {
+		for (size_t i = 0; i < count; i++) {
+			glm::quat Rotation(Batch.RotationW[i], Batch.RotationX[i], Batch.RotationY[i], Batch.RotationZ[i]);
+			glm::mat4 Model = glm::translate(glm::mat4(1.0f), glm::vec3(Batch.PositionX[i], Batch.PositionY[i], Batch.PositionZ[i]))
+				* glm::mat4_cast(Rotation)
+				* glm::scale(glm::mat4(1.0f), glm::vec3(Batch.Scale[i]));
+			NaiveModels[i] = Model;
+			NaiveMVPs[i] = VP * Model;
+		}
+	}, count, iterations);
+
+	std::vector<float> Reference(count * 16), Models(count * 16), MVPs(count * 16);
+	for (size_t i = 0; i < count; i++) {
+		memcpy(&Reference[i * 16], &NaiveMVPs[i][0][0], 16 * sizeof(float));
+	}
+
+	printf("{\n  \"objects\": %d,\n  \"naive_glm_ns_per_object\": %.3f,\n  \"kernels\": [\n", (int)count, NaiveNs);
+	TransformKernel Kernels[3] = { TransformKernelScalar, TransformKernelSSE, TransformKernelAVX2 };
+	bool First = true;
+	for (int k = 0; k < 3; k++) {
+		TransformKernel Kernel = Kernels[k];
+		if (Kernel > BestTransformKernel()) {
+			continue;
+		}
+		double Ns = TimePerObject([&]() {
+			ComputeTransforms(Batch, &VP[0][0], &Models[0], &MVPs[0], Kernel);
+		}, count, iterations);
+		printf("%s    { \"kernel\": \"%s\", \"ns_per_object\": %.3f, \"speedup_vs_glm\": %.2f, \"max_abs_error\": %g }",
+			First ? "" : ",\n", TransformKernelName(Kernel), Ns, NaiveNs / Ns, MaxDifference(MVPs, Reference));
+		First = false;
+	}
+	printf("\n  ],\n  \"best_kernel\": \"%s\"\n}\n", TransformKernelName(BestTransformKernel()));
+
+	DestroyTransformBatch(Batch);
+}
@@ -0,0 +1,55 @@
+#ifndef TRANSFORMBATCH_HPP
+#define TRANSFORMBATCH_HPP
+
+#include <stddef.h>
+
+// Object transforms stored as a structure of arrays: all the X positions together, then all the Y, etc.
+// That way 4 (SSE) or 8 (AVX2) objects fit in one register and get their matrices computed together.
+// The arrays of a batch are padded to a multiple of 8 objects, so they all start 32-byte aligned in the one
+// allocation. The SIMD kernels still finish the last Count % 4 (or % 8) objects with scalar code: a slice
+// isn't padded.
+struct TransformBatch
+{
+	size_t Count;
+	size_t Capacity;
+	float* PositionX;
+	float* PositionY;
+	float* PositionZ;
+	float* RotationX;	// Rotation as a unit quaternion
+	float* RotationY;
+	float* RotationZ;
+	float* RotationW;
+	float* Scale;		// Uniform scale
+};
+
+enum TransformKernel
+{
+	TransformKernelScalar,	// Reference implementation, plain C++
+	TransformKernelSSE,
+	TransformKernelAVX2,
+	TransformKernelBest		// Whatever the CPU running this supports
+};
+
+// Allocates room for count objects, all of them at the origin with no rotation and a scale of 1.
+// Returns false (and an empty batch) if the memory can't be allocated.
+bool CreateTransformBatch(TransformBatch& batch, size_t count);
+void DestroyTransformBatch(TransformBatch& batch);
+
+// The count objects of batch starting at first, sharing its memory (there's nothing to destroy).
+// first must be a multiple of 8, the SIMD kernels rely on the arrays being aligned. The slice's Capacity is
+// count, it has no padding of its own.
+TransformBatch SliceTransformBatch(const TransformBatch& batch, size_t first, size_t count);
+
+// Fastest kernel the CPU supports (checked once, at runtime)
+TransformKernel BestTransformKernel();
+const char* TransformKernelName(TransformKernel kernel);
+
+// Computes Model = Translate * Rotate * Scale and MVP = viewProjection * Model for every object.
+// Both outputs are arrays of column-major 4x4 matrices (16 floats per object, glm::mat4 layout),
+// either of them can be NULL if it's not needed.
+void ComputeTransforms(const TransformBatch& batch, const float* viewProjection, float* models, float* mvps, TransformKernel kernel = TransformKernelBest);
+
+// Times the scalar, SSE and AVX2 kernels against naive per-object glm on count objects and prints the results
+void RunTransformBenchmark(size_t count, int iterations);
+
+#endif
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "UniformBlocks.hpp"
+#include "StateCache.hpp"
+
+// std140 offsets, as the GLSL side sees them. If one of these fails, the struct no longer matches the block.
+static_assert(offsetof(FrameUniforms, Projection) == 0, "std140: FrameUniforms.Projection");
+static_assert(offsetof(FrameUniforms, View) == 64, "std140: FrameUniforms.View");
+static_assert(offsetof(FrameUniforms, ViewProjection) == 128, "std140: FrameUniforms.ViewProjection");
+static_assert(offsetof(FrameUniforms, CameraPosition) == 192, "std140: FrameUniforms.CameraPosition");
+static_assert(offsetof(FrameUniforms, Time) == 204, "std140: FrameUniforms.Time");
+static_assert(offsetof(FrameUniforms, FrustumPlanes) == 208, "std140: FrameUniforms.FrustumPlanes");
+static_assert(sizeof(FrameUniforms) == 304, "std140: FrameUniforms size");
+
+static_assert(offsetof(ObjectUniforms, Model) == 0, "std140: ObjectUniforms.Model");
+static_assert(offsetof(ObjectUniforms, ModelViewProjection) == 64, "std140: ObjectUniforms.ModelViewProjection");
+static_assert(offsetof(ObjectUniforms, PositionScale) == 128, "std140: ObjectUniforms.PositionScale");
+static_assert(offsetof(ObjectUniforms, PositionBias) == 144, "std140: ObjectUniforms.PositionBias");
+static_assert(sizeof(ObjectUniforms) == 160, "std140: ObjectUniforms size");
+
+static GLsizeiptr AlignUp(GLsizeiptr value, GLsizeiptr alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool CreateUniformRing(UniformRing& ring, int maxObjects)
+{
+	memset(&ring, 0, sizeof(ring));
+
+	// Usually 256 on desktop GPUs, and never more: the stream buffer regions are 256-byte aligned too
+	GLint Alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
+	ring.Alignment = Alignment > 0 ? Alignment : 256;
+	ring.MaxObjects = maxObjects;
+
+	GLsizeiptr RegionSize = AlignUp(sizeof(FrameUniforms), ring.Alignment) + maxObjects * AlignUp(sizeof(ObjectUniforms), ring.Alignment);
+	return CreateStreamBuffer(ring.Stream, RegionSize);
+}
+
+void DestroyUniformRing(UniformRing& ring)
+{
+	DestroyStreamBuffer(ring.Stream);
+	memset(&ring, 0, sizeof(ring));
+}
+
+void BindUniformBlocks(GLuint program)
+{
+	GLuint FrameIndex = glGetUniformBlockIndex(program, "FrameUniforms");
+	if (FrameIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, FrameIndex, FRAME_UNIFORMS_BINDING);
+	}
+	GLuint ObjectIndex = glGetUniformBlockIndex(program, "ObjectUniforms");
+	if (ObjectIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, ObjectIndex, OBJECT_UNIFORMS_BINDING);
+	}
+}
+
+FrameUniforms* UniformRingBeginFrame(UniformRing& ring)
+{
+	StreamBeginFrame(ring.Stream);
+	ring.BlocksWritten++;
+	return (FrameUniforms*)StreamAllocate(ring.Stream, sizeof(FrameUniforms), ring.Alignment, ring.FrameOffset);
+}
+
+ObjectUniforms* AllocateObjectUniforms(UniformRing& ring, GLintptr& offset)
+{
+	ObjectUniforms* Block = (ObjectUniforms*)StreamAllocate(ring.Stream, sizeof(ObjectUniforms), ring.Alignment, offset);
+	if (Block != NULL) {
+		ring.BlocksWritten++;
+	}
+	return Block;
+}
+
+unsigned char* AllocateObjectUniformsArray(UniformRing& ring, int count, GLintptr& offset, GLsizeiptr& stride)
+{
+	stride = AlignUp(sizeof(ObjectUniforms), ring.Alignment);
+	return (unsigned char*)StreamAllocate(ring.Stream, count * stride, ring.Alignment, offset);
+}
+
+void UniformRingFinishWrites(UniformRing& ring)
+{
+	StreamFinishWrites(ring.Stream);
+	CachedBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, ring.Stream.Buffer, ring.FrameOffset, sizeof(FrameUniforms));
+}
+
+void BindObjectUniforms(UniformRing& ring, GLintptr offset)
+{
+	CachedBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, ring.Stream.Buffer, offset, sizeof(ObjectUniforms));
+}
+
+void UniformRingEndFrame(UniformRing& ring)
+{
+	StreamEndFrame(ring.Stream);
+}
@@ -0,0 +1,77 @@
+#ifndef UNIFORMBLOCKS_HPP
+#define UNIFORMBLOCKS_HPP
+
+#include "StreamBuffer.hpp"
+
+// Uniform blocks shared by the shaders, instead of one glUniform*() per value, per program, per draw.
+// The structs below mirror the GLSL blocks with the std140 layout (vec3 and vec4 take 16 bytes,
+// a mat4 is 4 vec4 columns), so they can be memcpy'd as they are. UniformBlocks.cpp checks the offsets.
+//
+//  - FrameUniforms: what every draw of the frame shares (camera), written once per frame,
+//    always bound at FRAME_UNIFORMS_BINDING
+//  - ObjectUniforms: what changes per draw (model matrix...), one block per object in the same buffer,
+//    each draw binds its own with glBindBufferRange() at OBJECT_UNIFORMS_BINDING
+//
+// GLSL 3.30 can't say "layout(binding = N)", so BindUniformBlocks() assigns the binding points after linking.
+
+#define FRAME_UNIFORMS_BINDING 0
+#define OBJECT_UNIFORMS_BINDING 1
+
+// layout(std140) uniform FrameUniforms
+struct FrameUniforms
+{
+	float Projection[16];
+	float View[16];
+	float ViewProjection[16];
+	float CameraPosition[3];
+	float Time;					// std140 packs a float right after a vec3
+	float FrustumPlanes[6][4];	// World space, xyz is the normal pointing inside, w the distance
+};
+
+// layout(std140) uniform ObjectUniforms
+struct ObjectUniforms
+{
+	float Model[16];
+	float ModelViewProjection[16];
+	float PositionScale[4];		// vec3, padded. See VertexQuantize.hpp
+	float PositionBias[4];		// vec3, padded
+};
+
+// All the blocks of a frame go into one stream buffer region, written with a single pass of memcpy's
+// into mapped memory, so there's no glBufferSubData() and no driver synchronization per block
+struct UniformRing
+{
+	StreamBuffer Stream;
+	GLsizeiptr Alignment;		// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, every block starts on it
+	int MaxObjects;				// Object blocks per frame
+	GLintptr FrameOffset;		// Where this frame's FrameUniforms is
+	unsigned long long BlocksWritten;
+};
+
+bool CreateUniformRing(UniformRing& ring, int maxObjects);
+void DestroyUniformRing(UniformRing& ring);
+
+// Points the FrameUniforms and ObjectUniforms blocks of the program (those it has) at their binding points.
+// Call it after every link: a program that was linked again lost them.
+void BindUniformBlocks(GLuint program);
+
+// Starts the frame and returns its FrameUniforms to fill in
+FrameUniforms* UniformRingBeginFrame(UniformRing& ring);
+
+// Sub-allocates one object block of this frame, offset is what BindObjectUniforms() needs. NULL when full.
+ObjectUniforms* AllocateObjectUniforms(UniformRing& ring, GLintptr& offset);
+
+// Sub-allocates count object blocks in a row, block i is at offset + i * stride (stride keeps them aligned).
+// They can be filled from any thread, in any order. BlocksWritten isn't counted, the caller knows how many it used.
+unsigned char* AllocateObjectUniformsArray(UniformRing& ring, int count, GLintptr& offset, GLsizeiptr& stride);
+
+// Call once every block of the frame was written: binds the frame block, it stays bound for the whole frame
+void UniformRingFinishWrites(UniformRing& ring);
+
+// Binds the object block at offset for the next draws
+void BindObjectUniforms(UniformRing& ring, GLintptr offset);
+
+// Call after the last draw of the frame
+void UniformRingEndFrame(UniformRing& ring);
+
+#endif
@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define QUANTIZE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#include "VertexQuantize.hpp"
+
+// Same as for AVX2 in TransformBatch.cpp: GCC and Clang have to be told a function may use F16C
+#if defined(QUANTIZE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_F16C __attribute__((target("f16c")))
+#else
+#define TARGET_F16C
+#endif
+
+bool ParsePositionEncoding(const char* name, PositionEncoding& encoding)
+{
+	if (strcmp(name, "float") == 0) {
+		encoding = PositionFloat;
+	}
+	else if (strcmp(name, "half") == 0) {
+		encoding = PositionHalf;
+	}
+	else if (strcmp(name, "snorm16") == 0) {
+		encoding = PositionSnorm16;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+const char* PositionEncodingName(PositionEncoding encoding)
+{
+	switch (encoding) {
+	case PositionHalf: return "half";
+	case PositionSnorm16: return "snorm16";
+	default: return "float";
+	}
+}
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t Bits;
+	memcpy(&Bits, &value, sizeof(Bits));
+	uint32_t Sign = (Bits >> 16) & 0x8000;
+	uint32_t Abs = Bits & 0x7FFFFFFF;
+
+	if (Abs > 0x7F800000) {
+		return (uint16_t)(Sign | 0x7E00); // NaN stays NaN
+	}
+	if (Abs >= 0x47800000) {
+		return (uint16_t)(Sign | 0x7C00); // Too big (or infinite), 65504 is the largest half
+	}
+	if (Abs < 0x38800000) {
+		// Below the smallest normal half: subnormal, in units of 2^-24. The multiplication is exact.
+		float Magnitude;
+		memcpy(&Magnitude, &Abs, sizeof(Magnitude));
+		return (uint16_t)(Sign | (uint32_t)lrintf(Magnitude * 16777216.0f));
+	}
+
+	// Rebias the exponent (127 -> 15) and drop 13 bits of mantissa, rounding to nearest even.
+	// A mantissa that rounds up carries into the exponent, which is exactly what should happen.
+	uint32_t Half = (Abs - 0x38000000) >> 13;
+	uint32_t Rest = Abs & 0x1FFF;
+	if (Rest > 0x1000 || (Rest == 0x1000 && (Half & 1))) {
+		Half++;
+	}
+	return (uint16_t)(Sign | Half);
+}
+
+float HalfToFloat(uint16_t value)
+{
+	uint32_t Sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t Exponent = (value >> 10) & 0x1F;
+	uint32_t Mantissa = value & 0x3FF;
+	uint32_t Bits;
+	if (Exponent == 0) {
+		float Subnormal = ldexpf((float)Mantissa, -24);
+		return Sign ? -Subnormal : Subnormal;
+	}
+	else if (Exponent == 31) {
+		Bits = Sign | 0x7F800000 | (Mantissa << 13);
+	}
+	else {
+		Bits = Sign | ((Exponent + 112) << 23) | (Mantissa << 13);
+	}
+	float Result;
+	memcpy(&Result, &Bits, sizeof(Result));
+	return Result;
+}
+
+void ComputePositionDequantize(const float boundsMin[3], const float boundsMax[3], PositionDequantize& dequantize)
+{
+	for (int Axis = 0; Axis < 3; Axis++) {
+		dequantize.Bias[Axis] = (boundsMin[Axis] + boundsMax[Axis]) * 0.5f;
+		float Scale = (boundsMax[Axis] - boundsMin[Axis]) * 0.5f;
+		// A flat mesh still needs a scale the encoder can divide by
+		dequantize.Scale[Axis] = Scale > 0.0f ? Scale : 1.0f;
+	}
+}
+
+static int16_t ToSnorm16(float value)
+{
+	value = value < -1.0f ? -1.0f : value > 1.0f ? 1.0f : value;
+	return (int16_t)lrintf(value * 32767.0f);
+}
+
+static float FromSnorm16(int16_t value)
+{
+	// GL 4.2+ rule: -32768 and -32767 are both -1
+	float Result = value / 32767.0f;
+	return Result < -1.0f ? -1.0f : Result;
+}
+
+static uint8_t ToUnorm8(float value)
+{
+	value = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+	return (uint8_t)lrintf(value * 255.0f);
+}
+
+// Reference versions, one vertex at a time. The SIMD ones give the exact same bits.
+static void QuantizeVerticesScalar(const MeshVertex* vertices, size_t count, PositionEncoding encoding,
+	const PositionDequantize& dequantize, PackedVertex* packed)
+{
+	for (size_t i = 0; i < count; i++) {
+		for (int Axis = 0; Axis < 3; Axis++) {
+			float Value = vertices[i].Position[Axis];
+			packed[i].Position[Axis] = encoding == PositionHalf
+				? FloatToHalf(Value)
+				: (uint16_t)ToSnorm16((Value - dequantize.Bias[Axis]) / dequantize.Scale[Axis]);
+			packed[i].Color[Axis] = ToUnorm8(vertices[i].Color[Axis]);
+		}
+		packed[i].Position[3] = 0;
+		packed[i].Color[3] = 255;
+	}
+}
+
+#ifdef QUANTIZE_X86
+// x, y, z, 0 of the position, and r, g, b, 1 of the color. Both loads stay inside the vertex.
+static inline void LoadVertex(const MeshVertex& vertex, __m128& position, __m128& color)
+{
+	const __m128 KeepXyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	position = _mm_and_ps(_mm_loadu_ps(vertex.Position), KeepXyz);
+	// z r g b -> r g b z, then z is replaced by 1
+	color = _mm_loadu_ps(&vertex.Position[2]);
+	color = _mm_shuffle_ps(color, color, _MM_SHUFFLE(0, 3, 2, 1));
+	color = _mm_or_ps(_mm_and_ps(color, KeepXyz), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+static inline void StoreColor(__m128 color, PackedVertex& packed)
+{
+	color = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	// cvtps rounds to nearest even like lrintf, then two saturating packs go 32 -> 16 -> 8 bits
+	__m128i Color32 = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_set1_ps(255.0f)));
+	__m128i Color16 = _mm_packs_epi32(Color32, Color32);
+	int Color8 = _mm_cvtsi128_si32(_mm_packus_epi16(Color16, Color16));
+	memcpy(packed.Color, &Color8, sizeof(packed.Color));
+}
+
+static void QuantizeVerticesSnorm16SSE2(const MeshVertex* vertices, size_t count, const PositionDequantize& dequantize, PackedVertex* packed)
+{
+	__m128 Bias = _mm_setr_ps(dequantize.Bias[0], dequantize.Bias[1], dequantize.Bias[2], 0.0f);
+	__m128 Scale = _mm_setr_ps(dequantize.Scale[0], dequantize.Scale[1], dequantize.Scale[2], 1.0f);
+	__m128 One = _mm_set1_ps(1.0f);
+	__m128 MinusOne = _mm_set1_ps(-1.0f);
+	for (size_t i = 0; i < count; i++) {
+		__m128 Position, Color;
+		LoadVertex(vertices[i], Position, Color);
+		// Divide like the scalar version does, so both round the same way
+		Position = _mm_div_ps(_mm_sub_ps(Position, Bias), Scale);
+		Position = _mm_min_ps(_mm_max_ps(Position, MinusOne), One);
+		__m128i Position32 = _mm_cvtps_epi32(_mm_mul_ps(Position, _mm_set1_ps(32767.0f)));
+		// The padding lane was 0, so it stays 0
+		_mm_storel_epi64((__m128i*)packed[i].Position, _mm_packs_epi32(Position32, Position32));
+		StoreColor(Color, packed[i]);
+	}
+}
+
+TARGET_F16C static void QuantizeVerticesHalfF16C(const MeshVertex* vertices, size_t count, PackedVertex* packed)
+{
+	for (size_t i = 0; i < count; i++) {
+		__m128 Position, Color;
+		LoadVertex(vertices[i], Position, Color);
+		_mm_storel_epi64((__m128i*)packed[i].Position, _mm_cvtps_ph(Position, _MM_FROUND_TO_NEAREST_INT));
+		StoreColor(Color, packed[i]);
+	}
+}
+
+static bool CpuSupportsF16C()
+{
+#if defined(_MSC_VER)
+	int Info[4];
+	__cpuid(Info, 1);
+	// F16C instructions are VEX encoded, so the OS has to save the YMM registers as well
+	bool OsSavesYmm = (Info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	return OsSavesYmm && (Info[2] & (1 << 29)) != 0;
+#else
+	unsigned int a, b, c, d;
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx") && __get_cpuid(1, &a, &b, &c, &d) && (c & bit_F16C) != 0;
+#endif
+}
+#endif
+
+void QuantizeVertices(const Mesh& mesh, PositionEncoding encoding, std::vector<PackedVertex>& vertices,
+	PositionDequantize& dequantize, QuantizationReport& report)
+{
+	size_t Count = mesh.Vertices.size();
+	report.BytesPerVertexBefore = sizeof(MeshVertex);
+	report.BytesPerVertexAfter = encoding == PositionFloat ? (int)sizeof(MeshVertex) : (int)sizeof(PackedVertex);
+	report.MaxPositionError = 0.0f;
+	report.MaxColorError = 0.0f;
+	for (int Axis = 0; Axis < 3; Axis++) {
+		dequantize.Scale[Axis] = 1.0f;
+		dequantize.Bias[Axis] = 0.0f;
+	}
+	vertices.clear();
+	if (encoding == PositionFloat || Count == 0) {
+		return;
+	}
+
+	if (encoding == PositionSnorm16) {
+		float BoundsMin[3], BoundsMax[3];
+		for (int Axis = 0; Axis < 3; Axis++) {
+			BoundsMin[Axis] = BoundsMax[Axis] = mesh.Vertices[0].Position[Axis];
+		}
+		for (size_t i = 1; i < Count; i++) {
+			for (int Axis = 0; Axis < 3; Axis++) {
+				BoundsMin[Axis] = fminf(BoundsMin[Axis], mesh.Vertices[i].Position[Axis]);
+				BoundsMax[Axis] = fmaxf(BoundsMax[Axis], mesh.Vertices[i].Position[Axis]);
+			}
+		}
+		ComputePositionDequantize(BoundsMin, BoundsMax, dequantize);
+	}
+
+	vertices.resize(Count);
+#ifdef QUANTIZE_X86
+	static const bool HasF16C = CpuSupportsF16C();
+	if (encoding == PositionSnorm16)
+		QuantizeVerticesSnorm16SSE2(&mesh.Vertices[0], Count, dequantize, &vertices[0]);
+	else if (HasF16C)
+		QuantizeVerticesHalfF16C(&mesh.Vertices[0], Count, &vertices[0]);
+	else
+		QuantizeVerticesScalar(&mesh.Vertices[0], Count, encoding, dequantize, &vertices[0]);
+#else
+	QuantizeVerticesScalar(&mesh.Vertices[0], Count, encoding, dequantize, &vertices[0]);
+#endif
+
+	// Decode everything back, the way the GPU will, to know the real error
+	for (size_t i = 0; i < Count; i++) {
+		for (int Axis = 0; Axis < 3; Axis++) {
+			float Position = encoding == PositionHalf
+				? HalfToFloat(vertices[i].Position[Axis])
+				: dequantize.Bias[Axis] + FromSnorm16((int16_t)vertices[i].Position[Axis]) * dequantize.Scale[Axis];
+			report.MaxPositionError = fmaxf(report.MaxPositionError, fabsf(Position - mesh.Vertices[i].Position[Axis]));
+			float Color = vertices[i].Color[Axis] / 255.0f;
+			report.MaxColorError = fmaxf(report.MaxColorError, fabsf(Color - mesh.Vertices[i].Color[Axis]));
+		}
+	}
+}
+
+// Octahedral mapping: the unit sphere is projected on the octahedron |x| + |y| + |z| = 1, whose lower half
+// is folded over the upper one, so the whole sphere fits in the [-1, 1] square with only 2 values
+static void EncodeOctahedralScalar(const float* normal, int16_t* encoded)
+{
+	float L1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+	float x = L1 > 0.0f ? normal[0] / L1 : 0.0f;
+	float y = L1 > 0.0f ? normal[1] / L1 : 0.0f;
+	if (normal[2] < 0.0f) {
+		float FoldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float FoldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = FoldedX;
+		y = FoldedY;
+	}
+	encoded[0] = ToSnorm16(x);
+	encoded[1] = ToSnorm16(y);
+}
+
+void EncodeOctahedral(const float* normals, size_t count, int16_t* encoded)
+{
+	size_t i = 0;
+#ifdef QUANTIZE_X86
+	// 4 normals at a time, one per lane
+	const __m128 SignBit = _mm_set1_ps(-0.0f);
+	const __m128 One = _mm_set1_ps(1.0f);
+	const __m128 Zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		const float* n = normals + i * 3;
+		__m128 X = _mm_setr_ps(n[0], n[3], n[6], n[9]);
+		__m128 Y = _mm_setr_ps(n[1], n[4], n[7], n[10]);
+		__m128 Z = _mm_setr_ps(n[2], n[5], n[8], n[11]);
+
+		__m128 L1 = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(SignBit, X), _mm_andnot_ps(SignBit, Y)), _mm_andnot_ps(SignBit, Z));
+		__m128 NonZero = _mm_cmpgt_ps(L1, Zero);
+		X = _mm_and_ps(_mm_div_ps(X, L1), NonZero);
+		Y = _mm_and_ps(_mm_div_ps(Y, L1), NonZero);
+
+		// (1 - |other|) with the sign of the value itself, only where z < 0
+		__m128 SignX = _mm_or_ps(_mm_and_ps(X, SignBit), One);
+		__m128 SignY = _mm_or_ps(_mm_and_ps(Y, SignBit), One);
+		// +0 and -0 both count as positive, like in the scalar version
+		SignX = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(X, Zero), SignX), _mm_andnot_ps(_mm_cmplt_ps(X, Zero), One));
+		SignY = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(Y, Zero), SignY), _mm_andnot_ps(_mm_cmplt_ps(Y, Zero), One));
+		__m128 FoldedX = _mm_mul_ps(_mm_sub_ps(One, _mm_andnot_ps(SignBit, Y)), SignX);
+		__m128 FoldedY = _mm_mul_ps(_mm_sub_ps(One, _mm_andnot_ps(SignBit, X)), SignY);
+		__m128 Fold = _mm_cmplt_ps(Z, Zero);
+		X = _mm_or_ps(_mm_and_ps(Fold, FoldedX), _mm_andnot_ps(Fold, X));
+		Y = _mm_or_ps(_mm_and_ps(Fold, FoldedY), _mm_andnot_ps(Fold, Y));
+
+		__m128 Limit = _mm_set1_ps(32767.0f);
+		__m128i X32 = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(X, _mm_set1_ps(-1.0f)), One), Limit));
+		__m128i Y32 = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(Y, _mm_set1_ps(-1.0f)), One), Limit));
+		// x0 x1 x2 x3 and y0 y1 y2 y3 -> x0 y0 x1 y1 x2 y2 x3 y3
+		__m128i Interleaved = _mm_unpacklo_epi16(_mm_packs_epi32(X32, X32), _mm_packs_epi32(Y32, Y32));
+		_mm_storeu_si128((__m128i*)(encoded + i * 2), Interleaved);
+	}
+#endif
+	for (; i < count; i++) {
+		EncodeOctahedralScalar(normals + i * 3, encoded + i * 2);
+	}
+}
+
+void DecodeOctahedral(const int16_t* encoded, float normal[3])
+{
+	float x = FromSnorm16(encoded[0]);
+	float y = FromSnorm16(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f) {
+		float UnfoldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float UnfoldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = UnfoldedX;
+		y = UnfoldedY;
+	}
+	float Length = sqrtf(x * x + y * y + z * z);
+	normal[0] = x / Length;
+	normal[1] = y / Length;
+	normal[2] = z / Length;
+}
+
+float MeasureOctahedralError(size_t count)
+{
+	std::vector<float> Normals(count * 3);
+	srand(1234);
+	for (size_t i = 0; i < count; i++) {
+		// Uniform on the sphere: uniform z, uniform angle around it
+		float z = 2.0f * rand() / (float)RAND_MAX - 1.0f;
+		float Angle = 6.2831853f * rand() / (float)RAND_MAX;
+		float r = sqrtf(fmaxf(0.0f, 1.0f - z * z));
+		Normals[i * 3] = r * cosf(Angle);
+		Normals[i * 3 + 1] = r * sinf(Angle);
+		Normals[i * 3 + 2] = z;
+	}
+
+	std::vector<int16_t> Encoded(count * 2);
+	EncodeOctahedral(&Normals[0], count, &Encoded[0]);
+
+	double MaxAngle = 0.0;
+	for (size_t i = 0; i < count; i++) {
+		float Decoded[3];
+		DecodeOctahedral(&Encoded[i * 2], Decoded);
+		double Dot = Decoded[0] * Normals[i * 3] + Decoded[1] * Normals[i * 3 + 1] + Decoded[2] * Normals[i * 3 + 2];
+		double Angle = acos(Dot > 1.0 ? 1.0 : Dot) * 180.0 / 3.14159265358979;
+		MaxAngle = Angle > MaxAngle ? Angle : MaxAngle;
+	}
+	return (float)MaxAngle;
+}
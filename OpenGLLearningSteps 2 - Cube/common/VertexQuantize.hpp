@@ -0,0 +1,66 @@
+#ifndef VERTEXQUANTIZE_HPP
+#define VERTEXQUANTIZE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Compressed vertex formats. MeshVertex takes 24 bytes (6 floats); a PackedVertex takes 12:
+//  - position: 3 x snorm16 relative to the mesh bounds, or 3 x half float, plus 2 bytes of padding
+//  - color: RGBA8, normalized unsigned bytes
+// Normals (none of the shaders use them yet) go in 2 x snorm16 with the octahedral mapping.
+// The encoders are SSE2 (F16C for half floats) with a scalar fallback for other CPUs.
+
+enum PositionEncoding
+{
+	PositionFloat,		// Not quantized, MeshVertex as it is
+	PositionHalf,		// GL_HALF_FLOAT, model space as it is
+	PositionSnorm16		// GL_SHORT normalized, Position = Bias + Value * Scale
+};
+
+struct PackedVertex
+{
+	uint16_t Position[4];	// x, y, z as int16 (snorm16) or half float bits, the 4th is padding
+	uint8_t Color[4];		// RGBA8, alpha is always 255
+};
+
+// What the shader needs to get the model space position back. Scale 1 and bias 0 unless snorm16.
+struct PositionDequantize
+{
+	float Scale[3];
+	float Bias[3];
+};
+
+struct QuantizationReport
+{
+	int BytesPerVertexBefore;
+	int BytesPerVertexAfter;
+	float MaxPositionError;		// Model space units
+	float MaxColorError;		// In [0, 1] color units
+};
+
+// Parses "float", "half" or "snorm16". Returns false for anything else.
+bool ParsePositionEncoding(const char* name, PositionEncoding& encoding);
+const char* PositionEncodingName(PositionEncoding encoding);
+
+// Encodes every vertex of the mesh, and measures the error by decoding it back
+void QuantizeVertices(const Mesh& mesh, PositionEncoding encoding, std::vector<PackedVertex>& vertices,
+	PositionDequantize& dequantize, QuantizationReport& report);
+
+// The dequantization of snorm16 positions for the given bounds (the scale never goes to 0)
+void ComputePositionDequantize(const float boundsMin[3], const float boundsMax[3], PositionDequantize& dequantize);
+
+// Octahedral normal encoding: unit normals (3 floats each) to 2 x snorm16 each, and back
+void EncodeOctahedral(const float* normals, size_t count, int16_t* encoded);
+void DecodeOctahedral(const int16_t* encoded, float normal[3]);
+
+// Encodes count random unit normals and returns the largest angle between a normal and its decoded self, in degrees
+float MeasureOctahedralError(size_t count);
+
+// Half float from and to float, rounding to nearest even
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+#endif
@@ -2,6 +2,11 @@
 // A thing to remember: always include the "opengl32.lib" on the linker, otherwise OpenGL functions won't work.
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
 
 // Include GLEW, but always before gl.h and glfw3.h
 // Another thing to remember: When installing GLEW, you should copy the "glew32.dll" to the "%SystemRoot%/system32" folder,
@@ -21,55 +26,214 @@
 
 //include the shader loading function
 #include "common/Shader.hpp"
+// Include the offscreen rendering and the benchmark runner
+#include "common/Headless.hpp"
+#include "common/Benchmark.hpp"
+#include "common/Options.hpp"
+// Include the frame profiler
+#include "common/Profiler.hpp"
+// Include the GL state cache the render loop binds everything through
+#include "common/StateCache.hpp"
+// Include the indexed mesh builder
+#include "common/Mesh.hpp"
+// Include the instanced cube grid
+#include "common/Instancing.hpp"
+// Include the batched (SIMD) transforms
+#include "common/TransformBatch.hpp"
+// Include the streaming buffer for per-frame data
+#include "common/StreamBuffer.hpp"
+// Include the shader hot-reload
+#include "common/ShaderWatcher.hpp"
+// Include the binary mesh files
+#include "common/MeshFile.hpp"
+// Include the LOD selection
+#include "common/MeshLod.hpp"
+// Include the uniform blocks
+#include "common/UniformBlocks.hpp"
+// Include the GPU-driven culling, and the depth pyramid of its occlusion test
+#include "common/GpuCulling.hpp"
+#include "common/HiZBuffer.hpp"
+// Include the BVH for the CPU culling
+#include "common/Bvh.hpp"
+// Include the job system, and the frame update that runs on it
+#include "common/JobSystem.hpp"
+#include "common/SceneUpdate.hpp"
+// Include the frame capture
+#include "common/FrameCapture.hpp"
+// Include the render queue the draws are sorted in
+#include "common/RenderQueue.hpp"
+// Include the owner of the GL objects
+#include "common/GpuResources.hpp"
+// Include the startup and per-frame microbenchmarks
+#include "common/HotPathBenchmark.hpp"
+// Include the GL call recorder, after GLEW since it wraps some of its functions
+#include "common/GlTrace.hpp"
 
 GLFWwindow* window; // (In the Accompanying source code, this variable is global for simplicity)
 
-int main()
+// Same size for the window and the offscreen framebuffer, so both modes render the same amount of pixels
+static const int WindowWidth = 1024;
+static const int WindowHeight = 768;
+
+int main(int argc, char** argv)
 {
-	// Initializing GLFW
-	glewExperimental = true; // This is needed for core profile
-	if (!glfwInit())
+	AppOptions Options;
+	if (!ParseOptions(argc, argv, Options))
 	{
-		fprintf(stderr, "Failed to initialize GLFW\n");
 		return -1;
 	}
 
-	// Creating the first window
-	glfwWindowHint(GLFW_SAMPLES, 4); // I'm using 4x Antialiasing
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // I want to use OpenGL 3.3
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // This indicates that the OpenGL version is 3.3. If MAJOR was 4 and MINOR 6, I'd be using OpenGL 4.6
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // This should not be needed, it's just to make Mac OS happy
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Since I'm not using old OpenGL, I'll use Core Profile
+	// The transform benchmark is pure CPU work, no need for a window or a context
+	if (Options.BenchTransforms > 0)
+	{
+		RunTransformBenchmark(Options.BenchTransforms, 50);
+		return 0;
+	}
+	if (Options.BenchBvh > 0)
+	{
+		RunBvhBenchmark(Options.BenchBvh, 20);
+		return 0;
+	}
+	if (Options.BenchJobs > 0)
+	{
+		RunSceneUpdateBenchmark(Options.BenchJobs, Options.Threads, 50);
+		return 0;
+	}
 
-	// Open a Window and create its OpenGL context
-	window = glfwCreateWindow(1024, 768, "Tutorial 1", NULL, NULL); // To create a window use this method and pass width, height and window label. The other two params are null
-	if (window == NULL)
+	// Same for the converter, it only reads a text file and writes a binary one
+	if (Options.ConvertObjPath != NULL)
 	{
-		fprintf(stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials \n");
-		glfwTerminate(); // Kills the current instance of GLFW
-		return -1;
+		return ConvertObjToMeshFile(Options.ConvertObjPath, Options.ConvertOutputPath, Options.Lods, Options.Quantize) ? 0 : -1;
+	}
+
+	if (Options.Headless)
+	{
+		// No window at all: an EGL context draws into an offscreen framebuffer instead
+		window = NULL;
+		if (!CreateHeadlessContext())
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		// Initializing GLFW
+		glewExperimental = true; // This is needed for core profile
+		if (!glfwInit())
+		{
+			fprintf(stderr, "Failed to initialize GLFW\n");
+			return -1;
+		}
+
+		// Creating the first window
+		glfwWindowHint(GLFW_SAMPLES, 4); // I'm using 4x Antialiasing
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // I want to use OpenGL 3.3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // This indicates that the OpenGL version is 3.3. If MAJOR was 4 and MINOR 6, I'd be using OpenGL 4.6
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // This should not be needed, it's just to make Mac OS happy
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Since I'm not using old OpenGL, I'll use Core Profile
+
+		// Open a Window and create its OpenGL context
+		window = glfwCreateWindow(WindowWidth, WindowHeight, "Tutorial 1", NULL, NULL); // To create a window use this method and pass width, height and window label. The other two params are null
+		if (window == NULL)
+		{
+			fprintf(stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials \n");
+			glfwTerminate(); // Kills the current instance of GLFW
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
 	}
-	glfwMakeContextCurrent(window);
 
 	// Initialize GLEW
 	glewExperimental = true; // Needed in core profile
-	if (glewInit() != GLEW_OK)
+	GLenum GlewError = glewInit();
+	// GLEW built for GLX complains there's no X display on an EGL context, but the GL functions are loaded by then
+	if (GlewError != GLEW_OK && !(Options.Headless && GlewError == GLEW_ERROR_NO_GLX_DISPLAY))
 	{
 		fprintf(stderr, "failed to initialize GLEW\n");
-		glfwTerminate();
+		if (Options.Headless)
+			DestroyHeadlessContext();
+		else
+			glfwTerminate();
 		return -1;
 	}
 
-	// Ensure we can capture the escape key being pressed below
-	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+	if (Options.Headless)
+	{
+		if (!CreateHeadlessFramebuffer(WindowWidth, WindowHeight))
+		{
+			DestroyHeadlessContext();
+			return -1;
+		}
+	}
+	else
+	{
+		// Ensure we can capture the escape key being pressed below
+		glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+	}
+
+	// Loading needs the context for the upload, but nothing is drawn
+	if (Options.BenchMeshLoad != NULL)
+	{
+		bool Loaded = RunMeshLoadBenchmark(Options.BenchMeshLoad);
+		ShutdownGpuResources();
+		DestroyHeadlessContext();
+		return Loaded ? 0 : -1;
+	}
+
+	// The microbenchmarks only need the context too
+	if (Options.BenchHotPaths > 0)
+	{
+		bool Ran = RunHotPathBenchmark(Options.BenchHotPaths, Options.WarmupFrames, Options.JsonPath);
+		ShutdownGpuResources();
+		DestroyHeadlessContext();
+		return Ran ? 0 : -1;
+	}
+
+	// Same for a replay: the trace has every call that drew the frames, nothing of ours is needed
+	if (Options.ReplayPath != NULL)
+	{
+		bool Replayed = RunGlTraceReplay(Options.ReplayPath, Options.WarmupFrames, Options.JsonPath);
+		ShutdownGpuResources();
+		DestroyHeadlessContext();
+		return Replayed ? 0 : -1;
+	}
+
+	// Record from the first GL call after the framebuffer, so the replay starts from the same state
+	if (Options.TracePath != NULL && !StartGlTrace(Options.TracePath, WindowWidth, WindowHeight))
+	{
+		if (Options.Headless)
+			DestroyHeadlessContext();
+		else
+			glfwTerminate();
+		return -1;
+	}
 
 	// Set the background as a dark blue color
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
-	// This is the Vertex Array Object, which will identify our vertex array
-	GLuint VertexArrayId;
-	// Generate 1 array, put the resulting identifier in vertexArray
-	glGenVertexArrays(1, &VertexArrayId);
+	// Enable depth test
+	glEnable(GL_DEPTH_TEST);
+	// Accept fragment if it closer to the camera than the former one
+	glDepthFunc(GL_LESS);
+
+	// Start loading our GLSL program right away, it compiles while the mesh and the buffers are being built
+	bool Instanced = Options.Instances > 0;
+	// Direct draws go through the single object shader, once per object
+	bool DirectDraws = Instanced && Options.Draw == DrawDirect;
+	bool IndirectDraws = Instanced && Options.Draw == DrawIndirect;
+	bool InstancedShader = Instanced && !DirectDraws;
+	const char* VertexShaderPath = InstancedShader ? "shaders/InstancedTransformVertexShader.vertexshader" : "shaders/TransformVertexShader.vertexshader";
+	const char* FragmentShaderPath = "shaders/ColorFragmentShader.fragmentshader";
+	ShaderProgramHandle ProgramHandle = LoadShadersAsync(VertexShaderPath, FragmentShaderPath);
+	// The mixed scene's second program: the same vertex shader, and every fragment flat red
+	ShaderProgramHandle FlatProgramHandle = 0;
+	if (Options.MixedScene)
+		FlatProgramHandle = LoadShadersAsync(VertexShaderPath, "shaders/SimpleFragmentShader.fragmentshader");
+
+	// This is the Vertex Array Object, which will identify our vertex array.
+	// The GL objects belong to the resource manager, these only hold them (and give them back if we return early).
+	GpuVertexArray VertexArray(CreateGpuVertexArray("cube"));
+	GLuint VertexArrayId = VertexArray.Name();
 	// Bind to the 'vertexarray' array'
 	glBindVertexArray(VertexArrayId);
 
@@ -96,7 +260,7 @@ int main()
 		-1.0f, -1.0f, -1.0f, // triangle 6 : end
 		-1.0f, 1.0f, 1.0f, // triangle 7 : begin
 		-1.0f, -1.0f, 1.0f,
-		-1.0f, -1.0f, 1.0f, // triangle 7 : end
+		1.0f, -1.0f, 1.0f, // triangle 7 : end
 		1.0f, 1.0f, 1.0f, // triangle 8 : begin
 		1.0f, -1.0f, -1.0f,
 		1.0f, 1.0f, -1.0f, // triangle 8 : end
@@ -154,22 +318,235 @@ int main()
 		0.982f,  0.099f,  0.879f
 	};
 
-	// This will idenfity our vertex buffer
+	// The arrays above are a plain triangle list, every corner is repeated for each triangle that uses it.
+	// Weld the 36 vertices into the 8 unique corners (each keeps the first color it was given),
+	// then order the triangles for the post-transform cache and the vertices for fetching.
+	Mesh CubeMesh = BuildIndexedMesh(g_vertex_buffer_data, g_color_buffer_data, 12 * 3, true);
+	float AcmrBefore = ComputeACMR(CubeMesh.Indices, CubeMesh.Vertices.size(), MESH_ACMR_CACHE_SIZE);
+	OptimizeVertexCache(CubeMesh);
+	OptimizeVertexFetch(CubeMesh);
+	float AcmrAfter = ComputeACMR(CubeMesh.Indices, CubeMesh.Vertices.size(), MESH_ACMR_CACHE_SIZE);
+	// Without an index buffer every vertex of every triangle is transformed, so the ACMR is always 3
+	printf("Cube mesh: %d vertices -> %d unique, ACMR non-indexed 3.000, indexed %.3f, optimized %.3f\n",
+		12 * 3, (int)CubeMesh.Vertices.size(), AcmrBefore, AcmrAfter);
+
+	// This will idenfity our vertex buffer, positions and colors interleaved, and the index buffer
+	GpuBuffer CubeVertices;
+	GpuBuffer CubeIndices;
 	GLuint vertexBuffer;
-	// Generate 1 buffer, put the resulting identifier in vertexBuffer
-	glGenBuffers(1, &vertexBuffer);
-	// The following commands will talk about our 'vertexbuffer' buffer
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	// Give our vertices to OpenGL
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
+	GLuint elementBuffer;
+	GLsizei CubeIndexCount;
+	GLenum IndexType = GL_UNSIGNED_INT;
+	float SceneRadius = sqrtf(3.0f); // Just the one cube
+	float InstanceSpacing = 3.0f;
+	// A mesh file replaces the cube: mapped, uploaded straight from the mapping, with the vertex layout it describes.
+	// A quantized cube takes the same path, uploaded from memory in the packed vertex format.
+	GpuMesh LoadedMesh;
+	bool UseMeshFile = Options.MeshPath != NULL;
+	bool UseGpuMesh = UseMeshFile || Options.Quantize != PositionFloat;
+	QuantizationReport Quantization = { (int)sizeof(MeshVertex), (int)sizeof(MeshVertex), 0.0f, 0.0f };
+	// Float positions go to the shader as they are
+	PositionDequantize Dequantize = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	// A mesh file can come with simplified LODs (--convert-obj makes them), the cube is only ever LOD 0
+	int MeshLodCount = 1;
+	if (UseGpuMesh)
+	{
+		if (UseMeshFile ? !LoadMeshFile(Options.MeshPath, LoadedMesh) : !UploadMesh(CubeMesh, Options.Quantize, LoadedMesh, Quantization))
+			return -1;
+		if (UseMeshFile)
+			Quantization.BytesPerVertexAfter = LoadedMesh.VertexStride;
+		else
+			printf("Cube vertices: %s positions, %d -> %d bytes each, max position error %g, max color error %g\n", PositionEncodingName(Options.Quantize),
+				Quantization.BytesPerVertexBefore, Quantization.BytesPerVertexAfter, Quantization.MaxPositionError, Quantization.MaxColorError);
+		Dequantize = LoadedMesh.Dequantize;
+		vertexBuffer = GpuName(LoadedMesh.VertexBuffer);
+		elementBuffer = GpuName(LoadedMesh.IndexBuffer);
+		CubeIndexCount = (GLsizei)LoadedMesh.Lods[0].IndexCount;
+		IndexType = LoadedMesh.IndexType;
+		if (!Options.NoLod)
+			MeshLodCount = LoadedMesh.LodCount;
+		glBindVertexArray(VertexArrayId);
+		SetupMeshAttributes(LoadedMesh);
+
+		// Frame the whole mesh, and keep instances as far apart as the cubes are for their size
+		float HalfExtent = 0.0f;
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			float Extent = fmaxf(fabsf(LoadedMesh.BoundsMin[Axis]), fabsf(LoadedMesh.BoundsMax[Axis]));
+			HalfExtent = fmaxf(HalfExtent, Extent);
+		}
+		SceneRadius = sqrtf(3.0f) * HalfExtent;
+		InstanceSpacing = 3.0f * HalfExtent;
+	}
+	else
+	{
+		// Get 1 buffer, and give our vertices to OpenGL
+		CubeVertices.Reset(CreateGpuBuffer("cube vertices"));
+		vertexBuffer = CubeVertices.Name();
+		GpuBufferData(CubeVertices.Get(), GL_COPY_WRITE_BUFFER, CubeMesh.Vertices.size() * sizeof(MeshVertex), &CubeMesh.Vertices[0], GL_STATIC_DRAW);
+
+		// The vertex format is part of the VAO state, so it's set up once here instead of every frame.
+		// Binding the VAO in the render loop is then enough to get both attributes back.
+		glBindVertexArray(VertexArrayId);
+
+		// The index buffer binding is stored in the VAO too
+		CubeIndices.Reset(CreateGpuBuffer("cube indices"));
+		elementBuffer = CubeIndices.Name();
+		GpuBufferData(CubeIndices.Get(), GL_COPY_WRITE_BUFFER, CubeMesh.Indices.size() * sizeof(unsigned int), &CubeMesh.Indices[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+		CubeIndexCount = (GLsizei)CubeMesh.Indices.size();
+
+		// 1st attribute buffer: vertices
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glVertexAttribPointer(
+			0,			// attribute 0. No particular reason for 0, but must match the layout in the shader.
+			3,			// size
+			GL_FLOAT,	// type
+			GL_FALSE,	// is it normalized? if yes, then GL_TRUE. Otherwise, GL_FALSE
+			sizeof(MeshVertex),	// stride: from one vertex to the next, skipping the color
+			(void*)offsetof(MeshVertex, Position)	// array buffer offset
+		);
+
+		// 2nd attribute buffer: colors, in the same buffer
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(
+			1,			// attribute. No particular reason for 1, but must match the layout in the shader.
+			3,			// size
+			GL_FLOAT,	// type
+			GL_FALSE,	// normalized?
+			sizeof(MeshVertex),	// stride
+			(void*)offsetof(MeshVertex, Color)	// array buffer offset
+		);
+	}
+
+	// Instanced mode: a second VAO with the same vertices and indices, plus one model matrix per instance
+	GpuVertexArray InstancedVertexArray;
+	GpuBuffer InstanceMatrices;
+	GLuint InstancedVertexArrayId = 0;
+	GLuint instanceBuffer = 0;
+	TransformBatch Instances;
+	// Animated instances are rewritten every frame, straight into a persistently mapped buffer
+	// (direct draws put their matrices in their uniform blocks instead)
+	bool StreamInstances = Instanced && Options.Animate && !DirectDraws;
+	StreamBuffer InstanceStream;
+	// The bounding sphere of one object, before the grid replaces it with the whole scene's
+	float MeshRadius = SceneRadius;
+	if (Instanced)
+	{
+		if (!BuildInstanceGrid(Instances, Options.Instances, InstanceSpacing, MeshRadius, SceneRadius))
+			return -1;
+
+		if (StreamInstances)
+		{
+			if (!CreateStreamBuffer(InstanceStream, Options.Instances * sizeof(glm::mat4)))
+				return -1;
+			instanceBuffer = InstanceStream.Buffer;
+		}
+		else
+		{
+			// Only the model matrices are needed, the shader applies VP itself
+			std::vector<glm::mat4> InstanceModels(Options.Instances);
+			glm::mat4 Identity(1.0f);
+			ComputeTransforms(Instances, &Identity[0][0], &InstanceModels[0][0][0], NULL);
+
+			InstanceMatrices.Reset(CreateGpuBuffer("instance matrices"));
+			instanceBuffer = InstanceMatrices.Name();
+			GpuBufferData(InstanceMatrices.Get(), GL_COPY_WRITE_BUFFER, InstanceModels.size() * sizeof(glm::mat4), &InstanceModels[0], GL_STATIC_DRAW);
+		}
+
+		InstancedVertexArray.Reset(CreateGpuVertexArray("instanced cubes"));
+		InstancedVertexArrayId = InstancedVertexArray.Name();
+		glBindVertexArray(InstancedVertexArrayId);
+		if (UseGpuMesh)
+		{
+			SetupMeshAttributes(LoadedMesh);
+		}
+		else
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, Position));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, Color));
+		}
+		SetupInstanceAttributes(instanceBuffer);
+	}
+
+	// Mixed scene: some of the objects are octahedra instead of cubes, with their own buffers and VAO,
+	// and some are drawn with the flat program. The octahedron fits in the cube's bounding sphere, so the culling doesn't change.
+	GpuVertexArray OctahedronVertexArray;
+	GpuBuffer OctahedronVertices;
+	GpuBuffer OctahedronIndices;
+	GLuint OctahedronVertexArrayId = 0;
+	GLsizei OctahedronIndexCount = 0;
+	// Per object: 1 for an octahedron, 2 for the flat program
+	std::vector<unsigned char> ObjectKinds;
+	if (Options.MixedScene)
+	{
+		// One triangle per octant, between the corners on the 3 axes
+		static const GLfloat OctahedronPositions[] = {
+			1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f,   0.0f, 0.0f, 1.0f,
+			0.0f, 1.0f, 0.0f,   -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,
+			-1.0f, 0.0f, 0.0f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f, 1.0f,
+			0.0f, -1.0f, 0.0f,  1.0f, 0.0f, 0.0f,   0.0f, 0.0f, 1.0f,
+			0.0f, 1.0f, 0.0f,   1.0f, 0.0f, 0.0f,   0.0f, 0.0f, -1.0f,
+			-1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,   0.0f, 0.0f, -1.0f,
+			0.0f, -1.0f, 0.0f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f,
+			1.0f, 0.0f, 0.0f,   0.0f, -1.0f, 0.0f,  0.0f, 0.0f, -1.0f
+		};
+		// Each corner colored by where it points
+		GLfloat OctahedronColors[8 * 3 * 3];
+		for (int i = 0; i < 8 * 3 * 3; i++)
+			OctahedronColors[i] = 0.5f + 0.5f * OctahedronPositions[i];
+		Mesh Octahedron = BuildIndexedMesh(OctahedronPositions, OctahedronColors, 8 * 3, true);
+		OctahedronIndexCount = (GLsizei)Octahedron.Indices.size();
 
-	GLuint colorbuffer;
-	glGenBuffers(1, &colorbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_color_buffer_data), g_color_buffer_data, GL_STATIC_DRAW);
+		OctahedronVertices.Reset(CreateGpuBuffer("octahedron vertices"));
+		OctahedronIndices.Reset(CreateGpuBuffer("octahedron indices"));
+		GpuBufferData(OctahedronVertices.Get(), GL_COPY_WRITE_BUFFER, Octahedron.Vertices.size() * sizeof(MeshVertex), &Octahedron.Vertices[0], GL_STATIC_DRAW);
+		GpuBufferData(OctahedronIndices.Get(), GL_COPY_WRITE_BUFFER, Octahedron.Indices.size() * sizeof(unsigned int), &Octahedron.Indices[0], GL_STATIC_DRAW);
 
-	// Create abd Compile our GLSL program from the shaders
-	GLuint programID = LoadShaders("shaders/TransformVertexShader.vertexshader", "shaders/ColorFragmentShader.fragmentshader");
+		OctahedronVertexArray.Reset(CreateGpuVertexArray("octahedron"));
+		OctahedronVertexArrayId = OctahedronVertexArray.Name();
+		glBindVertexArray(OctahedronVertexArrayId);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, OctahedronIndices.Name());
+		glBindBuffer(GL_ARRAY_BUFFER, OctahedronVertices.Name());
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, Position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, Color));
+
+		// Scattered with a hash of the index, so neighbours in the BVH rarely share everything
+		ObjectKinds.resize(Options.Instances);
+		for (int i = 0; i < Options.Instances; i++)
+			ObjectKinds[i] = (unsigned char)(((unsigned int)i * 2654435761u) >> 30);
+	}
+
+	// Now the program is really needed, this is the only place that may wait for the compiler
+	GLuint programID = GetShaderProgram(ProgramHandle);
+	if (programID == 0)
+		return -1;
+
+	// From here on the program is Program.Program, it changes when the shaders are edited with --hot-reload on
+	ReloadableProgram Program;
+	WatchProgram(Program, VertexShaderPath, FragmentShaderPath, programID);
+	BindUniformBlocks(Program.Program);
+	if (Options.HotReload)
+		StartShaderWatcher("shaders");
+	// The flat program isn't reloaded, it's only there to have a second program to switch to
+	// (the reloadable one belongs to the shader watcher, which replaces it on every reload)
+	GpuProgram FlatProgram;
+	GLuint FlatProgramId = 0;
+	if (Options.MixedScene)
+	{
+		FlatProgram.Reset(AdoptGpuProgram(GetShaderProgram(FlatProgramHandle), "flat"));
+		FlatProgramId = FlatProgram.Name();
+		if (FlatProgramId == 0)
+			return -1;
+		BindUniformBlocks(FlatProgramId);
+	}
 
 	// translate the matrix
 	//glm::mat4 myMatrix = glm::translate(glm::mat4(), glm::vec3(10.0f, 0.0f, 0.0f));
@@ -189,17 +566,52 @@ int main()
 	// Order of multiplication on the sentence below: Scaling -> Rotation -> Translation.
 	//TransformedVector = TranslationMatrix * RotationMatrix * ScaleMatrix * OriginalVector;
 
-	// Get a handle for our "MVP" uniform
-	GLuint MatrixID = glGetUniformLocation(programID, "MVP");
+	// The uniforms live in uniform blocks: the frame one (camera) and one per object (the cube, the whole
+	// instanced grid, or every object with direct draws), all written together once per frame into a ring of uniform buffers
+	UniformRing Uniforms;
+	if (!CreateUniformRing(Uniforms, DirectDraws ? Options.Instances + 1 : 1))
+		return -1;
 
-	// Projection matrix : 45� Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
-	glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	// Indirect draws: the compute shader writes the draw commands, from the bounds of the objects
+	GpuCuller Culler;
+	if (IndirectDraws && !CreateGpuCuller(Culler, Instances, MeshRadius, CubeIndexCount))
+		return -1;
+	// And what they drew last frame hides the rest, through a depth pre-pass and its Hi-Z pyramid.
+	// Not while recording a trace: the recorder doesn't know the texture calls.
+	bool Occlusion = IndirectDraws && !Options.NoOcclusion && !GlTraceRecording();
+	HiZBuffer HiZ;
+	if (Occlusion && !CreateHiZBuffer(HiZ, WindowWidth, WindowHeight))
+		return -1;
+	// The CPU work of a frame (matrices, culling, recording the draws) is spread over this many threads
+	StartJobSystem(Options.Threads);
+	// Direct draws: the CPU computes every matrix and culls, the jobs record the draws in command lists.
+	// The culling walks a BVH of the objects instead of testing each of them. They only spin in place,
+	// so their bounds never change and it's built once.
+	Bvh CullTree;
+	SceneUpdate DirectUpdate;
+	if (DirectDraws)
+	{
+		std::vector<float> ObjectBounds;
+		ComputeBatchBounds(Instances, MeshRadius, ObjectBounds);
+		BuildBvh(CullTree, &ObjectBounds[0], Instances.Count);
+		CreateSceneUpdate(DirectUpdate, Instances, CullTree, MeshRadius, Options.Animate, Dequantize);
+	}
+
+	// The camera keeps looking from the (4,3,3) direction, but backs away until the whole grid fits
+	float CameraDistance = glm::length(glm::vec3(4, 3, 3));
+	if (Instanced || UseMeshFile)
+		CameraDistance += 2.5f * SceneRadius;
+	float FarPlane = CameraDistance + SceneRadius > 100.0f ? CameraDistance + SceneRadius : 100.0f;
+	glm::vec3 CameraPosition = glm::normalize(glm::vec3(4, 3, 3)) * CameraDistance;
+
+	// Projection matrix : 45� Field of View (unless --fov says otherwise), 4:3 ratio, display range : 0.1 unit <-> 100 units (more if the grid needs it)
+	glm::mat4 Projection = glm::perspective(glm::radians(Options.FieldOfView), 4.0f / 3.0f, 0.1f, FarPlane);
 	// Or, for an ortho camera :
 	//glm::mat4 Projection = glm::ortho(-10.0f,10.0f,-10.0f,10.0f,0.0f,100.0f); // In world coordinates
 
 	// Camera matrix
 	glm::mat4 View = glm::lookAt(
-		glm::vec3(4, 3, 3), // Camera is at (4,3,3), in World Space
+		CameraPosition, // Camera is at (4,3,3), in World Space
 		glm::vec3(0, 0, 0), // and looks at the origin
 		glm::vec3(0, 1, 0)  // Head is up (set to 0,-1,0 to look upside-down)
 	);
@@ -207,63 +619,464 @@ int main()
 	glm::mat4 Model = glm::mat4(1.0f);
 	// Our ModelViewProjection : multiplication of our 3 matrices
 	glm::mat4 MVP = Projection * View * Model; // Remember, matrix multiplication is the other way around
+	// The instanced shader uses only this part, the model matrix is applied per instance on the GPU
+	glm::mat4 VP = Projection * View;
+	// The frustum never moves, both culling paths use these
+	float FrustumPlanes[6][4];
+	ExtractFrustumPlanes(&VP[0][0], FrustumPlanes);
+
+	// Frame times of the benchmark run, reserved up front so recording them doesn't allocate inside the loop
+	std::vector<double> FrameTimesMs;
+	if (Options.Benchmark)
+		FrameTimesMs.reserve(Options.Frames);
+
+	// The profiler only runs when asked to, otherwise its calls do nothing
+	bool Profiling = Options.ProfileCsvPath != NULL || Options.ProfileTracePath != NULL;
+	if (Profiling)
+		ProfilerInit();
+
+	// Frames read back a few frames late through a ring of pixel buffers, and written by another thread
+	bool Capturing = Options.CapturePath != NULL;
+	FrameCapture Capture;
+	// The capture is an extra, the frames still render without it
+	if (Capturing && !CreateFrameCapture(Capture, WindowWidth, WindowHeight, Options.CapturePath, Options.CaptureFileFormat, Options.CaptureSync))
+	{
+		fprintf(stderr, "Capture is off\n");
+		Capturing = false;
+	}
+
+	// Every draw of the frame is recorded in the render queue, its packets come from an arena that starts over every frame.
+	// (Indirect draws don't go through it, the GPU decides what they draw.)
+	int MaxPackets = DirectDraws ? Options.Instances : 1;
+	FrameArena PacketArena;
+	if (!CreateFrameArena(PacketArena, MaxPackets * (sizeof(DrawPacket) + 2 * sizeof(SortEntry)) + 64))
+		return -1;
+	RenderQueue Queue;
+	InitRenderQueue(Queue);
+
+	// Everything above bound state behind the cache's back
+	StateCacheInvalidate();
+	double SubmitMsTotal = 0.0;
+	double CullMsTotal = 0.0;
+	double UpdateMsTotal = 0.0;
+	double SortMsTotal = 0.0;
+	// Triangles drawn and draws of each LOD, over every frame like the queue stats
+	double TrianglesTotal = 0.0;
+	unsigned long long LodDraws[MESH_FILE_MAX_LODS] = { 0 };
+	float PixelsPerUnit = LodPixelsPerUnit(glm::radians(Options.FieldOfView), WindowHeight);
+	GLintptr MeshIndexBytes = UseGpuMesh ? MeshIndexSize(LoadedMesh) : sizeof(unsigned int);
 
+	// The animation time is counted from here, a float can't hold seconds since the epoch to the frame
+	std::chrono::steady_clock::time_point LoopStart = std::chrono::steady_clock::now();
+	int Frame = 0;
+	bool Running = true;
 	do
 	{
+		std::chrono::steady_clock::time_point FrameStart = std::chrono::steady_clock::now();
+		ProfilerBeginFrame();
+		StateCacheBeginFrame();
+
 		// Clear the screen. It's not mentioned before Tutorial 02, but it can cause flilckering, so it's there nonetheless
+		int ClearScope = ProfilerBeginScope("Clear");
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		ProfilerEndScope(ClearScope);
 
-		// Use our shader
-		glUseProgram(programID);
-		
-		// Send our transformation to the currently bound shader,
-		// in the "MVP" uniform
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
+		// Fixed time step in benchmarks, so every run renders the same frames
+		float Time = Options.Benchmark ? Frame / 60.0f : (float)std::chrono::duration<double>(FrameStart - LoopStart).count();
 
-		// 1st attribute buffer: vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-		glVertexAttribPointer(
-			0,			// attribute 0. No particular reason for 0, but must match the layout in the shader.
-			3,			// size
-			GL_FLOAT,	// type
-			GL_FALSE,	// is it normalized? if yes, then GL_TRUE. Otherwise, GL_FALSE
-			0,			// stride
-			(void*)0	// array buffer offset
-		);
+		// Where this frame's instance matrices start in the stream buffer
+		GLintptr InstanceOffset = 0;
+		if (StreamInstances)
+		{
+			int UpdateScope = ProfilerBeginScope("Update");
+			std::chrono::steady_clock::time_point UpdateStart = std::chrono::steady_clock::now();
 
-		// 2nd attribute buffer: colors
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
-		glVertexAttribPointer(
-			1,			// attribute. No particular reason for 1, but must match the layout in the shader.
-			3,			// size
-			GL_FLOAT,	// type
-			GL_FALSE,	// normalized?
-			0,			// stride
-			(void*)0	// array buffer offset
-		);
+			// The matrices are computed right into the GPU buffer, no copy and no driver synchronization
+			// (each thread writes its own slice of it)
+			StreamBeginFrame(InstanceStream);
+			float* InstanceModels = (float*)StreamAllocate(InstanceStream, Options.Instances * sizeof(glm::mat4), sizeof(glm::mat4), InstanceOffset);
+			glm::mat4 Identity(1.0f);
+			ParallelTransforms(Instances, true, Time, &Identity[0][0], InstanceModels, NULL);
+			StreamFinishWrites(InstanceStream);
+			if (Options.Benchmark && Frame >= Options.WarmupFrames)
+				UpdateMsTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - UpdateStart).count();
+			ProfilerEndScope(UpdateScope);
+		}
+
+		// What the CPU spends recording the frame, uniforms to draw calls, for the draw mode comparison
+		std::chrono::steady_clock::time_point SubmitStart = std::chrono::steady_clock::now();
+		int SetupScope = ProfilerBeginScope("Setup");
+
+		// All the uniforms of the frame, written in one go: the frame block, then the block of our only object
+		// (and with direct draws, the block of each visible object)
+		FrameUniforms* FrameBlock = UniformRingBeginFrame(Uniforms);
+		memcpy(FrameBlock->Projection, &Projection[0][0], sizeof(FrameBlock->Projection));
+		memcpy(FrameBlock->View, &View[0][0], sizeof(FrameBlock->View));
+		memcpy(FrameBlock->ViewProjection, &VP[0][0], sizeof(FrameBlock->ViewProjection));
+		memcpy(FrameBlock->CameraPosition, &CameraPosition[0], sizeof(FrameBlock->CameraPosition));
+		FrameBlock->Time = Time;
+		memcpy(FrameBlock->FrustumPlanes, FrustumPlanes, sizeof(FrameBlock->FrustumPlanes));
+		GLintptr ObjectOffset;
+		ObjectUniforms* ObjectBlock = AllocateObjectUniforms(Uniforms, ObjectOffset);
+		memcpy(ObjectBlock->Model, &Model[0][0], sizeof(ObjectBlock->Model));
+		memcpy(ObjectBlock->ModelViewProjection, &MVP[0][0], sizeof(ObjectBlock->ModelViewProjection));
+		memcpy(ObjectBlock->PositionScale, Dequantize.Scale, sizeof(Dequantize.Scale));
+		memcpy(ObjectBlock->PositionBias, Dequantize.Bias, sizeof(Dequantize.Bias));
+		if (DirectDraws)
+		{
+			// Room for every object's block, the jobs fill in those of the visible ones
+			int UpdateScope = ProfilerBeginScope("Update");
+			GLintptr BlocksOffset;
+			GLsizeiptr BlockStride;
+			unsigned char* Blocks = AllocateObjectUniformsArray(Uniforms, Options.Instances, BlocksOffset, BlockStride);
+			RunSceneUpdate(DirectUpdate, Time, &VP[0][0], FrustumPlanes, Blocks, BlocksOffset, BlockStride);
+			Uniforms.BlocksWritten += CountSceneDraws(DirectUpdate);
+			if (Options.Benchmark && Frame >= Options.WarmupFrames)
+			{
+				UpdateMsTotal += DirectUpdate.TransformMs + DirectUpdate.CullMs;
+				CullMsTotal += DirectUpdate.CullMs;
+			}
+			ProfilerEndScope(UpdateScope);
+		}
+		UniformRingFinishWrites(Uniforms);
+
+		// Frame boundary: swap in a reloaded program if one finished linking (this never waits for the compiler)
+		if (UpdateReloadableProgram(Program))
+			BindUniformBlocks(Program.Program);
+
+		// The culling pass reads the frame block, and writes the commands the draw below reads
+		if (Occlusion)
+		{
+			// The objects drawn last frame, where they are now, give the depth the others are tested against
+			int PrepassScope = ProfilerBeginScope("DepthPrepass");
+			DispatchGpuOccluders(Culler, (GLuint)(InstanceOffset / sizeof(glm::mat4)));
+			BeginHiZDepthPass(HiZ);
+			CachedUseProgram(Program.Program);
+			BindObjectUniforms(Uniforms, ObjectOffset);
+			CachedBindVertexArray(InstancedVertexArrayId);
+			DrawGpuCulled(Culler, IndexType);
+			EndHiZDepthPass(HiZ);
+			ProfilerEndScope(PrepassScope);
+			int HiZScope = ProfilerBeginScope("HiZ");
+			BuildHiZPyramid(HiZ);
+			ProfilerEndScope(HiZScope);
+		}
+		if (IndirectDraws)
+			DispatchGpuCulling(Culler, (GLuint)(InstanceOffset / sizeof(glm::mat4)), Occlusion ? &HiZ : NULL);
+
+		// Without base instances, the instance attributes have to be moved to this frame's region (that's VAO state)
+		bool HasBaseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+		if (StreamInstances && !HasBaseInstance)
+		{
+			CachedBindVertexArray(InstancedVertexArrayId);
+			SetupInstanceAttributes(instanceBuffer, InstanceOffset);
+		}
+
+		// Record the draws as packets, the key of each says which program and VAO it needs.
+		// For the same state the nearest objects go first, the depth test then skips what they hide.
+		ResetFrameArena(PacketArena);
+		BeginRenderQueue(Queue, PacketArena, MaxPackets);
+		if (DirectDraws)
+		{
+			// The command lists, in order: same draws in the same order whatever the number of threads
+			for (size_t l = 0; l < DirectUpdate.Lists.size(); l++)
+			{
+				const std::vector<DrawCommand>& Draws = DirectUpdate.Lists[l].Draws;
+				for (size_t i = 0; i < Draws.size(); i++)
+				{
+					uint32_t Object = Draws[i].Object;
+					unsigned int Kind = Options.MixedScene ? ObjectKinds[Object] : 0;
+					bool Octahedron = (Kind & 1) != 0;
+					bool Flat = (Kind & 2) != 0;
+					float ToX = Instances.PositionX[Object] - CameraPosition.x;
+					float ToY = Instances.PositionY[Object] - CameraPosition.y;
+					float ToZ = Instances.PositionZ[Object] - CameraPosition.z;
+					float Distance = sqrtf(ToX * ToX + ToY * ToY + ToZ * ToZ);
+					// From the nearest point of its bounding sphere, a camera inside it gets LOD 0
+					int Lod = 0;
+					if (MeshLodCount > 1 && !Octahedron)
+						Lod = SelectLod(LoadedMesh.Lods, MeshLodCount, Instances.Scale[Object], Distance - MeshRadius * Instances.Scale[Object], PixelsPerUnit, Options.LodError);
+
+					DrawPacket* Packet = PushDrawPacket(Queue);
+					Packet->Key = MakeSortKey(0, Flat ? 1 : 0, 0, Octahedron ? 1 : 0, SortKeyDepth(Distance, FarPlane, false));
+					Packet->Program = Flat ? FlatProgramId : Program.Program;
+					Packet->VertexArray = Octahedron ? OctahedronVertexArrayId : VertexArrayId;
+					Packet->UniformOffset = Draws[i].UniformOffset;
+					Packet->IndexCount = Octahedron ? OctahedronIndexCount : Lod > 0 ? (GLsizei)LoadedMesh.Lods[Lod].IndexCount : CubeIndexCount;
+					Packet->IndexType = Octahedron ? (GLenum)GL_UNSIGNED_INT : IndexType;
+					Packet->IndexOffset = Lod > 0 ? LoadedMesh.Lods[Lod].FirstIndex * MeshIndexBytes : 0;
+					Packet->InstanceCount = 0;
+					Packet->BaseInstance = 0;
+					TrianglesTotal += Packet->IndexCount / 3;
+					LodDraws[Lod]++;
+				}
+			}
+		}
+		else if (!IndirectDraws)
+		{
+			// Our only cube (12 triangles -> 6 squares, through the 8 corners), or every instance in one call.
+			// The instances share one draw, so one LOD: the full mesh.
+			int Lod = 0;
+			if (MeshLodCount > 1 && !Instanced)
+				Lod = SelectLod(LoadedMesh.Lods, MeshLodCount, 1.0f, glm::length(CameraPosition) - MeshRadius, PixelsPerUnit, Options.LodError);
+			DrawPacket* Packet = PushDrawPacket(Queue);
+			Packet->Key = MakeSortKey(0, 0, 0, 0, 0);
+			Packet->Program = Program.Program;
+			Packet->VertexArray = InstancedShader ? InstancedVertexArrayId : VertexArrayId;
+			Packet->UniformOffset = ObjectOffset;
+			Packet->IndexCount = Lod > 0 ? (GLsizei)LoadedMesh.Lods[Lod].IndexCount : CubeIndexCount;
+			Packet->IndexType = IndexType;
+			Packet->IndexOffset = Lod > 0 ? LoadedMesh.Lods[Lod].FirstIndex * MeshIndexBytes : 0;
+			Packet->InstanceCount = Instanced ? Options.Instances : 0;
+			Packet->BaseInstance = StreamInstances && HasBaseInstance ? (GLuint)(InstanceOffset / sizeof(glm::mat4)) : 0;
+			TrianglesTotal += (double)(Packet->IndexCount / 3) * (Instanced ? Options.Instances : 1);
+			LodDraws[Lod]++;
+		}
+		ProfilerEndScope(SetupScope);
+
+		// The draws that share a program come together, then those that share a VAO
+		int SortScope = ProfilerBeginScope("Sort");
+		std::chrono::steady_clock::time_point SortStart = std::chrono::steady_clock::now();
+		SortRenderQueue(Queue, !Options.NoSort);
+		if (Options.Benchmark && Frame >= Options.WarmupFrames)
+			SortMsTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - SortStart).count();
+		ProfilerEndScope(SortScope);
 
 		// Draw the triangle, finally!
-		glDrawArrays(GL_TRIANGLES, 0, 12*3); // Starting from vertex 0; 12*3 vertices -> 12 triangles -> 6 squares
-		
-		glDisableVertexAttribArray(0);
+		int DrawScope = ProfilerBeginScope("Draw");
+		if (IndirectDraws)
+		{
+			// Every visible object, in one call, without the CPU knowing which
+			CachedUseProgram(Program.Program);
+			BindObjectUniforms(Uniforms, ObjectOffset);
+			CachedBindVertexArray(InstancedVertexArrayId);
+			DrawGpuCulled(Culler, IndexType);
+		}
+		else
+			SubmitRenderQueue(Queue, Uniforms);
+		ProfilerEndScope(DrawScope);
+		if (Options.Benchmark && Frame >= Options.WarmupFrames)
+			SubmitMsTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - SubmitStart).count();
+
+		// Nothing else reads this frame's region, the GPU can have it until the fence passes
+		if (StreamInstances)
+			StreamEndFrame(InstanceStream);
+		UniformRingEndFrame(Uniforms);
+		// What was released this frame gets deleted once the GPU is past it
+		GpuResourcesEndFrame();
+
+		// Before swapping, the read framebuffer still holds this frame
+		if (Capturing)
+		{
+			int CaptureScope = ProfilerBeginScope("Capture");
+			CaptureFrame(Capture, Frame);
+			ProfilerEndScope(CaptureScope);
+		}
+
+		int PresentScope = ProfilerBeginScope("Present");
+		if (Options.Headless)
+		{
+			// Nothing to present, so wait for the frame to actually finish or we'd only be timing the command submission
+			glFinish();
+		}
+		else
+		{
+			// Swap buffers
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+
+			// Check if thw ESC key was pressed or the window was closed
+			Running = glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS && glfwWindowShouldClose(window) == 0;
+		}
+		ProfilerEndScope(PresentScope);
+		ProfilerEndFrame();
+		GlTraceEndFrame();
+
+		double FrameTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+		if (Options.Benchmark && Frame >= Options.WarmupFrames)
+			FrameTimesMs.push_back(FrameTimeMs);
+
+		Frame++;
+		if (Options.Frames > 0 && Frame >= Options.Frames)
+			Running = false;
+	}
+	while (Running);
+
+	// The last frames are still on their way to the encoder
+	if (Capturing)
+		FinishFrameCapture(Capture);
 
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	if (Profiling)
+	{
+		// Shutting down collects the queries still in flight, so the last frames have their GPU times too
+		ProfilerShutdown();
+		if (Options.ProfileCsvPath != NULL)
+			ProfilerWriteCsv(Options.ProfileCsvPath);
+		if (Options.ProfileTracePath != NULL)
+			ProfilerWriteChromeTrace(Options.ProfileTracePath);
 	}
 
-	// Check if thw ESC key was pressed or the window was closed
-	while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS && glfwWindowShouldClose(window) == 0);
+	if (Options.Benchmark)
+	{
+		BenchmarkReport Report;
+		Report.Scene = "cube";
+		Report.Width = WindowWidth;
+		Report.Height = WindowHeight;
+		Report.FrameTimes = ComputeFrameTimeStats(FrameTimesMs);
+		Report.Counters.push_back(std::make_pair(std::string("warmup_frames"), (double)Options.WarmupFrames));
+		Report.Counters.push_back(std::make_pair(std::string("instances"), (double)(Instanced ? Options.Instances : 1)));
+		Report.Counters.push_back(std::make_pair(std::string("animated"), Instanced && Options.Animate ? 1.0 : 0.0));
+		if (Instanced)
+		{
+			static const char* DrawModeNames[] = { "instanced", "direct", "indirect" };
+			Report.Scene = std::string("cube_") + DrawModeNames[Options.Draw];
+			int Visible = DirectDraws ? CountSceneDraws(DirectUpdate) : IndirectDraws ? ReadGpuVisibleCount(Culler) : Options.Instances;
+			Report.Counters.push_back(std::make_pair(std::string("visible_objects"), (double)Visible));
+			Report.Counters.push_back(std::make_pair(std::string("draw_calls_per_frame"), DirectDraws ? (double)Visible : 1.0));
+			Report.Counters.push_back(std::make_pair(std::string("total_objects"), (double)Options.Instances));
+			Report.Counters.push_back(std::make_pair(std::string("culled_fraction"), 1.0 - (double)Visible / Options.Instances));
+			if (IndirectDraws)
+			{
+				// Of the objects in the frustum, the share the depth of last frame's ones hid (last frame of the run)
+				int Occluded = Occlusion ? ReadGpuOccludedCount(Culler) : 0;
+				Report.Counters.push_back(std::make_pair(std::string("occlusion_culling"), Occlusion ? 1.0 : 0.0));
+				Report.Counters.push_back(std::make_pair(std::string("occluded_objects"), (double)Occluded));
+				Report.Counters.push_back(std::make_pair(std::string("occlusion_culled_fraction"), Visible + Occluded > 0 ? (double)Occluded / (Visible + Occluded) : 0.0));
+				if (Occlusion)
+					Report.Counters.push_back(std::make_pair(std::string("hiz_levels"), (double)HiZ.Levels));
+			}
+			if (DirectDraws)
+			{
+				if (Report.FrameTimes.Frames > 0)
+					Report.Counters.push_back(std::make_pair(std::string("cull_ms_mean"), CullMsTotal / Report.FrameTimes.Frames));
+				Report.Counters.push_back(std::make_pair(std::string("bvh_nodes"), (double)CullTree.Nodes.size()));
+				Report.Counters.push_back(std::make_pair(std::string("bvh_nodes_visited"), (double)SumSceneCullStats(DirectUpdate).NodesVisited));
+				Report.Counters.push_back(std::make_pair(std::string("command_lists"), (double)DirectUpdate.Lists.size()));
+			}
+			if (DirectDraws || StreamInstances)
+			{
+				// Matrices, culling and recording, what the job threads share
+				Report.Counters.push_back(std::make_pair(std::string("job_threads"), (double)JobThreadCount()));
+				if (Report.FrameTimes.Frames > 0)
+					Report.Counters.push_back(std::make_pair(std::string("cpu_update_ms_mean"), UpdateMsTotal / Report.FrameTimes.Frames));
+			}
+		}
+		// The means are over the timed frames, there are none when --frames isn't above --warmup
+		if (Report.FrameTimes.Frames > 0)
+			Report.Counters.push_back(std::make_pair(std::string("cpu_submit_ms_mean"), SubmitMsTotal / Report.FrameTimes.Frames));
+		if (StreamInstances)
+		{
+			Report.Counters.push_back(std::make_pair(std::string("stream_persistent"), InstanceStream.Persistent ? 1.0 : 0.0));
+			Report.Counters.push_back(std::make_pair(std::string("stream_fence_waits"), (double)InstanceStream.Waits));
+			Report.Counters.push_back(std::make_pair(std::string("stream_fence_wait_ms_total"), InstanceStream.TotalWaitMs));
+			Report.Counters.push_back(std::make_pair(std::string("stream_fence_wait_ms_per_frame"), InstanceStream.TotalWaitMs / InstanceStream.Frames));
+		}
+		Report.Counters.push_back(std::make_pair(std::string("cube_vertices"), (double)CubeMesh.Vertices.size()));
+		Report.Counters.push_back(std::make_pair(std::string("acmr_indexed"), (double)AcmrBefore));
+		Report.Counters.push_back(std::make_pair(std::string("acmr_optimized"), (double)AcmrAfter));
+		Report.Counters.push_back(std::make_pair(std::string("vertex_bytes"), (double)Quantization.BytesPerVertexAfter));
+		Report.Counters.push_back(std::make_pair(std::string("uniform_blocks_per_frame"), (double)Uniforms.BlocksWritten / Frame));
+		if (UseGpuMesh && !UseMeshFile)
+		{
+			Report.Counters.push_back(std::make_pair(std::string("position_max_error"), (double)Quantization.MaxPositionError));
+			Report.Counters.push_back(std::make_pair(std::string("color_max_error"), (double)Quantization.MaxColorError));
+			// Nothing stores normals yet, so the octahedral encoding is measured on random ones
+			Report.Counters.push_back(std::make_pair(std::string("octahedral_normal_max_error_deg"), (double)MeasureOctahedralError(100000)));
+		}
+		if (Capturing)
+		{
+			Report.Counters.push_back(std::make_pair(std::string("capture_sync"), Capture.Synchronous ? 1.0 : 0.0));
+			Report.Counters.push_back(std::make_pair(std::string("captured_frames"), (double)Capture.FramesCaptured));
+			Report.Counters.push_back(std::make_pair(std::string("capture_stalls"), (double)Capture.Stalls));
+			Report.Counters.push_back(std::make_pair(std::string("capture_stall_ms_total"), Capture.StallMs));
+			Report.Counters.push_back(std::make_pair(std::string("capture_encode_ms_mean"), CaptureEncodeMsPerFrame(Capture)));
+		}
+		// Program, material and VAO switches from one draw to the next, in the order the draws were recorded
+		// and in the order they were submitted (the same with --no-sort)
+		if (!IndirectDraws && Queue.Frames > 0)
+		{
+			double QueueFrames = (double)Queue.Frames;
+			Report.Counters.push_back(std::make_pair(std::string("render_queue_sorted"), Options.NoSort ? 0.0 : 1.0));
+			Report.Counters.push_back(std::make_pair(std::string("render_packets_per_frame"), Queue.TotalSorted.Packets / QueueFrames));
+			if (Report.FrameTimes.Frames > 0)
+				Report.Counters.push_back(std::make_pair(std::string("sort_ms_mean"), SortMsTotal / Report.FrameTimes.Frames));
+			Report.Counters.push_back(std::make_pair(std::string("program_changes_unsorted_per_frame"), Queue.TotalUnsorted.ProgramChanges / QueueFrames));
+			Report.Counters.push_back(std::make_pair(std::string("program_changes_sorted_per_frame"), Queue.TotalSorted.ProgramChanges / QueueFrames));
+			Report.Counters.push_back(std::make_pair(std::string("vertex_array_changes_unsorted_per_frame"), Queue.TotalUnsorted.VertexArrayChanges / QueueFrames));
+			Report.Counters.push_back(std::make_pair(std::string("vertex_array_changes_sorted_per_frame"), Queue.TotalSorted.VertexArrayChanges / QueueFrames));
+			Report.Counters.push_back(std::make_pair(std::string("state_changes_unsorted_per_frame"),
+				(Queue.TotalUnsorted.ProgramChanges + Queue.TotalUnsorted.MaterialChanges + Queue.TotalUnsorted.VertexArrayChanges) / QueueFrames));
+			Report.Counters.push_back(std::make_pair(std::string("state_changes_sorted_per_frame"),
+				(Queue.TotalSorted.ProgramChanges + Queue.TotalSorted.MaterialChanges + Queue.TotalSorted.VertexArrayChanges) / QueueFrames));
+			Report.Counters.push_back(std::make_pair(std::string("frame_arena_bytes"), (double)PacketArena.HighWater));
+			// What the LODs saved: triangles actually drawn, and how many draws each LOD got
+			Report.Counters.push_back(std::make_pair(std::string("lod_count"), (double)MeshLodCount));
+			Report.Counters.push_back(std::make_pair(std::string("lod_error_pixels"), (double)Options.LodError));
+			Report.Counters.push_back(std::make_pair(std::string("triangles_per_frame"), TrianglesTotal / QueueFrames));
+			for (int Lod = 0; Lod < MeshLodCount; Lod++)
+			{
+				char Name[32];
+				snprintf(Name, sizeof(Name), "lod%d_draws_per_frame", Lod);
+				Report.Counters.push_back(std::make_pair(std::string(Name), LodDraws[Lod] / QueueFrames));
+			}
+		}
+		// What the resource manager holds at the end of the run, to spot leaks and churn
+		GpuResourceStats BufferStats = GetGpuResourceStats(GpuResourceBuffer);
+		Report.Counters.push_back(std::make_pair(std::string("gpu_buffers_live"), (double)BufferStats.Live));
+		Report.Counters.push_back(std::make_pair(std::string("gpu_buffer_mb"), BufferStats.Bytes / (1024.0 * 1024.0)));
+		Report.Counters.push_back(std::make_pair(std::string("gpu_buffer_peak_mb"), BufferStats.PeakBytes / (1024.0 * 1024.0)));
+		Report.Counters.push_back(std::make_pair(std::string("gpu_vertex_arrays_live"), (double)GetGpuResourceStats(GpuResourceVertexArray).Live));
+		Report.Counters.push_back(std::make_pair(std::string("gpu_programs_live"), (double)GetGpuResourceStats(GpuResourceProgram).Live));
+		long long ObjectsCreated = 0;
+		for (int Type = 0; Type < NumGpuResourceTypes; Type++)
+			ObjectsCreated += GetGpuResourceStats((GpuResourceType)Type).Created;
+		Report.Counters.push_back(std::make_pair(std::string("gpu_objects_created"), (double)ObjectsCreated));
+		// Over the whole run, warm-up included, since the first frame is the only one that really binds anything
+		StateCacheCounters StateCalls = StateCacheTotalCounters();
+		Report.Counters.push_back(std::make_pair(std::string("state_calls_issued_per_frame"), (double)StateCalls.Issued / Frame));
+		Report.Counters.push_back(std::make_pair(std::string("state_calls_elided_per_frame"), (double)StateCalls.Elided / Frame));
+		WriteBenchmarkJson(Options.JsonPath, Report);
+	}
 
 	// Cleanup VBO and Shader
-	glDeleteBuffers(1, &vertexBuffer);
-	glDeleteProgram(programID);
-	glDeleteVertexArrays(1, &VertexArrayId);
+	if (UseGpuMesh)
+		DestroyGpuMesh(LoadedMesh);
+	CubeVertices.Reset();
+	CubeIndices.Reset();
+	if (Instanced)
+	{
+		if (StreamInstances)
+			DestroyStreamBuffer(InstanceStream);
+		else
+			InstanceMatrices.Reset();
+		InstancedVertexArray.Reset();
+		DestroyTransformBatch(Instances);
+	}
+	DestroyUniformRing(Uniforms);
+	if (IndirectDraws)
+		DestroyGpuCuller(Culler);
+	if (Occlusion)
+		DestroyHiZBuffer(HiZ);
+	StopShaderWatcher();
+	StopJobSystem();
+	if (Capturing)
+		DestroyFrameCapture(Capture);
+	DestroyFrameArena(PacketArena);
+	OctahedronVertices.Reset();
+	OctahedronIndices.Reset();
+	OctahedronVertexArray.Reset();
+	FlatProgram.Reset();
+	ReleaseReloadableProgram(Program);
+	VertexArray.Reset();
+	// Deletes what's still pending, anything it reports was forgotten above
+	ShutdownGpuResources();
+	StopGlTrace();
 
-	// Close OpenGL window and terminate GLFW
-	glfwTerminate();
+	// Close OpenGL window and terminate GLFW (or the offscreen context)
+	if (Options.Headless)
+		DestroyHeadlessContext();
+	else
+		glfwTerminate();
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Benchmark.hpp"
+
+// Nearest-rank percentile of an already sorted list
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+	size_t Rank = (size_t)(p * sorted.size() + 0.999999);
+	if (Rank < 1) {
+		Rank = 1;
+	}
+	if (Rank > sorted.size()) {
+		Rank = sorted.size();
+	}
+	return sorted[Rank - 1];
+}
+
+FrameTimeStats ComputeFrameTimeStats(std::vector<double> frameTimesMs)
+{
+	FrameTimeStats Stats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (frameTimesMs.empty()) {
+		return Stats;
+	}
+
+	std::sort(frameTimesMs.begin(), frameTimesMs.end());
+
+	double Sum = 0.0;
+	for (size_t i = 0; i < frameTimesMs.size(); i++) {
+		Sum += frameTimesMs[i];
+	}
+
+	Stats.Frames = (int)frameTimesMs.size();
+	Stats.MinMs = frameTimesMs.front();
+	Stats.MedianMs = Percentile(frameTimesMs, 0.5);
+	Stats.P99Ms = Percentile(frameTimesMs, 0.99);
+	Stats.MaxMs = frameTimesMs.back();
+	Stats.MeanMs = Sum / frameTimesMs.size();
+	return Stats;
+}
+
+bool WriteBenchmarkJson(const char* path, const BenchmarkReport& report)
+{
+	FILE* Out = stdout;
+	if (path != NULL) {
+		Out = fopen(path, "w");
+		if (Out == NULL) {
+			fprintf(stderr, "Impossible to open %s to write the benchmark results\n", path);
+			return false;
+		}
+	}
+
+	fprintf(Out, "{\n");
+	fprintf(Out, "  \"scene\": \"%s\",\n", report.Scene.c_str());
+	fprintf(Out, "  \"width\": %d,\n", report.Width);
+	fprintf(Out, "  \"height\": %d,\n", report.Height);
+	fprintf(Out, "  \"frames\": %d,\n", report.FrameTimes.Frames);
+	fprintf(Out, "  \"frame_time_ms\": {\n");
+	fprintf(Out, "    \"min\": %.4f,\n", report.FrameTimes.MinMs);
+	fprintf(Out, "    \"median\": %.4f,\n", report.FrameTimes.MedianMs);
+	fprintf(Out, "    \"p99\": %.4f,\n", report.FrameTimes.P99Ms);
+	fprintf(Out, "    \"max\": %.4f,\n", report.FrameTimes.MaxMs);
+	fprintf(Out, "    \"mean\": %.4f\n", report.FrameTimes.MeanMs);
+	fprintf(Out, "  }%s\n", report.Counters.empty() ? "" : ",");
+	if (!report.Counters.empty()) {
+		fprintf(Out, "  \"counters\": {\n");
+		for (size_t i = 0; i < report.Counters.size(); i++) {
+			fprintf(Out, "    \"%s\": %.6g%s\n", report.Counters[i].first.c_str(), report.Counters[i].second, i + 1 < report.Counters.size() ? "," : "");
+		}
+		fprintf(Out, "  }\n");
+	}
+	fprintf(Out, "}\n");
+
+	if (Out != stdout) {
+		fclose(Out);
+	}
+	return true;
+}
@@ -0,0 +1,45 @@
+// Generated by tools/EmbedShaders.py from the files in shaders/, don't edit it by hand.
+#ifndef EMBEDDED_SHADERS_HPP
+#define EMBEDDED_SHADERS_HPP
+
+#include <string_view>
+
+struct EmbeddedShader
+{
+	std::string_view Name;
+	std::string_view Source;
+};
+
+inline constexpr EmbeddedShader EmbeddedShaders[] = {
+	{ "shaders/SimpleFragmentShader.fragmentshader",
+		R"SHADER(#version 330 core
+
+out vec3 color;
+
+void main() {
+	color = vec3(1,0,0);
+})SHADER" },
+	{ "shaders/SimpleVertexShader.vertexshader",
+		R"SHADER(#version 330 core
+
+layout(location = 0) in vec3 vertexPosition_modelspace;
+
+void main() {
+	gl_Position.xyz = vertexPosition_modelspace;
+	gl_Position.w = 1.0;
+})SHADER" },
+	{ std::string_view(), std::string_view() } // Keeps the array valid when there's no shader at all
+};
+
+// Returns NULL when there's no shader with that name
+constexpr const EmbeddedShader* FindEmbeddedShader(std::string_view name)
+{
+	for (const EmbeddedShader& Shader : EmbeddedShaders) {
+		if (!Shader.Name.empty() && Shader.Name == name) {
+			return &Shader;
+		}
+	}
+	return nullptr;
+}
+
+#endif
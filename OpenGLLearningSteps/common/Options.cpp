@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Options.hpp"
+
+// Frames rendered when running without a window and no --frames was given, since there's no ESC key to stop
+static const int DefaultHeadlessFrames = 300;
+static const int DefaultBenchmarkFrames = 1000;
+static const int DefaultWarmupFrames = 10;
+
+static void PrintUsage(const char* program)
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --headless      render offscreen (EGL), without opening a window\n");
+	printf("  --benchmark     render a fixed number of frames headless and print frame times as JSON\n");
+	printf("  --frames N      number of frames to render (default: until closed, %d headless, %d benchmark)\n", DefaultHeadlessFrames, DefaultBenchmarkFrames);
+	printf("  --warmup N      frames left out of the benchmark stats (default: %d)\n", DefaultWarmupFrames);
+	printf("  --json FILE     write the benchmark results to FILE instead of stdout\n");
+}
+
+bool ParseOptions(int argc, char** argv, AppOptions& options)
+{
+	options.Headless = false;
+	options.Benchmark = false;
+	options.Frames = 0;
+	options.WarmupFrames = DefaultWarmupFrames;
+	options.JsonPath = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		bool HasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--headless") == 0) {
+			options.Headless = true;
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0) {
+			options.Benchmark = true;
+			options.Headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && HasValue) {
+			options.Frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && HasValue) {
+			options.WarmupFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--json") == 0 && HasValue) {
+			options.JsonPath = argv[++i];
+		}
+		else {
+			fprintf(stderr, "Unknown or incomplete option: %s\n", argv[i]);
+			PrintUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (options.Frames < 0 || options.WarmupFrames < 0) {
+		fprintf(stderr, "--frames and --warmup can't be negative\n");
+		return false;
+	}
+
+	if (options.Frames == 0 && options.Headless) {
+		options.Frames = options.Benchmark ? DefaultBenchmarkFrames : DefaultHeadlessFrames;
+	}
+
+	return true;
+}
@@ -0,0 +1,17 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+// Command line options shared by the render loop and the benchmark runner
+struct AppOptions
+{
+	bool Headless;			// --headless: render offscreen with EGL, no window needed
+	bool Benchmark;			// --benchmark: time every frame and print the stats as JSON (implies --headless)
+	int Frames;				// --frames N: frames to render, 0 renders until the window is closed
+	int WarmupFrames;		// --warmup N: first frames left out of the stats
+	const char* JsonPath;	// --json FILE: where the benchmark results go, stdout if not given
+};
+
+// Fills options from argv. Prints the usage and returns false on a bad or unknown argument.
+bool ParseOptions(int argc, char** argv, AppOptions& options);
+
+#endif
@@ -2,6 +2,8 @@
 // A thing to remember: always include the "opengl32.lib" on the linker, otherwise OpenGL functions won't work.
 #include <stdio.h>
 #include <stdlib.h>
+#include <vector>
+#include <chrono>
 
 // Include GLEW, but always before gl.h and glfw3.h
 // Another thing to remember: When installing GLEW, you should copy the "glew32.dll" to the "%SystemRoot%/system32" folder,
@@ -16,47 +18,89 @@
 
 //include the shader loading function
 #include "common/Shader.hpp"
+// Include the offscreen rendering and the benchmark runner
+#include "common/Headless.hpp"
+#include "common/Benchmark.hpp"
+#include "common/Options.hpp"
 
 GLFWwindow* window; // (In the Accompanying source code, this variable is global for simplicity)
 
-int main() 
+// Same size for the window and the offscreen framebuffer, so both modes render the same amount of pixels
+static const int WindowWidth = 1024;
+static const int WindowHeight = 768;
+
+int main(int argc, char** argv) 
 {
-	// Initializing GLFW
-	glewExperimental = true; // This is needed for core profile
-	if (!glfwInit())
+	AppOptions Options;
+	if (!ParseOptions(argc, argv, Options))
 	{
-		fprintf(stderr, "Failed to initialize GLFW\n");
 		return -1;
 	}
 
-	// Creating the first window
-	glfwWindowHint(GLFW_SAMPLES, 4); // I'm using 4x Antialiasing
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // I want to use OpenGL 3.3
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // This indicates that the OpenGL version is 3.3. If MAJOR was 4 and MINOR 6, I'd be using OpenGL 4.6
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // This should not be needed, it's just to make Mac OS happy
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Since I'm not using old OpenGL, I'll use Core Profile
-
-	// Open a Window and create its OpenGL context
-	window = glfwCreateWindow(1024, 768, "Tutorial 1", NULL, NULL); // To create a window use this method and pass width, height and window label. The other two params are null
-	if (window == NULL)
+	if (Options.Headless)
 	{
-		fprintf(stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials \n");
-		glfwTerminate(); // Kills the current instance of GLFW
-		return -1;
+		// No window at all: an EGL context draws into an offscreen framebuffer instead
+		window = NULL;
+		if (!CreateHeadlessContext())
+		{
+			return -1;
+		}
+	}
+	else
+	{
+		// Initializing GLFW
+		glewExperimental = true; // This is needed for core profile
+		if (!glfwInit())
+		{
+			fprintf(stderr, "Failed to initialize GLFW\n");
+			return -1;
+		}
+
+		// Creating the first window
+		glfwWindowHint(GLFW_SAMPLES, 4); // I'm using 4x Antialiasing
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // I want to use OpenGL 3.3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // This indicates that the OpenGL version is 3.3. If MAJOR was 4 and MINOR 6, I'd be using OpenGL 4.6
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // This should not be needed, it's just to make Mac OS happy
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Since I'm not using old OpenGL, I'll use Core Profile
+
+		// Open a Window and create its OpenGL context
+		window = glfwCreateWindow(WindowWidth, WindowHeight, "Tutorial 1", NULL, NULL); // To create a window use this method and pass width, height and window label. The other two params are null
+		if (window == NULL)
+		{
+			fprintf(stderr, "Failed to open GLFW window. If you have an Intel GPU, they are not 3.3 compatible. Try the 2.1 version of the tutorials \n");
+			glfwTerminate(); // Kills the current instance of GLFW
+			return -1;
+		}
+		glfwMakeContextCurrent(window); 
 	}
-	glfwMakeContextCurrent(window); 
 	
 	// Initialize GLEW
 	glewExperimental = true; // Needed in core profile
-	if (glewInit() != GLEW_OK)
+	GLenum GlewError = glewInit();
+	// GLEW built for GLX complains there's no X display on an EGL context, but the GL functions are loaded by then
+	if (GlewError != GLEW_OK && !(Options.Headless && GlewError == GLEW_ERROR_NO_GLX_DISPLAY))
 	{
 		fprintf(stderr, "failed to initialize GLEW\n");
-		glfwTerminate();
+		if (Options.Headless)
+			DestroyHeadlessContext();
+		else
+			glfwTerminate();
 		return -1;
 	}
 
-	// Ensure we can capture the escape key being pressed below
-	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+	if (Options.Headless)
+	{
+		if (!CreateHeadlessFramebuffer(WindowWidth, WindowHeight))
+		{
+			DestroyHeadlessContext();
+			return -1;
+		}
+	}
+	else
+	{
+		// Ensure we can capture the escape key being pressed below
+		glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+	}
 
 	// Set the background as a dark blue color
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
@@ -87,8 +131,17 @@ int main()
 	// Create abd Compile our GLSL program from the shaders
 	GLuint programID = LoadShaders("shaders/SimpleVertexShader.vertexshader", "shaders/SimpleFragmentShader.fragmentshader");
 
+	// Frame times of the benchmark run, reserved up front so recording them doesn't allocate inside the loop
+	std::vector<double> FrameTimesMs;
+	if (Options.Benchmark)
+		FrameTimesMs.reserve(Options.Frames);
+
+	int Frame = 0;
+	bool Running = true;
 	do 
 	{
+		std::chrono::steady_clock::time_point FrameStart = std::chrono::steady_clock::now();
+
 		// Clear the screen. It's not mentioned before Tutorial 02, but it can cause flilckering, so it's there nonetheless
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -111,16 +164,51 @@ int main()
 		glDrawArrays(GL_TRIANGLES, 0, 3); // Starting from vertex 0; 3 vertices total -> 1 triangle
 		glDisableVertexAttribArray(0);
 
-		// Swap buffers
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		if (Options.Headless)
+		{
+			// Nothing to present, so wait for the frame to actually finish or we'd only be timing the command submission
+			glFinish();
+		}
+		else
+		{
+			// Swap buffers
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+
+			// Check if thw ESC key was pressed or the window was closed
+			Running = glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS && glfwWindowShouldClose(window) == 0;
+		}
+
+		double FrameTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+		if (Options.Benchmark && Frame >= Options.WarmupFrames)
+			FrameTimesMs.push_back(FrameTimeMs);
+
+		Frame++;
+		if (Options.Frames > 0 && Frame >= Options.Frames)
+			Running = false;
 	} 
-	
-	// Check if thw ESC key was pressed or the window was closed
-	while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS && glfwWindowShouldClose(window) == 0);
+	while (Running);
 
+	if (Options.Benchmark)
+	{
+		BenchmarkReport Report;
+		Report.Scene = "triangle";
+		Report.Width = WindowWidth;
+		Report.Height = WindowHeight;
+		Report.FrameTimes = ComputeFrameTimeStats(FrameTimesMs);
+		Report.Counters.push_back(std::make_pair(std::string("warmup_frames"), (double)Options.WarmupFrames));
+		WriteBenchmarkJson(Options.JsonPath, Report);
+	}
 
-	// Close OpenGL window and terminate GLFW
-	glfwTerminate();
+	// Cleanup VBO and Shader
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteProgram(programID);
+	glDeleteVertexArrays(1, &VertexArrayId);
+
+	// Close OpenGL window and terminate GLFW (or the offscreen context)
+	if (Options.Headless)
+		DestroyHeadlessContext();
+	else
+		glfwTerminate();
 
 }
\ No newline at end of file
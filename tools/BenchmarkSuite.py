@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+# Runs the startup and per-frame benchmarks of the cube on a software GL context (Mesa's llvmpipe, headless)
+# and compares them with a stored baseline:
+#
+#   python3 tools/BenchmarkSuite.py <cube executable> [--baseline FILE] [--output FILE] [--update-baseline]
+#
+# The cases are the ones of --bench-hot-paths (LoadShaders() and its steps, buffer uploads, MVP composition)
+# plus cube_frame, the frame time of the plain --benchmark scene. Each is run --repeat times, and what's
+# compared is the median of the medians of the runs.
+#
+# A case regressed when its median is more than --threshold slower than the baseline AND the difference is
+# bigger than --noise times how much the medians of the runs move around (run_mad: their median absolute
+# deviation, the larger of the baseline's and this one's) and than --min-diff, so a case that's just noisy,
+# or too short for the clock, doesn't fail. Exits with 1 on a regression, so it
+# can gate a build.
+#
+# Timings only compare on the same machine and renderer: the baseline in the repo was made on llvmpipe,
+# with a single CPU core. Make your own with --update-baseline before relying on it.
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+CUBE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "OpenGLLearningSteps 2 - Cube")
+DEFAULT_BASELINE = os.path.join(CUBE_DIR, "benchmarks", "baseline-linux-llvmpipe.json")
+
+
+def parse_args(argv):
+    args = {
+        "executable": None,
+        "baseline": DEFAULT_BASELINE,
+        "output": None,
+        "update_baseline": False,
+        "samples": 50,
+        "frames": 300,
+        "warmup": 10,
+        "repeat": 5,
+        "threshold": 0.10,
+        "noise": 3.0,
+        "min_diff": 0.01,
+        "hardware": False,
+    }
+    values = {"--baseline": ("baseline", str), "--output": ("output", str), "--samples": ("samples", int),
+              "--frames": ("frames", int), "--warmup": ("warmup", int), "--repeat": ("repeat", int),
+              "--threshold": ("threshold", float), "--noise": ("noise", float), "--min-diff": ("min_diff", float)}
+    i = 0
+    while i < len(argv):
+        arg = argv[i]
+        if arg in values and i + 1 < len(argv):
+            name, convert = values[arg]
+            args[name] = convert(argv[i + 1])
+            i += 2
+            continue
+        if arg == "--update-baseline":
+            args["update_baseline"] = True
+        elif arg == "--hardware":
+            args["hardware"] = True
+        elif args["executable"] is None and not arg.startswith("--"):
+            args["executable"] = os.path.abspath(arg)
+        else:
+            return None
+        i += 1
+    return args if args["executable"] is not None and args["repeat"] > 0 else None
+
+
+def usage():
+    print("usage: BenchmarkSuite.py <cube executable> [options]")
+    print("  --baseline FILE     baseline to compare with (default: %s)" % os.path.relpath(DEFAULT_BASELINE))
+    print("  --output FILE       also write the results there, in the baseline format")
+    print("  --update-baseline   write the results as the new baseline instead of comparing")
+    print("  --samples N         samples of each --bench-hot-paths case per run (default: 50)")
+    print("  --frames N          frames of the cube scene per run (default: 300)")
+    print("  --warmup N          untimed samples and frames first (default: 10)")
+    print("  --repeat N          runs of everything, the median of their medians is kept (default: 5)")
+    print("  --threshold X       slowdown that counts as a regression, 0.10 is 10% (default: 0.10)")
+    print("  --noise X           and it has to be more than X median absolute deviations (default: 3)")
+    print("  --min-diff MS       and more than MS milliseconds (default: 0.01)")
+    print("  --hardware          use the GPU driver instead of forcing llvmpipe")
+
+
+def run_json(executable, options, env):
+    # stdout has the shader logs, the results go through --json
+    with tempfile.TemporaryDirectory() as temp:
+        path = os.path.join(temp, "results.json")
+        result = subprocess.run([executable] + options + ["--json", path], cwd=CUBE_DIR, env=env,
+                                stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, universal_newlines=True)
+        if result.returncode != 0 or not os.path.exists(path):
+            sys.stderr.write(result.stderr)
+            raise RuntimeError("%s %s failed" % (os.path.basename(executable), " ".join(options)))
+        with open(path) as f:
+            return json.load(f)
+
+
+def run_suite(args):
+    env = dict(os.environ)
+    if not args["hardware"]:
+        env["LIBGL_ALWAYS_SOFTWARE"] = "1"
+    # Mesa's own shader cache would turn every compile after the first run into a lookup
+    env["MESA_SHADER_CACHE_DISABLE"] = "true"
+
+    runs = {}
+    renderer = None
+    for r in range(args["repeat"]):
+        print("Run %d of %d" % (r + 1, args["repeat"]))
+        hot = run_json(args["executable"], ["--bench-hot-paths", str(args["samples"]), "--warmup", str(args["warmup"])], env)
+        renderer = hot["renderer"]
+        for case in hot["cases"]:
+            runs.setdefault(case["name"], []).append((case["samples"], case["time_ms"]))
+        frame = run_json(args["executable"], ["--benchmark", "--frames", str(args["frames"]), "--warmup", str(args["warmup"])], env)
+        runs.setdefault("cube_frame", []).append((frame["frames"], frame["frame_time_ms"]))
+
+    cases = []
+    for name, results in runs.items():
+        times = [t for _, t in results]
+        median = statistics.median(t["median"] for t in times)
+        cases.append({
+            "name": name,
+            "samples": sum(n for n, _ in results),
+            "time_ms": {
+                "min": min(t["min"] for t in times),
+                "median": median,
+                "p99": statistics.median(t["p99"] for t in times),
+                "max": max(t["max"] for t in times),
+                "mean": statistics.mean(t["mean"] for t in times),
+                # The spread of the samples inside a run, then the one of the runs themselves
+                "mad": statistics.median(t["mad"] for t in times),
+                "run_mad": statistics.median(abs(t["median"] - median) for t in times),
+            },
+        })
+    return {"renderer": renderer, "cases": cases}
+
+
+def compare(results, baseline, threshold, noise, min_diff):
+    if baseline["renderer"] != results["renderer"]:
+        print("Warning: the baseline was made on %s, this run is on %s" % (baseline["renderer"], results["renderer"]))
+    current = dict((c["name"], c["time_ms"]) for c in results["cases"])
+    regressions = 0
+    print("%-22s %12s %12s %9s" % ("case", "baseline ms", "now ms", "change"))
+    for case in baseline["cases"]:
+        name = case["name"]
+        if name not in current:
+            print("%-22s %12.4f %12s" % (name, case["time_ms"]["median"], "missing"))
+            regressions += 1
+            continue
+        before, now = case["time_ms"], current[name]
+        change = now["median"] / before["median"] - 1.0 if before["median"] > 0 else 0.0
+        spread = max(noise * max(before.get("run_mad", 0.0), now.get("run_mad", 0.0)), min_diff)
+        verdict = ""
+        if change > threshold and now["median"] - before["median"] > spread:
+            verdict = "REGRESSION"
+            regressions += 1
+        elif change < -threshold and before["median"] - now["median"] > spread:
+            verdict = "faster"
+        print("%-22s %12.4f %12.4f %+8.1f%% %s" % (name, before["median"], now["median"], change * 100.0, verdict))
+    for name in current:
+        if not any(c["name"] == name for c in baseline["cases"]):
+            print("%-22s %12s %12.4f  (not in the baseline)" % (name, "", current[name]["median"]))
+    return regressions
+
+
+def main():
+    args = parse_args(sys.argv[1:])
+    if args is None:
+        usage()
+        return 2
+
+    try:
+        results = run_suite(args)
+    except RuntimeError as error:
+        print(error)
+        return 2
+
+    if args["output"] is not None:
+        with open(args["output"], "w") as f:
+            json.dump(results, f, indent=2)
+    if args["update_baseline"]:
+        os.makedirs(os.path.dirname(os.path.abspath(args["baseline"])), exist_ok=True)
+        with open(args["baseline"], "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+        print("Wrote the baseline %s" % args["baseline"])
+        return 0
+
+    if not os.path.exists(args["baseline"]):
+        print("No baseline at %s, make one with --update-baseline" % args["baseline"])
+        return 2
+    with open(args["baseline"]) as f:
+        baseline = json.load(f)
+    regressions = compare(results, baseline, args["threshold"], args["noise"], args["min_diff"])
+    print("%d regression%s" % (regressions, "" if regressions == 1 else "s"))
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+# Turns every file in a shaders folder into a constexpr std::string_view, so the program
+# can start without touching the disk. Run by the pre-build step of both Visual Studio projects:
+#
+#   python tools/EmbedShaders.py <project>/shaders <project>/common/EmbeddedShaders.hpp
+#
+# The header is only rewritten when something changed, so an unchanged build doesn't recompile Shader.cpp.
+import os
+import sys
+
+# MSVC refuses string literals longer than 16380 bytes, longer shaders are split into adjacent literals
+CHUNK_SIZE = 8000
+
+
+def raw_literal(text):
+    # Pick a delimiter that doesn't show up in the source
+    delimiter = "SHADER"
+    while ")" + delimiter + '"' in text:
+        delimiter += "_"
+    chunks = [text[i:i + CHUNK_SIZE] for i in range(0, len(text), CHUNK_SIZE)] or [""]
+    return "\n\t\t".join('R"%s(%s)%s"' % (delimiter, chunk, delimiter) for chunk in chunks)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: EmbedShaders.py <shaders folder> <output header>")
+        return 1
+
+    shaders_dir, output_path = sys.argv[1], sys.argv[2]
+    # Shaders are registered under the same path LoadShaders() is given, e.g. "shaders/ColorFragmentShader.fragmentshader"
+    prefix = os.path.basename(os.path.normpath(shaders_dir))
+
+    entries = []
+    for name in sorted(os.listdir(shaders_dir)):
+        path = os.path.join(shaders_dir, name)
+        if not os.path.isfile(path):
+            continue
+        with open(path, "r", encoding="utf-8", newline="") as f:
+            source = f.read().replace("\r\n", "\n")
+        entries.append('\t{ "%s/%s",\n\t\t%s },\n' % (prefix, name, raw_literal(source)))
+
+    header = (
+        "// Generated by tools/EmbedShaders.py from the files in %s/, don't edit it by hand.\n"
+        "#ifndef EMBEDDED_SHADERS_HPP\n"
+        "#define EMBEDDED_SHADERS_HPP\n"
+        "\n"
+        "#include <string_view>\n"
+        "\n"
+        "struct EmbeddedShader\n"
+        "{\n"
+        "\tstd::string_view Name;\n"
+        "\tstd::string_view Source;\n"
+        "};\n"
+        "\n"
+        "inline constexpr EmbeddedShader EmbeddedShaders[] = {\n"
+        "%s"
+        "\t{ std::string_view(), std::string_view() } // Keeps the array valid when there's no shader at all\n"
+        "};\n"
+        "\n"
+        "// Returns NULL when there's no shader with that name\n"
+        "constexpr const EmbeddedShader* FindEmbeddedShader(std::string_view name)\n"
+        "{\n"
+        "\tfor (const EmbeddedShader& Shader : EmbeddedShaders) {\n"
+        "\t\tif (!Shader.Name.empty() && Shader.Name == name) {\n"
+        "\t\t\treturn &Shader;\n"
+        "\t\t}\n"
+        "\t}\n"
+        "\treturn nullptr;\n"
+        "}\n"
+        "\n"
+        "#endif\n"
+    ) % (prefix, "".join(entries))
+
+    try:
+        with open(output_path, "r", encoding="utf-8", newline="") as f:
+            if f.read() == header:
+                return 0
+    except OSError:
+        pass
+
+    with open(output_path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(header)
+    print("Embedded %d shaders into %s" % (len(entries), output_path))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())